@@ -443,6 +443,17 @@ namespace beam
 
 			bool IsValid(const void* pInput, uint32_t nSizeInput) const;
 
+			struct BatchItem
+			{
+				const PoW* m_pPoW;
+				const void* m_pInput;
+				uint32_t m_nSizeInput;
+				bool m_bValid; // out
+			};
+
+			// verifies all the items, spread across nThreads (0 - all the cores)
+			static void IsValidBatch(BatchItem*, size_t nCount, uint32_t nThreads = 0);
+
 			using Cancel = std::function<bool(bool bRetrying)>;
 			// Difficulty and Nonce must be initialized. During the solution it's incremented each time by 1.
 			// returns false only if cancelled
@@ -821,7 +832,7 @@ namespace beam
 		void Create(ISource&, const SystemState::Full& sRoot);
 		bool IsValid(SystemState::Full* pTip = NULL) const;
 		bool Crop(); // according to current bound
-		bool Crop(const ChainWorkProof& src);
+		bool Crop(const ChainWorkProof& src); // src is assumed to be trusted, its PoW isn't re-verified
 		bool IsEmpty() const { return m_Heading.m_vElements.empty(); }
 
 		template <typename Archive>
@@ -838,7 +849,8 @@ namespace beam
 
 	private:
 		struct Sampler;
-		bool IsValidInternal(size_t& iState, size_t& iHash, const Difficulty::Raw& lowerBound, SystemState::Full* pTip) const;
+		bool IsValidInternal(size_t& iState, size_t& iHash, const Difficulty::Raw& lowerBound, SystemState::Full* pTip) const; // PoW is not verified
+		bool IsValidPoW() const; // all the included headers, in parallel
 		void ZeroInit();
 	};
 
@@ -195,7 +195,58 @@ namespace beam
 		return
 			IsValidInternal(iState, iHash, m_LowerBound, pTip) &&
 			(m_vArbitraryStates.size() + m_Heading.m_vElements.size() == iState) &&
-			(m_Proof.m_vData.size() == iHash);
+			(m_Proof.m_vData.size() == iHash) &&
+			IsValidPoW(); // the most expensive part, do it last
+	}
+
+	bool Block::ChainWorkProof::IsValidPoW() const
+	{
+		if (Rules::get().FakePoW)
+			return true;
+
+		// expand the heading, the arbitrary states are used as-is
+		std::vector<SystemState::Full> vHeading(m_Heading.m_vElements.size());
+		for (size_t i = 0; i < vHeading.size(); i++)
+		{
+			SystemState::Full& s = vHeading[i];
+			if (i)
+			{
+				s = vHeading[i - 1];
+				s.NextPrefix();
+			}
+			else
+				Cast::Down<SystemState::Sequence::Prefix>(s) = m_Heading.m_Prefix;
+
+			Cast::Down<SystemState::Sequence::Element>(s) = m_Heading.m_vElements[vHeading.size() - i - 1];
+			if (i)
+				s.m_ChainWork += s.m_PoW.m_Difficulty;
+		}
+
+		size_t nCount = vHeading.size() + m_vArbitraryStates.size();
+		if (!nCount)
+			return true;
+
+		std::vector<Merkle::Hash> vHashes(nCount);
+		std::vector<PoW::BatchItem> vItems(nCount);
+
+		for (size_t i = 0; i < nCount; i++)
+		{
+			const SystemState::Full& s = (i < vHeading.size()) ? vHeading[i] : m_vArbitraryStates[i - vHeading.size()];
+			s.get_HashForPoW(vHashes[i]);
+
+			PoW::BatchItem& x = vItems[i];
+			x.m_pPoW = &s.m_PoW;
+			x.m_pInput = vHashes[i].m_pData;
+			x.m_nSizeInput = vHashes[i].nBytes;
+		}
+
+		PoW::IsValidBatch(&vItems.front(), nCount);
+
+		for (size_t i = 0; i < nCount; i++)
+			if (!vItems[i].m_bValid)
+				return false;
+
+		return true;
 	}
 
 	template <typename T> void CopyCroppedVector(std::vector<T>& dst, const std::vector<T>& src)
@@ -270,7 +321,7 @@ namespace beam
 
 		for (size_t i = m_Heading.m_vElements.size() - 1; ; )
 		{
-			if (!(s.IsValid()))
+			if (!(s.IsSane()))
 				return false;
 
 			if (!i--)
@@ -284,7 +335,7 @@ namespace beam
 		for (size_t i = 0; i < m_vArbitraryStates.size(); i++)
 		{
 			const Block::SystemState::Full& s2 = m_vArbitraryStates[i];
-			if (!(s2.IsValid()))
+			if (!(s2.IsSane()))
 				return false;
 		}
 
@@ -82,8 +82,11 @@ void FlyClient::NetworkStd::Connection::ResetVars()
 {
     ZeroObject(m_Tip);
     m_LoginFlags = 0;
+    m_LoginExtFlags = 0;
     m_Flags = 0;
     m_NodeID = Zero;
+    m_nBatch = 0;
+    m_vBatchesSent.clear();
 }
 
 void FlyClient::NetworkStd::Connection::ResetInternal()
@@ -108,7 +111,7 @@ void FlyClient::NetworkStd::Connection::OnConnectedSecure()
 {
     Login msg;
     msg.m_CfgChecksum = Rules::get().Checksum;
-    msg.m_Flags = LoginFlags::MiningFinalization | LoginFlags::Extension1;
+    msg.m_Flags = LoginFlags::MiningFinalization | LoginFlags::Extension1 | LoginFlags::Extended;
     Send(msg);
 
     if (!(Flags::ReportedConnected & m_Flags))
@@ -231,7 +234,19 @@ void FlyClient::NetworkStd::Connection::OnMsg(Login&& msg)
     VerifyCfg(msg);
 
     m_LoginFlags = msg.m_Flags;
-    AssignRequests();
+
+    if (LoginFlags::Extended & m_LoginFlags)
+    {
+        // we don't accept any of the extended capabilities. The requests are assigned once the node tells its own
+        LoginExt msgOut;
+        msgOut.m_Flags = 0;
+        Send(msgOut);
+    }
+    else
+    {
+        m_LoginExtFlags = 0;
+        AssignRequests();
+    }
 
     if (LoginFlags::Bbs & m_LoginFlags)
         for (BbsSubscriptions::const_iterator it = m_This.m_BbsSubscriptions.begin(); m_This.m_BbsSubscriptions.end() != it; it++)
@@ -244,6 +259,12 @@ void FlyClient::NetworkStd::Connection::OnMsg(Login&& msg)
         }
 }
 
+void FlyClient::NetworkStd::Connection::OnMsg(LoginExt&& msg)
+{
+    m_LoginExtFlags = msg.m_Flags;
+    AssignRequests();
+}
+
 void FlyClient::NetworkStd::Connection::OnMsg(NewTip&& msg)
 {
 	if (msg.m_Description.m_Height < Rules::HeightGenesis)
@@ -581,7 +602,20 @@ void FlyClient::NetworkStd::PostRequestInternal(Request& r)
     m_lst.push_back(*pNode);
     pNode->m_pRequest = &r;
 
-    OnNewRequests();
+    switch (r.get_Type())
+    {
+    case Request::Type::Kernel:
+    case Request::Type::Utxo:
+        // can be batched with the requests that follow
+        if (!m_pNewRequestsTimer)
+            m_pNewRequestsTimer = io::Timer::create(io::Reactor::get_Current());
+
+        m_pNewRequestsTimer->start(0, false, [this]() { OnNewRequests(); });
+        break;
+
+    default:
+        OnNewRequests();
+    }
 }
 
 void FlyClient::NetworkStd::OnNewRequests()
@@ -608,6 +642,8 @@ void FlyClient::NetworkStd::Connection::AssignRequests()
     for (RequestList::iterator it = m_This.m_lst.begin(); m_This.m_lst.end() != it; )
         AssignRequest(*it++);
 
+    FlushBatch();
+
     if (m_lst.empty() && m_This.m_Cfg.m_PollPeriod_ms)
         SetTimer(0);
     else
@@ -647,6 +683,86 @@ void FlyClient::NetworkStd::Connection::AssignRequest(RequestNode& n)
     m_lst.push_back(n);
 }
 
+void FlyClient::NetworkStd::Connection::SendRequest(RequestKernel& req)
+{
+    if (LoginExtFlags::ProofsBatch & m_LoginExtFlags)
+        AddToBatch(Request::Type::Kernel);
+    else
+        Send(req.m_Msg);
+}
+
+void FlyClient::NetworkStd::Connection::SendRequest(RequestUtxo& req)
+{
+    if ((LoginExtFlags::ProofsBatch & m_LoginExtFlags) && !req.m_Msg.m_MaturityMin)
+        AddToBatch(Request::Type::Utxo);
+    else
+    {
+        FlushBatch();
+        Send(req.m_Msg);
+    }
+}
+
+void FlyClient::NetworkStd::Connection::AddToBatch(Request::Type x)
+{
+    if (m_nBatch && ((m_BatchType != x) || (m_nBatch == g_ProofsBatchMaxSize)))
+        FlushBatch();
+
+    m_BatchType = x;
+    m_nBatch++;
+}
+
+void FlyClient::NetworkStd::Connection::FlushBatch()
+{
+    if (!m_nBatch)
+        return;
+
+    RequestList::iterator it = m_lst.end();
+    for (uint32_t i = 0; i < m_nBatch; i++)
+        it--;
+
+    if (1 == m_nBatch)
+    {
+        // send as a regular request, the node would respond with a regular response
+        switch (m_BatchType)
+        {
+        case Request::Type::Kernel:
+            Send(Cast::Up<RequestKernel>(*it->m_pRequest).m_Msg);
+            break;
+
+        default:
+            Send(Cast::Up<RequestUtxo>(*it->m_pRequest).m_Msg);
+        }
+    }
+    else
+    {
+        switch (m_BatchType)
+        {
+        case Request::Type::Kernel:
+            {
+                GetProofKernels msg;
+                msg.m_IDs.reserve(m_nBatch);
+                for (; m_lst.end() != it; it++)
+                    msg.m_IDs.push_back(Cast::Up<RequestKernel>(*it->m_pRequest).m_Msg.m_ID);
+                Send(msg);
+            }
+            break;
+
+        default:
+            {
+                GetProofUtxos msg;
+                msg.m_Utxos.reserve(m_nBatch);
+                for (; m_lst.end() != it; it++)
+                    msg.m_Utxos.push_back(Cast::Up<RequestUtxo>(*it->m_pRequest).m_Msg.m_Utxo);
+                Send(msg);
+            }
+        }
+
+        m_vBatchesSent.push_back(m_nBatch);
+    }
+
+    m_nBatch = 0;
+}
+
 void FlyClient::NetworkStd::RequestList::Clear()
 {
     while (!empty())
@@ -694,6 +810,40 @@ REQUEST_TYPES_All(THE_MACRO)
 #undef THE_MACRO
 #undef THE_MACRO_SWAP_FIELD
 
+void FlyClient::NetworkStd::Connection::OnBatchResponse(size_t nCount)
+{
+    if (m_vBatchesSent.empty() || (m_vBatchesSent.front() != nCount))
+        ThrowUnexpected();
+
+    m_vBatchesSent.pop_front();
+}
+
+void FlyClient::NetworkStd::Connection::OnMsg(ProofKernels&& msg)
+{
+    OnBatchResponse(msg.m_Proofs.size());
+
+    for (size_t i = 0; i < msg.m_Proofs.size(); i++)
+    {
+        RequestKernel& req = Cast::Up<RequestKernel>(get_FirstRequestStrict(Request::Type::Kernel));
+        std::swap(req.m_Res.m_Proof, msg.m_Proofs[i]);
+        OnRequestData(req);
+        OnFirstRequestDone(IsSupported(req));
+    }
+}
+
+void FlyClient::NetworkStd::Connection::OnMsg(ProofUtxos&& msg)
+{
+    OnBatchResponse(msg.m_Proofs.size());
+
+    for (size_t i = 0; i < msg.m_Proofs.size(); i++)
+    {
+        RequestUtxo& req = Cast::Up<RequestUtxo>(get_FirstRequestStrict(Request::Type::Utxo));
+        req.m_Res.m_Proofs.swap(msg.m_Proofs[i]);
+        OnRequestData(req);
+        OnFirstRequestDone(IsSupported(req));
+    }
+}
+
 bool FlyClient::NetworkStd::Connection::IsSupported(RequestUtxo& req)
 {
     return IsAtTip();
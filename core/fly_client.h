@@ -19,6 +19,7 @@
 #include <boost/intrusive/set.hpp>
 #include <boost/intrusive/list.hpp>
 #include <boost/intrusive_ptr.hpp>
+#include <deque>
 
 namespace beam {
 namespace proto {
@@ -125,6 +126,9 @@ namespace proto {
 			RequestList m_lst; // idle
 			void OnNewRequests();
 
+			// requests posted within the same reactor cycle are assigned together, so that they can be batched
+			io::Timer::Ptr m_pNewRequestsTimer;
+
 			struct Config {
 				std::vector<io::Address> m_vNodes;
 				uint32_t m_PollPeriod_ms = 0; // set to 0 to keep connection. Anyway poll period would be no less than the expected rate of blocks
@@ -160,6 +164,15 @@ namespace proto {
 				Request& get_FirstRequestStrict(Request::Type);
 				void OnFirstRequestDone(bool bStillSupported);
 
+				// Kernel and Utxo requests assigned in a row are sent as a single batch message (if the node supports it).
+				// They're already in m_lst, the last m_nBatch elements.
+				Request::Type m_BatchType;
+				uint32_t m_nBatch;
+				std::deque<uint32_t> m_vBatchesSent; // sizes of the batches awaiting the response, the node must respond to each in full
+				void AddToBatch(Request::Type);
+				void FlushBatch();
+				void OnBatchResponse(size_t nCount);
+
 				io::Timer::Ptr m_pTimer;
 				void OnTimer();
 				void SetTimer(uint32_t);
@@ -188,6 +201,7 @@ namespace proto {
 
 				bool IsAtTip() const;
 				uint8_t m_LoginFlags;
+				uint32_t m_LoginExtFlags;
 				uint8_t m_Flags;
 
 				struct Flags {
@@ -201,12 +215,15 @@ namespace proto {
 				virtual void OnDisconnect(const DisconnectReason&) override;
 				virtual void OnMsg(proto::Authentication&& msg) override;
 				virtual void OnMsg(proto::Login&& msg) override;
+				virtual void OnMsg(proto::LoginExt&& msg) override;
 				virtual void OnMsg(proto::GetBlockFinalization&& msg) override;
 				virtual void OnMsg(proto::NewTip&& msg) override;
 				virtual void OnMsg(proto::ProofCommonState&& msg) override;
 				virtual void OnMsg(proto::ProofChainWork&& msg) override;
 				virtual void OnMsg(proto::BbsMsg&& msg) override;
 				virtual void OnMsg(proto::BbsMsgV0&& msg) override;
+				virtual void OnMsg(proto::ProofKernels&& msg) override;
+				virtual void OnMsg(proto::ProofUtxos&& msg) override;
 #define THE_MACRO(type, msgOut, msgIn) \
 				virtual void OnMsg(proto::msgIn&&) override; \
 				bool IsSupported(Request##type&); \
@@ -214,8 +231,10 @@ namespace proto {
 				REQUEST_TYPES_All(THE_MACRO)
 #undef THE_MACRO
 
-				template <typename Req> void SendRequest(Req& r) { Send(r.m_Msg); }
+				template <typename Req> void SendRequest(Req& r) { FlushBatch(); Send(r.m_Msg); }
 				void SendRequest(RequestBbsMsg&);
+				void SendRequest(RequestKernel&);
+				void SendRequest(RequestUtxo&);
 			};
 
 			typedef boost::intrusive::list<Connection> ConnectionList;
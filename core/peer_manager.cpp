@@ -36,7 +36,15 @@ void PeerManager::Rating::Dec(uint32_t& r, uint32_t delta)
 
 uint32_t PeerManager::PeerInfo::AdjustedRating::get() const
 {
-	return Rating::Saturate(get_ParentObj().m_RawRating.m_Value + m_Increment);
+	return Rating::Saturate(get_ParentObj().m_RawRating.m_Value + m_Increment + m_PerfBonus);
+}
+
+void PeerManager::PeerInfo::Perf::Update(uint32_t& val, uint32_t sample)
+{
+	// each new sample has weight 1/8
+	val = val ?
+		static_cast<uint32_t>((static_cast<uint64_t>(val) * 7 + sample) >> 3) :
+		sample;
 }
 
 void PeerManager::Update()
@@ -184,8 +192,11 @@ PeerManager::PeerInfo* PeerManager::Find(const PeerID& id, bool& bCreate)
 	m_Ratings.insert(ret->m_RawRating);
 
 	ret->m_AdjustedRating.m_Increment = 0;
+	ret->m_AdjustedRating.m_PerfBonus = 0;
 	m_AdjustedRatings.insert(ret->m_AdjustedRating);
 
+	ZeroObject(ret->m_Perf);
+
 	ret->m_Active.m_Now = false;
 	ret->m_LastSeen = 0;
 	ret->m_LastActivity_ms = 0;
@@ -222,6 +233,7 @@ void PeerManager::ModifyRatingInternal(PeerInfo& pi, uint32_t delta, bool bAdd,
 	{
 		pi.m_RawRating.m_Value = 0;
 		pi.m_AdjustedRating.m_Increment = 0;
+		pi.m_AdjustedRating.m_PerfBonus = 0;
 	}
 	else
 	{
@@ -231,6 +243,7 @@ void PeerManager::ModifyRatingInternal(PeerInfo& pi, uint32_t delta, bool bAdd,
 			Rating::Dec(pi.m_RawRating.m_Value, delta);
 
 		assert(pi.m_RawRating.m_Value);
+		pi.m_AdjustedRating.m_PerfBonus = get_PerfBonus(pi); // could've been reset by ban
 		m_AdjustedRatings.insert(pi.m_AdjustedRating);
 	}
 
@@ -239,6 +252,56 @@ void PeerManager::ModifyRatingInternal(PeerInfo& pi, uint32_t delta, bool bAdd,
 	LOG_INFO() << pi << " Rating " << r0 << " -> " << pi.m_RawRating.m_Value;
 }
 
+uint32_t PeerManager::get_PerfBonus(const PeerInfo& pi) const
+{
+	const PeerInfo::Perf& x = pi.m_Perf; // alias
+	if (!x.m_Bps)
+		return 0;
+
+	uint64_t val = static_cast<uint64_t>(Rating::PerfMax) * x.m_Bps / (static_cast<uint64_t>(x.m_Bps) + m_Cfg.m_PerfRefBps);
+
+	if (x.m_Rtt_ms > m_Cfg.m_PerfRefRtt_ms)
+		val = val * m_Cfg.m_PerfRefRtt_ms / x.m_Rtt_ms;
+
+	val = (val * (1024 - std::min(x.m_FailRate, 1024U))) >> 10;
+
+	return static_cast<uint32_t>(val);
+}
+
+void PeerManager::UpdatePerfBonus(PeerInfo& pi)
+{
+	if (!pi.m_RawRating.m_Value)
+		return; // banned, not in the adjusted set
+
+	uint32_t val = get_PerfBonus(pi);
+	if (pi.m_AdjustedRating.m_PerfBonus == val)
+		return;
+
+	m_AdjustedRatings.erase(AdjustedRatingSet::s_iterator_to(pi.m_AdjustedRating));
+	pi.m_AdjustedRating.m_PerfBonus = val;
+	m_AdjustedRatings.insert(pi.m_AdjustedRating);
+}
+
+void PeerManager::OnThroughput(PeerInfo& pi, uint64_t nBytes, uint32_t dt_ms)
+{
+	uint64_t nBps = nBytes * 1000 / std::max(dt_ms, 1U);
+	PeerInfo::Perf::Update(pi.m_Perf.m_Bps, static_cast<uint32_t>(std::min<uint64_t>(nBps, static_cast<uint32_t>(-1))));
+	UpdatePerfBonus(pi);
+}
+
+void PeerManager::OnRtt(PeerInfo& pi, uint32_t dt_ms)
+{
+	PeerInfo::Perf::Update(pi.m_Perf.m_Rtt_ms, std::max(dt_ms, 1U));
+	UpdatePerfBonus(pi);
+}
+
+void PeerManager::OnRequestDone(PeerInfo& pi, bool bSuccess)
+{
+	uint32_t& val = pi.m_Perf.m_FailRate; // unlike others, starts from 0 (no failures)
+	val = (val * 7 + (bSuccess ? 0 : 1024)) >> 3;
+	UpdatePerfBonus(pi);
+}
+
 void PeerManager::RemoveAddr(PeerInfo& pi)
 {
 	if (!pi.m_Addr.m_Value.empty())
@@ -47,6 +47,10 @@ namespace beam {
 		//	So that we effectively always try to maintain connection with the best peers, but also shuffle and connect to others.
 		//
 		//	There is a min threshold for connection time, i.e. we won't disconnect shortly after connecting because the rating of this peer went slightly below another candidate
+		//
+		// Performance:
+		//	Throughput of delivered bodies, round-trip time and request failure rate are measured (moving averages)
+		//	Adjusted rating gets a bonus according to them, so that peers on good links are preferred.
 
 		struct Rating
 		{
@@ -56,6 +60,7 @@ namespace beam {
 			static const uint32_t RewardBlock = 512;
 			static const uint32_t PenaltyTimeout = 256;
 			static const uint32_t PenaltyNetworkErr = 128;
+			static const uint32_t PerfMax = 2048; // max bonus for the measured performance
 			static const uint32_t Max = 10240; // saturation
 
 			static uint32_t Saturate(uint32_t);
@@ -72,6 +77,8 @@ namespace beam {
 			uint32_t m_TimeoutAddrChange_s	= 60 * 60 * 2;
 			uint32_t m_StarvationRatioInc	= 1; // increase per second while not connected
 			uint32_t m_StarvationRatioDec	= 2; // decrease per second while connected (until starvation reward is zero)
+			uint32_t m_PerfRefBps			= 1024 * 256; // throughput that gets half of the max perf bonus
+			uint32_t m_PerfRefRtt_ms		= 300; // above this the perf bonus is reduced proportionally
 		} m_Cfg;
 
 
@@ -99,6 +106,7 @@ namespace beam {
 				:public boost::intrusive::set_base_hook<>
 			{
 				uint32_t m_Increment;
+				uint32_t m_PerfBonus;
 				uint32_t get() const;
 				bool operator < (const AdjustedRating& x) const { return (get() > x.get()); } // reverse order, begin - max
 
@@ -122,6 +130,16 @@ namespace beam {
 				IMPLEMENT_GET_PARENT_OBJ(PeerInfo, m_Addr)
 			} m_Addr;
 
+			struct Perf
+			{
+				// moving averages, 0 - not measured yet
+				uint32_t m_Bps; // throughput of delivered bodies
+				uint32_t m_Rtt_ms;
+				uint32_t m_FailRate; // of the requests, normalized to 1024
+
+				static void Update(uint32_t& val, uint32_t sample);
+			} m_Perf;
+
 			Timestamp m_LastSeen; // needed to filter-out dead peers, and to know when to update the address
 			uint32_t m_LastActivity_ms; // updated on connection attempt, and disconnection.
 		};
@@ -140,6 +158,9 @@ namespace beam {
 		void Ban(PeerInfo&);
 		void OnSeen(PeerInfo&);
 		void OnRemoteError(PeerInfo&, bool bShouldBan);
+		void OnThroughput(PeerInfo&, uint64_t nBytes, uint32_t dt_ms);
+		void OnRtt(PeerInfo&, uint32_t dt_ms);
+		void OnRequestDone(PeerInfo&, bool bSuccess);
 		bool IsOutdated(const PeerInfo&) const;
 		void ModifyAddr(PeerInfo&, const io::Address&);
 		void RemoveAddr(PeerInfo&);
@@ -169,6 +190,8 @@ namespace beam {
 
 		void ActivatePeerInternal(PeerInfo&, uint32_t nTicks_ms, uint32_t& nSelected);
 		void ModifyRatingInternal(PeerInfo&, uint32_t, bool bAdd, bool ban);
+		uint32_t get_PerfBonus(const PeerInfo&) const;
+		void UpdatePerfBonus(PeerInfo&);
 	};
 
 	std::ostream& operator << (std::ostream& s, const PeerManager::PeerInfo&);
@@ -53,12 +53,17 @@ bool ProtocolPlus::VerifyMsg(const uint8_t* p, uint32_t nSize)
     if (Mode::Duplex != m_Mode)
         return true;
 
+    return VerifyMac(m_HMac, p, nSize);
+}
+
+bool ProtocolPlus::VerifyMac(const ECC::Hash::Mac& hmKey, const uint8_t* p, uint32_t nSize)
+{
     MacValue hmac;
 
     if (nSize < hmac.nBytes)
         return false; // could happen on (sort of) overflow attack?
 
-    ECC::Hash::Mac hm = m_HMac;
+    ECC::Hash::Mac hm = hmKey;
     hm.Write(p, nSize - hmac.nBytes);
 
     get_HMac(hm, hmac);
@@ -66,6 +71,39 @@ bool ProtocolPlus::VerifyMsg(const uint8_t* p, uint32_t nSize)
     return !memcmp(p + nSize - hmac.nBytes, hmac.m_pData, hmac.nBytes);
 }
 
+struct ProtocolPlus::InboundCipher
+    :public IInboundCipher
+{
+    AES::Encoder m_Enc;
+    AES::StreamCipher m_Cipher;
+    ECC::Hash::Mac m_HMac;
+
+    virtual void Decrypt(uint8_t* p, uint32_t nSize) override
+    {
+        m_Cipher.XCrypt(m_Enc, p, nSize);
+    }
+
+    virtual bool VerifyMsg(const uint8_t* p, uint32_t nSize) override
+    {
+        return VerifyMac(m_HMac, p, nSize);
+    }
+};
+
+std::unique_ptr<IInboundCipher> ProtocolPlus::DetachInbound()
+{
+    // In the Duplex mode both directions are encrypted, and the mode isn't changed anymore.
+    // The inbound stream cipher is advanced only by the reader, the encoder and the mac key are fixed.
+    if (Mode::Duplex != m_Mode)
+        return nullptr;
+
+    auto pRes = std::make_unique<InboundCipher>();
+    pRes->m_Enc = m_Enc;
+    pRes->m_Cipher = m_CipherIn;
+    pRes->m_HMac = m_HMac;
+
+    return pRes;
+}
+
 void ProtocolPlus::get_HMac(ECC::Hash::Mac& hm, MacValue& res)
 {
     ECC::Hash::Value hv;
@@ -289,6 +327,248 @@ bool Bbs::IsHashValid(const ECC::Hash::Value& hv)
 	return nHigh < (1 << 10); // upper 22 bits should be zero, probability ~ 1 / 4mln
 }
 
+/////////////////////////
+// CompactBody
+CompactBody::ShortID CompactBody::get_ID(uint64_t nNonce, const Output& outp)
+{
+	ECC::Hash::Value hv;
+	ECC::Hash::Processor()
+		<< "cb.outp"
+		<< nNonce
+		<< outp.m_Commitment
+		>> hv;
+
+	ShortID ret;
+	hv.ExportWord<0>(ret);
+	return ret;
+}
+
+CompactBody::ShortID CompactBody::get_ID(uint64_t nNonce, const TxKernel& krn)
+{
+	Merkle::Hash hvID;
+	krn.get_ID(hvID);
+
+	ECC::Hash::Value hv;
+	ECC::Hash::Processor()
+		<< "cb.krn"
+		<< nNonce
+		<< hvID
+		>> hv;
+
+	ShortID ret;
+	hv.ExportWord<0>(ret);
+	return ret;
+}
+
+bool CompactBody::IsPrefilled(const Output& outp)
+{
+	return outp.m_Coinbase;
+}
+
+bool CompactBody::IsPrefilled(const TxKernel& krn)
+{
+	return !krn.m_Fee; // coinbase kernel. Txs without fee don't get to the pool anyway
+}
+
+void CompactBody::Create(BodyCompact& msg, const Block::Body& body)
+{
+	Block::Body bodyP; // prefilled part
+	bodyP.m_Offset = body.m_Offset;
+
+	for (size_t i = 0; i < body.m_vInputs.size(); i++)
+	{
+		bodyP.m_vInputs.emplace_back(new Input);
+		*bodyP.m_vInputs.back() = *body.m_vInputs[i];
+	}
+
+	for (size_t i = 0; i < body.m_vOutputs.size(); i++)
+	{
+		const Output& outp = *body.m_vOutputs[i];
+		if (IsPrefilled(outp))
+		{
+			bodyP.m_vOutputs.emplace_back(new Output);
+			*bodyP.m_vOutputs.back() = outp;
+		}
+		else
+			msg.m_Outputs.push_back(get_ID(msg.m_Nonce, outp));
+	}
+
+	for (size_t i = 0; i < body.m_vKernels.size(); i++)
+	{
+		const TxKernel& krn = *body.m_vKernels[i];
+		if (IsPrefilled(krn))
+		{
+			bodyP.m_vKernels.emplace_back(new TxKernel);
+			*bodyP.m_vKernels.back() = krn;
+		}
+		else
+			msg.m_Kernels.push_back(get_ID(msg.m_Nonce, krn));
+	}
+
+	Serializer ser;
+	ser & Cast::Down<Block::BodyBase>(bodyP);
+	ser & Cast::Down<TxVectors::Perishable>(bodyP);
+	ser.swap_buf(msg.m_Prefilled.m_Perishable);
+
+	ser.reset();
+	ser & Cast::Down<TxVectors::Eternal>(bodyP);
+	ser.swap_buf(msg.m_Prefilled.m_Eternal);
+}
+
+void CompactBody::get_Missing(BodyCompactMissing& msgOut, const Block::Body& body, const GetBodyCompactMissing& msg)
+{
+	Assembler::IDSet setOutputs(msg.m_Outputs.begin(), msg.m_Outputs.end());
+	Assembler::IDSet setKernels(msg.m_Kernels.begin(), msg.m_Kernels.end());
+
+	TxVectors::Full txv;
+
+	for (size_t i = 0; i < body.m_vOutputs.size(); i++)
+		if (!IsPrefilled(*body.m_vOutputs[i]))
+			Assembler::Pick(txv.m_vOutputs, setOutputs, msg.m_Nonce, *body.m_vOutputs[i]);
+
+	for (size_t i = 0; i < body.m_vKernels.size(); i++)
+		if (!IsPrefilled(*body.m_vKernels[i]))
+			Assembler::Pick(txv.m_vKernels, setKernels, msg.m_Nonce, *body.m_vKernels[i]);
+
+	Serializer ser;
+	ser & Cast::Down<TxVectors::Perishable>(txv);
+	ser.swap_buf(msgOut.m_Body.m_Perishable);
+
+	ser.reset();
+	ser & Cast::Down<TxVectors::Eternal>(txv);
+	ser.swap_buf(msgOut.m_Body.m_Eternal);
+}
+
+template <typename T>
+bool HasNullPtrs(const std::vector<T>& v)
+{
+	for (size_t i = 0; i < v.size(); i++)
+		if (!v[i])
+			return true;
+	return false;
+}
+
+bool HasNullPtrs(const TxVectors::Full& txv)
+{
+	return
+		HasNullPtrs(txv.m_vInputs) ||
+		HasNullPtrs(txv.m_vOutputs) ||
+		HasNullPtrs(txv.m_vKernels);
+}
+
+bool CompactBody::Assembler::Init(const BodyCompact& msg)
+{
+	m_Nonce = msg.m_Nonce;
+
+	try {
+		Deserializer der;
+		der.reset(msg.m_Prefilled.m_Perishable);
+		der & Cast::Down<Block::BodyBase>(m_Body);
+		der & Cast::Down<TxVectors::Perishable>(m_Body);
+
+		der.reset(msg.m_Prefilled.m_Eternal);
+		der & Cast::Down<TxVectors::Eternal>(m_Body);
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+
+	if (HasNullPtrs(m_Body))
+		return false;
+
+	m_setOutputs.insert(msg.m_Outputs.begin(), msg.m_Outputs.end());
+	m_setKernels.insert(msg.m_Kernels.begin(), msg.m_Kernels.end());
+	return true;
+}
+
+void CompactBody::Assembler::Pick(std::vector<Output::Ptr>& v, IDSet& s, uint64_t nNonce, const Output& outp)
+{
+	if (s.empty())
+		return;
+
+	IDSet::iterator it = s.find(get_ID(nNonce, outp));
+	if (s.end() == it)
+		return;
+
+	s.erase(it);
+	v.emplace_back(new Output);
+	*v.back() = outp;
+}
+
+void CompactBody::Assembler::Pick(std::vector<TxKernel::Ptr>& v, IDSet& s, uint64_t nNonce, const TxKernel& krn)
+{
+	if (s.empty())
+		return;
+
+	IDSet::iterator it = s.find(get_ID(nNonce, krn));
+	if (s.end() == it)
+		return;
+
+	s.erase(it);
+	v.emplace_back(new TxKernel);
+	*v.back() = krn;
+}
+
+void CompactBody::Assembler::Add(const TxVectors::Full& txv)
+{
+	for (size_t i = 0; i < txv.m_vOutputs.size(); i++)
+		Pick(m_Body.m_vOutputs, m_setOutputs, m_Nonce, *txv.m_vOutputs[i]);
+
+	for (size_t i = 0; i < txv.m_vKernels.size(); i++)
+		Pick(m_Body.m_vKernels, m_setKernels, m_Nonce, *txv.m_vKernels[i]);
+}
+
+bool CompactBody::Assembler::Add(const BodyCompactMissing& msg)
+{
+	TxVectors::Full txv;
+
+	try {
+		Deserializer der;
+		der.reset(msg.m_Body.m_Perishable);
+		der & Cast::Down<TxVectors::Perishable>(txv);
+
+		der.reset(msg.m_Body.m_Eternal);
+		der & Cast::Down<TxVectors::Eternal>(txv);
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+
+	if (HasNullPtrs(txv) || !txv.m_vInputs.empty())
+		return false;
+
+	size_t nRemaining = m_setOutputs.size() + m_setKernels.size();
+	Add(txv);
+
+	// every returned element must have been requested
+	size_t nPicked = nRemaining - m_setOutputs.size() - m_setKernels.size();
+	return (txv.m_vOutputs.size() + txv.m_vKernels.size() == nPicked);
+}
+
+void CompactBody::Assembler::get_Missing(GetBodyCompactMissing& msg) const
+{
+	msg.m_Nonce = m_Nonce;
+	msg.m_Outputs.assign(m_setOutputs.begin(), m_setOutputs.end());
+	msg.m_Kernels.assign(m_setKernels.begin(), m_setKernels.end());
+}
+
+void CompactBody::Assembler::Finalize(BodyBuffers& bb)
+{
+	assert(IsComplete());
+
+	std::sort(m_Body.m_vOutputs.begin(), m_Body.m_vOutputs.end());
+	std::sort(m_Body.m_vKernels.begin(), m_Body.m_vKernels.end());
+
+	Serializer ser;
+	ser & Cast::Down<Block::BodyBase>(m_Body);
+	ser & Cast::Down<TxVectors::Perishable>(m_Body);
+	ser.swap_buf(bb.m_Perishable);
+
+	ser.reset();
+	ser & Cast::Down<TxVectors::Eternal>(m_Body);
+	ser.swap_buf(bb.m_Eternal);
+}
+
 union HighestMsgCode
 {
 #define THE_MACRO(code, msg) uint8_t m_pBuf_##msg[code + 1];
@@ -514,6 +794,12 @@ void NodeConnection::Accept(io::TcpStream::Ptr&& newStream)
         100,
         std::move(newStream)
         );
+
+    if (m_pInboundPool)
+        m_Connection->offload_inbound(*m_pInboundPool);
+
+    if (m_WatermarkHi)
+        m_Connection->set_watermarks(m_WatermarkHi, m_WatermarkLo, [this](bool bOverflow) { OnWatermark(bOverflow); });
 }
 
 bool NodeConnection::IsLive() const
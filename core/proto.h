@@ -24,6 +24,7 @@
 #include "../utility/io/timer.h"
 #include "aes.h"
 #include "block_crypt.h"
+#include <set>
 
 namespace beam {
 namespace proto {
@@ -68,6 +69,24 @@ namespace proto {
 #define BeamNodeMsg_BodyPack(macro) \
     macro(std::vector<BodyBuffers>, Bodies)
 
+#define BeamNodeMsg_GetBodyCompact(macro) \
+    macro(Block::SystemState::ID, ID)
+
+#define BeamNodeMsg_BodyCompact(macro) \
+    macro(uint64_t, Nonce) \
+    macro(BodyBuffers, Prefilled) \
+    macro(std::vector<uint64_t>, Outputs) \
+    macro(std::vector<uint64_t>, Kernels)
+
+#define BeamNodeMsg_GetBodyCompactMissing(macro) \
+    macro(Block::SystemState::ID, ID) \
+    macro(uint64_t, Nonce) \
+    macro(std::vector<uint64_t>, Outputs) \
+    macro(std::vector<uint64_t>, Kernels)
+
+#define BeamNodeMsg_BodyCompactMissing(macro) \
+    macro(BodyBuffers, Body)
+
 #define BeamNodeMsg_GetProofState(macro) \
     macro(Height, Height)
 
@@ -85,6 +104,12 @@ namespace proto {
     macro(ECC::Point, Utxo) \
     macro(Height, MaturityMin) /* set to non-zero in case the result is too big, and should be retrieved within multiple queries */
 
+#define BeamNodeMsg_GetProofKernels(macro) \
+    macro(std::vector<Merkle::Hash>, IDs)
+
+#define BeamNodeMsg_GetProofUtxos(macro) \
+    macro(std::vector<ECC::Point>, Utxos) /* MaturityMin is assumed zero */
+
 #define BeamNodeMsg_GetProofChainWork(macro) \
     macro(Difficulty::Raw, LowerBound)
 
@@ -99,6 +124,12 @@ namespace proto {
 #define BeamNodeMsg_ProofUtxo(macro) \
     macro(std::vector<Input::Proof>, Proofs)
 
+#define BeamNodeMsg_ProofKernels(macro) \
+    macro(std::vector<TxKernel::LongProof>, Proofs) /* one per requested ID, empty if not found */
+
+#define BeamNodeMsg_ProofUtxos(macro) \
+    macro(std::vector<std::vector<Input::Proof> >, Proofs) /* one list per requested utxo */
+
 #define BeamNodeMsg_ProofState(macro) \
     macro(Merkle::HardProof, Proof)
 
@@ -113,6 +144,9 @@ namespace proto {
     macro(ECC::Hash::Value, CfgChecksum) \
     macro(uint8_t, Flags)
 
+#define BeamNodeMsg_LoginExt(macro) \
+    macro(uint32_t, Flags)
+
 #define BeamNodeMsg_Ping(macro)
 #define BeamNodeMsg_Pong(macro)
 
@@ -126,6 +160,12 @@ namespace proto {
 #define BeamNodeMsg_GetTransaction(macro) \
     macro(Transaction::KeyType, ID)
 
+#define BeamNodeMsg_HaveTransactions(macro) \
+    macro(std::vector<Transaction::KeyType>, IDs)
+
+#define BeamNodeMsg_GetTransactions(macro) \
+    macro(std::vector<Transaction::KeyType>, IDs)
+
 #define BeamNodeMsg_Bye(macro) \
     macro(uint8_t, Reason)
 
@@ -226,6 +266,7 @@ namespace proto {
     macro(0x0c, Time) \
     macro(0x0d, DataMissing) \
     macro(0x0e, Boolean) \
+    macro(0x0f, LoginExt) /* sent in response to Login with the Extended flag */ \
     /* blockchain status */ \
     macro(0x10, NewTip) \
     macro(0x11, GetHdr) \
@@ -250,6 +291,10 @@ namespace proto {
     macro(0x25, ProofKernel2) \
     macro(0x26, GetBodyPack) \
     macro(0x27, BodyPack) \
+    macro(0x28, GetBodyCompact) \
+    macro(0x29, BodyCompact) \
+    macro(0x2a, GetBodyCompactMissing) \
+    macro(0x2b, BodyCompactMissing) \
     /* onwer-relevant */ \
     macro(0x2c, GetUtxoEvents) \
     macro(0x2d, UtxoEvents) \
@@ -259,6 +304,8 @@ namespace proto {
     macro(0x30, NewTransaction) \
     macro(0x31, HaveTransaction) \
     macro(0x32, GetTransaction) \
+    macro(0x33, HaveTransactions) \
+    macro(0x34, GetTransactions) \
     /* bbs */ \
     macro(0x38, BbsMsgV0) /* Deprecated */ \
     macro(0x39, BbsHaveMsg) \
@@ -268,6 +315,11 @@ namespace proto {
     macro(0x3d, BbsPickChannelResV0) /* Deprecated */ \
     macro(0x3e, BbsResetSync) \
     macro(0x3f, BbsMsg) \
+    /* batched proofs */ \
+    macro(0x40, GetProofKernels) \
+    macro(0x41, ProofKernels) \
+    macro(0x42, GetProofUtxos) \
+    macro(0x43, ProofUtxos) \
 
 
     struct LoginFlags {
@@ -277,7 +329,15 @@ namespace proto {
         static const uint8_t MiningFinalization     = 0x8; // I want to finalize block construction for my owned node
         static const uint8_t Extension1             = 0x10; // Supports Bbs with POW, more advanced proof/disproof scheme for SPV clients (?)
         static const uint8_t Extension2             = 0x20; // Supports large HdrPack, BlockPack with parameters
-	    static const uint8_t Recognized             = 0x3f;
+        static const uint8_t CompactBody            = 0x40; // Supports compact block relay
+        static const uint8_t Extended               = 0x80; // Supports LoginExt, which carries the capabilities that don't fit here
+	    static const uint8_t Recognized             = 0xff;
+    };
+
+    struct LoginExtFlags {
+        static const uint32_t TxsBatch              = 0x1; // Supports batched tx announcements/requests
+        static const uint32_t ProofsBatch           = 0x2; // Supports batched kernel/utxo proofs
+        static const uint32_t Recognized            = 0x3;
     };
 
     struct IDType
@@ -289,6 +349,8 @@ namespace proto {
 
     static const uint32_t g_HdrPackMaxSizeV0 = 128; // about 25K
 	static const uint32_t g_HdrPackMaxSize = 2048; // about 400K
+	static const uint32_t g_TxsBatchMaxSize = 1024; // about 32K
+	static const uint32_t g_ProofsBatchMaxSize = 128; // about 256K for kernels
 
     struct UtxoEvent
     {
@@ -416,6 +478,45 @@ namespace proto {
 		bool IsHashValid(const ECC::Hash::Value&);
 	}
 
+	struct CompactBody
+	{
+		// Compact block relay. Outputs and kernels are referred by 64-bit short IDs, the receiver is expected to find them in its tx pool.
+		// Elements that can't be there (coinbase outputs, kernels without fee) are prefilled, inputs are always sent as-is.
+		// The short IDs are salted by a per-message nonce, to make collisions unpredictable.
+		typedef uint64_t ShortID;
+
+		static ShortID get_ID(uint64_t nNonce, const Output&);
+		static ShortID get_ID(uint64_t nNonce, const TxKernel&);
+
+		static bool IsPrefilled(const Output&);
+		static bool IsPrefilled(const TxKernel&);
+
+		static void Create(BodyCompact&, const Block::Body&); // m_Nonce must be set by the caller
+		static void get_Missing(BodyCompactMissing&, const Block::Body&, const GetBodyCompactMissing&);
+
+		// Reconstructs the body on the receiver side
+		struct Assembler
+		{
+			Block::Body m_Body;
+			uint64_t m_Nonce = 0;
+
+			typedef std::multiset<ShortID> IDSet;
+			IDSet m_setOutputs; // unresolved
+			IDSet m_setKernels;
+
+			bool Init(const BodyCompact&); // returns false if the prefilled part is malformed
+			void Add(const TxVectors::Full&); // picks the elements referred by the body
+			bool Add(const BodyCompactMissing&); // returns false if the data is malformed or irrelevant
+
+			bool IsComplete() const { return m_setOutputs.empty() && m_setKernels.empty(); }
+			void get_Missing(GetBodyCompactMissing&) const;
+			void Finalize(BodyBuffers&); // sorts the elements, as required by the standard
+
+			static void Pick(std::vector<Output::Ptr>&, IDSet&, uint64_t nNonce, const Output&);
+			static void Pick(std::vector<TxKernel::Ptr>&, IDSet&, uint64_t nNonce, const TxKernel&);
+		};
+	};
+
     struct ProtocolPlus
         :public Protocol
     {
@@ -439,6 +540,9 @@ namespace proto {
 
         typedef uintBig_t<8> MacValue;
         static void get_HMac(ECC::Hash::Mac&, MacValue&);
+        static bool VerifyMac(const ECC::Hash::Mac&, const uint8_t*, uint32_t nSize);
+
+        struct InboundCipher; // detached copy of the inbound state
 
         ProtocolPlus(uint8_t v0, uint8_t v1, uint8_t v2, size_t maxMessageTypes, IErrorHandler& errorHandler, size_t serializedFragmentsSize);
         void ResetVars();
@@ -448,6 +552,7 @@ namespace proto {
         virtual void Decrypt(uint8_t*, uint32_t nSize) override;
         virtual uint32_t get_MacSize() override;
         virtual bool VerifyMsg(const uint8_t*, uint32_t nSize) override;
+        virtual std::unique_ptr<IInboundCipher> DetachInbound() override;
 
         void Encrypt(SerializedMsg&, MsgSerializer&);
     };
@@ -600,6 +705,13 @@ namespace proto {
 		size_t m_UnsentHiMark = 0;
 		void TestNotDrown();
 
+		// Output backpressure. If set - OnWatermark(true) is called when the unsent data reaches the high mark, and OnWatermark(false) once it drains to the low one. Set before Accept/Connect
+		size_t m_WatermarkHi = 0;
+		size_t m_WatermarkLo = 0;
+		virtual void OnWatermark(bool /* bOverflow */) {}
+
+		InboundPool* m_pInboundPool = nullptr; // if set - decryption, MAC checks and framing of the established channel run there. Set before Accept/Connect
+
         void OnIoErr(io::ErrorCode);
         void OnExc(const std::exception&);
         void OnProcessingExc(const NodeProcessingException& exception);
@@ -18,6 +18,7 @@
 #include "http/http_msg_creator.h"
 #include "http/http_json_serializer.h"
 #include "nlohmann/json.hpp"
+#include "utility/io/json_writer.h"
 #include "utility/helpers.h"
 #include "utility/logger.h"
 
@@ -28,25 +29,6 @@ namespace {
 static const size_t PACKER_FRAGMENTS_SIZE = 4096;
 static const size_t CACHE_DEPTH = 100000;
 
-const char* hash_to_hex(char* buf, const Merkle::Hash& hash) {
-    return to_hex(buf, hash.m_pData, 32);
-}
-
-const char* uint256_to_hex(char* buf, const ECC::uintBig& n) {
-    char* p = to_hex(buf + 2, n.m_pData, 32);
-    while (p && *p == '0') ++p;
-    if (*p == '\0') --p;
-    *--p = 'x';
-    *--p = '0';
-    return p;
-}
-
-const char* difficulty_to_hex(char* buf, const Difficulty& d) {
-    ECC::uintBig raw;
-    d.Unpack(raw);
-    return uint256_to_hex(buf, raw);
-}
-
 struct ResponseCache {
     io::SharedBuffer status;
     std::map<Height, io::SharedBuffer> blocks;
@@ -163,22 +145,17 @@ private:
             _cache.currentHeight = cursor.m_Sid.m_Height;
             _cache.lowHorizon = _nodeBackend.m_Extra.m_LoHorizon;
 
-            char buf[80];
-
             _sm.clear();
-            if (!serialize_json_msg(
-                _sm,
-                _packer,
-                json{
-                    { "timestamp", cursor.m_Full.m_TimeStamp },
-                    { "height", _cache.currentHeight },
-                    { "low_horizon", _nodeBackend.m_Extra.m_LoHorizon },
-                    { "hash", hash_to_hex(buf, cursor.m_ID.m_Hash) },
-                    { "chainwork",  uint256_to_hex(buf, cursor.m_Full.m_ChainWork) }
-                }
-            )) {
-                return false;
-            }
+            io::FragmentWriter& fw = _packer.acquire_writer(_sm);
+            io::JsonWriter w(fw);
+            w.begin_object();
+            w.key("chainwork").hex_number(cursor.m_Full.m_ChainWork.m_pData, cursor.m_Full.m_ChainWork.nBytes);
+            w.key("hash").hex(cursor.m_ID.m_Hash.m_pData, cursor.m_ID.m_Hash.nBytes);
+            w.key("height").value(_cache.currentHeight);
+            w.key("low_horizon").value(_nodeBackend.m_Extra.m_LoHorizon);
+            w.key("timestamp").value(cursor.m_Full.m_TimeStamp);
+            w.end_object();
+            finalize_json(fw);
 
             _cache.status = io::normalize(_sm, false);
             _statusDirty = false;
@@ -210,7 +187,16 @@ private:
         return true;
     }
 
-    bool extract_block_from_row(json& out, uint64_t row) {
+    /// Ends the json message in _packer's writer, as serialize_json_msg does
+    void finalize_json(io::FragmentWriter& fw) {
+        static const char eol = 10;
+        fw.write(&eol, 1);
+        fw.finalize();
+        _packer.release_writer();
+    }
+
+    /// Serializes the block straight into the writer, only once all its data is loaded.
+    bool extract_block_from_row(io::JsonWriter& w, uint64_t row) {
         NodeDB& db = _nodeBackend.get_DB();
 
         Block::SystemState::Full blockState;
@@ -233,65 +219,56 @@ private:
 
 
         if (ok) {
-            char buf[80];
-
-            json inputs = json::array();
+            w.begin_object();
+            w.key("chainwork").hex_number(blockState.m_ChainWork.m_pData, blockState.m_ChainWork.nBytes);
+            w.key("difficulty").value(blockState.m_PoW.m_Difficulty.ToFloat());
+            w.key("found").value(true);
+            w.key("hash").hex(id.m_Hash.m_pData, id.m_Hash.nBytes);
+            w.key("height").value(blockState.m_Height);
+
+            w.key("inputs").begin_array();
             for (const auto &v : block.m_vInputs) {
-                inputs.push_back(
-                json{
-                    {"commitment", uint256_to_hex(buf, v->m_Commitment.m_X)},
-                    {"maturity",   v->m_Maturity}
-                }
-                );
-            }
-
-            json outputs = json::array();
-            for (const auto &v : block.m_vOutputs) {
-                outputs.push_back(
-                json{
-                    {"commitment", uint256_to_hex(buf, v->m_Commitment.m_X)},
-                    {"maturity",   v->m_Maturity},
-                    {"coinbase",   v->m_Coinbase},
-                    {"incubation", v->m_Incubation}
-                }
-                );
+                w.begin_object();
+                w.key("commitment").hex_number(v->m_Commitment.m_X.m_pData, v->m_Commitment.m_X.nBytes);
+                w.key("maturity").value(v->m_Maturity);
+                w.end_object();
             }
+            w.end_array();
 
-            json kernels = json::array();
+            w.key("kernels").begin_array();
             for (const auto &v : block.m_vKernels) {
                 Merkle::Hash kernelID;
                 v->get_ID(kernelID);
-                kernels.push_back(
-                    json{
-                        {"id", hash_to_hex(buf, kernelID)},
-                        {"excess", uint256_to_hex(buf, v->m_Commitment.m_X)},
-                        {"minHeight", v->m_Height.m_Min},
-                        {"maxHeight", v->m_Height.m_Max},
-                        {"fee", v->m_Fee}
-                    }
-                );
+                w.begin_object();
+                w.key("excess").hex_number(v->m_Commitment.m_X.m_pData, v->m_Commitment.m_X.nBytes);
+                w.key("fee").value(v->m_Fee);
+                w.key("id").hex(kernelID.m_pData, kernelID.nBytes);
+                w.key("maxHeight").value(v->m_Height.m_Max);
+                w.key("minHeight").value(v->m_Height.m_Min);
+                w.end_object();
             }
+            w.end_array();
 
-            out = json{
-                {"found",      true},
-                {"timestamp",  blockState.m_TimeStamp},
-                {"height",     blockState.m_Height},
-                {"hash",       hash_to_hex(buf, id.m_Hash)},
-                {"prev",       hash_to_hex(buf, blockState.m_Prev)},
-                {"difficulty", blockState.m_PoW.m_Difficulty.ToFloat()},
-                {"chainwork",  uint256_to_hex(buf, blockState.m_ChainWork)},
-                {"subsidy",    Rules::get_Emission(blockState.m_Height)},
-                {"inputs",     inputs},
-                {"outputs",    outputs},
-                {"kernels",    kernels}
-            };
-
-            LOG_DEBUG() << out;
+            w.key("outputs").begin_array();
+            for (const auto &v : block.m_vOutputs) {
+                w.begin_object();
+                w.key("coinbase").value(v->m_Coinbase);
+                w.key("commitment").hex_number(v->m_Commitment.m_X.m_pData, v->m_Commitment.m_X.nBytes);
+                w.key("incubation").value(v->m_Incubation);
+                w.key("maturity").value(v->m_Maturity);
+                w.end_object();
+            }
+            w.end_array();
+
+            w.key("prev").hex(blockState.m_Prev.m_pData, blockState.m_Prev.nBytes);
+            w.key("subsidy").value(Rules::get_Emission(blockState.m_Height));
+            w.key("timestamp").value(blockState.m_TimeStamp);
+            w.end_object();
         }
         return ok;
     }
 
-    bool extract_block(json& out, Height height, uint64_t& row, uint64_t* prevRow) {
+    bool extract_block(io::JsonWriter& w, Height height, uint64_t& row, uint64_t* prevRow) {
         bool ok = true;
         if (row == 0) {
             ok = extract_row(height, row, prevRow);
@@ -301,7 +278,7 @@ private:
                 *prevRow = 0;
             }
         }
-        return ok && extract_block_from_row(out, row);
+        return ok && extract_block_from_row(w, row);
     }
 
     bool get_block_impl(io::SerializedMsg& out, uint64_t height, uint64_t& row, uint64_t* prevRow) {
@@ -321,19 +298,16 @@ private:
         io::SharedBuffer body;
         bool blockAvailable = (/*height >= _cache.lowHorizon && */height <= _cache.currentHeight);
         if (blockAvailable) {
-            json j;
-            if (!extract_block(j, height, row, prevRow)) {
-                blockAvailable = false;
-            } else {
-                _sm.clear();
-                if (serialize_json_msg(_sm, _packer, j)) {
-                    body = io::normalize(_sm, false);
-                    _cache.put_block(height, body);
-                } else {
-                    return false;
-                }
-                _sm.clear();
+            _sm.clear();
+            io::FragmentWriter& fw = _packer.acquire_writer(_sm);
+            io::JsonWriter w(fw);
+            blockAvailable = extract_block(w, height, row, prevRow);
+            finalize_json(fw);
+            if (blockAvailable) {
+                body = io::normalize(_sm, false);
+                _cache.put_block(height, body);
             }
+            _sm.clear();
         }
 
         if (blockAvailable) {
@@ -33,6 +33,7 @@ struct Options {
     static const unsigned logRotationPeriod = 3*60*60*1000; // 3 hours
     std::vector<uint32_t> whitelist;
     uint32_t logCleanupPeriod;
+    bool profileDb;
 };
 
 static bool parse_cmdline(int argc, char* argv[], Options& o);
@@ -92,6 +93,7 @@ bool parse_cmdline(int argc, char* argv[], Options& o) {
         (cli::PASS, po::value<string>()->default_value(""), "password for owner key")
         (cli::IP_WHITELIST, po::value<std::string>()->default_value(""), "IP whitelist")
         (cli::LOG_CLEANUP_DAYS, po::value<uint32_t>()->default_value(5), "old logfiles cleanup period(days)")
+        (cli::PROFILE_DB, po::value<bool>()->default_value(false), "collect per-statement DB statistics, exposed via /metrics")
     ;
 
     cliOptions.add(createRulesOptionsDescription());
@@ -130,6 +132,7 @@ bool parse_cmdline(int argc, char* argv[], Options& o) {
 
         o.logCleanupPeriod = vm[cli::LOG_CLEANUP_DAYS].as<uint32_t>() * 24 * 3600;
         o.nodeDbFilename = FILES_PREFIX "db";
+        o.profileDb = vm[cli::PROFILE_DB].as<bool>();
         //o.accessControlFile = "api.keys";
 
         o.nodeConnectTo = vm[cli::NODE_PEER].as<string>();
@@ -207,6 +210,7 @@ void setup_node(Node& node, const Options& o) {
     node.m_Cfg.m_Listen.ip(o.nodeListenTo.ip());
     node.m_Cfg.m_MiningThreads = 0;
     node.m_Cfg.m_VerificationThreads = 1;
+    node.m_Cfg.m_ProfileDB = o.profileDb;
 
     node.m_Keys.m_pOwner = o.ownerKey;
 
@@ -15,6 +15,7 @@
 #include "server.h"
 #include "adapter.h"
 #include "utility/logger.h"
+#include "utility/metrics.h"
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <fstream>
@@ -31,7 +32,7 @@ static const unsigned SERVER_RESTART_INTERVAL = 1000;
 static const unsigned ACL_REFRESH_INTERVAL = 5555;
 
 enum Dirs {
-    DIR_STATUS, DIR_BLOCK, DIR_BLOCKS
+    DIR_STATUS, DIR_BLOCK, DIR_BLOCKS, DIR_METRICS
     // etc
 };
 
@@ -112,7 +113,7 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
     const std::string& path = msg.msg->get_path();
 
     static const std::map<std::string_view, int> dirs {
-        { "status", DIR_STATUS }, { "block", DIR_BLOCK }, { "blocks", DIR_BLOCKS }
+        { "status", DIR_STATUS }, { "block", DIR_BLOCK }, { "blocks", DIR_BLOCKS }, { "metrics", DIR_METRICS }
     };
 
     const HttpConnection::Ptr& conn = it->second;
@@ -130,6 +131,9 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
             case DIR_BLOCKS:
                 func = &Server::send_blocks;
                 break;
+            case DIR_METRICS:
+                func = &Server::send_metrics;
+                break;
             default:
                 break;
         }
@@ -205,7 +209,14 @@ bool Server::send_blocks(const HttpConnection::Ptr& conn) {
     return send(conn, 200, "OK");
 }
 
-bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message) {
+bool Server::send_metrics(const HttpConnection::Ptr& conn) {
+    std::string s;
+    Metrics::Registry::get().Write(s);
+    _body.push_back(io::SharedBuffer(s.data(), s.size()));
+    return send(conn, 200, "OK", "text/plain; version=0.0.4");
+}
+
+bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message, const char* contentType) {
     assert(conn);
 
     size_t bodySize = 0;
@@ -218,7 +229,7 @@ bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message
         0, //headers,
         0, //sizeof(headers) / sizeof(HeaderPair),
         1,
-        "application/json",
+        contentType,
         bodySize
     );
 
@@ -52,7 +52,8 @@ private:
     bool send_status(const HttpConnection::Ptr& conn);
     bool send_block(const HttpConnection::Ptr& conn);
     bool send_blocks(const HttpConnection::Ptr& conn);
-    bool send(const HttpConnection::Ptr& conn, int code, const char* message);
+    bool send_metrics(const HttpConnection::Ptr& conn);
+    bool send(const HttpConnection::Ptr& conn, int code, const char* message, const char* contentType = "application/json");
 
     HttpMsgCreator _msgCreator;
     IAdapter& _backend;
@@ -179,6 +179,8 @@ int main_impl(int argc, char* argv[])
 
 		const auto path = boost::filesystem::system_complete(LOG_FILES_DIR);
 		auto logger = beam::Logger::create(logLevel, logLevel, fileLogLevel, LOG_FILES_PREFIX, path.string());
+		if (vm[cli::LOG_ASYNC].as<bool>())
+			logger->set_async(true);
 
 		try
 		{
@@ -231,6 +233,8 @@ int main_impl(int argc, char* argv[])
 					node.m_Cfg.m_sPathLocal = vm[cli::STORAGE].as<string>();
 					node.m_Cfg.m_MiningThreads = vm[cli::MINING_THREADS].as<uint32_t>();
 					node.m_Cfg.m_VerificationThreads = vm[cli::VERIFICATION_THREADS].as<int>();
+					node.m_Cfg.m_InboundThreads = vm[cli::INBOUND_THREADS].as<uint32_t>();
+					node.m_Cfg.m_ProfileDB = vm[cli::PROFILE_DB].as<bool>();
 
 					node.m_Cfg.m_LogUtxos = vm[cli::LOG_UTXOS].as<bool>();
 
@@ -13,9 +13,15 @@
 // limitations under the License.
 
 #include "db.h"
+#include "../utility/metrics.h"
 
 namespace beam {
 
+namespace
+{
+	Metrics::Histogram s_mtxDbStep("node_db_step_seconds", "NodeDB statement step latency", 1e9);
+}
+
 
 // Literal constants
 #define TblParams				"Params"
@@ -83,6 +89,7 @@ namespace beam {
 
 NodeDB::NodeDB()
 	:m_pDb(NULL)
+	,m_pProfile(nullptr)
 {
 	ZeroObject(m_pPrep);
 }
@@ -269,6 +276,7 @@ void NodeDB::Open(const char* szPath)
 	TestRet(sqlite3_open_v2(szPath, &m_pDb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_CREATE, NULL));
 	// Attempt to fix the "busy" error when PC goes to sleep and then awakes. Try the busy handler with non-zero timeout (maybe a single retry would be enough)
 	sqlite3_busy_timeout(m_pDb, 5000);
+	ApplyProfile();
 
 	ExecTextOut("PRAGMA locking_mode = EXCLUSIVE");
 	ExecTextOut("PRAGMA journal_size_limit=1048576"); // limit journal file, otherwise it may remain huge even after tx commit, until the app is closed
@@ -448,7 +456,13 @@ bool NodeDB::ExecStep(sqlite3_stmt* pStmt)
 {
 	int n = sqlite3_total_changes(m_pDb);
 
+	auto t0 = std::chrono::steady_clock::now();
 	int nVal = sqlite3_step(pStmt);
+	uint64_t ns = Metrics::Histogram::get_ElapsedNs(t0);
+
+	s_mtxDbStep.Add(ns);
+	if (m_pProfile)
+		m_pProfile->OnStep(pStmt, ns, SQLITE_ROW == nVal);
 
 	if (sqlite3_total_changes(m_pDb) != n)
 		OnModified();
@@ -503,6 +517,37 @@ sqlite3_stmt* NodeDB::get_Statement(Query::Enum val, const char* sql)
 }
 
 
+void NodeDB::set_Profile(Metrics::QueryProfile* p)
+{
+	m_pProfile = p;
+	ApplyProfile();
+}
+
+void NodeDB::ApplyProfile()
+{
+	if (m_pDb)
+		sqlite3_trace_v2(m_pDb, m_pProfile ? SQLITE_TRACE_PROFILE : 0, m_pProfile ? OnTrace : nullptr, this);
+}
+
+int NodeDB::OnTrace(unsigned int nType, void* pCtx, void* pP, void* pX)
+{
+	NodeDB& db = *reinterpret_cast<NodeDB*>(pCtx);
+	assert(db.m_pProfile && (SQLITE_TRACE_PROFILE == nType));
+
+	sqlite3_stmt* pStmt = reinterpret_cast<sqlite3_stmt*>(pP);
+
+	int iQuery = -1;
+	for (int i = 0; i < Query::count; i++)
+		if (db.m_pPrep[i].m_pStmt == pStmt)
+		{
+			iQuery = i;
+			break;
+		}
+
+	db.m_pProfile->OnRun(pP, sqlite3_sql(pStmt), iQuery, *reinterpret_cast<const int64_t*>(pX));
+	return 0;
+}
+
 int NodeDB::get_RowsChanged() const
 {
 	return sqlite3_changes(m_pDb);
@@ -20,6 +20,8 @@
 
 namespace beam {
 
+namespace Metrics { class QueryProfile; }
+
 class NodeDBUpgradeException : public std::runtime_error
 {
 public:
@@ -165,6 +167,9 @@ public:
 	void Close();
 	void Open(const char* szPath);
 
+	// Per-statement profiling via the sqlite trace hooks, no overhead unless set. Pass nullptr to stop.
+	void set_Profile(Metrics::QueryProfile*);
+
 	void Vacuum();
 	void CheckIntegrity();
 
@@ -433,6 +438,10 @@ public:
 private:
 
 	sqlite3* m_pDb;
+	Metrics::QueryProfile* m_pProfile;
+
+	void ApplyProfile();
+	static int OnTrace(unsigned int nType, void* pCtx, void* pP, void* pX);
 
 	struct Statement
 	{
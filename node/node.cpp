@@ -28,6 +28,12 @@
 
 namespace beam {
 
+namespace
+{
+	Metrics::Gauge s_mtxTaskQueue("node_task_queue_depth", "Tasks waiting for the verification threads");
+	Metrics::Counter s_mtxProofsBatched("node_proofs_batched_total", "Kernel and utxo proofs requested in batches");
+}
+
 bool Node::SyncStatus::operator == (const SyncStatus& x) const
 {
 	return
@@ -40,6 +46,8 @@ void Node::RefreshCongestions()
 	for (TaskSet::iterator it = m_setTasks.begin(); m_setTasks.end() != it; it++)
 		it->m_bNeeded = false;
 
+	m_vPeersByBps.clear(); // re-sort wrt the latest measurements
+
     m_Processor.EnumCongestions();
 
     for (TaskList::iterator it = m_lstTasksUnassigned.begin(); m_lstTasksUnassigned.end() != it; )
@@ -82,6 +90,7 @@ void Node::UpdateSyncStatusRaw()
 	Height hTotal = m_Processor.m_Cursor.m_ID.m_Height;
 	Height hDoneBlocks = hTotal;
 	Height hDoneHdrs = hTotal;
+	Height hMissingBlock = MaxHeight;
 
 	if (m_Processor.IsFastSync())
 		hTotal = m_Processor.m_SyncData.m_Target.m_Height;
@@ -98,10 +107,9 @@ void Node::UpdateSyncStatusRaw()
 		if (bBlock)
 		{
 			assert(t.m_Key.first.m_Height);
-			// all the blocks up to this had been dloaded
 			hTotal = std::max(hTotal, t.m_sidTrg.m_Height);
 			hDoneHdrs = std::max(hDoneHdrs, t.m_sidTrg.m_Height);
-			hDoneBlocks = std::max(hDoneBlocks, t.m_Key.first.m_Height - 1);
+			hMissingBlock = std::min(hMissingBlock, t.m_Key.first.m_Height); // several chunks may be in progress
 		}
 		else
 		{
@@ -114,6 +122,10 @@ void Node::UpdateSyncStatusRaw()
 		}
 	}
 
+	if (MaxHeight != hMissingBlock)
+		// all the blocks up to this had been dloaded
+		hDoneBlocks = std::max(hDoneBlocks, hMissingBlock - 1);
+
 	// account for treasury
 	hTotal++;
 
@@ -302,8 +314,41 @@ void Node::Wanted::OnTimer()
     }
 }
 
+const std::vector<Node::Peer*>& Node::get_PeersByBps()
+{
+	if (m_vPeersByBps.empty() && !m_lstPeers.empty())
+	{
+		m_vPeersByBps.reserve(m_lstPeers.size());
+		for (PeerList::iterator it = m_lstPeers.begin(); m_lstPeers.end() != it; it++)
+			m_vPeersByBps.push_back(&*it);
+
+		std::stable_sort(m_vPeersByBps.begin(), m_vPeersByBps.end(), [](Peer* p1, Peer* p2) { return p1->get_Bps() > p2->get_Bps(); });
+	}
+
+	return m_vPeersByBps;
+}
+
 void Node::TryAssignTask(Task& t, const PeerID* pPeerID)
 {
+	// Walk the peers wrt measured throughput: bodies - fastest first, headers - slowest first, to keep the fast ones free.
+	// Large body ranges aren't given to peers that are much slower than the fastest one.
+	const std::vector<Peer*>& vPeers = get_PeersByBps();
+
+	uint32_t nBpsMax = 0; // among those that can supply the data
+	for (size_t i = 0; i < vPeers.size(); i++)
+	{
+		const Peer& p = *vPeers[i];
+		if ((p.m_Tip.m_Height >= t.m_Key.first.m_Height) && (p.m_setRejected.end() == p.m_setRejected.find(t.m_Key)))
+		{
+			nBpsMax = p.get_Bps();
+			break; // the fastest
+		}
+	}
+
+	uint64_t nBpsMin = 0;
+	if (t.m_Key.second && (t.m_sidTrg.m_Height - t.m_Key.first.m_Height >= m_Cfg.m_BandwidthCtl.m_LargeBodyRange))
+		nBpsMin = nBpsMax / std::max(m_Cfg.m_BandwidthCtl.m_SlowPeerRatio, 1U);
+
 	// prefer to request data from nodes supporting latest protocol
 	for (uint32_t iCycle = 0; iCycle < 2; iCycle++)
 	{
@@ -312,14 +357,14 @@ void Node::TryAssignTask(Task& t, const PeerID* pPeerID)
 			bool bCreate = false;
 			PeerMan::PeerInfoPlus* pInfo = Cast::Up<PeerMan::PeerInfoPlus>(m_PeerMan.Find(*pPeerID, bCreate));
 
-			if (pInfo && pInfo->m_pLive && TryAssignTask(t, *pInfo->m_pLive, !iCycle))
+			if (pInfo && pInfo->m_pLive && !pInfo->m_pLive->IsSlow(nBpsMin) && TryAssignTask(t, *pInfo->m_pLive, !iCycle))
 				return;
 		}
 
-		for (PeerList::iterator it = m_lstPeers.begin(); m_lstPeers.end() != it; it++)
+		for (size_t i = 0; i < vPeers.size(); i++)
 		{
-			Peer& p = *it;
-			if (TryAssignTask(t, p, !iCycle))
+			Peer& p = *vPeers[t.m_Key.second ? i : (vPeers.size() - 1 - i)];
+			if (!p.IsSlow(nBpsMin) && TryAssignTask(t, p, !iCycle))
 				return;
 		}
 	}
@@ -362,6 +407,9 @@ bool Node::TryAssignTask(Task& t, Peer& p)
     if (p.m_setRejected.end() != p.m_setRejected.find(t.m_Key))
         return false;
 
+    if ((Peer::Flags::CompactBody & p.m_Flags) || p.m_pCompactBody)
+        return false; // the reconstruction may need another round-trip, don't queue other requests meanwhile
+
     // check if the peer currently transfers a block
     uint32_t nBlocks = 0;
     for (TaskList::iterator it = p.m_lstTasks.begin(); p.m_lstTasks.end() != it; it++)
@@ -374,22 +422,45 @@ bool Node::TryAssignTask(Task& t, Peer& p)
 		if (m_nTasksPackBody >= m_Cfg.m_MaxConcurrentBlocksRequest)
 			return false; // too many blocks requested
 
+		if (nBlocks && (proto::LoginFlags::Extension2 & p.m_LoginFlags))
+			return false; // spread the chunks among different peers
+
 		Height hCountExtra = t.m_sidTrg.m_Height - t.m_Key.first.m_Height;
 
-		if (proto::LoginFlags::Extension2 & p.m_LoginFlags)
+		if (!hCountExtra &&
+			(proto::LoginFlags::CompactBody & p.m_LoginFlags) &&
+			(t.m_Key.first.m_Height > m_Processor.m_SyncData.m_Target.m_Height) &&
+			p.m_lstTasks.empty() &&
+			!m_TxPool.m_setTxs.empty())
+		{
+			// a single block at the tip. Most of it is likely to be in our tx pool
+			proto::GetBodyCompact msg;
+			msg.m_ID = t.m_Key.first;
+			p.Send(msg);
+
+			p.m_Flags |= Peer::Flags::CompactBody;
+
+			t.m_nCount = 1;
+			m_nTasksPackBody++;
+		}
+		else if (proto::LoginFlags::Extension2 & p.m_LoginFlags)
 		{
 			proto::GetBodyPack msg;
 
 			if (t.m_Key.first.m_Height <= m_Processor.m_SyncData.m_Target.m_Height)
 			{
-				// fast-sync mode, diluted blocks request.
-				msg.m_Top.m_Height = m_Processor.m_SyncData.m_Target.m_Height;
+				// fast-sync mode, diluted blocks request. The chunk may end below the target
+				const NodeDB::StateID& sidTop = (t.m_sidTrg.m_Height < m_Processor.m_SyncData.m_Target.m_Height) ?
+					t.m_sidTrg :
+					m_Processor.m_SyncData.m_Target;
+
+				msg.m_Top.m_Height = sidTop.m_Height;
 				if (m_Processor.IsFastSync())
-					m_Processor.get_DB().get_StateHash(m_Processor.m_SyncData.m_Target.m_Row, msg.m_Top.m_Hash);
+					m_Processor.get_DB().get_StateHash(sidTop.m_Row, msg.m_Top.m_Hash);
 				else
 					msg.m_Top.m_Hash = Zero; // treasury
 
-				msg.m_CountExtra = m_Processor.m_SyncData.m_Target.m_Height - t.m_Key.first.m_Height;
+				msg.m_CountExtra = sidTop.m_Height - t.m_Key.first.m_Height;
 				msg.m_Height0 = m_Processor.m_SyncData.m_h0;
 				msg.m_HorizonLo1 = m_Processor.m_SyncData.m_TxoLo;
 				msg.m_HorizonHi1 = m_Processor.m_SyncData.m_Target.m_Height;
@@ -404,8 +475,9 @@ bool Node::TryAssignTask(Task& t, Peer& p)
 
 			p.Send(msg);
 
-			t.m_nCount = std::min(static_cast<uint32_t>(msg.m_CountExtra), m_Cfg.m_BandwidthCtl.m_MaxBodyPackCount) + 1; // just an estimate, the actual num of blocks can be smaller
-			m_nTasksPackBody += t.m_nCount;
+			// Account for the request, not the blocks. The number of chunks in flight is limited by the sync window
+			t.m_nCount = 1;
+			m_nTasksPackBody++;
 		}
 		else
 		{
@@ -505,7 +577,27 @@ void Node::Peer::SetTimerWrtFirstTask()
     if (m_lstTasks.empty())
         KillTimer();
     else
+    {
         SetTimer(m_lstTasks.front().m_Key.second ? m_This.m_Cfg.m_Timeout.m_GetBlock_ms : m_This.m_Cfg.m_Timeout.m_GetState_ms);
+        m_FirstTask_ms = GetTime_ms();
+    }
+}
+
+uint32_t Node::Peer::get_Bps() const
+{
+    return m_pInfo ? m_pInfo->m_Perf.m_Bps : 0;
+}
+
+bool Node::Peer::IsSlow(uint64_t nBpsMin) const
+{
+    uint32_t nBps = get_Bps();
+    return nBps && (nBps < nBpsMin); // not measured yet - give it a chance
+}
+
+void Node::Peer::OnBodiesDelivered(uint64_t nBytes)
+{
+    assert((Flags::PiRcvd & m_Flags) && m_pInfo);
+    m_This.m_PeerMan.OnThroughput(*m_pInfo, nBytes, GetTime_ms() - m_FirstTask_ms);
 }
 
 void Node::Processor::RequestData(const Block::SystemState::ID& id, bool bBlock, const PeerID* pPreferredPeer, const NodeDB::StateID& sidTrg)
@@ -679,6 +771,7 @@ void Node::Processor::TaskProcessor::Push(Task::Ptr&& pTask)
 
 	m_queTasks.push_back(std::move(pTask));
 	m_InProgress++;
+	s_mtxTaskQueue.Add(1);
 
 	m_NewTask.notify_one();
 }
@@ -736,6 +829,7 @@ void Node::Processor::TaskProcessor::Stop()
 			m_vThreads[i].join();
 
 	m_vThreads.clear();
+	s_mtxTaskQueue.Add(-static_cast<int64_t>(m_queTasks.size()));
 	m_queTasks.clear();
 }
 
@@ -762,6 +856,7 @@ void Node::Processor::TaskProcessor::Thread(uint32_t)
 					pGuard = std::move(m_queTasks.front());
 					pTask = pGuard.get();
 					m_queTasks.pop_front();
+					s_mtxTaskQueue.Add(-1);
 					break;
 				}
 
@@ -899,16 +994,24 @@ Node::Peer* Node::AllocPeer(const beam::io::Address& addr)
 {
     Peer* pPeer = new Peer(*this);
     m_lstPeers.push_back(*pPeer);
+	m_vPeersByBps.clear();
 
 	pPeer->m_UnsentHiMark = m_Cfg.m_BandwidthCtl.m_Drown;
+	pPeer->m_WatermarkHi = m_Cfg.m_BandwidthCtl.m_Chocking;
+	pPeer->m_WatermarkLo = m_Cfg.m_BandwidthCtl.m_Chocking / 2;
+	pPeer->m_pInboundPool = m_pInboundPool.get();
     pPeer->m_pInfo = NULL;
     pPeer->m_Flags = 0;
     pPeer->m_Port = 0;
     ZeroObject(pPeer->m_Tip);
     pPeer->m_RemoteAddr = addr;
     pPeer->m_LoginFlags = 0;
+    pPeer->m_LoginExtFlags = 0;
 	pPeer->m_CursorBbs = std::numeric_limits<int64_t>::max();
 	pPeer->m_pCursorTx = nullptr;
+	pPeer->m_FirstTask_ms = 0;
+	pPeer->m_Ping_ms = 0;
+	pPeer->m_nChockingPing = 0;
 
     LOG_INFO() << "+Peer " << addr;
 
@@ -932,9 +1035,27 @@ void Node::Keys::SetSingleKey(const Key::IKdf::Ptr& pKdf)
 
 void Node::Initialize(IExternalPOW* externalPOW)
 {
+	// several nodes may run in one process (tests, explorer), their samples are told apart by the listen port
+	std::string sMetricsLabels = "node=\"" + std::to_string(m_Cfg.m_Listen.port()) + "\"";
+
+	m_MetricsCollector.m_sLabels = sMetricsLabels;
+	Metrics::Registry::get().Add(m_MetricsCollector);
+
+	if (m_Cfg.m_ProfileDB)
+	{
+		m_pDbProfile = std::make_unique<Metrics::QueryProfile>("node");
+		m_pDbProfile->m_sLabels = std::move(sMetricsLabels);
+		m_Processor.get_DB().set_Profile(m_pDbProfile.get());
+		Metrics::Registry::get().Add(*m_pDbProfile);
+	}
+
     m_Processor.m_Horizon = m_Cfg.m_Horizon;
+    m_Processor.m_SyncWindow = m_Cfg.m_SyncWindow;
     m_Processor.Initialize(m_Cfg.m_sPathLocal.c_str(), m_Cfg.m_ProcessorParams);
 
+	if (m_Cfg.m_InboundThreads)
+		m_pInboundPool = std::make_unique<InboundPool>(io::Reactor::get_Current(), m_Cfg.m_InboundThreads);
+
 	if (m_Cfg.m_ProcessorParams.m_EraseSelfID)
 	{
 		m_Processor.get_DB().ParamSet(NodeDB::ParamID::MyID, nullptr, nullptr);
@@ -1066,6 +1187,18 @@ Node::~Node()
 {
     LOG_INFO() << "Node stopping...";
 
+	Metrics::Registry::get().Remove(m_MetricsCollector);
+
+	if (m_pDbProfile)
+	{
+		Metrics::Registry::get().Remove(*m_pDbProfile);
+		m_Processor.get_DB().set_Profile(nullptr); // the DB outlives it
+
+		std::string s;
+		m_pDbProfile->Dump(s);
+		LOG_INFO() << s;
+	}
+
     m_Miner.HardAbortSafe();
 	if (m_Miner.m_External.m_pSolver)
 		m_Miner.m_External.m_pSolver->stop();
@@ -1100,6 +1233,45 @@ Node::~Node()
     LOG_INFO() << "Node stopped";
 }
 
+void Node::MetricsCollector::Collect(Metrics::Writer& w)
+{
+	Node& n = get_ParentObj();
+
+	uint64_t nFluffSize = 0;
+	for (TxPool::Fluff::ProfitSet::iterator it = n.m_TxPool.m_setProfit.begin(); n.m_TxPool.m_setProfit.end() != it; it++)
+		nFluffSize += it->m_nSize;
+
+	w.Type("node_txpool_fluff_txs", "Transactions in the fluff pool", "gauge");
+	w.Sample("node_txpool_fluff_txs", nullptr, nullptr, static_cast<uint64_t>(n.m_TxPool.m_setProfit.size()));
+	w.Type("node_txpool_fluff_bytes", "Size of the transactions in the fluff pool", "gauge");
+	w.Sample("node_txpool_fluff_bytes", nullptr, nullptr, nFluffSize);
+	w.Type("node_txpool_stem_kernels", "Kernels of the transactions in the stem pool", "gauge");
+	w.Sample("node_txpool_stem_kernels", nullptr, nullptr, static_cast<uint64_t>(n.m_Dandelion.m_setKrns.size()));
+
+	w.Type("node_peers", "Connected peers", "gauge");
+	w.Sample("node_peers", nullptr, nullptr, static_cast<uint64_t>(n.m_lstPeers.size()));
+
+	const char* szRecv = "node_peer_received_bytes_total";
+	const char* szSent = "node_peer_sent_bytes_total";
+
+	std::string sLabels;
+	for (int iDir = 0; iDir < 2; iDir++)
+	{
+		const char* szName = iDir ? szSent : szRecv;
+		w.Type(szName, iDir ? "Bytes sent to the peer" : "Bytes received from the peer", "counter");
+
+		for (PeerList::iterator it = n.m_lstPeers.begin(); n.m_lstPeers.end() != it; it++)
+		{
+			const Connection* pConn = it->get_Connection();
+			if (!pConn)
+				continue;
+
+			sLabels = "peer=\"" + it->m_RemoteAddr.str() + "\"";
+			w.Sample(szName, nullptr, sLabels.c_str(), iDir ? pConn->get_Sent() : pConn->get_Received());
+		}
+	}
+}
+
 void Node::Peer::SetTimer(uint32_t timeout_ms)
 {
     if (!m_pTimer)
@@ -1123,7 +1295,10 @@ void Node::Peer::OnTimer()
         LOG_WARNING() << "Peer " << m_RemoteAddr << " request timeout";
 
         if (m_pInfo)
+        {
             m_This.m_PeerMan.ModifyRating(*m_pInfo, PeerMan::Rating::PenaltyTimeout, false); // task (request) wasn't handled in time.
+            m_This.m_PeerMan.OnRequestDone(*m_pInfo, false);
+        }
 
         DeleteSelf(false, ByeReason::Timeout);
     }
@@ -1181,6 +1356,7 @@ void Node::Peer::OnConnectedSecure()
     ProveID(m_This.m_MyPrivateID, proto::IDType::Node);
 
 	SendLogin();
+	SendPing(false); // measure RTT
 
     if (m_This.m_Processor.IsTreasuryHandled() && !m_This.m_Processor.IsFastSync())
     {
@@ -1198,6 +1374,8 @@ void Node::Peer::SendLogin()
 	msgLogin.m_Flags =
 		proto::LoginFlags::Extension1 |
 		proto::LoginFlags::Extension2 |
+		proto::LoginFlags::CompactBody |
+		proto::LoginFlags::Extended |
 		proto::LoginFlags::SendPeers; // request a another node to periodically send a list of recommended peers
 
 	if (m_This.m_PostStartSynced)
@@ -1398,6 +1576,9 @@ void Node::Peer::ReleaseTask(Task& t)
     assert(this == t.m_pOwner);
     t.m_pOwner = NULL;
 
+	m_Flags &= ~Flags::CompactBody;
+	m_pCompactBody.reset();
+
     if (t.m_nCount)
     {
         uint32_t& nCounter = t.m_Key.second ? m_This.m_nTasksPackBody : m_This.m_nTasksPackHdr;
@@ -1470,6 +1651,7 @@ void Node::Peer::DeleteSelf(bool bIsError, uint8_t nByeReason)
 	SetTxCursor(nullptr);
 
     m_This.m_lstPeers.erase(PeerList::s_iterator_to(*this));
+	m_This.m_vPeersByBps.clear();
    
     delete this;
 }
@@ -1496,11 +1678,62 @@ void Node::Peer::TakeTasks()
         m_This.TryAssignTask(*it++, *this);
 }
 
+void Node::Peer::SendPing(bool bChocking)
+{
+	// Pongs come in order. Only the pong of the chocking ping tells that the data queued before it is handled
+	if (bChocking)
+	{
+		if (m_nChockingPing)
+			return; // already pending
+
+		m_nChockingPing = m_Ping_ms ? 2 : 1;
+	}
+	else
+	{
+		if (m_Ping_ms || m_nChockingPing)
+			return; // already pending, or the RTT would be measured after a lot of data
+
+		m_Ping_ms = GetTimeNnz_ms();
+	}
+
+	Send(proto::Ping(Zero));
+}
+
 void Node::Peer::OnMsg(proto::Pong&&)
 {
-	if (!(Flags::Chocking & m_Flags))
+	if (m_nChockingPing && !--m_nChockingPing)
+	{
+		if ((Flags::Chocking & m_Flags) && !(Flags::Overflow & m_Flags))
+			OnChockingOver(); // otherwise wait for the stream to drain
+		return;
+	}
+
+	if (!m_Ping_ms)
 		ThrowUnexpected();
 
+	uint32_t dt_ms = GetTime_ms() - m_Ping_ms;
+	m_Ping_ms = 0;
+
+	// the RTT is meaningful only if the ping wasn't queued after a lot of data
+	if (!(Flags::Chocking & m_Flags) && m_pInfo)
+		m_This.m_PeerMan.OnRtt(*m_pInfo, dt_ms);
+}
+
+void Node::Peer::OnWatermark(bool bOverflow)
+{
+	if (bOverflow)
+	{
+		m_Flags |= Flags::Overflow | Flags::Chocking;
+		return;
+	}
+
+	m_Flags &= ~Flags::Overflow;
+	if (Flags::Chocking & m_Flags)
+		OnChockingOver();
+}
+
+void Node::Peer::OnChockingOver()
+{
 	m_Flags &= ~Flags::Chocking;
 
 	// not chocking - continue broadcast
@@ -1587,6 +1820,9 @@ void Node::Peer::OnMsg(proto::DataMissing&&)
     Task& t = get_FirstTask();
     m_setRejected.insert(t.m_Key);
 
+    if (m_pInfo)
+        m_This.m_PeerMan.OnRequestDone(*m_pInfo, false);
+
     OnFirstTaskDone();
 }
 
@@ -1672,39 +1908,30 @@ void Node::Peer::OnMsg(proto::HdrPack&& msg)
     if (msg.m_vElements.empty() || (msg.m_vElements.size() > proto::g_HdrPackMaxSize))
         ThrowUnexpected();
 
-    Block::SystemState::Full s;
-    Cast::Down<Block::SystemState::Sequence::Prefix>(s) = msg.m_Prefix;
-    Cast::Down<Block::SystemState::Sequence::Element>(s) = msg.m_vElements.back();
+    // elements are in reverse order
+    std::vector<Block::SystemState::Full> vStates(msg.m_vElements.size());
 
-    uint32_t nAccepted = 0;
-    bool bInvalid = false;
-
-	Block::SystemState::ID idLast;
-
-    for (size_t i = msg.m_vElements.size(); ; )
+    for (size_t i = 0; i < vStates.size(); i++)
     {
-        NodeProcessor::DataStatus::Enum eStatus = m_This.m_Processor.OnStateSilent(s, m_pInfo->m_ID.m_Key, idLast);
-        switch (eStatus)
+        Block::SystemState::Full& s = vStates[i];
+        if (i)
         {
-        case NodeProcessor::DataStatus::Invalid:
-            bInvalid = true;
-            break;
-
-        case NodeProcessor::DataStatus::Accepted:
-            nAccepted++;
-
-        default:
-            break; // suppress warning
+            s = vStates[i - 1];
+            s.NextPrefix();
         }
+        else
+            Cast::Down<Block::SystemState::Sequence::Prefix>(s) = msg.m_Prefix;
 
-        if (! --i)
-            break;
-
-        s.NextPrefix();
-        Cast::Down<Block::SystemState::Sequence::Element>(s) = msg.m_vElements[i - 1];
-        s.m_ChainWork += s.m_PoW.m_Difficulty;
+        Cast::Down<Block::SystemState::Sequence::Element>(s) = msg.m_vElements[vStates.size() - i - 1];
+        if (i)
+            s.m_ChainWork += s.m_PoW.m_Difficulty;
     }
 
+    bool bInvalid = false;
+	Block::SystemState::ID idLast;
+
+    uint32_t nAccepted = m_This.m_Processor.OnStatesSilent(&vStates.front(), vStates.size(), m_pInfo->m_ID.m_Key, idLast, bInvalid);
+
     // just to be pedantic
     if (idLast != t.m_Key.first)
         bInvalid = true;
@@ -1817,6 +2044,15 @@ void Node::Peer::OnMsg(proto::GetBodyPack&& msg)
 }
 
 void Node::Peer::OnMsg(proto::Body&& msg)
+{
+	if (!get_FirstTask().m_Key.second)
+		ThrowUnexpected();
+
+	OnBodiesDelivered(msg.m_Body.m_Perishable.size() + msg.m_Body.m_Eternal.size());
+	OnBody(std::move(msg));
+}
+
+void Node::Peer::OnBody(proto::Body&& msg)
 {
 	Task& t = get_FirstTask();
 
@@ -1861,6 +2097,11 @@ void Node::Peer::OnMsg(proto::BodyPack&& msg)
 	NodeProcessor::DataStatus::Enum eStatus = NodeProcessor::DataStatus::Rejected;
 	if (!msg.m_Bodies.empty())
 	{
+		uint64_t nBytes = 0;
+		for (size_t i = 0; i < msg.m_Bodies.size(); i++)
+			nBytes += msg.m_Bodies[i].m_Perishable.size() + msg.m_Bodies[i].m_Eternal.size();
+		OnBodiesDelivered(nBytes);
+
 		const uint64_t* pPtr = p.get_CachedRows(t.m_sidTrg, hCountExtra);
 		if (pPtr)
 		{
@@ -1890,12 +2131,143 @@ void Node::Peer::OnMsg(proto::BodyPack&& msg)
 	OnFirstTaskDone(eStatus);
 }
 
+bool Node::Peer::LoadBody(const Block::SystemState::ID& id, Block::Body& body)
+{
+	Processor& p = m_This.m_Processor; // alias
+
+	if (!id.m_Height)
+		return false;
+
+	NodeDB::StateID sid;
+	sid.m_Row = p.get_DB().StateFindSafe(id);
+	if (!sid.m_Row)
+		return false;
+	sid.m_Height = id.m_Height;
+
+	proto::BodyBuffers bb;
+	if (!p.GetBlock(sid, &bb.m_Eternal, &bb.m_Perishable, 0, 0, 0))
+		return false;
+
+	try {
+		Deserializer der;
+		der.reset(bb.m_Perishable);
+		der & Cast::Down<Block::BodyBase>(body);
+		der & Cast::Down<TxVectors::Perishable>(body);
+
+		der.reset(bb.m_Eternal);
+		der & Cast::Down<TxVectors::Eternal>(body);
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+
+	return true;
+}
+
+void Node::Peer::OnMsg(proto::GetBodyCompact&& msg)
+{
+	Block::Body body;
+	if (LoadBody(msg.m_ID, body))
+	{
+		proto::BodyCompact msgOut;
+		m_This.NextNonce().ExportWord<0>(msgOut.m_Nonce);
+		proto::CompactBody::Create(msgOut, body);
+		Send(msgOut);
+	}
+	else
+	{
+		proto::DataMissing msgMiss(Zero);
+		Send(msgMiss);
+	}
+}
+
+void Node::Peer::OnMsg(proto::GetBodyCompactMissing&& msg)
+{
+	Block::Body body;
+	if (LoadBody(msg.m_ID, body))
+	{
+		proto::BodyCompactMissing msgOut;
+		proto::CompactBody::get_Missing(msgOut, body, msg);
+		Send(msgOut);
+	}
+	else
+	{
+		proto::DataMissing msgMiss(Zero);
+		Send(msgMiss);
+	}
+}
+
+void Node::Peer::OnMsg(proto::BodyCompact&& msg)
+{
+	Task& t = get_FirstTask();
+
+	if (!t.m_Key.second || !(Flags::CompactBody & m_Flags))
+		ThrowUnexpected();
+
+	m_Flags &= ~Flags::CompactBody;
+
+	m_pCompactBody.reset(new proto::CompactBody::Assembler);
+	if (!m_pCompactBody->Init(msg))
+		ThrowUnexpected();
+
+	size_t nShort = msg.m_Outputs.size() + msg.m_Kernels.size();
+
+	for (TxPool::Fluff::TxSet::iterator it = m_This.m_TxPool.m_setTxs.begin(); m_This.m_TxPool.m_setTxs.end() != it; it++)
+	{
+		if (m_pCompactBody->IsComplete())
+			break;
+
+		m_pCompactBody->Add(*it->get_ParentObj().m_pValue);
+	}
+
+	if (m_pCompactBody->IsComplete())
+	{
+		LOG_INFO() << t.m_Key.first << " Compact block reconstructed, elements from pool: " << nShort;
+		OnCompactBodyComplete();
+	}
+	else
+	{
+		proto::GetBodyCompactMissing msgOut;
+		msgOut.m_ID = t.m_Key.first;
+		m_pCompactBody->get_Missing(msgOut);
+
+		LOG_INFO() << t.m_Key.first << " Compact block, elements from pool: " << (nShort - msgOut.m_Outputs.size() - msgOut.m_Kernels.size()) << ", missing: " << (msgOut.m_Outputs.size() + msgOut.m_Kernels.size());
+		Send(msgOut);
+	}
+}
+
+void Node::Peer::OnMsg(proto::BodyCompactMissing&& msg)
+{
+	Task& t = get_FirstTask();
+
+	if (!t.m_Key.second || !m_pCompactBody)
+		ThrowUnexpected();
+
+	if (!m_pCompactBody->Add(msg) || !m_pCompactBody->IsComplete())
+		ThrowUnexpected();
+
+	OnCompactBodyComplete();
+}
+
+void Node::Peer::OnCompactBodyComplete()
+{
+	proto::Body msgBody;
+	m_pCompactBody->Finalize(msgBody.m_Body);
+	m_pCompactBody.reset();
+
+	OnBody(std::move(msgBody)); // not accounted as delivered bytes, most of the body is from our pool
+}
+
 void Node::Peer::OnFirstTaskDone(NodeProcessor::DataStatus::Enum eStatus)
 {
     if (NodeProcessor::DataStatus::Invalid == eStatus)
         ThrowUnexpected();
 
     get_FirstTask().m_bNeeded = false;
+
+    if (m_pInfo)
+        m_This.m_PeerMan.OnRequestDone(*m_pInfo, true);
+
     OnFirstTaskDone();
 }
 
@@ -2365,9 +2737,6 @@ bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPo
 	if (!pNewTxElem)
 		return false;
 
-    proto::HaveTransaction msgOut;
-    msgOut.m_ID = key.m_Key;
-
     for (PeerList::iterator it2 = m_lstPeers.begin(); m_lstPeers.end() != it2; it2++)
     {
         Peer& peer = *it2;
@@ -2376,7 +2745,7 @@ bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPo
         if (!(peer.m_LoginFlags & proto::LoginFlags::SpreadingTransactions) || peer.IsChocking())
             continue;
 
-        peer.Send(msgOut);
+        peer.AnnounceTx(key.m_Key);
 		peer.SetTxCursor(pNewTxElem);
     }
 
@@ -2432,6 +2801,18 @@ void Node::Peer::OnMsg(proto::Login&& msg)
 		Send(msgOut);
 	}
 
+	if (proto::LoginFlags::Extended & msg.m_Flags)
+	{
+		if (!(proto::LoginFlags::Extended & m_LoginFlags))
+		{
+			proto::LoginExt msgOut;
+			msgOut.m_Flags = proto::LoginExtFlags::TxsBatch | proto::LoginExtFlags::ProofsBatch;
+			Send(msgOut);
+		}
+	}
+	else
+		m_LoginExtFlags = 0;
+
     m_LoginFlags = msg.m_Flags;
 
 	if (b != ShouldFinalizeMining()) {
@@ -2443,12 +2824,18 @@ void Node::Peer::OnMsg(proto::Login&& msg)
 	BroadcastBbs();
 }
 
+void Node::Peer::OnMsg(proto::LoginExt&& msg)
+{
+	m_LoginExtFlags = msg.m_Flags;
+}
+
 bool Node::Peer::IsChocking(size_t nExtra /* = 0 */)
 {
 	if (Flags::Chocking & m_Flags)
 		return true;
 
-	if (get_Unsent() + nExtra  <= m_This.m_Cfg.m_BandwidthCtl.m_Chocking)
+	// the sent data is watched by the stream (see OnWatermark), here only the estimated extra is checked
+	if (!nExtra || (get_Unsent() + nExtra <= m_This.m_Cfg.m_BandwidthCtl.m_Chocking))
 		return false;
 
 	OnChocking();
@@ -2460,7 +2847,7 @@ void Node::Peer::OnChocking()
 	if (!(Flags::Chocking & m_Flags))
 	{
 		m_Flags |= Flags::Chocking;
-		Send(proto::Ping(Zero));
+		SendPing(true); // the data isn't sent yet, wait till the peer handles what's already queued
 	}
 }
 
@@ -2504,9 +2891,7 @@ void Node::Peer::BroadcastTxs()
 		if (!m_pCursorTx->m_pValue)
 			continue; // already deleted
 
-		proto::HaveTransaction msgOut;
-		msgOut.m_ID = m_pCursorTx->m_Tx.m_Key;
-		Send(msgOut);
+		AnnounceTx(m_pCursorTx->m_Tx.m_Key);
 
 		nExtra += m_pCursorTx->m_Profit.m_nSize;
 		if (IsChocking(nExtra))
@@ -2543,27 +2928,61 @@ void Node::Peer::BroadcastBbs()
 	m_CursorBbs = wlk.m_ID;
 }
 
-void Node::Peer::OnMsg(proto::HaveTransaction&& msg)
+void Node::Peer::AnnounceTx(const Transaction::KeyType& key)
+{
+	if (!(proto::LoginExtFlags::TxsBatch & m_LoginExtFlags))
+	{
+		proto::HaveTransaction msgOut;
+		msgOut.m_ID = key;
+		Send(msgOut);
+		return;
+	}
+
+	m_vTxsPending.push_back(key);
+
+	if (m_vTxsPending.size() >= proto::g_TxsBatchMaxSize)
+		FlushTxs();
+	else
+	{
+		if (1 == m_vTxsPending.size())
+		{
+			if (!m_pTimerTxs)
+				m_pTimerTxs = io::Timer::create(io::Reactor::get_Current());
+
+			m_pTimerTxs->start(m_This.m_Cfg.m_Timeout.m_TxsFlush_ms, false, [this]() { FlushTxs(); });
+		}
+	}
+}
+
+void Node::Peer::FlushTxs()
+{
+	if (m_pTimerTxs)
+		m_pTimerTxs->cancel();
+
+	if (m_vTxsPending.empty())
+		return;
+
+	proto::HaveTransactions msgOut;
+	msgOut.m_IDs.swap(m_vTxsPending);
+	Send(msgOut);
+}
+
+bool Node::Peer::IsTxWanted(const Transaction::KeyType& id)
 {
     TxPool::Fluff::Element::Tx key;
-    key.m_Key = msg.m_ID;
+    key.m_Key = id;
 
     TxPool::Fluff::TxSet::iterator it = m_This.m_TxPool.m_setTxs.find(key);
     if (m_This.m_TxPool.m_setTxs.end() != it)
-        return; // already have it
+        return false; // already have it
 
-    if (!m_This.m_Wtx.Add(key.m_Key))
-        return; // already waiting for it
-
-    proto::GetTransaction msgOut;
-    msgOut.m_ID = msg.m_ID;
-    Send(msgOut);
+    return m_This.m_Wtx.Add(key.m_Key); // false if already waiting for it
 }
 
-void Node::Peer::OnMsg(proto::GetTransaction&& msg)
+void Node::Peer::SendTxIfHave(const Transaction::KeyType& id)
 {
     TxPool::Fluff::Element::Tx key;
-    key.m_Key = msg.m_ID;
+    key.m_Key = id;
 
     TxPool::Fluff::TxSet::iterator it = m_This.m_TxPool.m_setTxs.find(key);
     if (m_This.m_TxPool.m_setTxs.end() == it)
@@ -2572,6 +2991,44 @@ void Node::Peer::OnMsg(proto::GetTransaction&& msg)
     SendTx(it->get_ParentObj().m_pValue, true);
 }
 
+void Node::Peer::OnMsg(proto::HaveTransaction&& msg)
+{
+    if (!IsTxWanted(msg.m_ID))
+        return;
+
+    proto::GetTransaction msgOut;
+    msgOut.m_ID = msg.m_ID;
+    Send(msgOut);
+}
+
+void Node::Peer::OnMsg(proto::GetTransaction&& msg)
+{
+    SendTxIfHave(msg.m_ID);
+}
+
+void Node::Peer::OnMsg(proto::HaveTransactions&& msg)
+{
+	if (msg.m_IDs.size() > proto::g_TxsBatchMaxSize)
+		ThrowUnexpected();
+
+	proto::GetTransactions msgOut;
+	for (size_t i = 0; i < msg.m_IDs.size(); i++)
+		if (IsTxWanted(msg.m_IDs[i]))
+			msgOut.m_IDs.push_back(msg.m_IDs[i]);
+
+	if (!msgOut.m_IDs.empty())
+		Send(msgOut);
+}
+
+void Node::Peer::OnMsg(proto::GetTransactions&& msg)
+{
+	if (msg.m_IDs.size() > proto::g_TxsBatchMaxSize)
+		ThrowUnexpected();
+
+	for (size_t i = 0; i < msg.m_IDs.size(); i++)
+		SendTxIfHave(msg.m_IDs[i]);
+}
+
 void Node::Peer::SendTx(Transaction::Ptr& ptx, bool bFluff)
 {
     proto::NewTransaction msg;
@@ -2639,26 +3096,45 @@ void Node::Processor::GenerateProofStateStrict(Merkle::HardProof& proof, Height
     get_Utxos().get_Hash(proof.back());
 }
 
-void Node::Peer::OnMsg(proto::GetProofKernel&& msg)
+void Node::Processor::GenerateProofKernel(TxKernel::LongProof& proof, const Merkle::Hash& idKrn)
 {
-    proto::ProofKernel msgOut;
+	if (IsFastSync())
+		return;
 
-    Processor& p = m_This.m_Processor;
-	if (!p.IsFastSync())
+	Height h = get_ProofKernel(proof.m_Inner, NULL, idKrn);
+	if (h)
 	{
-		Height h = p.get_ProofKernel(msgOut.m_Proof.m_Inner, NULL, msg.m_ID);
-		if (h)
-		{
-			uint64_t rowid = p.FindActiveAtStrict(h);
-			p.get_DB().get_State(rowid, msgOut.m_Proof.m_State);
+		uint64_t rowid = FindActiveAtStrict(h);
+		get_DB().get_State(rowid, proof.m_State);
 
-			if (h < p.m_Cursor.m_ID.m_Height)
-				p.GenerateProofStateStrict(msgOut.m_Proof.m_Outer, h);
-		}
+		if (h < m_Cursor.m_ID.m_Height)
+			GenerateProofStateStrict(proof.m_Outer, h);
 	}
+}
+
+void Node::Peer::OnMsg(proto::GetProofKernel&& msg)
+{
+    proto::ProofKernel msgOut;
+	m_This.m_Processor.GenerateProofKernel(msgOut.m_Proof, msg.m_ID);
     Send(msgOut);
 }
 
+void Node::Peer::OnMsg(proto::GetProofKernels&& msg)
+{
+	if (msg.m_IDs.size() > proto::g_ProofsBatchMaxSize)
+		ThrowUnexpected();
+
+	s_mtxProofsBatched.Inc(msg.m_IDs.size());
+
+	proto::ProofKernels msgOut;
+	msgOut.m_Proofs.resize(msg.m_IDs.size());
+
+	for (size_t i = 0; i < msg.m_IDs.size(); i++)
+		m_This.m_Processor.GenerateProofKernel(msgOut.m_Proofs[i], msg.m_IDs[i]);
+
+	Send(msgOut);
+}
+
 void Node::Peer::OnMsg(proto::GetProofKernel2&& msg)
 {
     proto::ProofKernel2 msgOut;
@@ -2669,11 +3145,11 @@ void Node::Peer::OnMsg(proto::GetProofKernel2&& msg)
     Send(msgOut);
 }
 
-void Node::Peer::OnMsg(proto::GetProofUtxo&& msg)
+void Node::Processor::GenerateProofUtxo(std::vector<Input::Proof>& vProofs, const ECC::Point& comm, Height hMaturityMin)
 {
     struct Traveler :public UtxoTree::ITraveler
     {
-        proto::ProofUtxo m_Msg;
+        std::vector<Input::Proof>& m_Proofs;
         UtxoTree* m_pTree;
         Merkle::Hash m_hvHistory;
 
@@ -2683,8 +3159,8 @@ void Node::Peer::OnMsg(proto::GetProofUtxo&& msg)
             UtxoTree::Key::Data d;
             d = v.m_Key;
 
-            m_Msg.m_Proofs.resize(m_Msg.m_Proofs.size() + 1);
-            Input::Proof& ret = m_Msg.m_Proofs.back();
+            m_Proofs.resize(m_Proofs.size() + 1);
+            Input::Proof& ret = m_Proofs.back();
 
             ret.m_State.m_Count = v.get_Count();
             ret.m_State.m_Maturity = d.m_Maturity;
@@ -2694,15 +3170,16 @@ void Node::Peer::OnMsg(proto::GetProofUtxo&& msg)
             ret.m_Proof.back().first = false;
             ret.m_Proof.back().second = m_hvHistory;
 
-            return m_Msg.m_Proofs.size() < Input::Proof::s_EntriesMax;
+            return m_Proofs.size() < Input::Proof::s_EntriesMax;
         }
-    } t;
 
-	Processor& p = m_This.m_Processor;
-	if (!p.IsFastSync())
+        Traveler(std::vector<Input::Proof>& vProofs) :m_Proofs(vProofs) {}
+    } t(vProofs);
+
+	if (!IsFastSync())
 	{
-		t.m_pTree = &p.get_Utxos();
-		t.m_hvHistory = p.m_Cursor.m_History;
+		t.m_pTree = &get_Utxos();
+		t.m_hvHistory = m_Cursor.m_History;
 
 		UtxoTree::Cursor cu;
 		t.m_pCu = &cu;
@@ -2711,8 +3188,8 @@ void Node::Peer::OnMsg(proto::GetProofUtxo&& msg)
 		UtxoTree::Key kMin, kMax;
 
 		UtxoTree::Key::Data d;
-		d.m_Commitment = msg.m_Utxo;
-		d.m_Maturity = msg.m_MaturityMin;
+		d.m_Commitment = comm;
+		d.m_Maturity = hMaturityMin;
 		kMin = d;
 		d.m_Maturity = Height(-1);
 		kMax = d;
@@ -2722,8 +3199,29 @@ void Node::Peer::OnMsg(proto::GetProofUtxo&& msg)
 
 		t.m_pTree->Traverse(t);
 	}
+}
+
+void Node::Peer::OnMsg(proto::GetProofUtxo&& msg)
+{
+	proto::ProofUtxo msgOut;
+	m_This.m_Processor.GenerateProofUtxo(msgOut.m_Proofs, msg.m_Utxo, msg.m_MaturityMin);
+	Send(msgOut);
+}
+
+void Node::Peer::OnMsg(proto::GetProofUtxos&& msg)
+{
+	if (msg.m_Utxos.size() > proto::g_ProofsBatchMaxSize)
+		ThrowUnexpected();
 
-    Send(t.m_Msg);
+	s_mtxProofsBatched.Inc(msg.m_Utxos.size());
+
+	proto::ProofUtxos msgOut;
+	msgOut.m_Proofs.resize(msg.m_Utxos.size());
+
+	for (size_t i = 0; i < msg.m_Utxos.size(); i++)
+		m_This.m_Processor.GenerateProofUtxo(msgOut.m_Proofs[i], msg.m_Utxos[i], 0);
+
+	Send(msgOut);
 }
 
 bool Node::Processor::BuildCwp()
@@ -2894,8 +3392,6 @@ void Node::Peer::OnMsg(const proto::BbsMsg& msg, bool bNonceValid)
 
         s.m_pPeer->SendBbsMsg(wlk.m_Data);
 		s.m_Cursor = id;
-
-		s.m_pPeer->IsChocking(); // in case it's chocking - for faster recovery recheck it ASAP
     }
 }
 
@@ -19,6 +19,7 @@
 #include "core/proto.h"
 #include "core/block_crypt.h"
 #include "core/peer_manager.h"
+#include "utility/metrics.h"
 #include <boost/intrusive/list.hpp>
 #include <boost/intrusive/set.hpp>
 #include <condition_variable>
@@ -55,11 +56,13 @@ struct Node
 
 		std::string m_sPathLocal;
 		NodeProcessor::Horizon m_Horizon;
+		NodeProcessor::SyncWindow m_SyncWindow;
 
 		struct Timeout {
 			uint32_t m_GetState_ms	= 1000 * 5;
 			uint32_t m_GetBlock_ms	= 1000 * 30;
 			uint32_t m_GetTx_ms		= 1000 * 5;
+			uint32_t m_TxsFlush_ms	= 100; // tx announcements are accumulated and sent in batches
 			uint32_t m_GetBbsMsg_ms	= 1000 * 10;
 			uint32_t m_MiningSoftRestart_ms = 1000;
 			uint32_t m_TopPeersUpd_ms = 1000 * 60 * 10; // once in 10 minutes
@@ -75,12 +78,17 @@ struct Node
 		uint32_t m_MiningThreads = 0; // by default disabled
 
 		bool m_LogUtxos = false; // may be insecure. Off by default.
+		bool m_ProfileDB = false; // per-statement DB statistics, logged on exit
 
 		// Number of verification threads for CPU-hungry cryptography. Currently used for block validation only.
 		// 0: single threaded
 		// negative: number of cores minus number of mining threads.
 		int m_VerificationThreads = 0;
 
+		// Number of threads for decryption, MAC checks and framing of the established peer connections.
+		// 0: done in the node thread. The messages are processed in the node thread anyway.
+		uint32_t m_InboundThreads = 0;
+
 		bool m_Bbs = true;
 		bool m_BbsAllowV0 = true; // allow older format, without pow
 
@@ -92,6 +100,10 @@ struct Node
 			size_t m_MaxBodyPackSize = 1024 * 1024 * 5;
 			uint32_t m_MaxBodyPackCount = 3000;
 
+			// body ranges of at least this size go to the fastest peers. Those slower than the fastest by m_SlowPeerRatio get headers only
+			Height m_LargeBodyRange = 16;
+			uint32_t m_SlowPeerRatio = 4;
+
 		} m_BandwidthCtl;
 
 		struct TestMode {
@@ -218,6 +230,8 @@ private:
 		bool BuildCwp();
 
 		void GenerateProofStateStrict(Merkle::HardProof&, Height);
+		void GenerateProofKernel(TxKernel::LongProof&, const Merkle::Hash&);
+		void GenerateProofUtxo(std::vector<Input::Proof>&, const ECC::Point&, Height hMaturityMin);
 
 		bool m_bFlushPending = false;
 		io::Timer::Ptr m_pFlushTimer;
@@ -329,6 +343,18 @@ private:
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Dandelion)
 	} m_Dandelion;
 
+	struct MetricsCollector
+		:public Metrics::Collector
+	{
+		// pool sizes and per-peer traffic, read at scrape time
+		virtual void Collect(Metrics::Writer&) override;
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_MetricsCollector)
+	} m_MetricsCollector;
+
+	std::unique_ptr<Metrics::QueryProfile> m_pDbProfile;
+	std::unique_ptr<InboundPool> m_pInboundPool; // the peers are deleted before it
+
 	bool OnTransactionStem(Transaction::Ptr&&, const Peer*);
 	void OnTransactionAggregated(Dandelion::Element&);
 	void PerformAggregation(Dandelion::Element&);
@@ -424,6 +450,8 @@ private:
 			static const uint16_t Finalizing	= 0x080;
 			static const uint16_t HasTreasury	= 0x100;
 			static const uint16_t Chocking		= 0x200;
+			static const uint16_t CompactBody	= 0x400; // GetBodyCompact is pending
+			static const uint16_t Overflow		= 0x800; // unsent data is over the high watermark, the stream reports when it drains
 		};
 
 		uint16_t m_Flags;
@@ -432,18 +460,27 @@ private:
 
 		Block::SystemState::Full m_Tip;
 		uint8_t m_LoginFlags;
+		uint32_t m_LoginExtFlags;
 
 		uint64_t m_CursorBbs;
 		TxPool::Fluff::Element* m_pCursorTx;
 
 		TaskList m_lstTasks;
+		uint32_t m_FirstTask_ms; // when the current 1st task became the 1st, to measure the response time
+		uint32_t m_Ping_ms; // pending RTT ping
+		uint8_t m_nChockingPing; // pongs till the one of the chocking ping, 0 if it's not pending
 		std::set<Task::Key> m_setRejected; // data that shouldn't be requested from this peer. Reset after reconnection or on receiving NewTip
 
+		std::unique_ptr<proto::CompactBody::Assembler> m_pCompactBody; // block being reconstructed, waiting for the missing elements
+
 		Bbs::Subscription::PeerSet m_Subscriptions;
 
 		io::Timer::Ptr m_pTimer;
 		io::Timer::Ptr m_pTimerPeers;
 
+		std::vector<Transaction::KeyType> m_vTxsPending; // announcements not sent yet
+		io::Timer::Ptr m_pTimerTxs;
+
 		Peer(Node& n) :m_This(n) {}
 
 		void TakeTasks();
@@ -459,9 +496,19 @@ private:
 		void SendBbsMsg(const NodeDB::WalkerBbs::Data&);
 		void DeleteSelf(bool bIsError, uint8_t nByeReason);
 		void BroadcastTxs();
+		void AnnounceTx(const Transaction::KeyType&);
+		void FlushTxs();
+		bool IsTxWanted(const Transaction::KeyType&);
+		void SendTxIfHave(const Transaction::KeyType&);
 		void BroadcastBbs();
 		void BroadcastBbs(Bbs::Subscription&);
 		void OnChocking();
+		void OnChockingOver();
+		void SendPing(bool bChocking);
+		uint32_t get_Bps() const; // measured throughput, 0 if unknown
+		bool IsSlow(uint64_t nBpsMin) const;
+		void OnBodiesDelivered(uint64_t nBytes);
+		void OnBody(proto::Body&&);
 		void SetTxCursor(TxPool::Fluff::Element*);
 		void SendLogin();
 
@@ -471,6 +518,8 @@ private:
 		Task& get_FirstTask();
 		void OnFirstTaskDone();
 		void OnFirstTaskDone(NodeProcessor::DataStatus::Enum);
+		bool LoadBody(const Block::SystemState::ID&, Block::Body&);
+		void OnCompactBodyComplete();
 
 		void OnMsg(const proto::BbsMsg&, bool bNonceValid);
 
@@ -483,8 +532,10 @@ private:
 		// messages
 		virtual void OnMsg(proto::Authentication&&) override;
 		virtual void OnMsg(proto::Login&&) override;
+		virtual void OnMsg(proto::LoginExt&&) override;
 		virtual void OnMsg(proto::Bye&&) override;
 		virtual void OnMsg(proto::Pong&&) override;
+		virtual void OnWatermark(bool bOverflow) override;
 		virtual void OnMsg(proto::NewTip&&) override;
 		virtual void OnMsg(proto::DataMissing&&) override;
 		virtual void OnMsg(proto::GetHdr&&) override;
@@ -495,14 +546,22 @@ private:
 		virtual void OnMsg(proto::GetBodyPack&&) override;
 		virtual void OnMsg(proto::Body&&) override;
 		virtual void OnMsg(proto::BodyPack&&) override;
+		virtual void OnMsg(proto::GetBodyCompact&&) override;
+		virtual void OnMsg(proto::BodyCompact&&) override;
+		virtual void OnMsg(proto::GetBodyCompactMissing&&) override;
+		virtual void OnMsg(proto::BodyCompactMissing&&) override;
 		virtual void OnMsg(proto::NewTransaction&&) override;
 		virtual void OnMsg(proto::HaveTransaction&&) override;
 		virtual void OnMsg(proto::GetTransaction&&) override;
+		virtual void OnMsg(proto::HaveTransactions&&) override;
+		virtual void OnMsg(proto::GetTransactions&&) override;
 		virtual void OnMsg(proto::GetCommonState&&) override;
 		virtual void OnMsg(proto::GetProofState&&) override;
 		virtual void OnMsg(proto::GetProofKernel&&) override;
 		virtual void OnMsg(proto::GetProofKernel2&&) override;
 		virtual void OnMsg(proto::GetProofUtxo&&) override;
+		virtual void OnMsg(proto::GetProofKernels&&) override;
+		virtual void OnMsg(proto::GetProofUtxos&&) override;
 		virtual void OnMsg(proto::GetProofChainWork&&) override;
 		virtual void OnMsg(proto::PeerInfoSelf&&) override;
 		virtual void OnMsg(proto::PeerInfo&&) override;
@@ -522,6 +581,9 @@ private:
 	typedef boost::intrusive::list<Peer> PeerList;
 	PeerList m_lstPeers;
 
+	std::vector<Peer*> m_vPeersByBps; // fastest first. Sorted once per RefreshCongestions pass, reset when peers come and go
+	const std::vector<Peer*>& get_PeersByBps();
+
 	ECC::NoLeak<ECC::uintBig> m_NonceLast;
 	const ECC::uintBig& NextNonce();
 	void NextNonce(ECC::Scalar::Native&);
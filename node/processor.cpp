@@ -18,10 +18,18 @@
 #include "../utility/serialize.h"
 #include "../utility/logger.h"
 #include "../utility/logger_checkpoints.h"
+#include "../utility/metrics.h"
+#include "../utility/parallel.h"
 #include <condition_variable>
 
 namespace beam {
 
+namespace
+{
+	Metrics::Histogram s_mtxBlockApply("node_block_apply_seconds", "Block interpretation latency (HandleBlock)", 1e9);
+	Metrics::Gauge s_mtxMbcPending("node_block_verify_pending_bytes", "Size of the blocks queued for the parallel verification");
+}
+
 void NodeProcessor::OnCorrupted()
 {
 	CorruptionException exc;
@@ -252,6 +260,11 @@ NodeProcessor::CongestionCache::TipCongestion* NodeProcessor::EnumCongestionsInt
 {
 	assert(IsTreasuryHandled());
 
+	if (!m_CongestionCache.m_bDirty && !(m_Cursor.m_Full.m_ChainWork < m_CongestionCache.m_CursorChainWork))
+		return UpdateCongestions();
+
+	m_CongestionCache.m_FullScans++;
+
 	CongestionCache cc;
 	cc.m_lstTips.swap(m_CongestionCache.m_lstTips);
 
@@ -357,14 +370,114 @@ NodeProcessor::CongestionCache::TipCongestion* NodeProcessor::EnumCongestionsInt
 
 		assert(pEntry && pEntry->m_Rows.size());
 		pEntry->m_bNeedHdrs = bNeedHdrs;
+		pEntry->m_ChainWork = wrk;
 
 		if (!bNeedHdrs && (!pMaxTarget || (pMaxTarget->m_Height < pEntry->m_Height)))
 			pMaxTarget = pEntry;
 	}
 
+	m_CongestionCache.m_bDirty = false;
+	m_CongestionCache.m_CursorChainWork = m_Cursor.m_Full.m_ChainWork;
+
 	return pMaxTarget;
 }
 
+NodeProcessor::CongestionCache::TipCongestion* NodeProcessor::UpdateCongestions()
+{
+	// The tips are up-to-date (new headers are added on insertion), and the cursor only moved fwd.
+	// The only remaining change is that some missing states became reachable (bottom-up)
+	CongestionCache::TipCongestion* pMaxTarget = nullptr;
+
+	for (CongestionCache::TipList::iterator it = m_CongestionCache.m_lstTips.begin(); m_CongestionCache.m_lstTips.end() != it; )
+	{
+		CongestionCache::TipCongestion& x = *it++;
+
+		if (x.m_ChainWork < m_Cursor.m_Full.m_ChainWork)
+		{
+			m_CongestionCache.Delete(&x); // not interested in tips behind the current cursor
+			continue;
+		}
+
+		while (x.m_Rows.size() && (NodeDB::StateFlags::Reachable & m_DB.GetStateFlags(x.m_Rows.at(x.m_Rows.size() - 1))))
+			x.m_Rows.pop_back(); // already retrieved
+
+		if (!x.m_Rows.size())
+		{
+			m_CongestionCache.Delete(&x); // the tip is reachable now
+			continue;
+		}
+
+		if (!x.m_bNeedHdrs && (!pMaxTarget || (pMaxTarget->m_Height < x.m_Height)))
+			pMaxTarget = &x;
+	}
+
+	return pMaxTarget;
+}
+
+void NodeProcessor::OnCongestionStateInserted(const NodeDB::StateID& sid, const Block::SystemState::Full& s)
+{
+	if (m_CongestionCache.m_bDirty)
+		return; // rebuilt anyway
+
+	if (m_DB.GetStateNextCount(sid.m_Row))
+	{
+		// fills a gap below the existing headers, their tips reach further down now
+		m_CongestionCache.m_bDirty = true;
+		return;
+	}
+
+	// a new tip. Not reachable, since it has no block yet
+	if (s.m_ChainWork < m_Cursor.m_Full.m_ChainWork)
+		return; // not interested in tips behind the current cursor
+
+	CongestionCache::TipCongestion* pEntry = nullptr;
+
+	NodeDB::StateID sidPrev = sid;
+	bool bPrev = (Rules::HeightGenesis != sid.m_Height) && m_DB.get_Prev(sidPrev);
+
+	if (bPrev && !(NodeDB::StateFlags::Reachable & m_DB.GetStateFlags(sidPrev.m_Row)))
+	{
+		CongestionCache::TipCongestion* p = m_CongestionCache.Find(sidPrev);
+		if (!p)
+		{
+			// the prev is a part of a tip dropped behind the cursor
+			m_CongestionCache.m_bDirty = true;
+			return;
+		}
+
+		if ((p->m_Height == sidPrev.m_Height) && (1 == m_DB.GetStateNextCount(sidPrev.m_Row)))
+			pEntry = p; // the prev was a tip, move it fwd
+		else
+		{
+			// a new fork, shares the rest with the existing entry
+			pEntry = new CongestionCache::TipCongestion;
+			m_CongestionCache.m_lstTips.push_back(*pEntry);
+
+			pEntry->m_Height = sidPrev.m_Height;
+			pEntry->m_bNeedHdrs = p->m_bNeedHdrs;
+
+			for (size_t i = p->m_Height - sidPrev.m_Height; i < p->m_Rows.size(); i++)
+				pEntry->m_Rows.push_back(p->m_Rows.at(i));
+		}
+
+		pEntry->m_Height++;
+		pEntry->m_Rows.push_front(sid.m_Row);
+	}
+	else
+	{
+		pEntry = new CongestionCache::TipCongestion;
+		m_CongestionCache.m_lstTips.push_back(*pEntry);
+
+		pEntry->m_Height = sid.m_Height;
+		pEntry->m_Rows.push_back(sid.m_Row);
+
+		// the prev is either reachable, or missing
+		pEntry->m_bNeedHdrs = (Rules::HeightGenesis != sid.m_Height) && !bPrev;
+	}
+
+	pEntry->m_ChainWork = s.m_ChainWork;
+}
+
 void NodeProcessor::EnumCongestions()
 {
 	if (!IsTreasuryHandled())
@@ -441,12 +554,7 @@ void NodeProcessor::EnumCongestions()
 			if (IsFastSync() && !x.IsContained(m_SyncData.m_Target))
 				continue; // ignore irrelevant branches
 
-			NodeDB::StateID sid;
-			sid.m_Height = x.m_Height - (x.m_Rows.size() - 1);
-			sid.m_Row = x.m_Rows.at(x.m_Rows.size() - 1);
-
-			m_DB.get_StateID(sid, id);
-			RequestDataInternal(id, sid.m_Row, true, sidTrg);
+			RequestBodies(x);
 		}
 		else
 		{
@@ -463,6 +571,55 @@ void NodeProcessor::EnumCongestions()
 	}
 }
 
+void NodeProcessor::RequestBodies(CongestionCache::TipCongestion& x)
+{
+	// x.m_Rows are from the tip down to the lowest missing block
+	Height hLo = x.m_Height - (x.m_Rows.size() - 1);
+
+	for (uint32_t iChunk = 0; (iChunk < m_SyncWindow.m_ChunksMax) && (hLo <= x.m_Height); iChunk++)
+	{
+		Height hHi = x.m_Height;
+		if (m_SyncWindow.m_Chunk && (hHi - hLo >= m_SyncWindow.m_Chunk))
+			hHi = hLo + m_SyncWindow.m_Chunk - 1;
+
+		if (IsFastSync() && (hLo <= m_SyncData.m_Target.m_Height) && (hHi > m_SyncData.m_Target.m_Height))
+			hHi = m_SyncData.m_Target.m_Height; // diluted and full blocks are requested separately
+
+		NodeDB::StateID sidTrg;
+		sidTrg.m_Height = hHi;
+		sidTrg.m_Row = x.m_Rows.at(x.m_Height - hHi);
+
+		if (iChunk)
+		{
+			// skip what's already downloaded. Chunks are filled bottom-up, hence the downloaded part is a prefix
+			if (NodeDB::StateFlags::Functional & m_DB.GetStateFlags(sidTrg.m_Row))
+			{
+				hLo = hHi + 1;
+				continue;
+			}
+
+			for (Height h1 = hHi; hLo < h1; )
+			{
+				Height hMid = hLo + (h1 - hLo) / 2;
+				if (NodeDB::StateFlags::Functional & m_DB.GetStateFlags(x.m_Rows.at(x.m_Height - hMid)))
+					hLo = hMid + 1;
+				else
+					h1 = hMid;
+			}
+		}
+
+		NodeDB::StateID sid;
+		sid.m_Height = hLo;
+		sid.m_Row = x.m_Rows.at(x.m_Height - hLo);
+
+		Block::SystemState::ID id;
+		m_DB.get_StateID(sid, id);
+		RequestDataInternal(id, sid.m_Row, true, sidTrg);
+
+		hLo = hHi + 1;
+	}
+}
+
 const uint64_t* NodeProcessor::get_CachedRows(const NodeDB::StateID& sid, Height nCountExtra)
 {
 	EnumCongestionsInternal();
@@ -503,6 +660,7 @@ struct NodeProcessor::MultiblockContext
 	TxoID m_id0;
 	HeightRange m_InProgress;
 	PeerID  m_pidLast;
+	bool m_bPidMixed = false; // blocks in progress came from different peers, the culprit is unknown
 
 	MultiblockContext(NodeProcessor& np)
 		:m_This(np)
@@ -677,7 +835,11 @@ struct NodeProcessor::MultiblockContext
 			assert(m_Sigma == Zero);
 		}
 
+		if (m_This.m_bMbcPerPeer && (m_InProgress.m_Max >= m_This.m_hMbcPerPeer))
+			m_This.m_bMbcPerPeer = false; // the range of the failed batch is verified
+
 		m_InProgress.m_Min = m_InProgress.m_Max + 1;
+		m_bPidMixed = false;
 	}
 
 	void OnBlock(const PeerID& pid, const MyTask::SharedBlock::Ptr& pShared)
@@ -691,13 +853,17 @@ struct NodeProcessor::MultiblockContext
 		bool bMustFlush =
 			!m_InProgress.IsEmpty() &&
 			(
-				(m_pidLast != pid) || // PeerID changed
+				((m_pidLast != pid) && m_This.m_bMbcPerPeer) || // PeerID changed, and we must know whom to blame
 				(m_InProgress.m_Max == m_This.m_SyncData.m_TxoLo) // range complete up to TxLo
 			);
 
 		if (bMustFlush && !Flush())
 			return;
 
+		// Blocks are downloaded from several peers in parallel. Mixing them in a single batch is much cheaper than flushing on every switch.
+		if (!m_InProgress.IsEmpty() && (m_pidLast != pid))
+			m_bPidMixed = true;
+
 		m_pidLast = pid;
 
 		const size_t nSizeMax = 1024 * 1024 * 10; // fair enough
@@ -710,6 +876,7 @@ struct NodeProcessor::MultiblockContext
 				if (m_SizePending <= nSizeMax)
 				{
 					m_SizePending += pShared->m_Size;
+					s_mtxMbcPending.Add(pShared->m_Size);
 					break;
 				}
 			}
@@ -773,6 +940,7 @@ struct NodeProcessor::MultiblockContext
 		m_This.SaveSyncData();
 
 		m_pidLast = Zero; // don't blame the last peer for the failure!
+		m_bPidMixed = false;
 	}
 
 	void OnFastSyncFailedOnLo()
@@ -816,6 +984,7 @@ void NodeProcessor::MultiblockContext::MyTask::SharedBlock::Exec(uint32_t iVerif
 	{
 		assert(m_Mbc.m_SizePending >= m_Size);
 		m_Mbc.m_SizePending -= m_Size;
+		s_mtxMbcPending.Add(-static_cast<int64_t>(m_Size));
 
 		if (bValid && !bSparse)
 			bValid = m_Ctx.IsValidBlock();
@@ -916,6 +1085,7 @@ void NodeProcessor::TryGoUp()
 					break;
 
 				mbc.m_pidLast = Zero; // don't blame the last peer if something goes wrong
+				mbc.m_bPidMixed = false;
 				NodeDB::StateID sidFail;
 				sidFail.SetNull(); // suppress warning
 
@@ -964,6 +1134,7 @@ void NodeProcessor::TryGoUp()
 							{
 								bbP.clear();
 								m_DB.SetStateNotFunctional(sid.m_Row);
+								m_CongestionCache.m_bDirty = true;
 							}
 
 							RollbackTo(sid.m_Height - 1);
@@ -1010,7 +1181,18 @@ void NodeProcessor::TryGoUp()
 		RollbackTo(mbc.m_InProgress.m_Min - 1);
 
 		DeleteBlocksInRange(sidTop, m_Cursor.m_Sid.m_Height); // blocks from this peer
-		OnPeerInsane(mbc.m_pidLast);
+
+		if (mbc.m_bPidMixed)
+		{
+			LOG_WARNING() << "Failed batch contained blocks from several peers, will verify per-peer";
+			m_bMbcPerPeer = true;
+			m_hMbcPerPeer = sidTop.m_Height;
+		}
+		else
+		{
+			OnPeerInsane(mbc.m_pidLast);
+			m_bMbcPerPeer = false;
+		}
 	}
 
 	if (bDirty)
@@ -1027,6 +1209,7 @@ void NodeProcessor::DeleteBlocksInRange(const NodeDB::StateID& sidTop, Height hS
 	{
 		m_DB.DelStateBlockAll(sid.m_Row);
 		m_DB.SetStateNotFunctional(sid.m_Row);
+		m_CongestionCache.m_bDirty = true;
 		m_DB.set_StateExtra(sid.m_Row, nullptr);
 		m_DB.set_StateTxos(sid.m_Row, nullptr);
 
@@ -1067,6 +1250,7 @@ Height NodeProcessor::PruneOld()
 			{
 				if (!m_DB.DeleteState(rowid, rowid))
 					break;
+				m_CongestionCache.m_bDirty = true;
 				hRet++;
 
 			} while (rowid);
@@ -1116,6 +1300,7 @@ Height NodeProcessor::RaiseFossil(Height hTrg)
 			else
 			{
 				m_DB.SetStateNotFunctional(ws.m_Sid.m_Row);
+				m_CongestionCache.m_bDirty = true;
 
 				m_DB.DelStateBlockAll(ws.m_Sid.m_Row);
 				m_DB.set_Peer(ws.m_Sid.m_Row, NULL);
@@ -1368,6 +1553,8 @@ std::ostream& operator << (std::ostream& s, const LogSid& sid)
 
 bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, MultiblockContext& mbc)
 {
+	Metrics::Histogram::Scope scopeMtx(s_mtxBlockApply);
+
 	ByteBuffer bbP, bbE;
 	m_DB.GetStateBlock(sid.m_Row, &bbP, &bbE);
 
@@ -1976,11 +2163,11 @@ void NodeProcessor::RollbackTo(Height h)
 	m_Extra.m_Txos = id0;
 }
 
-NodeProcessor::DataStatus::Enum NodeProcessor::OnStateInternal(const Block::SystemState::Full& s, Block::SystemState::ID& id)
+NodeProcessor::DataStatus::Enum NodeProcessor::OnStateInternal(const Block::SystemState::Full& s, Block::SystemState::ID& id, bool bPoWVerified)
 {
 	s.get_ID(id);
 
-	if (!s.IsValid())
+	if (!s.IsSane() || !(bPoWVerified || s.IsValidPoW()))
 	{
 		LOG_WARNING() << id << " header invalid!";
 		return DataStatus::Invalid;
@@ -2023,12 +2210,84 @@ NodeProcessor::DataStatus::Enum NodeProcessor::OnStateSilent(const Block::System
 {
 	DataStatus::Enum ret = OnStateInternal(s, id);
 	if (DataStatus::Accepted == ret)
+		InsertPeerState(s, peer);
+
+	return ret;
+}
+
+void NodeProcessor::InsertPeerState(const Block::SystemState::Full& s, const PeerID& peer)
+{
+	NodeDB::StateID sid;
+	sid.m_Row = m_DB.InsertState(s);
+	sid.m_Height = s.m_Height;
+
+	m_DB.set_Peer(sid.m_Row, &peer);
+	OnCongestionStateInserted(sid, s);
+}
+
+void NodeProcessor::VerifyPoW(const Block::SystemState::Full* pS, size_t nCount, uint8_t* pValid)
+{
+	// every thread of the task processor picks the next unverified header
+	struct MyTask
+		:public Task
+	{
+		ParallelLoop& m_Loop;
+		MyTask(ParallelLoop& x) :m_Loop(x) {}
+
+		virtual void Exec() override
+		{
+			m_Loop.Run();
+		}
+	};
+
+	ParallelLoop loop(nCount, [pS, pValid](size_t i)
+	{
+		pValid[i] = pS[i].IsValidPoW();
+	});
+
+	MyTask t(loop);
+	get_TaskProcessor().ExecAll(t);
+
+	loop.Rethrow();
+}
+
+uint32_t NodeProcessor::OnStatesSilent(const Block::SystemState::Full* pS, size_t nCount, const PeerID& peer, Block::SystemState::ID& idLast, bool& bInvalid)
+{
+	std::vector<uint8_t> vValid(nCount);
+	if (nCount)
+		VerifyPoW(pS, nCount, &vValid.front());
+
+	uint32_t nAccepted = 0;
+
+	for (size_t i = 0; i < nCount; i++)
 	{
-		uint64_t rowid = m_DB.InsertState(s);
-		m_DB.set_Peer(rowid, &peer);
+		const Block::SystemState::Full& s = pS[i];
+
+		if (!vValid[i])
+		{
+			s.get_ID(idLast);
+			LOG_WARNING() << idLast << " header invalid!";
+			bInvalid = true;
+			continue;
+		}
+
+		switch (OnStateInternal(s, idLast, true))
+		{
+		case DataStatus::Invalid:
+			bInvalid = true;
+			break;
+
+		case DataStatus::Accepted:
+			InsertPeerState(s, peer);
+			nAccepted++;
+			break;
+
+		default:
+			break; // suppress warning
+		}
 	}
 
-	return ret;
+	return nAccepted;
 }
 
 NodeProcessor::DataStatus::Enum NodeProcessor::OnBlock(const Block::SystemState::ID& id, const Blob& bbP, const Blob& bbE, const PeerID& peer)
@@ -2899,7 +3158,12 @@ bool NodeProcessor::ImportMacroBlockInternal(Block::BodyBase::IMacroReader& r)
 		}
 
 		case DataStatus::Accepted:
-			m_DB.InsertState(s);
+			{
+				NodeDB::StateID sid;
+				sid.m_Row = m_DB.InsertState(s);
+				sid.m_Height = s.m_Height;
+				OnCongestionStateInserted(sid, s);
+			}
 
 		default: // suppress the warning of not handling all the enum values
 			break;
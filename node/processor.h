@@ -88,6 +88,7 @@ class NodeProcessor
 		{
 			Height m_Height;
 			bool m_bNeedHdrs;
+			Difficulty::Raw m_ChainWork;
 			std::dvector<uint64_t> m_Rows;
 
 			bool IsContained(const NodeDB::StateID&);
@@ -96,6 +97,12 @@ class NodeProcessor
 		typedef boost::intrusive::list<TipCongestion> TipList;
 		TipList m_lstTips;
 
+		// Set when states are deleted or lose reachability, or a header fills a gap below the existing ones.
+		// Otherwise the new headers are added to the cached tips, and the cached rows are only trimmed as the data arrives
+		bool m_bDirty = true;
+		Difficulty::Raw m_CursorChainWork; // at the last full scan
+		uint32_t m_FullScans = 0;
+
 		~CongestionCache() { Clear(); }
 
 		void Clear();
@@ -105,6 +112,12 @@ class NodeProcessor
 	} m_CongestionCache;
 
 	CongestionCache::TipCongestion* EnumCongestionsInternal();
+	CongestionCache::TipCongestion* UpdateCongestions();
+	void OnCongestionStateInserted(const NodeDB::StateID&, const Block::SystemState::Full&);
+	void RequestBodies(CongestionCache::TipCongestion&);
+
+	bool m_bMbcPerPeer = false; // a batch with blocks from several peers failed. Verify them per-peer, to find the culprit
+	Height m_hMbcPerPeer = 0; // top of the failed batch, back to mixed batches once verified up to it
 
 	void DeleteBlocksInRange(const NodeDB::StateID& sidTop, Height hStop);
 
@@ -132,6 +145,15 @@ public:
 
 	} m_Horizon;
 
+	struct SyncWindow {
+
+		// Missing blocks are requested in chunks, so that they can be downloaded from different peers simultaneously.
+		// The chunks are already ordered by height, blocks are validated in order as they become reachable.
+		Height m_Chunk = 500; // 0 - request the whole range at once
+		uint32_t m_ChunksMax = 8;
+
+	} m_SyncWindow;
+
 	void OnHorizonChanged();
 
 	struct Cursor
@@ -191,6 +213,8 @@ public:
 
 	DataStatus::Enum OnState(const Block::SystemState::Full&, const PeerID&);
 	DataStatus::Enum OnStateSilent(const Block::SystemState::Full&, const PeerID&, Block::SystemState::ID&);
+	// consecutive headers. PoW is verified for all of them in parallel, then they're processed in order. Returns the num of accepted
+	uint32_t OnStatesSilent(const Block::SystemState::Full*, size_t nCount, const PeerID&, Block::SystemState::ID& idLast, bool& bInvalid);
 	DataStatus::Enum OnBlock(const Block::SystemState::ID&, const Blob& bbP, const Blob& bbE, const PeerID&);
 	DataStatus::Enum OnBlock(const NodeDB::StateID&, const Blob& bbP, const Blob& bbE, const PeerID&);
 	DataStatus::Enum OnTreasury(const Blob&);
@@ -205,6 +229,7 @@ public:
 
 	void EnumCongestions();
 	const uint64_t* get_CachedRows(const NodeDB::StateID&, Height nCountExtra); // retval valid till next call to this func, or to EnumCongestions()
+	uint32_t get_CongestionFullScans() const { return m_CongestionCache.m_FullScans; } // for tests
 	void TryGoUp();
 
 	static bool IsRemoteTipNeeded(const Block::SystemState::Full& sTipRemote, const Block::SystemState::Full& sTipMy);
@@ -335,7 +360,9 @@ public:
 private:
 	size_t GenerateNewBlockInternal(BlockContext&);
 	void GenerateNewHdr(BlockContext&);
-	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&);
+	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&, bool bPoWVerified = false);
+	void InsertPeerState(const Block::SystemState::Full&, const PeerID&); // accepted header, not applied yet
+	void VerifyPoW(const Block::SystemState::Full*, size_t nCount, uint8_t* pValid);
 };
 
 struct LogSid
@@ -0,0 +1,466 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../processor.h"
+#include "../../core/ecc_native.h"
+#include "../../core/serialization_adapters.h"
+#include "../../utility/serialize.h"
+#include <iostream>
+#include <chrono>
+
+#ifdef WIN32
+#	include <windows.h>
+#	include <psapi.h>
+#	pragma comment(lib, "psapi.lib")
+#else
+#	include <sys/resource.h>
+#endif
+
+using namespace beam;
+
+// Block processing benchmarks. Generates a chain with the given layout (all keys are derived from a fixed seed),
+// then measures the main paths over it: block generation, context-free validation, the full block handling (as during sync),
+// UTXO set loading, macroblock import, and the block reconstruction from Txos (as served to the syncing peers).
+//
+// Usage: block_benchmark [blocks] [txs/block] [inputs/tx] [outputs/tx] [kernels/tx]
+// Each result is printed as a single-line JSON object.
+
+const char* g_szSrc = "block_benchmark_src.db";
+const char* g_szTrg = "block_benchmark_trg.db";
+const char* g_szMacro = "block_benchmark_macro";
+
+struct Params
+{
+	Height m_Blocks = 100;
+	uint32_t m_Txs = 10;
+	uint32_t m_Inputs = 2;
+	uint32_t m_Outputs = 2;
+	uint32_t m_Kernels = 1;
+};
+
+struct BlockPlus
+{
+	Block::SystemState::Full m_Hdr;
+	ByteBuffer m_BodyP;
+	ByteBuffer m_BodyE;
+};
+
+uint64_t get_PeakRssKB()
+{
+#ifdef WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return 0;
+	return pmc.PeakWorkingSetSize >> 10;
+#else
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru))
+		return 0;
+	return ru.ru_maxrss; // in KB on linux
+#endif
+}
+
+struct Stopwatch
+{
+	std::chrono::steady_clock::time_point m_t0;
+	uint64_t m_Total_us = 0;
+
+	void Start() { m_t0 = std::chrono::steady_clock::now(); }
+
+	void Stop()
+	{
+		m_Total_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_t0).count();
+	}
+};
+
+void Report(const char* szName, uint64_t nBlocks, uint64_t nElements, const Stopwatch& sw)
+{
+	uint64_t dt_us = std::max<uint64_t>(sw.m_Total_us, 1);
+
+	std::cout
+		<< "{\"bench\":\"" << szName << "\""
+		<< ",\"blocks\":" << nBlocks
+		<< ",\"elements\":" << nElements
+		<< ",\"ms\":" << dt_us / 1000.
+		<< ",\"blocks_per_sec\":" << nBlocks * 1e6 / dt_us
+		<< ",\"us_per_element\":" << (nElements ? static_cast<double>(dt_us) / nElements : 0.)
+		<< ",\"peak_rss_kb\":" << get_PeakRssKB()
+		<< "}" << std::endl;
+}
+
+struct Generator
+{
+	const Params& m_Pars;
+	Key::IKdf::Ptr m_pKdf;
+	uint64_t m_nIdx = 0;
+
+	typedef std::multimap<Height, Key::IDV> UtxoQueue; // by maturity
+	UtxoQueue m_Utxos;
+
+	uint64_t m_nElements = 0; // inputs + outputs + kernels, all blocks
+	static const Amount s_Fee = 100;
+
+	Generator(const Params& pars)
+		:m_Pars(pars)
+	{
+		ECC::Hash::Value hvSeed;
+		ECC::Hash::Processor() << "block_benchmark" >> hvSeed;
+		ECC::HKdf::Create(m_pKdf, hvSeed);
+	}
+
+	bool MakeTx(Transaction& tx, Height hTip)
+	{
+		ECC::Scalar::Native kOffset = Zero, k;
+		Amount val = 0;
+
+		for (uint32_t i = 0; i < m_Pars.m_Inputs; i++)
+		{
+			UtxoQueue::iterator it = m_Utxos.begin();
+			if ((m_Utxos.end() == it) || (it->first > hTip))
+				break;
+
+			Input::Ptr pInp(new Input);
+			SwitchCommitment().Create(k, pInp->m_Commitment, *m_pKdf, it->second);
+			tx.m_vInputs.push_back(std::move(pInp));
+
+			kOffset += k;
+			val += it->second.m_Value;
+			m_Utxos.erase(it);
+		}
+
+		Amount fee = s_Fee * m_Pars.m_Kernels;
+		if (val <= fee + m_Pars.m_Outputs)
+			return false; // won't happen normally, the coinbase values are huge
+
+		val -= fee;
+
+		for (uint32_t i = 0; i < m_Pars.m_Outputs; i++)
+		{
+			Amount v = (i + 1 == m_Pars.m_Outputs) ? val : (val / (m_Pars.m_Outputs - i));
+			val -= v;
+
+			Key::IDV kidv(v, ++m_nIdx, Key::Type::Regular);
+
+			Output::Ptr pOut(new Output);
+			pOut->Create(k, *m_pKdf, kidv, *m_pKdf);
+			tx.m_vOutputs.push_back(std::move(pOut));
+
+			k = -k;
+			kOffset += k;
+			m_Utxos.insert(std::make_pair(hTip + 1 + Rules::get().Maturity.Std, kidv));
+		}
+
+		for (uint32_t i = 0; i < m_Pars.m_Kernels; i++)
+		{
+			m_pKdf->DeriveKey(k, Key::ID(++m_nIdx, Key::Type::Kernel));
+
+			TxKernel::Ptr pKrn(new TxKernel);
+			pKrn->m_Fee = s_Fee;
+			pKrn->Sign(k);
+			tx.m_vKernels.push_back(std::move(pKrn));
+
+			k = -k;
+			kOffset += k;
+		}
+
+		tx.m_Offset = kOffset;
+		tx.Normalize();
+
+		m_nElements += tx.m_vInputs.size() + tx.m_vOutputs.size() + tx.m_vKernels.size();
+		return true;
+	}
+
+	void Generate(std::vector<BlockPlus>& vBlocks, NodeProcessor& np, Stopwatch& sw)
+	{
+		for (Height h = Rules::HeightGenesis; h < Rules::HeightGenesis + m_Pars.m_Blocks; h++)
+		{
+			TxPool::Fluff txPool;
+			size_t nKernels = 1; // coinbase
+
+			for (uint32_t i = 0; i < m_Pars.m_Txs; i++)
+			{
+				Transaction::Ptr pTx = std::make_shared<Transaction>();
+				if (!MakeTx(*pTx, h - 1))
+					break;
+
+				Transaction::Context::Params pars;
+				Transaction::Context ctx(pars);
+				ctx.m_Height.m_Min = h;
+				if (!pTx->IsValid(ctx))
+					throw std::runtime_error("generated tx invalid");
+
+				nKernels += pTx->m_vKernels.size();
+
+				Transaction::KeyType key;
+				pTx->get_Key(key);
+				txPool.AddValidTx(std::move(pTx), ctx, key);
+			}
+
+			NodeProcessor::BlockContext bc(txPool, 0, *m_pKdf, *m_pKdf);
+
+			sw.Start();
+			bool bOk = np.GenerateNewBlock(bc);
+			sw.Stop();
+
+			if (!bOk)
+				throw std::runtime_error("block generation failed");
+			if (bc.m_Block.m_vKernels.size() != nKernels)
+				throw std::runtime_error("not all the txs fit the block, reduce the block layout");
+
+			np.OnState(bc.m_Hdr, PeerID());
+
+			Block::SystemState::ID id;
+			bc.m_Hdr.get_ID(id);
+
+			np.OnBlock(id, bc.m_BodyP, bc.m_BodyE, PeerID());
+			np.TryGoUp();
+
+			if (np.m_Cursor.m_ID.m_Height != h)
+				throw std::runtime_error("generated block rejected");
+
+			m_nElements += 2; // coinbase output and kernel
+			m_Utxos.insert(std::make_pair(h + Rules::get().Maturity.Coinbase, Key::IDV(Rules::get_Emission(h), h, Key::Type::Coinbase)));
+
+			if (bc.m_Fees)
+			{
+				m_nElements++;
+				m_Utxos.insert(std::make_pair(h + Rules::get().Maturity.Std, Key::IDV(bc.m_Fees, h, Key::Type::Comission)));
+			}
+
+			BlockPlus& b = vBlocks.emplace_back();
+			b.m_Hdr = bc.m_Hdr;
+			b.m_BodyP = std::move(bc.m_BodyP);
+			b.m_BodyE = std::move(bc.m_BodyE);
+		}
+	}
+};
+
+void ReadBody(Block::Body& body, const BlockPlus& b)
+{
+	Deserializer der;
+	der.reset(b.m_BodyP);
+	der & Cast::Down<Block::BodyBase>(body);
+	der & Cast::Down<TxVectors::Perishable>(body);
+
+	der.reset(b.m_BodyE);
+	der & Cast::Down<TxVectors::Eternal>(body);
+}
+
+void BenchValidate(const std::vector<BlockPlus>& vBlocks, NodeProcessor& np, uint64_t nElements)
+{
+	Stopwatch sw;
+
+	for (size_t i = 0; i < vBlocks.size(); i++)
+	{
+		Block::Body body;
+		ReadBody(body, vBlocks[i]);
+
+		TxBase::Context::Params pars;
+		pars.m_bBlockMode = true;
+		TxBase::Context ctx(pars);
+		ctx.m_Height.m_Min = ctx.m_Height.m_Max = vBlocks[i].m_Hdr.m_Height;
+
+		sw.Start();
+		bool bValid = np.ValidateAndSummarize(ctx, body, body.get_Reader()) && ctx.IsValidBlock();
+		sw.Stop();
+
+		if (!bValid)
+			throw std::runtime_error("block validation failed");
+	}
+
+	Report("ValidateAndSummarize", vBlocks.size(), nElements, sw);
+}
+
+void BenchHandleBlock(const std::vector<BlockPlus>& vBlocks, uint64_t nElements)
+{
+	NodeProcessor np;
+	np.Initialize(g_szTrg);
+
+	// headers first, as during the sync
+	for (size_t i = 0; i < vBlocks.size(); i++)
+		np.OnState(vBlocks[i].m_Hdr, PeerID());
+
+	Stopwatch sw;
+	sw.Start();
+
+	for (size_t i = 0; i < vBlocks.size(); i++)
+	{
+		Block::SystemState::ID id;
+		vBlocks[i].m_Hdr.get_ID(id);
+
+		np.OnBlock(id, vBlocks[i].m_BodyP, vBlocks[i].m_BodyE, PeerID());
+	}
+
+	np.TryGoUp();
+	sw.Stop();
+
+	if (np.m_Cursor.m_ID.m_Height != vBlocks.back().m_Hdr.m_Height)
+		throw std::runtime_error("block replay failed");
+
+	Report("HandleBlock", vBlocks.size(), nElements, sw);
+}
+
+void BenchInitializeUtxos(const std::vector<BlockPlus>& vBlocks)
+{
+	// the UTXO set is loaded from the DB on every start
+	NodeProcessor np;
+
+	Stopwatch sw;
+	sw.Start();
+	np.Initialize(g_szTrg);
+	sw.Stop();
+
+	struct Walker
+		:public NodeProcessor::ITxoWalker_UnspentNaked
+	{
+		uint64_t m_Count = 0;
+
+		virtual bool OnTxo(const NodeDB::WalkerTxo&, Height hCreate, Output&) override
+		{
+			m_Count++;
+			return true;
+		}
+	} wlk;
+
+	np.EnumTxos(wlk);
+
+	Report("InitializeUtxos", vBlocks.size(), wlk.m_Count, sw);
+}
+
+void BenchGetBlock(const std::vector<BlockPlus>& vBlocks, uint64_t nElements)
+{
+	NodeProcessor np;
+	np.Initialize(g_szTrg);
+
+	Height hTip = np.m_Cursor.m_ID.m_Height;
+
+	Stopwatch sw;
+	sw.Start();
+
+	for (Height h = Rules::HeightGenesis; h < hTip; h++)
+	{
+		NodeDB::StateID sid;
+		sid.m_Height = h;
+		sid.m_Row = np.FindActiveAtStrict(h);
+
+		// Peer syncs up to the tip, the perishable part is re-created from Txos
+		ByteBuffer bbE, bbP;
+		if (!np.GetBlock(sid, &bbE, &bbP, 0, 0, hTip))
+			throw std::runtime_error("block reconstruction failed");
+	}
+
+	sw.Stop();
+
+	Report("GetBlock", hTip - Rules::HeightGenesis, nElements, sw);
+}
+
+void BenchImportMacroBlock(const std::vector<BlockPlus>& vBlocks, NodeProcessor& npSrc, uint64_t nElements)
+{
+	Block::BodyBase::RW rw;
+	rw.m_sPath = g_szMacro;
+	rw.m_hvContentTag = Zero;
+
+	rw.WCreate();
+	npSrc.ExportMacroBlock(rw, HeightRange(Rules::HeightGenesis, vBlocks.back().m_Hdr.m_Height));
+	rw.Close();
+
+	DeleteFile(g_szTrg);
+
+	{
+		NodeProcessor np;
+		np.Initialize(g_szTrg);
+
+		rw.ROpen();
+
+		Stopwatch sw;
+		sw.Start();
+		bool bOk = np.ImportMacroBlock(rw);
+		sw.Stop();
+
+		rw.Close();
+
+		if (!bOk || (np.m_Cursor.m_ID.m_Height != vBlocks.back().m_Hdr.m_Height))
+			throw std::runtime_error("macroblock import failed");
+
+		Report("ImportMacroBlock", vBlocks.size(), nElements, sw);
+	}
+
+	rw.Delete();
+}
+
+int main(int argc, char* argv[])
+{
+	Params pars;
+	if (argc > 1)
+		pars.m_Blocks = std::stoul(argv[1]);
+	if (argc > 2)
+		pars.m_Txs = std::stoul(argv[2]);
+	if (argc > 3)
+		pars.m_Inputs = std::stoul(argv[3]);
+	if (argc > 4)
+		pars.m_Outputs = std::stoul(argv[4]);
+	if (argc > 5)
+		pars.m_Kernels = std::stoul(argv[5]);
+
+	if (!pars.m_Blocks || !pars.m_Inputs || !pars.m_Outputs || !pars.m_Kernels)
+	{
+		std::cout << "Usage: block_benchmark [blocks] [txs/block] [inputs/tx] [outputs/tx] [kernels/tx]" << std::endl;
+		return 1;
+	}
+
+	Rules::get().FakePoW = true;
+	Rules::get().TreasuryChecksum = Zero; // no treasury
+	Rules::get().UpdateChecksum();
+
+	DeleteFile(g_szSrc);
+	DeleteFile(g_szTrg);
+
+	try
+	{
+		std::cout
+			<< "{\"bench\":\"config\""
+			<< ",\"blocks\":" << pars.m_Blocks
+			<< ",\"txs_per_block\":" << pars.m_Txs
+			<< ",\"inputs_per_tx\":" << pars.m_Inputs
+			<< ",\"outputs_per_tx\":" << pars.m_Outputs
+			<< ",\"kernels_per_tx\":" << pars.m_Kernels
+			<< "}" << std::endl;
+
+		std::vector<BlockPlus> vBlocks;
+		vBlocks.reserve(pars.m_Blocks);
+
+		NodeProcessor npSrc;
+		npSrc.Initialize(g_szSrc);
+
+		Generator gen(pars);
+		Stopwatch sw;
+		gen.Generate(vBlocks, npSrc, sw);
+		Report("GenerateNewBlock", vBlocks.size(), gen.m_nElements, sw);
+
+		BenchValidate(vBlocks, npSrc, gen.m_nElements);
+		BenchHandleBlock(vBlocks, gen.m_nElements);
+		BenchInitializeUtxos(vBlocks);
+		BenchGetBlock(vBlocks, gen.m_nElements);
+		BenchImportMacroBlock(vBlocks, npSrc, gen.m_nElements);
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "{\"error\":\"" << e.what() << "\"}" << std::endl;
+		return 1;
+	}
+
+	DeleteFile(g_szSrc);
+	DeleteFile(g_szTrg);
+	return 0;
+}
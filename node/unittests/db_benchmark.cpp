@@ -0,0 +1,125 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../processor.h"
+#include "../../core/ecc_native.h"
+#include "../../utility/metrics.h"
+#include "../../utility/helpers.h"
+#include <iostream>
+
+using namespace beam;
+
+// Generates a chain, then replays it into a fresh NodeProcessor the way the sync does (headers first, then bodies),
+// with the DB profile attached. Prints the per-statement statistics, the heaviest first.
+
+const char* g_szSrc = "db_benchmark_src.db";
+const char* g_szTrg = "db_benchmark_trg.db";
+
+struct BlockPlus
+{
+	Block::SystemState::Full m_Hdr;
+	ByteBuffer m_BodyP;
+	ByteBuffer m_BodyE;
+};
+
+void GenerateChain(std::vector<BlockPlus>& vBlocks, Height nCount)
+{
+	ECC::Hash::Value hvSeed;
+	ECC::GenRandom(hvSeed);
+
+	Key::IKdf::Ptr pKdf;
+	ECC::HKdf::Create(pKdf, hvSeed);
+
+	NodeProcessor np;
+	np.Initialize(g_szSrc);
+
+	TxPool::Fluff txPool;
+
+	for (Height h = 0; h < nCount; h++)
+	{
+		NodeProcessor::BlockContext bc(txPool, 0, *pKdf, *pKdf);
+		if (!np.GenerateNewBlock(bc))
+			throw std::runtime_error("block generation failed");
+
+		np.OnState(bc.m_Hdr, PeerID());
+
+		Block::SystemState::ID id;
+		bc.m_Hdr.get_ID(id);
+
+		np.OnBlock(id, bc.m_BodyP, bc.m_BodyE, PeerID());
+		np.TryGoUp();
+
+		BlockPlus& b = vBlocks.emplace_back();
+		b.m_Hdr = bc.m_Hdr;
+		b.m_BodyP = std::move(bc.m_BodyP);
+		b.m_BodyE = std::move(bc.m_BodyE);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Height nCount = 500;
+	if (argc > 1)
+		nCount = std::stoul(argv[1]);
+
+	Rules::get().FakePoW = true;
+	Rules::get().TreasuryChecksum = Zero; // no treasury
+	Rules::get().UpdateChecksum();
+
+	DeleteFile(g_szSrc);
+	DeleteFile(g_szTrg);
+
+	std::vector<BlockPlus> vBlocks;
+	vBlocks.reserve(nCount);
+	GenerateChain(vBlocks, nCount);
+
+	Metrics::QueryProfile prof("node");
+
+	uint64_t t0 = local_timestamp_msec();
+	{
+		NodeProcessor np;
+		np.get_DB().set_Profile(&prof);
+		np.Initialize(g_szTrg);
+
+		for (size_t i = 0; i < vBlocks.size(); i++)
+			np.OnState(vBlocks[i].m_Hdr, PeerID());
+
+		for (size_t i = 0; i < vBlocks.size(); i++)
+		{
+			Block::SystemState::ID id;
+			vBlocks[i].m_Hdr.get_ID(id);
+
+			np.OnBlock(id, vBlocks[i].m_BodyP, vBlocks[i].m_BodyE, PeerID());
+			np.TryGoUp();
+		}
+
+		if (np.m_Cursor.m_ID.m_Height != vBlocks.back().m_Hdr.m_Height)
+		{
+			std::cout << "replay failed at height " << np.m_Cursor.m_ID.m_Height << std::endl;
+			return 1;
+		}
+
+		np.get_DB().set_Profile(nullptr);
+	}
+
+	std::cout << vBlocks.size() << " blocks replayed in " << local_timestamp_msec() - t0 << " ms" << std::endl;
+
+	std::string s;
+	prof.Dump(s);
+	std::cout << s;
+
+	DeleteFile(g_szSrc);
+	DeleteFile(g_szTrg);
+	return 0;
+}
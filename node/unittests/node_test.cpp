@@ -23,6 +23,7 @@
 #include "../../utility/test_helpers.h"
 #include "../../utility/serialize.h"
 #include "../../core/unittest/mini_blockchain.h"
+#include "../../utility/metrics.h"
 
 #ifndef LOG_VERBOSE_ENABLED
     #define LOG_VERBOSE_ENABLED 0
@@ -753,6 +754,55 @@ namespace beam
 		ByteBuffer m_BodyE;
 	};
 
+	void TestCompactBody(const BlockPlus& blk, const std::vector<Transaction::Ptr>& vPool)
+	{
+		Block::Body body;
+		{
+			Deserializer der;
+			der.reset(blk.m_BodyP);
+			der & Cast::Down<Block::BodyBase>(body);
+			der & Cast::Down<TxVectors::Perishable>(body);
+
+			der.reset(blk.m_BodyE);
+			der & Cast::Down<TxVectors::Eternal>(body);
+		}
+
+		proto::BodyCompact msg;
+		ECC::GenRandom(&msg.m_Nonce, sizeof(msg.m_Nonce));
+		proto::CompactBody::Create(msg, body);
+
+		verify_test(msg.m_Outputs.size() + msg.m_Kernels.size() + 2 >= body.m_vOutputs.size() + body.m_vKernels.size()); // only coinbase is prefilled
+
+		proto::CompactBody::Assembler asm1;
+		verify_test(asm1.Init(msg));
+
+		for (size_t i = 0; i < vPool.size(); i++)
+			asm1.Add(*vPool[i]);
+
+		// only the fees output is expected to be missing
+		verify_test(asm1.m_setKernels.empty());
+		verify_test(asm1.m_setOutputs.size() <= 1);
+
+		if (!asm1.IsComplete())
+		{
+			proto::GetBodyCompactMissing msgMiss;
+			asm1.get_Missing(msgMiss);
+
+			proto::BodyCompactMissing msgMissOut;
+			proto::CompactBody::get_Missing(msgMissOut, body, msgMiss);
+
+			verify_test(asm1.Add(msgMissOut));
+			verify_test(asm1.IsComplete());
+			verify_test(!asm1.Add(msgMissOut)); // not requested anymore
+		}
+
+		proto::BodyBuffers bb;
+		asm1.Finalize(bb);
+
+		verify_test(bb.m_Perishable == blk.m_BodyP);
+		verify_test(bb.m_Eternal == blk.m_BodyE);
+	}
+
 	void TestNodeProcessor1(std::vector<BlockPlus::Ptr>& blockChain)
 	{
 		MyNodeProcessor1 np;
@@ -786,6 +836,10 @@ namespace beam
 				np.m_TxPool.AddValidTx(std::move(pTx), ctx, key);
 			}
 
+			std::vector<Transaction::Ptr> vPool;
+			for (TxPool::Fluff::TxSet::iterator it = np.m_TxPool.m_setTxs.begin(); np.m_TxPool.m_setTxs.end() != it; it++)
+				vPool.push_back(it->get_ParentObj().m_pValue);
+
 			NodeProcessor::BlockContext bc(np.m_TxPool, 0, *np.m_Wallet.m_pKdf, *np.m_Wallet.m_pKdf);
 			verify_test(np.GenerateNewBlock(bc));
 
@@ -804,6 +858,9 @@ namespace beam
 			pBlock->m_Hdr = std::move(bc.m_Hdr);
 			pBlock->m_BodyP = std::move(bc.m_BodyP);
 			pBlock->m_BodyE = std::move(bc.m_BodyE);
+
+			TestCompactBody(*pBlock, vPool);
+
 			blockChain.push_back(std::move(pBlock));
 		}
 
@@ -958,6 +1015,83 @@ namespace beam
 
 	}
 
+	void TestCongestionCache(const std::vector<BlockPlus::Ptr>& blockChain)
+	{
+		struct Row {
+			static NodeDB::StateID Get(NodeProcessor& np, const Block::SystemState::Full& s)
+			{
+				Block::SystemState::ID id;
+				s.get_ID(id);
+
+				NodeDB::StateID sid;
+				sid.m_Row = np.get_DB().StateFindSafe(id);
+				sid.m_Height = id.m_Height;
+				verify_test(sid.m_Row);
+				return sid;
+			}
+
+			static std::vector<uint64_t> Cached(NodeProcessor& np, const NodeDB::StateID& sid)
+			{
+				// the whole branch down to the treasury is missing
+				Height n = sid.m_Height - Rules::HeightGenesis;
+				const uint64_t* pRows = np.get_CachedRows(sid, n);
+				verify_test(pRows);
+				verify_test(!np.get_CachedRows(sid, n + 1));
+
+				return std::vector<uint64_t>(pRows, pRows + n + 1);
+			}
+		};
+
+		// a header of the same height and chainwork, that starts a fork in the middle of the chain
+		const size_t iFork = blockChain.size() / 2;
+		Block::SystemState::Full sFork = blockChain[iFork]->m_Hdr;
+		sFork.m_TimeStamp++;
+
+		std::vector<uint64_t> vTip, vFork;
+
+		{
+			NodeProcessor np;
+			np.Initialize(g_sz);
+			np.OnTreasury(g_Treasury);
+
+			np.EnumCongestions();
+			uint32_t nScans = np.get_CongestionFullScans();
+
+			PeerID peer;
+			ZeroObject(peer);
+
+			for (size_t i = 0; i < blockChain.size(); i++)
+			{
+				verify_test(NodeProcessor::DataStatus::Accepted == np.OnState(blockChain[i]->m_Hdr, peer));
+				np.EnumCongestions();
+			}
+
+			verify_test(NodeProcessor::DataStatus::Accepted == np.OnState(sFork, peer));
+			np.EnumCongestions();
+
+			vTip = Row::Cached(np, Row::Get(np, blockChain.back()->m_Hdr));
+			vFork = Row::Cached(np, Row::Get(np, sFork));
+
+			// the headers were added to the cached tips, no rescan
+			verify_test(np.get_CongestionFullScans() == nScans);
+
+			verify_test(vTip.size() == blockChain.size());
+			verify_test(vFork.size() == iFork + 1);
+			verify_test(vFork[0] != vTip[vTip.size() - iFork - 1]);
+			verify_test(std::equal(vFork.begin() + 1, vFork.end(), vTip.end() - iFork));
+		}
+
+		{
+			// the full scan must build the same
+			NodeProcessor np;
+			np.Initialize(g_sz);
+
+			verify_test(vTip == Row::Cached(np, Row::Get(np, blockChain.back()->m_Hdr)));
+			verify_test(vFork == Row::Cached(np, Row::Get(np, sFork)));
+			verify_test(np.get_CongestionFullScans() == 1);
+		}
+	}
+
 	void TestNodeProcessor3(std::vector<BlockPlus::Ptr>& blockChain)
 	{
 		NodeProcessor np, npSrc;
@@ -1404,6 +1538,217 @@ namespace beam
 		pReactor->run();
 	}
 
+	void TestNodeTxsBatch()
+	{
+		// Testing configuration: Sender -> Node0 <-> Node1 <-> Client.
+		// The tx is submitted to Node0, both hops announce and request it in batches
+
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Node node, node2;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_Listen.port(g_Port);
+		node.m_Cfg.m_Listen.ip(INADDR_ANY);
+		node.m_Cfg.m_Treasury = g_Treasury;
+
+		node2.m_Cfg.m_sPathLocal = g_sz2;
+		node2.m_Cfg.m_Listen.port(g_Port + 1);
+		node2.m_Cfg.m_Listen.ip(INADDR_ANY);
+		node2.m_Cfg.m_Treasury = g_Treasury;
+		node2.m_Cfg.m_Connect.resize(1);
+		node2.m_Cfg.m_Connect[0].resolve("127.0.0.1");
+		node2.m_Cfg.m_Connect[0].port(g_Port);
+
+		ECC::SetRandom(node);
+		ECC::SetRandom(node2);
+
+		node.Initialize();
+		node2.Initialize();
+
+		// mine on Node0 until there's a mature coinbase to spend, Node1 syncs once the reactor runs
+		MiniWallet wallet;
+		wallet.m_pKdf = node.m_Keys.m_pMiner;
+
+		const Height hTrg = Rules::get().Maturity.Coinbase + 5;
+		while (node.get_Processor().m_Cursor.m_ID.m_Height < hTrg)
+		{
+			TxPool::Fluff txPool; // empty, no transactions
+			NodeProcessor::BlockContext bc(txPool, 0, *node.m_Keys.m_pMiner, *node.m_Keys.m_pMiner);
+
+			verify_test(node.get_Processor().GenerateNewBlock(bc));
+
+			node.get_Processor().OnState(bc.m_Hdr, PeerID());
+
+			Block::SystemState::ID id;
+			bc.m_Hdr.get_ID(id);
+
+			node.get_Processor().OnBlock(id, bc.m_BodyP, bc.m_BodyE, PeerID());
+			node.get_Processor().TryGoUp();
+
+			wallet.AddMyUtxo(Key::IDV(Rules::get_Emission(bc.m_Hdr.m_Height), bc.m_Hdr.m_Height, Key::Type::Coinbase));
+		}
+
+		struct MySender
+			:public proto::NodeConnection
+		{
+			Transaction::Ptr m_pTx;
+
+			virtual void OnConnectedSecure() override
+			{
+				proto::Login msg;
+				msg.m_CfgChecksum = Rules::get().Checksum;
+				msg.m_Flags = proto::LoginFlags::Extension1;
+				Send(msg);
+
+				proto::NewTransaction msgTx;
+				msgTx.m_Transaction = m_pTx;
+				msgTx.m_Fluff = true;
+				Send(msgTx);
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+				io::Reactor::get_Current().stop();
+			}
+		};
+
+		struct MyClient
+			:public proto::NodeConnection
+		{
+			Node* m_pNode1;
+			MiniWallet* m_pWallet;
+			Height m_hTrg;
+
+			MySender m_Sender;
+			Transaction::KeyType m_TxKey;
+			uint32_t m_WaitingCycles = 0;
+			bool m_bSent = false;
+			bool m_bAnnounced = false;
+			bool m_bReceived = false;
+			bool m_bRejected = false;
+
+			io::Timer::Ptr m_pTimer;
+
+			MyClient()
+			{
+				m_pTimer = io::Timer::create(io::Reactor::get_Current());
+			}
+
+			virtual void OnConnectedSecure() override
+			{
+				proto::Login msg;
+				msg.m_CfgChecksum = Rules::get().Checksum;
+				msg.m_Flags = proto::LoginFlags::Extension1 | proto::LoginFlags::SpreadingTransactions | proto::LoginFlags::Extended;
+				Send(msg);
+
+				SetTimer(100);
+			}
+
+			virtual void OnMsg(proto::Login&& msg) override
+			{
+				verify_test(proto::LoginFlags::Extended & msg.m_Flags);
+
+				proto::LoginExt msgOut;
+				msgOut.m_Flags = proto::LoginExtFlags::TxsBatch;
+				Send(msgOut);
+			}
+
+			void OnTimer()
+			{
+				if (m_WaitingCycles++ > 300)
+				{
+					fail_test("Batched tx relay didn't complete");
+					io::Reactor::get_Current().stop();
+					return;
+				}
+
+				// Node1 turns on tx replication once synced, let its new login reach Node0 first
+				if (!m_bSent && (m_pNode1->get_Processor().m_Cursor.m_ID.m_Height == m_hTrg) && (m_WaitingCycles > 10))
+				{
+					verify_test(m_pWallet->MakeTx(m_Sender.m_pTx, m_hTrg, 0));
+					m_Sender.m_pTx->get_Key(m_TxKey);
+
+					io::Address addr;
+					addr.resolve("127.0.0.1");
+					addr.port(g_Port);
+					m_Sender.Connect(addr);
+
+					m_bSent = true;
+				}
+
+				SetTimer(100);
+			}
+
+			void SetTimer(uint32_t timeout_ms) {
+				m_pTimer->start(timeout_ms, false, [this]() { return (this->OnTimer)(); });
+			}
+
+			virtual void OnMsg(proto::HaveTransaction&&) override
+			{
+				fail_test("tx announced individually");
+			}
+
+			virtual void OnMsg(proto::HaveTransactions&& msg) override
+			{
+				verify_test(m_bSent);
+				verify_test(!msg.m_IDs.empty() && (msg.m_IDs.size() <= proto::g_TxsBatchMaxSize));
+
+				proto::GetTransactions msgOut;
+				for (size_t i = 0; i < msg.m_IDs.size(); i++)
+					if (msg.m_IDs[i] == m_TxKey)
+					{
+						m_bAnnounced = true;
+						msgOut.m_IDs.push_back(m_TxKey);
+					}
+
+				if (!msgOut.m_IDs.empty())
+					Send(msgOut);
+			}
+
+			virtual void OnMsg(proto::NewTransaction&& msg) override
+			{
+				verify_test(m_bAnnounced);
+				verify_test(msg.m_Transaction);
+
+				Transaction::KeyType key;
+				msg.m_Transaction->get_Key(key);
+				verify_test(key == m_TxKey);
+				m_bReceived = true;
+
+				// a batch above the limit is a protocol violation
+				proto::HaveTransactions msgOut;
+				msgOut.m_IDs.resize(proto::g_TxsBatchMaxSize + 1);
+				for (size_t i = 0; i < msgOut.m_IDs.size(); i++)
+					ECC::GenRandom(msgOut.m_IDs[i]);
+
+				Send(msgOut);
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override
+			{
+				m_bRejected = m_bReceived;
+				io::Reactor::get_Current().stop();
+			}
+		};
+
+		MyClient cl;
+		cl.m_pNode1 = &node2;
+		cl.m_pWallet = &wallet;
+		cl.m_hTrg = hTrg;
+
+		io::Address addr;
+		addr.resolve("127.0.0.1");
+		addr.port(g_Port + 1);
+
+		cl.Connect(addr);
+
+		pReactor->run();
+
+		verify_test(cl.m_bReceived);
+		verify_test(cl.m_bRejected);
+	}
+
 
 
 	void TestNodeClientProto()
@@ -1426,6 +1771,7 @@ namespace beam
 		node.m_Cfg.m_Horizon.m_SchwarzschildHi = 10;
 		node.m_Cfg.m_Horizon.m_SchwarzschildLo = 14;
 		node.m_Cfg.m_VerificationThreads = -1;
+		node.m_Cfg.m_InboundThreads = 2; // the clients and the syncing node are decrypted by the pool
 
 		node.m_Cfg.m_Dandelion.m_AggregationTime_ms = 0;
 		node.m_Cfg.m_Dandelion.m_OutputsMin = 3;
@@ -1911,6 +2257,8 @@ namespace beam
 		node2.m_Cfg.m_Timeout = node.m_Cfg.m_Timeout;
 
 		node2.m_Cfg.m_Dandelion = node.m_Cfg.m_Dandelion;
+		node2.m_Cfg.m_SyncWindow.m_Chunk = 5; // small chunks, to have several of them in flight
+		node2.m_Cfg.m_InboundThreads = 1;
 
 		ECC::SetRandom(node2);
 		node2.Initialize();
@@ -1999,7 +2347,7 @@ namespace beam
 		}
 	}
 
-	void RaiseHeightTo(Node& node, Height h)
+	void RaiseHeightTo(Node& node, Height h, std::vector<Merkle::Hash>* pKrnIDs = nullptr, std::vector<ECC::Point>* pUtxos = nullptr)
 	{
 		TxPool::Fluff txPool;
 
@@ -2013,9 +2361,33 @@ namespace beam
 			bc.m_Hdr.get_ID(id);
 			node.get_Processor().OnBlock(id, bc.m_BodyP, bc.m_BodyE, PeerID());
 			node.get_Processor().TryGoUp();
+
+			if (pKrnIDs)
+				for (const auto& pKrn : bc.m_Block.m_vKernels)
+				{
+					pKrnIDs->emplace_back();
+					pKrn->get_ID(pKrnIDs->back());
+				}
+
+			if (pUtxos)
+				for (const auto& pOutp : bc.m_Block.m_vOutputs)
+					pUtxos->push_back(pOutp->m_Commitment);
 		}
 	}
 
+	uint64_t get_ProofsBatched()
+	{
+		std::string s;
+		Metrics::Registry::get().Write(s);
+
+		size_t nPos = s.find("\nnode_proofs_batched_total");
+		if (std::string::npos == nPos)
+			return 0;
+
+		nPos = s.find(' ', nPos);
+		return (std::string::npos == nPos) ? 0 : std::stoull(s.substr(nPos + 1));
+	}
+
 	void TestFlyClient()
 	{
 		io::Reactor::Ptr pReactor(io::Reactor::create());
@@ -2046,6 +2418,10 @@ namespace beam
 			bool m_bBbsReceived;
 			Block::SystemState::HistoryMap m_Hist;
 
+			// existing kernels and utxos, to get non-empty proofs
+			std::vector<Merkle::Hash> m_vKrnIDs;
+			std::vector<ECC::Point> m_vUtxos;
+
 			MyFlyClient()
 			{
 				m_pTimer = io::Timer::create(io::Reactor::get_Current());
@@ -2090,6 +2466,28 @@ namespace beam
 				verify_test(this == r.m_pTrg);
 				verify_test(m_nProofsExpected);
 				m_nProofsExpected--;
+
+				// the proofs from the batches must be dispatched to the right requests
+				switch (r.get_Type())
+				{
+				case Request::Type::Kernel:
+					{
+						const RequestKernel& req = Cast::Up<RequestKernel>(r);
+						verify_test(req.m_Res.m_Proof.empty() == (req.m_Msg.m_ID == Zero));
+					}
+					break;
+
+				case Request::Type::Utxo:
+					{
+						const RequestUtxo& req = Cast::Up<RequestUtxo>(r);
+						verify_test(req.m_Res.m_Proofs.empty() == (req.m_Msg.m_Utxo.m_X == Zero));
+					}
+					break;
+
+				default: // suppress warning
+					break;
+				}
+
 				MaybeStop();
 			}
 
@@ -2142,6 +2540,29 @@ namespace beam
 					m_nProofsExpected++;
 				}
 
+				// consecutive proof requests, should be sent in batches. Mix the existing and missing items
+				for (uint32_t i = 0; i < 6; i++)
+				{
+					RequestKernel::Ptr pKrnl(new RequestKernel);
+					if (!(1 & i) && (i < m_vKrnIDs.size()))
+						pKrnl->m_Msg.m_ID = m_vKrnIDs[m_vKrnIDs.size() - 1 - i];
+					net.PostRequest(*pKrnl, *this);
+
+					if (3 == i)
+						pKrnl->m_pTrg = NULL;
+					else
+						m_nProofsExpected++;
+				}
+
+				for (uint32_t i = 0; i < 6; i++)
+				{
+					RequestUtxo::Ptr pUtxo(new RequestUtxo);
+					if (!(1 & i) && (i < m_vUtxos.size()))
+						pUtxo->m_Msg.m_Utxo = m_vUtxos[m_vUtxos.size() - 1 - i];
+					net.PostRequest(*pUtxo, *this);
+					m_nProofsExpected++;
+				}
+
 				net.BbsSubscribe(m_LastBbsChannel, 0, this);
 
 				SetTimer(90 * 1000);
@@ -2150,14 +2571,21 @@ namespace beam
 			}
 		};
 
+		MyFlyClient fc;
+
 		const Height hThrd1 = 250;
-		RaiseHeightTo(node, hThrd1);
+		RaiseHeightTo(node, hThrd1, &fc.m_vKrnIDs, &fc.m_vUtxos);
+		verify_test(fc.m_vKrnIDs.size() >= 6);
+		verify_test(fc.m_vUtxos.size() >= 6);
 
+		uint64_t nBatched = get_ProofsBatched();
 
-		MyFlyClient fc;
 		// simple case
 		fc.SyncSync();
 
+		// 5 kernels (one is cancelled) and 6 utxos, at least
+		verify_test(get_ProofsBatched() >= nBatched + 11);
+
 		verify_test(fc.m_bTip);
 		verify_test(fc.m_hRolledTo == MaxHeight);
 		verify_test(!fc.m_Hist.m_Map.empty() && fc.m_Hist.m_Map.rbegin()->second.m_Height == hThrd1);
@@ -2198,6 +2626,138 @@ namespace beam
 		verify_test(!fc.m_Hist.m_Map.empty() && fc.m_Hist.m_Map.rbegin()->second.m_Height == hThrd2);
 	}
 
+	void TestInboundPoolOrder()
+	{
+		// Several encrypted connections, each sends a numbered sequence (with the output watermarks set). The server decrypts them on the pool threads,
+		// the messages of each peer must still arrive in order
+
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		InboundPool pool(*pReactor, 3);
+
+		const uint32_t nMsgs = 2000;
+
+		struct MyPeer
+			:public proto::NodeConnection
+		{
+			uint32_t* m_pDone;
+			uint32_t m_Peers;
+			Height m_hNext = 1;
+
+			virtual void OnMsg(proto::GetHdr&& msg) override
+			{
+				verify_test(IsSecureIn());
+				verify_test(msg.m_ID.m_Height == m_hNext);
+				m_hNext++;
+
+				if ((m_hNext > nMsgs) && (++*m_pDone == m_Peers))
+					io::Reactor::get_Current().stop();
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+				io::Reactor::get_Current().stop();
+			}
+		};
+
+		struct MyServer
+			:public proto::NodeConnection::Server
+		{
+			InboundPool* m_pPool;
+			std::vector<std::unique_ptr<MyPeer> > m_vPeers;
+			uint32_t m_Peers;
+			uint32_t m_Done = 0;
+
+			virtual void OnAccepted(io::TcpStream::Ptr&& newStream, int errorCode) override
+			{
+				if (!newStream)
+					return;
+
+				m_vPeers.push_back(std::make_unique<MyPeer>());
+				MyPeer& p = *m_vPeers.back();
+				p.m_pDone = &m_Done;
+				p.m_Peers = m_Peers;
+				p.m_pInboundPool = m_pPool;
+				p.Accept(std::move(newStream));
+			}
+		};
+
+		struct MyClient
+			:public proto::NodeConnection
+		{
+			uint32_t m_nOverflow = 0;
+			uint32_t m_nDrained = 0;
+
+			MyClient()
+			{
+				// the burst is written while the 1st request is in progress, must go over the high mark
+				m_WatermarkHi = 0x1000;
+				m_WatermarkLo = 0x400;
+			}
+
+			virtual void OnWatermark(bool bOverflow) override
+			{
+				if (bOverflow)
+				{
+					verify_test(m_nOverflow == m_nDrained);
+					verify_test(get_Unsent() >= m_WatermarkHi);
+					m_nOverflow++;
+				}
+				else
+				{
+					verify_test(m_nOverflow == m_nDrained + 1);
+					verify_test(get_Unsent() <= m_WatermarkLo);
+					m_nDrained++;
+				}
+			}
+
+			virtual void OnConnectedSecure() override
+			{
+				for (uint32_t i = 1; i <= nMsgs; i++)
+				{
+					proto::GetHdr msg;
+					ZeroObject(msg.m_ID);
+					msg.m_ID.m_Height = i;
+					Send(msg);
+				}
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+				io::Reactor::get_Current().stop();
+			}
+		};
+
+		MyServer srv;
+		srv.m_pPool = &pool;
+		srv.m_Peers = 4;
+
+		io::Address addr;
+		addr.resolve("127.0.0.1");
+		addr.port(g_Port);
+		srv.Listen(addr);
+
+		std::vector<std::unique_ptr<MyClient> > vClients;
+		for (uint32_t i = 0; i < srv.m_Peers; i++)
+		{
+			vClients.push_back(std::make_unique<MyClient>());
+			vClients.back()->Connect(addr);
+		}
+
+		io::Timer::Ptr pTimer = io::Timer::create(*pReactor);
+		pTimer->start(60 * 1000, false, []() { io::Reactor::get_Current().stop(); });
+
+		pReactor->run();
+
+		verify_test(srv.m_Done == srv.m_Peers);
+		for (const auto& p : srv.m_vPeers)
+			verify_test(p->IsSecureIn() && (p->m_hNext == nMsgs + 1));
+
+		for (const auto& p : vClients)
+			verify_test(p->m_nOverflow && (p->m_nDrained + 1 >= p->m_nOverflow));
+	}
+
 	void TestHalving()
 	{
 		HeightRange hr;
@@ -2277,6 +2837,12 @@ int main()
 		beam::TestNodeProcessor2(blockChain);
 		beam::DeleteFile(beam::g_sz);
 
+		printf("NodeProcessor congestion cache test...\n");
+		fflush(stdout);
+
+		beam::TestCongestionCache(blockChain);
+		beam::DeleteFile(beam::g_sz);
+
 		printf("NodeProcessor test3...\n");
 		fflush(stdout);
 
@@ -2292,6 +2858,13 @@ int main()
 	beam::DeleteFile(beam::g_sz);
 	beam::DeleteFile(beam::g_sz2);
 
+	printf("Batched tx relay test...\n");
+	fflush(stdout);
+
+	beam::TestNodeTxsBatch();
+	beam::DeleteFile(beam::g_sz);
+	beam::DeleteFile(beam::g_sz2);
+
 	printf("Node <---> Client test (with proofs)...\n");
 	fflush(stdout);
 
@@ -2299,6 +2872,11 @@ int main()
 	beam::DeleteFile(beam::g_sz);
 	beam::DeleteFile(beam::g_sz2);
 
+	printf("Inbound pool order test...\n");
+	fflush(stdout);
+
+	beam::TestInboundPoolOrder();
+
 	printf("Node <---> FlyClient test...\n");
 	fflush(stdout);
 
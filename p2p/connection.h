@@ -49,6 +49,9 @@ public:
     /// Disables all messages
     void disable_all_msg_types() { _msgReader.disable_all_msg_types(); }
 
+    /// Moves the inbound decryption to the pool, once the channel is established
+    void offload_inbound(InboundPool& pool) { _msgReader.offload(pool); }
+
 private:
     MsgReader _msgReader;
 };
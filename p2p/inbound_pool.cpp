@@ -0,0 +1,202 @@
+// Copyright 2018 The Beam Team
+// Copyright 2019 - 2022 The LiteCash Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "inbound_pool.h"
+#include <algorithm>
+
+namespace beam {
+
+namespace {
+    // larger message buffers aren't kept between the messages
+    const size_t MAX_KEPT_FRAME = 0x10000;
+}
+
+struct InboundPool::Stream {
+    const ProtocolBase& protocol;
+    std::unique_ptr<IInboundCipher> cipher;
+    Deliver deliver;
+
+    // guarded by the pool mutex
+    std::vector<uint8_t> input;
+    bool queued = false;
+    bool running = false;
+    bool closed = false;
+
+    // accessed by one job at a time
+    std::vector<uint8_t> frame;
+    size_t bytesLeft = MsgHeader::SIZE;
+    bool failed = false;
+
+    Stream(const ProtocolBase& p, std::unique_ptr<IInboundCipher>&& pCipher, Deliver&& d) :
+        protocol(p),
+        cipher(std::move(pCipher)),
+        deliver(std::move(d))
+    {}
+
+    /// Returns false if the reading must stop
+    bool process(uint8_t* p, size_t size, Batch& batch);
+};
+
+bool InboundPool::Stream::process(uint8_t* p, size_t size, Batch& batch) {
+    while (size) {
+        // decrypt as much as we expect, same as MsgReader
+        size_t n = std::min(size, bytesLeft);
+        cipher->Decrypt(p, (uint32_t) n);
+        frame.insert(frame.end(), p, p + n);
+
+        p += n;
+        size -= n;
+        bytesLeft -= n;
+
+        if (bytesLeft)
+            break;
+
+        MsgHeader header(frame.data());
+
+        if (MsgHeader::SIZE == frame.size()) {
+            if (no_error != protocol.check_msg_header(header)) {
+                batch.header = header;
+                batch.badHeader = true;
+                return false;
+            }
+
+            bytesLeft = header.size;
+            if (bytesLeft)
+                continue;
+        }
+
+        if (!cipher->VerifyMsg(frame.data(), (uint32_t) frame.size())) {
+            batch.corrupt = true;
+            return false;
+        }
+
+        batch.data.insert(batch.data.end(), frame.begin(), frame.end());
+
+        if (frame.capacity() > MAX_KEPT_FRAME)
+            std::vector<uint8_t>().swap(frame);
+        else
+            frame.clear();
+
+        bytesLeft = MsgHeader::SIZE;
+    }
+
+    return true;
+}
+
+InboundPool::InboundPool(io::Reactor& reactor, uint32_t nThreads) :
+    _rx(reactor, [](std::function<void()>&& done) { done(); })
+{
+    for (uint32_t i = 0; i < nThreads; i++)
+        _threads.emplace_back(&InboundPool::run, this, _rx.get_tx());
+}
+
+InboundPool::~InboundPool() {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _newJob.notify_all();
+
+    for (auto& t : _threads)
+        t.join();
+}
+
+InboundPool::StreamPtr InboundPool::open(const ProtocolBase& protocol, std::unique_ptr<IInboundCipher>&& pCipher, Deliver&& deliver) {
+    return std::make_shared<Stream>(protocol, std::move(pCipher), std::move(deliver));
+}
+
+void InboundPool::push(const StreamPtr& pStream, const void* data, size_t size) {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (pStream->closed)
+            return;
+
+        const uint8_t* p = (const uint8_t*) data;
+        pStream->input.insert(pStream->input.end(), p, p + size);
+
+        // the stream is queued once, so that its data is processed in order, by one thread at a time
+        if (pStream->queued)
+            return;
+
+        pStream->queued = true;
+        _ready.push_back(pStream);
+    }
+
+    _newJob.notify_one();
+}
+
+void InboundPool::close(const StreamPtr& pStream) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    pStream->closed = true;
+    pStream->input.clear();
+
+    _jobDone.wait(lock, [&pStream] { return !pStream->running; });
+}
+
+void InboundPool::run(TX<std::function<void()>> tx) {
+    std::vector<uint8_t> input;
+
+    while (true) {
+        StreamPtr pStream;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _newJob.wait(lock, [this] { return _stop || !_ready.empty(); });
+
+            if (_stop)
+                break;
+
+            pStream = std::move(_ready.front());
+            _ready.pop_front();
+
+            if (pStream->closed) {
+                pStream->queued = false;
+                continue;
+            }
+
+            input.swap(pStream->input);
+            pStream->running = true;
+        }
+
+        Batch batch;
+        if (!pStream->failed)
+            pStream->failed = !pStream->process(input.data(), input.size(), batch);
+
+        input.clear();
+
+        // sent before the next job of the stream may start, hence the batches arrive in order
+        if (!batch.data.empty() || batch.badHeader || batch.corrupt) {
+            tx.send([pStream, batch = std::move(batch)]() mutable {
+                if (!pStream->closed)
+                    pStream->deliver(batch);
+            });
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            pStream->running = false;
+
+            if (pStream->closed || pStream->input.empty())
+                pStream->queued = false;
+            else
+                _ready.push_back(pStream);
+        }
+
+        _newJob.notify_one();
+        _jobDone.notify_all();
+    }
+}
+
+} //namespace
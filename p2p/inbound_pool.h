@@ -0,0 +1,69 @@
+// Copyright 2018 The Beam Team
+// Copyright 2019 - 2022 The LiteCash Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "protocol_base.h"
+#include "utility/message_queue.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace beam {
+
+/// Worker threads that take the decryption, MAC checks and framing of the inbound data off the reactor thread.
+/// Used for the connections whose inbound cipher is settled. The verified messages are passed back
+/// to the reactor thread in the order of arrival, and dispatched there.
+/// Must outlive the streams opened in it.
+class InboundPool {
+public:
+    /// Complete messages of a stream (header, decrypted body, MAC), and the error that stopped the reading, if any
+    struct Batch {
+        std::vector<uint8_t> data;
+        MsgHeader header = MsgHeader(0, 0, 0); // rejected header
+        bool badHeader = false;
+        bool corrupt = false;
+    };
+
+    using Deliver = std::function<void(Batch& batch)>;
+
+    struct Stream;
+    using StreamPtr = std::shared_ptr<Stream>;
+
+    InboundPool(io::Reactor& reactor, uint32_t nThreads);
+    ~InboundPool();
+
+    /// Called in the reactor thread, the deliver callback is called there too
+    StreamPtr open(const ProtocolBase& protocol, std::unique_ptr<IInboundCipher>&& pCipher, Deliver&& deliver);
+
+    /// Queues the raw (encrypted) data of the stream
+    void push(const StreamPtr& pStream, const void* data, size_t size);
+
+    /// Waits for the running job of the stream, nothing is delivered afterwards
+    void close(const StreamPtr& pStream);
+
+private:
+    void run(TX<std::function<void()>> tx);
+
+    RX<std::function<void()>> _rx;
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _newJob;
+    std::condition_variable _jobDone;
+    std::deque<StreamPtr> _ready;
+    bool _stop = false;
+};
+
+} //namespace
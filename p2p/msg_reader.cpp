@@ -40,6 +40,9 @@ MsgReader::~MsgReader()
 {
 	if (_pAlive)
 		*_pAlive = false;
+
+	if (_offloaded)
+		_pool->close(_offloaded);
 }
 
 void MsgReader::reset() {
@@ -48,6 +51,10 @@ void MsgReader::reset() {
     _cursor = _msgBuffer.data();
 }
 
+void MsgReader::offload(InboundPool& pool) {
+    _pool = &pool;
+}
+
 void MsgReader::change_id(uint64_t newStreamId) {
     _streamId = newStreamId;
 }
@@ -69,6 +76,102 @@ void MsgReader::disable_all_msg_types() {
 }
 
 bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void* data, size_t size) {
+    return on_data(connectionStatus, (const uint8_t*) data, size, nullptr);
+}
+
+bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, void* data, size_t size) {
+    return on_data(connectionStatus, (const uint8_t*) data, size, (uint8_t*) data);
+}
+
+bool MsgReader::on_header(const MsgHeader& header, volatile const bool& bAlive) {
+	if (!_protocol.approve_msg_header(_streamId, header))
+		// at this moment, the *this* may be deleted
+		return false;
+
+	if (!bAlive)
+		return false;
+
+	if (!_expectedMsgTypes.test(header.type)) {
+		_protocol.on_unexpected_msg(_streamId, header.type);
+		// at this moment, the *this* may be deleted
+		return false;
+	}
+
+	return bAlive;
+}
+
+bool MsgReader::on_message(const uint8_t* pMsg, const MsgHeader& header, volatile const bool& bAlive) {
+	if (!_protocol.VerifyMsg(pMsg, static_cast<uint32_t>(MsgHeader::SIZE + header.size)))
+	{
+		_protocol.on_corrupt_msg(_streamId);
+		return false;
+	}
+
+    if (!_protocol.on_new_message(_streamId, header.type, pMsg + MsgHeader::SIZE, header.size - _protocol.get_MacSize())) {
+        // at this moment, the *this* may be deleted
+        if (bAlive) {
+            reset();
+        }
+        return false;
+    }
+
+	return bAlive;
+}
+
+bool MsgReader::try_offload(const uint8_t* data, size_t size) {
+	auto pCipher = _protocol.DetachInbound();
+	if (!pCipher)
+		return false;
+
+	std::shared_ptr<bool> pAlive(_pAlive);
+	_offloaded = _pool->open(_protocol, std::move(pCipher), [this, pAlive](InboundPool::Batch& batch) {
+		if (*pAlive)
+			on_offloaded(batch);
+	});
+
+	// the rest of the chunk isn't decrypted yet
+	if (size)
+		_pool->push(_offloaded, data, size);
+
+	return true;
+}
+
+void MsgReader::on_offloaded(InboundPool::Batch& batch) {
+	std::shared_ptr<bool> pAlive(_pAlive);
+	volatile const bool& bAlive = *pAlive;
+
+	uint32_t nMac = _protocol.get_MacSize();
+
+	for (size_t i = 0; i < batch.data.size(); ) {
+		const uint8_t* pMsg = batch.data.data() + i;
+		MsgHeader header(pMsg);
+		i += MsgHeader::SIZE + header.size;
+
+		// the filter is checked here, it's maintained by the protocol logic in this thread
+		bool bOk = _expectedMsgTypes.test(header.type);
+		if (bOk)
+			bOk = _protocol.on_new_message(_streamId, header.type, pMsg + MsgHeader::SIZE, header.size - nMac);
+		else
+			_protocol.on_unexpected_msg(_streamId, header.type);
+
+		// at this moment, the *this* may be deleted
+		if (!bAlive)
+			return;
+
+		if (!bOk) {
+			// no more reading, as in on_data()
+			_pool->close(_offloaded);
+			return;
+		}
+	}
+
+	if (batch.corrupt)
+		_protocol.on_corrupt_msg(_streamId);
+	else if (batch.badHeader)
+		_protocol.approve_msg_header(_streamId, batch.header); // reports the error
+}
+
+bool MsgReader::on_data(io::ErrorCode connectionStatus, const uint8_t* data, size_t size, uint8_t* pInPlace) {
     if (connectionStatus != 0) {
         _protocol.on_connection_error(_streamId, connectionStatus);
         return false;
@@ -78,39 +181,75 @@ bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void*
         return true;
     }
 
+    if (_offloaded) {
+        _pool->push(_offloaded, data, size);
+        return true;
+    }
+
 	std::shared_ptr<bool> pAlive(_pAlive);
 	volatile const bool& bAlive = *pAlive;
 
-    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* p = data;
     size_t sz = size;
 
 	while (sz >= _bytesLeft)
 	{
+		if (pInPlace && (reading_header == _state) && (MsgHeader::SIZE == _bytesLeft))
+		{
+			// Nothing is buffered. Decrypt the header in the stream buffer, and if the whole message is there - parse it in place
+			_protocol.Decrypt(pInPlace, MsgHeader::SIZE);
+
+			MsgHeader header(pInPlace);
+			if (!on_header(header, bAlive))
+				return false;
+
+			size_t nMsg = MsgHeader::SIZE + header.size;
+			if (sz >= nMsg)
+			{
+				_protocol.Decrypt(pInPlace + MsgHeader::SIZE, header.size);
+
+				if (!on_message(pInPlace, header, bAlive))
+					return false;
+
+				sz -= nMsg;
+				p += nMsg;
+				pInPlace += nMsg;
+
+				if (_pool && try_offload(p, sz))
+					return true;
+
+				continue;
+			}
+
+			// message continues in the next chunk(s), fall back to buffering
+			memcpy(_msgBuffer.data(), pInPlace, MsgHeader::SIZE);
+
+			sz -= MsgHeader::SIZE;
+			p += MsgHeader::SIZE;
+			pInPlace += MsgHeader::SIZE;
+
+			_bytesLeft = header.size;
+			_msgBuffer.resize(nMsg);
+			_cursor = _msgBuffer.data() + MsgHeader::SIZE;
+
+			_state = reading_message;
+			continue;
+		}
+
 		memcpy(_cursor, p, _bytesLeft);
 		_protocol.Decrypt(_cursor, (uint32_t) _bytesLeft); // decrypt as much as we expect, no more (because cipher may change)
 
 		sz -= _bytesLeft;
 		p += _bytesLeft;
+		if (pInPlace)
+			pInPlace += _bytesLeft;
 
 		MsgHeader header(_msgBuffer.data());
 
 		if (_state == reading_header)
 		{
 			// header has just been read
-			if (!_protocol.approve_msg_header(_streamId, header))
-				// at this moment, the *this* may be deleted
-				return false;
-
-			if (!bAlive)
-				return false;
-
-			if (!_expectedMsgTypes.test(header.type)) {
-				_protocol.on_unexpected_msg(_streamId, header.type);
-				// at this moment, the *this* may be deleted
-				return false;
-			}
-
-			if (!bAlive)
+			if (!on_header(header, bAlive))
 				return false;
 
 			// header deserialized successfully
@@ -124,21 +263,7 @@ bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void*
 		else
 		{
 			// whole message has been read
-			if (!_protocol.VerifyMsg(_msgBuffer.data(), static_cast<uint32_t>(_msgBuffer.size())))
-			{
-				_protocol.on_corrupt_msg(_streamId);
-				return false;
-			}
-
-            if (!_protocol.on_new_message(_streamId, header.type, _msgBuffer.data() + MsgHeader::SIZE, header.size - _protocol.get_MacSize())) {
-                // at this moment, the *this* may be deleted
-                if (bAlive) {
-                    reset();
-                }
-                return false;
-            }
-
-			if (!bAlive)
+			if (!on_message(_msgBuffer.data(), header, bAlive))
 				return false;
 
 			if (_msgBuffer.size() > 2 * _defaultSize) {
@@ -153,6 +278,9 @@ bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void*
 			_state = reading_header;
 
 			_cursor = _msgBuffer.data();
+
+			if (_pool && try_offload(p, sz))
+				return true;
 		}
 	}
 
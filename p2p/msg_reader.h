@@ -13,7 +13,7 @@
 // limitations under the License.
 
 #pragma once
-#include "protocol_base.h"
+#include "inbound_pool.h"
 #include <vector>
 #include <bitset>
 
@@ -33,6 +33,10 @@ public:
     /// Calls the callback whenever a new protocol message is exctracted or on errors
     bool new_data_from_stream(io::ErrorCode connectionStatus, const void* data, size_t size);
 
+    /// Same as above, but the data belongs to the stream's read buffer and may be modified.
+    /// Messages that are contiguous in the buffer are decrypted and parsed in place, without copying
+    bool new_data_from_stream(io::ErrorCode connectionStatus, void* data, size_t size);
+
     /// Allows receiving messages of given type
     void enable_msg_type(MsgType type);
 
@@ -48,10 +52,29 @@ public:
     /// Resets to initial state
     void reset();
 
+    /// Once the protocol detaches its inbound cipher, the rest of the data is decrypted, verified and framed in the pool.
+    /// The messages are still dispatched in the reactor thread
+    void offload(InboundPool& pool);
+
 private:
     /// 2 states of the reader
     enum State { reading_header, reading_message };
 
+    /// pInPlace is either null or writable alias of data
+    bool on_data(io::ErrorCode connectionStatus, const uint8_t* data, size_t size, uint8_t* pInPlace);
+
+    /// Validates just decrypted header, returns false if reading must stop
+    bool on_header(const MsgHeader& header, volatile const bool& bAlive);
+
+    /// Verifies and dispatches complete message (header, body, MAC), returns false if reading must stop
+    bool on_message(const uint8_t* pMsg, const MsgHeader& header, volatile const bool& bAlive);
+
+    /// Called after a message is dispatched, the rest of the data goes to the pool if the cipher is detached
+    bool try_offload(const uint8_t* data, size_t size);
+
+    /// Dispatches the messages processed by the pool
+    void on_offloaded(InboundPool::Batch& batch);
+
     /// Callbacks
     ProtocolBase& _protocol;
 
@@ -77,6 +100,9 @@ private:
     std::bitset<256> _expectedMsgTypes;
 
 	std::shared_ptr<bool> _pAlive;
+
+    InboundPool* _pool = nullptr;
+    InboundPool::StreamPtr _offloaded;
 };
 
 } //namespace
@@ -16,6 +16,7 @@
 #include "utility/io/buffer.h"
 #include "utility/io/errorhandling.h"
 #include <string.h>
+#include <memory>
 #include <vector>
 
 namespace beam {
@@ -108,6 +109,14 @@ struct IErrorHandler {
     }
 };
 
+/// Inbound decryption and MAC checks, detached from the protocol so that they may run on another thread
+struct IInboundCipher {
+    virtual ~IInboundCipher() {}
+
+    virtual void Decrypt(uint8_t*, uint32_t nSize) = 0;
+    virtual bool VerifyMsg(const uint8_t*, uint32_t nSize) = 0; // all together: header, body, MAC
+};
+
 class Deserializer;
 
 /// Protocol base
@@ -143,19 +152,7 @@ public:
 
     /// Called by MsgReader on receiving message header
     bool approve_msg_header(uint64_t fromStream, const MsgHeader& header) {
-        ProtocolError error = no_error;
-
-        if (header.V0 != V0 || header.V1 != V1 || header.V2 != V2) {
-            error = protocol_version_error;
-        } else if (header.type >= _maxMessageTypes) {
-            error = msg_type_error;
-        } else {
-            const DispatchTableItem& i = _dispatchTable[header.type];
-            if (!i.callback)
-                error = msg_type_error;
-            else if (i.minSize > header.size || i.maxSize < header.size)
-                error = msg_size_error;
-        }
+        ProtocolError error = check_msg_header(header);
 
         if (error == no_error) {
             return true;
@@ -165,6 +162,24 @@ public:
         return false;
     }
 
+    /// Same as above, without reporting. Safe to call from another thread, the dispatch table isn't changed after the setup
+    ProtocolError check_msg_header(const MsgHeader& header) const {
+        if (header.V0 != V0 || header.V1 != V1 || header.V2 != V2)
+            return protocol_version_error;
+
+        if (header.type >= _maxMessageTypes)
+            return msg_type_error;
+
+        const DispatchTableItem& i = _dispatchTable[header.type];
+        if (!i.callback)
+            return msg_type_error;
+
+        if (i.minSize > header.size || i.maxSize < header.size)
+            return msg_size_error;
+
+        return no_error;
+    }
+
     /// Called by Connection on network errors
     void on_connection_error(uint64_t fromStream, io::ErrorCode errorCode) {
         _errorHandler.on_connection_error(fromStream, errorCode);
@@ -196,6 +211,10 @@ public:
 	virtual uint32_t get_MacSize() { return 0; }
 	virtual bool VerifyMsg(const uint8_t*, uint32_t /*nSize*/) { return true; } // all together: header, body, MAC
 
+	// Returns the inbound cipher once its mode can't change anymore, the protocol doesn't use it afterwards.
+	// Called by MsgReader between the messages, if it may offload them
+	virtual std::unique_ptr<IInboundCipher> DetachInbound() { return nullptr; }
+
 private:
     /// protocol version, all received messages must have these bytes
     uint8_t V0, V1, V2;
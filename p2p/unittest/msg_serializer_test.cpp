@@ -16,6 +16,7 @@
 #include "p2p/msg_reader.h"
 #include "p2p/protocol.h"
 #include "utility/helpers.h"
+#include "utility/io/timer.h"
 #include <iostream>
 #include <assert.h>
 
@@ -68,6 +69,7 @@ struct SomeObject {
 struct MsgHandler : IErrorHandler {
     void on_protocol_error(uint64_t fromStream, ProtocolError error) override {
         cout << __FUNCTION__ << "(" << fromStream << "," << error << ")" << endl;
+        lastError = error;
     }
 
     void on_connection_error(uint64_t fromStream, io::ErrorCode errorCode) override {
@@ -83,11 +85,14 @@ struct MsgHandler : IErrorHandler {
     bool on_some_object(uint64_t fromStream, SomeObject&& msg) {
         cout << __FUNCTION__ << "(" << fromStream << "," << msg.i << ")" << endl;
         receivedObj = msg;
+        ++nObjects;
         return true;
     }
 
     IntList receivedInts;
     SomeObject receivedObj;
+    int nObjects=0;
+    ProtocolError lastError=no_error;
 };
 
 void msg_serializer_test_1() {
@@ -183,8 +188,150 @@ void msg_serializer_test_2() {
     assert(msg == handler.receivedObj);
 }
 
+void msg_reader_in_place_test() {
+    MsgType type = 222;
+
+    MsgHandler handler;
+    Protocol protocol(0xAA, 0xBB, 0xCC, 256, handler, 50);
+
+    protocol.add_message_handler<MsgHandler, SomeObject, &MsgHandler::on_some_object>(type, &handler, 8, 1<<24);
+
+    // several messages back-to-back in one stream buffer
+    std::vector<uint8_t> stream;
+    SomeObject msg;
+    for (int n=0; n<3; ++n) {
+        msg.i = n;
+        msg.x = 100 + n;
+        for (int i=0; i<50; ++i) msg.ooo.push_back(i);
+
+        std::vector<io::SharedBuffer> fragments;
+        protocol.serialize(fragments, type, msg);
+        for (const auto& f: fragments) {
+            stream.insert(stream.end(), f.data, f.data + f.size);
+        }
+    }
+
+    MsgReader reader(
+        protocol,
+        123456,
+        12
+    );
+
+    // the 1st chunk ends in the middle of the last message, it must be completed from the internal buffer
+    size_t split = stream.size() - 17;
+    reader.new_data_from_stream(io::EC_OK, (void*)stream.data(), split);
+    assert(handler.nObjects == 2);
+    reader.new_data_from_stream(io::EC_OK, (void*)(stream.data() + split), stream.size() - split);
+    assert(handler.nObjects == 3);
+
+    assert(msg == handler.receivedObj);
+}
+
+// Toy cipher: xor, and the last byte is the sum of the rest
+struct XorCipher : IInboundCipher {
+    void Decrypt(uint8_t* p, uint32_t nSize) override {
+        for (uint32_t i=0; i<nSize; ++i) p[i] ^= 0x5A;
+    }
+
+    bool VerifyMsg(const uint8_t* p, uint32_t nSize) override {
+        uint8_t sum = 0;
+        for (uint32_t i=0; i+1<nSize; ++i) sum += p[i];
+        return nSize && (p[nSize-1] == sum);
+    }
+
+    static void encrypt(std::vector<uint8_t>& stream, const std::vector<uint8_t>& msg) {
+        std::vector<uint8_t> v = msg;
+        MsgHeader header(v.data());
+        header.size++;
+        header.write(v.data());
+
+        uint8_t sum = 0;
+        for (uint8_t x : v) sum += x;
+        v.push_back(sum);
+
+        for (uint8_t x : v) stream.push_back(x ^ 0x5A);
+    }
+};
+
+// The channel becomes encrypted after the 1st message, as after SChannelReady
+struct XorProtocol : Protocol {
+    XorProtocol(MsgHandler& handler) : Protocol(0xAA, 0xBB, 0xCC, 256, handler, 50), _handler(handler) {}
+
+    uint32_t get_MacSize() override { return _handler.nObjects ? 1 : 0; }
+
+    std::unique_ptr<IInboundCipher> DetachInbound() override {
+        if (!_handler.nObjects) return nullptr;
+        return std::make_unique<XorCipher>();
+    }
+
+    MsgHandler& _handler;
+};
+
+void msg_reader_offload_test() {
+    MsgType type = 222;
+
+    io::Reactor::Ptr reactor = io::Reactor::create();
+    io::Reactor::Scope scope(*reactor);
+
+    InboundPool pool(*reactor, 2);
+
+    MsgHandler handler;
+    XorProtocol protocol(handler);
+    protocol.add_message_handler<MsgHandler, SomeObject, &MsgHandler::on_some_object>(type, &handler, 1, 1<<24);
+
+    std::vector<uint8_t> stream;
+    SomeObject msg;
+    for (int n=0; n<5; ++n) {
+        msg.i = n;
+        msg.ooo.push_back(n);
+
+        std::vector<io::SharedBuffer> fragments;
+        protocol.serialize(fragments, type, msg);
+        std::vector<uint8_t> v;
+        for (const auto& f: fragments) {
+            v.insert(v.end(), f.data, f.data + f.size);
+        }
+
+        if (n)
+            XorCipher::encrypt(stream, v);
+        else
+            stream = v;
+    }
+
+    // the last one is corrupted, and the rest is ignored
+    size_t corruptAt = stream.size() - 3;
+    stream[corruptAt] ^= 1;
+    std::vector<uint8_t> tail(stream.begin(), stream.begin() + 20);
+    stream.insert(stream.end(), tail.begin(), tail.end());
+
+    MsgReader reader(protocol, 123456, 12);
+    reader.offload(pool);
+
+    // small chunks, so that the switch to the pool happens in the middle of a chunk, and the messages are split
+    for (size_t i=0; i<stream.size(); i+=7) {
+        reader.new_data_from_stream(io::EC_OK, (void*)(stream.data() + i), std::min<size_t>(7, stream.size() - i));
+    }
+
+    // the 1st message is dispatched directly, the rest - once the pool passes them back
+    assert(handler.nObjects == 1);
+
+    int nWaits = 0;
+    io::Timer::Ptr timer = io::Timer::create(*reactor);
+    timer->start(10, true, [&] {
+        if ((handler.lastError != no_error) || (++nWaits > 500))
+            reactor->stop();
+    });
+    reactor->run();
+
+    assert(handler.nObjects == 4);
+    assert(handler.receivedObj.i == 3);
+    assert(handler.lastError == message_corrupted);
+}
+
 int main() {
     fragment_writer_test();
     msg_serializer_test_1();
     msg_serializer_test_2();
+    msg_reader_in_place_test();
+    msg_reader_offload_test();
 }
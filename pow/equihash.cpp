@@ -19,6 +19,7 @@
 #include <utility>
 #include "utility/logger.h"
 #include <mutex>
+#include "utility/parallel.h"
 
 namespace beam
 {
@@ -88,13 +89,24 @@ bool Block::PoW::Solve(const void* pInput, uint32_t nSizeInput, const Cancel& fn
 
 bool Block::PoW::IsValid(const void* pInput, uint32_t nSizeInput) const
 {
+	// the difficulty test is much cheaper, do it first
 	Helper hlp;
+	if (!hlp.TestDifficulty(&m_Indices.front(), (uint32_t) m_Indices.size(), m_Difficulty))
+		return false;
+
 	hlp.Reset(pInput, nSizeInput, m_Nonce);
 
 	std::vector<uint8_t> v(m_Indices.begin(), m_Indices.end());
-    return
-		hlp.m_Eh.IsValidSolution(hlp.m_Blake, v) &&
-		hlp.TestDifficulty(&m_Indices.front(), (uint32_t) m_Indices.size(), m_Difficulty);
+	return hlp.m_Eh.IsValidSolution(hlp.m_Blake, std::move(v));
+}
+
+void Block::PoW::IsValidBatch(BatchItem* pItems, size_t nCount, uint32_t nThreads)
+{
+	ParallelFor(nCount, [pItems](size_t i)
+	{
+		BatchItem& x = pItems[i];
+		x.m_bValid = x.m_pPoW->IsValid(x.m_pInput, x.m_nSizeInput);
+	}, nThreads);
 }
 
 } // namespace beam
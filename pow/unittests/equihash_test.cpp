@@ -89,9 +89,86 @@ void TestArrayExpanding()
     TestArrayExpanding(96, 5);
 }
 
+void TestBatch()
+{
+    cout << "Test batch verification...\n";
+
+    // Solved once for the input 0, 1, ..., 31 and this nonce, difficulty 0
+    static const uint8_t pNonce[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x07 };
+    static const uint8_t pSolution[beam::Block::PoW::nSolutionBytes] = {
+        0x09, 0x5e, 0x21, 0x54, 0x98, 0x4b, 0x37, 0xd2, 0x3d, 0x8f, 0x12, 0x94, 0xb7,
+        0x33, 0xc6, 0x71, 0xe8, 0x58, 0x18, 0x38, 0x3c, 0x2b, 0x97, 0xaf, 0xa9, 0xbd,
+        0x0b, 0x57, 0x33, 0x10, 0xff, 0xb4, 0x71, 0x7c, 0x25, 0x47, 0x47, 0x8e, 0x06,
+        0x45, 0x7c, 0x7b, 0x3e, 0xd7, 0x4c, 0x95, 0xcd, 0x52, 0x99, 0xe7, 0x96, 0x71,
+        0x10, 0xfc, 0x89, 0x13, 0x2f, 0xfd, 0x82, 0xd3, 0xe2, 0x09, 0x0a, 0xbc, 0x53,
+        0x15, 0x72, 0xd5, 0xcb, 0xe0, 0xed, 0x42, 0x2d, 0xa1, 0x1b, 0x93, 0xce, 0x2f,
+        0x28, 0x8d, 0x56, 0x72, 0xbb, 0x38, 0x96, 0xd7, 0x06, 0x37, 0x6d, 0x12, 0xd1,
+        0x58, 0xa4, 0x19, 0x71, 0xbb, 0xc5, 0x76, 0xe3, 0xab, 0x0e, 0x2c, 0x3c, 0x10
+    };
+
+    beam::Merkle::Hash hvInput;
+    for (uint32_t i = 0; i < hvInput.nBytes; i++)
+        hvInput.m_pData[i] = static_cast<uint8_t>(i);
+
+    beam::Block::PoW powValid;
+    static_assert(sizeof(pNonce) == powValid.m_Nonce.nBytes);
+    memcpy(powValid.m_Nonce.m_pData, pNonce, sizeof(pNonce));
+    std::copy(pSolution, pSolution + sizeof(pSolution), powValid.m_Indices.begin());
+    powValid.m_Difficulty = 0;
+
+    WALLET_CHECK(powValid.IsValid(hvInput.m_pData, hvInput.nBytes));
+
+    // valid solutions, the same ones with a corrupted index, and random ones
+    const size_t nCount = 21;
+    beam::Merkle::Hash pInput[nCount];
+    beam::Block::PoW pPoW[nCount];
+    beam::Block::PoW::BatchItem pItems[nCount];
+    bool pExpected[nCount];
+
+    for (size_t i = 0; i < nCount; i++)
+    {
+        switch (i % 3)
+        {
+        case 0:
+            pInput[i] = hvInput;
+            pPoW[i] = powValid;
+            pExpected[i] = true;
+            break;
+
+        case 1:
+            pInput[i] = hvInput;
+            pPoW[i] = powValid;
+            pPoW[i].m_Indices[i % beam::Block::PoW::nSolutionBytes] ^= 0x10;
+            pExpected[i] = false;
+            break;
+
+        default:
+            ECC::GenRandom(pInput[i]);
+            ECC::GenRandom(pPoW[i].m_Nonce);
+            ECC::GenRandom(pPoW[i].m_Indices.data(), beam::Block::PoW::nSolutionBytes);
+            pPoW[i].m_Difficulty = 0;
+            pExpected[i] = false;
+        }
+
+        pItems[i].m_pPoW = pPoW + i;
+        pItems[i].m_pInput = pInput[i].m_pData;
+        pItems[i].m_nSizeInput = pInput[i].nBytes;
+        pItems[i].m_bValid = !pExpected[i]; // must be overwritten
+    }
+
+    beam::Block::PoW::IsValidBatch(pItems, nCount, 4);
+
+    for (size_t i = 0; i < nCount; i++)
+    {
+        WALLET_CHECK(pItems[i].m_bValid == pExpected[i]);
+        WALLET_CHECK(pItems[i].m_bValid == pPoW[i].IsValid(pInput[i].m_pData, pInput[i].nBytes));
+    }
+}
+
 int main()
 {
     TestArrayExpanding();
+    TestBatch();
     
     // commented since it doesn't complete in 10 minutes and failes auto tests
 /*
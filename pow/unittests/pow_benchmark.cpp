@@ -0,0 +1,91 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/block_crypt.h"
+#include "utility/helpers.h"
+#include <iostream>
+#include <thread>
+
+using namespace beam;
+
+// Solutions are random, hence rejected. But all the index hashes are generated before the collisions are checked,
+// so this measures the dominant part of the verification.
+
+struct Sample
+{
+	Merkle::Hash m_Input;
+	Block::PoW m_PoW;
+};
+
+void Report(const char* szName, size_t nCount, uint64_t dt_ms)
+{
+	if (!dt_ms)
+		dt_ms = 1;
+
+	uint64_t nPerSec = nCount * 1000ULL / dt_ms;
+
+	std::cout << szName << ": " << nCount << " solutions in " << dt_ms << " ms, "
+		<< nPerSec << " solutions/sec, "
+		<< nPerSec * Block::PoW::nNumIndices << " index hashes/sec" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t nCount = 2000;
+	if (argc > 1)
+		nCount = std::stoul(argv[1]);
+
+	std::vector<Sample> vSamples(nCount);
+	for (size_t i = 0; i < nCount; i++)
+	{
+		Sample& x = vSamples[i];
+		ECC::GenRandom(x.m_Input);
+		ECC::GenRandom(x.m_PoW.m_Nonce);
+		ECC::GenRandom(x.m_PoW.m_Indices.data(), Block::PoW::nSolutionBytes);
+		x.m_PoW.m_Difficulty.m_Packed = 0;
+	}
+
+	std::vector<Block::PoW::BatchItem> vItems(nCount);
+	for (size_t i = 0; i < nCount; i++)
+	{
+		Block::PoW::BatchItem& x = vItems[i];
+		x.m_pPoW = &vSamples[i].m_PoW;
+		x.m_pInput = vSamples[i].m_Input.m_pData;
+		x.m_nSizeInput = vSamples[i].m_Input.nBytes;
+	}
+
+	uint64_t t0 = local_timestamp_msec();
+
+	size_t nValid = 0;
+	for (size_t i = 0; i < nCount; i++)
+		if (vSamples[i].m_PoW.IsValid(vSamples[i].m_Input.m_pData, vSamples[i].m_Input.nBytes))
+			nValid++;
+
+	Report("serial", nCount, local_timestamp_msec() - t0);
+
+	uint32_t nThreads = std::thread::hardware_concurrency();
+
+	t0 = local_timestamp_msec();
+	Block::PoW::IsValidBatch(&vItems.front(), vItems.size(), nThreads);
+	Report("batch", nCount, local_timestamp_msec() - t0);
+
+	size_t nValidBatch = 0;
+	for (size_t i = 0; i < nCount; i++)
+		if (vItems[i].m_bValid)
+			nValidBatch++;
+
+	std::cout << "threads: " << nThreads << ", valid: " << nValid << "/" << nValidBatch << std::endl;
+
+	return (nValid == nValidBatch) ? 0 : 1;
+}
@@ -38,6 +38,8 @@ namespace beam
         const char* WALLET_STORAGE = "wallet_path";
         const char* MINING_THREADS = "mining_threads";
         const char* VERIFICATION_THREADS = "verification_threads";
+        const char* INBOUND_THREADS = "inbound_threads";
+        const char* PROFILE_DB = "profile_db";
         const char* NONCEPREFIX_DIGITS = "nonceprefix_digits";
         const char* NODE_PEER = "peer";
         const char* PASS = "pass";
@@ -91,6 +93,7 @@ namespace beam
         const char* LOG_VERBOSE = "verbose";
         const char* LOG_CLEANUP_DAYS = "log_cleanup_days";
 		const char* LOG_UTXOS = "log_utxos";
+		const char* LOG_ASYNC = "log_async";
         const char* VERSION = "version";
         const char* VERSION_FULL = "version,v";
         const char* GIT_COMMIT_HASH = "git_commit_hash";
@@ -114,6 +117,10 @@ namespace beam
         const char* API_TLS_KEY = "tls_key";
         const char* API_USE_ACL= "use_acl";
         const char* API_ACL_PATH = "acl_path";
+        const char* API_READ_THREADS = "read_threads";
+        const char* API_WALLETS_DIR = "wallets_dir";
+        const char* API_OWNER_WALLET = "owner_wallet";
+        const char* API_IDLE_TIMEOUT = "wallet_idle_timeout";
 
         // treasury
         const char* TR_OPCODE = "tr_op";
@@ -157,6 +164,7 @@ namespace beam
             (cli::MINING_THREADS, po::value<uint32_t>()->default_value(0), "number of mining threads(there is no mining if 0)")
 
             (cli::VERIFICATION_THREADS, po::value<int>()->default_value(-1), "number of threads for cryptographic verifications (0 = single thread, -1 = auto)")
+            (cli::INBOUND_THREADS, po::value<uint32_t>()->default_value(0), "number of threads for decryption of the peer connections (0 = in the node thread)")
             (cli::NONCEPREFIX_DIGITS, po::value<unsigned>()->default_value(0), "number of hex digits for nonce prefix for stratum client (0..6)")
             (cli::NODE_PEER, po::value<vector<string>>()->multitoken(), "nodes to connect to")
             (cli::STRATUM_PORT, po::value<uint16_t>()->default_value(0), "port to start stratum server on")
@@ -166,6 +174,7 @@ namespace beam
 			(cli::RESET_ID, po::value<bool>()->default_value(false), "Reset self ID (used for network authentication). Must do if the node is cloned")
 			(cli::ERASE_ID, po::value<bool>()->default_value(false), "Reset self ID (used for network authentication) and stop before re-creating the new one.")
 			(cli::CHECKDB, po::value<bool>()->default_value(false), "DB integrity check and compact (vacuum)")
+			(cli::PROFILE_DB, po::value<bool>()->default_value(false), "Collect per-statement DB statistics (logged on exit, exposed via metrics)")
             (cli::BBS_ENABLE, po::value<bool>()->default_value(true), "Enable SBBS messaging")
             (cli::CRASH, po::value<int>()->default_value(0), "Induce crash (test proper handling)")
             (cli::OWNER_KEY, po::value<string>(), "Owner viewer key")
@@ -174,6 +183,7 @@ namespace beam
             (cli::KEY_MINE, po::value<string>(), "Standalone miner key (deprecated)")
             (cli::PASS, po::value<string>(), "password for keys")
 			(cli::LOG_UTXOS, po::value<bool>()->default_value(false), "Log recovered UTXOs (make sure the log file is not exposed)")
+			(cli::LOG_ASYNC, po::value<bool>()->default_value(false), "Write the log on a background thread, in batches (messages below the flush level may be lost on a crash)")
 			(cli::HORIZON_HI, po::value<Height>()->default_value(MaxHeight), "spent TXO Hi-Horizon")
 			(cli::HORIZON_LO, po::value<Height>()->default_value(MaxHeight), "spent TXO Lo-Horizon")
             ;
@@ -35,6 +35,8 @@ namespace beam
         extern const char* WALLET_STORAGE;
         extern const char* MINING_THREADS;
         extern const char* VERIFICATION_THREADS;
+        extern const char* INBOUND_THREADS;
+        extern const char* PROFILE_DB;
         extern const char* NONCEPREFIX_DIGITS;
         extern const char* NODE_PEER;
         extern const char* PASS;
@@ -90,6 +92,7 @@ namespace beam
         extern const char* LOG_VERBOSE;
         extern const char* LOG_CLEANUP_DAYS;
 		extern const char* LOG_UTXOS;
+		extern const char* LOG_ASYNC;
         extern const char* VERSION;
         extern const char* VERSION_FULL;
         extern const char* GIT_COMMIT_HASH;
@@ -113,6 +116,10 @@ namespace beam
         extern const char* API_TLS_KEY;
         extern const char* API_USE_ACL;
         extern const char* API_ACL_PATH;
+        extern const char* API_READ_THREADS;
+        extern const char* API_WALLETS_DIR;
+        extern const char* API_OWNER_WALLET;
+        extern const char* API_IDLE_TIMEOUT;
 
         // treasury
         extern const char* TR_OPCODE;
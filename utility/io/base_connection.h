@@ -59,6 +59,19 @@ public:
 		return _stream->state().unsent;
 	}
 
+	uint64_t get_Received() const {
+		return _stream->state().received;
+	}
+
+	uint64_t get_Sent() const {
+		return _stream->state().sent;
+	}
+
+    /// Output backpressure notifications, see TcpStream::set_watermarks
+    void set_watermarks(size_t high, size_t low, const io::TcpStream::WatermarkCallback& callback) {
+        _stream->set_watermarks(high, low, callback);
+    }
+
 protected:
     /// Ctor. Attaches connected tcp stream
     BaseConnection(Direction d, io::TcpStream::Ptr&& stream) :
@@ -38,18 +38,24 @@ namespace {
 
 } //namespace
 
-bool serialize_json_msg(io::FragmentWriter& packer, const nlohmann::json& o) {
-    bool result = true;
+bool serialize_json(io::FragmentWriter& packer, const nlohmann::json& o) {
     try {
         // TODO make stateful object out of these fns if performance issues occur
         nlohmann::detail::serializer<json> s(std::make_shared<JsonOutputAdapter>(packer), ' ');
         s.dump(o, false, false, 0);
+    } catch (const std::exception& e) {
+        LOG_ERROR() << "dump json: " << e.what();
+        return false;
+    }
+    return true;
+}
+
+bool serialize_json_msg(io::FragmentWriter& packer, const nlohmann::json& o) {
+    bool result = serialize_json(packer, o);
+    if (result) {
         // for stratum
         static const char eol = 10;
         packer.write(&eol, 1);
-    } catch (const std::exception& e) {
-        LOG_ERROR() << "dump json: " << e.what();
-        result = false;
     }
     packer.finalize();
     return result;
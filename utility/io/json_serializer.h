@@ -21,5 +21,8 @@ namespace beam {
 // appends json msg to out by fragment writer
 bool serialize_json_msg(io::FragmentWriter& packer, const nlohmann::json& o);
 
+// appends json value to out by fragment writer, without eol and finalizing
+bool serialize_json(io::FragmentWriter& packer, const nlohmann::json& o);
+
 } //namespace
 
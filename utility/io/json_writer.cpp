@@ -0,0 +1,311 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "json_writer.h"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <assert.h>
+
+namespace beam { namespace io {
+
+namespace {
+
+    struct HexTable {
+        char pairs[512];
+
+        HexTable() {
+            static const char digits[] = "0123456789abcdef";
+            for (int i = 0; i < 256; i++) {
+                pairs[2 * i] = digits[i >> 4];
+                pairs[2 * i + 1] = digits[i & 0xF];
+            }
+        }
+    };
+
+    const HexTable g_HexTable;
+
+    // writes 2 hex digits per byte, returns the end of the output
+    char* encode_hex(char* dst, const uint8_t* src, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            memcpy(dst, g_HexTable.pairs + 2 * src[i], 2);
+            dst += 2;
+        }
+        return dst;
+    }
+
+    const size_t HEX_CHUNK = 128; // source bytes per write
+
+    // short escape sequence for the char, 0 if it needs \u00XX
+    char escape_char(uint8_t c) {
+        switch (c) {
+        case '"': return '"';
+        case '\\': return '\\';
+        case '\b': return 'b';
+        case '\f': return 'f';
+        case '\n': return 'n';
+        case '\r': return 'r';
+        case '\t': return 't';
+        default: return 0;
+        }
+    }
+
+    // size of the well-formed UTF-8 sequence at p (non-ASCII lead byte), 0 if it's malformed
+    size_t utf8_sequence(const uint8_t* p, const uint8_t* end) {
+        size_t n = 0;
+        uint8_t lo = 0x80, hi = 0xbf; // range of the 2nd byte
+        if (*p >= 0xc2 && *p <= 0xdf) {
+            n = 2;
+        } else if (*p >= 0xe0 && *p <= 0xef) {
+            n = 3;
+            if (*p == 0xe0) lo = 0xa0; // overlong
+            if (*p == 0xed) hi = 0x9f; // surrogates
+        } else if (*p >= 0xf0 && *p <= 0xf4) {
+            n = 4;
+            if (*p == 0xf0) lo = 0x90; // overlong
+            if (*p == 0xf4) hi = 0x8f; // above U+10FFFF
+        }
+
+        if (!n || (size_t)(end - p) < n || p[1] < lo || p[1] > hi) return 0;
+        for (size_t i = 2; i < n; i++) {
+            if ((p[i] & 0xc0) != 0x80) return 0;
+        }
+        return n;
+    }
+
+} //namespace
+
+JsonWriter::JsonWriter(FragmentWriter& fw) :
+    _fw(fw)
+{}
+
+void JsonWriter::next_item() {
+    if (_afterKey) {
+        _afterKey = false;
+        return;
+    }
+    if (!_depth) return;
+    uint64_t bit = 1ULL << (_depth - 1);
+    if (_hasItems & bit) put(',');
+    else _hasItems |= bit;
+}
+
+void JsonWriter::begin(char c) {
+    next_item();
+    assert(_depth < 64);
+    put(c);
+    ++_depth;
+    _hasItems &= ~(1ULL << (_depth - 1));
+}
+
+void JsonWriter::end(char c) {
+    assert(_depth > 0 && !_afterKey);
+    --_depth;
+    put(c);
+}
+
+JsonWriter& JsonWriter::begin_object() {
+    begin('{');
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_object() {
+    end('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::begin_array() {
+    begin('[');
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_array() {
+    end(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(const char* name) {
+    assert(_depth > 0 && !_afterKey);
+    next_item();
+    put('"');
+    _fw.write(name, strlen(name));
+    _fw.write("\":", 2);
+    _afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    next_item();
+    _fw.write("null", 4);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+    next_item();
+    if (b) _fw.write("true", 4);
+    else _fw.write("false", 5);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value_signed(int64_t n) {
+    next_item();
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), n);
+    _fw.write(buf, r.ptr - buf);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value_unsigned(uint64_t n) {
+    next_item();
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), n);
+    _fw.write(buf, r.ptr - buf);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double d) {
+    if (!std::isfinite(d)) return null();
+
+    next_item();
+
+    // shortest round-trip form, integral values keep ".0" as nlohmann's dump does
+    char buf[40];
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+    char* end = std::to_chars(buf, buf + sizeof(buf) - 2, d).ptr;
+#else
+    // no floating point to_chars in older libc++ (Apple clang). The least precision that round-trips, up to "%.17g"
+    int n = 0;
+    for (int nDigits = 15; nDigits <= 17; nDigits++) {
+        n = snprintf(buf, sizeof(buf) - 2, "%.*g", nDigits, d);
+        if (strtod(buf, nullptr) == d)
+            break;
+    }
+    char* end = buf + n;
+#endif
+    if (!memchr(buf, '.', end - buf) && !memchr(buf, 'e', end - buf)) {
+        *end++ = '.';
+        *end++ = '0';
+    }
+    _fw.write(buf, end - buf);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* s) {
+    return value(s, strlen(s));
+}
+
+JsonWriter& JsonWriter::value(const char* s, size_t size) {
+    next_item();
+    put('"');
+
+    // runs of chars that don't need escaping are written at once
+    const uint8_t* run = reinterpret_cast<const uint8_t*>(s);
+    const uint8_t* end = run + size;
+    for (const uint8_t* p = run; p < end; ) {
+        uint8_t c = *p;
+        if (c >= 0x80) {
+            size_t n = utf8_sequence(p, end);
+            if (n) {
+                p += n;
+                continue;
+            }
+
+            // the text may come from a peer, a malformed byte must not break the json
+            _fw.write(run, p - run);
+            _fw.write("\xef\xbf\xbd", 3); // U+FFFD
+            run = ++p;
+            continue;
+        }
+
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            ++p;
+            continue;
+        }
+
+        _fw.write(run, p - run);
+        run = ++p;
+
+        char esc[6] = { '\\', escape_char(c) };
+        if (esc[1]) {
+            _fw.write(esc, 2);
+        } else {
+            memcpy(esc + 1, "u00", 3);
+            memcpy(esc + 4, g_HexTable.pairs + 2 * c, 2);
+            _fw.write(esc, 6);
+        }
+    }
+    _fw.write(run, end - run);
+
+    put('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::hex(const void* data, size_t size) {
+    next_item();
+
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    char buf[2 * HEX_CHUNK + 2];
+    char* dst = buf;
+    *dst++ = '"';
+
+    while (size > HEX_CHUNK) {
+        dst = encode_hex(dst, p, HEX_CHUNK);
+        _fw.write(buf, dst - buf);
+        dst = buf;
+        p += HEX_CHUNK;
+        size -= HEX_CHUNK;
+    }
+
+    dst = encode_hex(dst, p, size);
+    *dst++ = '"';
+    _fw.write(buf, dst - buf);
+    return *this;
+}
+
+JsonWriter& JsonWriter::hex_number(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (size && !*p) {
+        ++p;
+        --size;
+    }
+
+    assert(size <= HEX_CHUNK);
+    next_item();
+
+    char buf[2 * HEX_CHUNK + 4];
+    memcpy(buf, "\"0x", 3);
+    char* dst = encode_hex(buf + 3, p, size);
+
+    // the first byte may have a leading zero digit, zero is written as "0x0"
+    char* digits = buf + 3;
+    if (!size) *dst++ = '0';
+    else if (*digits == '0') {
+        memmove(digits, digits + 1, dst - digits - 1);
+        --dst;
+    }
+
+    *dst++ = '"';
+    _fw.write(buf, dst - buf);
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(const void* data, size_t size) {
+    next_item();
+    _fw.write(data, size);
+    return *this;
+}
+
+}} //namespaces
@@ -0,0 +1,85 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "fragment_writer.h"
+#include <string>
+#include <type_traits>
+
+namespace beam { namespace io {
+
+/// Streaming (SAX-style) json writer, serializes values straight into fragments,
+/// without building json DOM and without intermediate strings.
+/// Commas and colons are inserted automatically, the caller is responsible for the proper nesting.
+/// Doesn't finalize the fragment writer
+class JsonWriter {
+public:
+    explicit JsonWriter(FragmentWriter& fw);
+
+    JsonWriter& begin_object();
+    JsonWriter& end_object();
+    JsonWriter& begin_array();
+    JsonWriter& end_array();
+
+    /// Object member name, must be followed by its value. The name is written as is (no escaping)
+    JsonWriter& key(const char* name);
+
+    JsonWriter& null();
+    JsonWriter& value(bool b);
+    JsonWriter& value(double d);
+    /// Strings are escaped, each malformed UTF-8 byte is replaced by U+FFFD
+    JsonWriter& value(const char* s);
+    JsonWriter& value(const char* s, size_t size);
+    JsonWriter& value(const std::string& s) { return value(s.data(), s.size()); }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    JsonWriter& value(T n) {
+        if (std::is_signed<T>::value) return value_signed(static_cast<int64_t>(n));
+        return value_unsigned(static_cast<uint64_t>(n));
+    }
+
+    /// Bytes as a quoted lowercase hex string (hashes, IDs)
+    JsonWriter& hex(const void* data, size_t size);
+
+    /// Big-endian number (commitment X, chainwork) up to 128 bytes,
+    /// as a quoted "0x"-prefixed hex string without leading zeros
+    JsonWriter& hex_number(const void* data, size_t size);
+
+    /// Already serialized json value, written as is
+    JsonWriter& raw(const void* data, size_t size);
+
+private:
+    JsonWriter& value_signed(int64_t n);
+    JsonWriter& value_unsigned(uint64_t n);
+
+    /// Writes comma if needed
+    void next_item();
+
+    void begin(char c);
+    void end(char c);
+
+    void put(char c) { _fw.write(&c, 1); }
+
+    FragmentWriter& _fw;
+
+    /// Bit per nesting level, set if the level already has items
+    uint64_t _hasItems=0;
+
+    uint32_t _depth=0;
+
+    /// True between key and its value
+    bool _afterKey=false;
+};
+
+}} //namespaces
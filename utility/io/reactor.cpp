@@ -261,45 +261,50 @@ public:
         _writeRequestsPool(config().get_int("io.write_pool_size", 256, 0, 65536))
     {}
 
+    ~PendingWrites() {
+        // requests that are still linked never got their callbacks
+        while (_head) {
+            release_request(_head);
+        }
+    }
+
     void cancel_all() {
-        for (uv_write_t* wr : _writeRequests) {
+        for (WriteRequest* wr = _head; wr; wr = wr->next) {
             uv_handle_t* h = (uv_handle_t*)(wr->handle);
             _reactor.async_close(h);
         }
     }
 
     ErrorCode async_write(Reactor::Object* o, BufferChain& unsent, const Reactor::OnDataWritten& cb) {
-        uv_write_t* req = _writeRequestsPool.alloc();
-
-        size_t nBytes = unsent.size();
-        auto p = _data.insert({ req, Ctx{ this, std::move(unsent), cb, nBytes } });
-
-        assert (p.second);
-        Ctx* ctx = &p.first->second;
-        req->data = ctx;
-
-        _writeRequests.insert(req);
-
+        WriteRequest* req = _writeRequestsPool.alloc();
+        req->self = this;
+        req->nBytes = unsent.size();
+        new(&req->unsent) BufferChain(std::move(unsent));
+        new(&req->cb) Callback(cb);
+        link(req);
+
+        // all fragments go to the kernel in one writev
         auto ec = (ErrorCode)uv_write(
             req,
             (uv_stream_t*)o->_handle,
-            (uv_buf_t*)ctx->unsent.fragments(),
-            static_cast<unsigned>(ctx->unsent.num_fragments()),
-            [](uv_write_t* req, int errorCode) {
-                assert(req);
-                assert(req->data);
-                Ctx* ctx = reinterpret_cast<Ctx*>(req->data);
-                assert(ctx->self);
+            (uv_buf_t*)req->unsent.fragments(),
+            static_cast<unsigned>(req->unsent.num_fragments()),
+            [](uv_write_t* request, int errorCode) {
+                assert(request);
+                WriteRequest* req = static_cast<WriteRequest*>(request);
+                assert(req->self);
                 if (errorCode != UV_ECANCELED && req->handle != 0 && req->handle->data != 0) {
                     // object may be no longer alive if UV_CANCELED
-                    assert(ctx->cb);
-                    ctx->cb(ErrorCode(errorCode), errorCode == EC_OK ? ctx->nBytes : 0);
+                    assert(req->cb);
+                    req->cb(ErrorCode(errorCode), errorCode == EC_OK ? req->nBytes : 0);
                 }
-                ctx->self->release_request(req);
+                req->self->release_request(req);
             }
         );
 
         if (ec != EC_OK) {
+            // give the data back to the caller
+            unsent = std::move(req->unsent);
             release_request(req);
         } else {
             unsent.clear();
@@ -309,23 +314,41 @@ public:
     }
 
 private:
-    struct Ctx {
-        PendingWrites* self = 0;
+    using Callback = Reactor::OnDataWritten;
+
+    /// Write request with its context, linked into intrusive list of active requests
+    struct WriteRequest : uv_write_t {
+        PendingWrites* self;
+        WriteRequest* prev;
+        WriteRequest* next;
         BufferChain unsent;
-        Reactor::OnDataWritten cb;
-        size_t nBytes = 0;
+        Callback cb;
+        size_t nBytes;
     };
 
-    void release_request(uv_write_t* req) {
-        _data.erase(req);
-        _writeRequests.erase(req);
+    void link(WriteRequest* req) {
+        req->prev = 0;
+        req->next = _head;
+        if (_head) _head->prev = req;
+        _head = req;
+    }
+
+    void unlink(WriteRequest* req) {
+        if (req->prev) req->prev->next = req->next;
+        else _head = req->next;
+        if (req->next) req->next->prev = req->prev;
+    }
+
+    void release_request(WriteRequest* req) {
+        unlink(req);
+        req->unsent.~BufferChain();
+        req->cb.~Callback();
         _writeRequestsPool.release(req);
     }
 
     Reactor& _reactor;
-    MemPool<uv_write_t, sizeof(uv_write_t)> _writeRequestsPool;
-    std::unordered_set<uv_write_t*> _writeRequests;
-    std::unordered_map<uv_write_t*, Ctx> _data;
+    MemPool<WriteRequest, sizeof(WriteRequest)> _writeRequestsPool;
+    WriteRequest* _head = 0;
 };
 
 Reactor::Ptr Reactor::create() {
@@ -115,6 +115,10 @@ void TcpStream::shutdown() {
     if (is_connected()) {
         disable_read();
         do_write(true);
+        if (_writeInProgress && !_writeBuffer.empty()) {
+            // don't wait for the previous request, libuv will send them in order before shutdown
+            submit_write();
+        }
         _reactor->shutdown_tcpstream(this);
         assert(!_callback);
         assert(!is_connected());
@@ -127,29 +131,84 @@ void TcpStream::enable_keepalive(unsigned initialDelaySecs) {
     }
 }
 
+void TcpStream::set_watermarks(size_t high, size_t low, const WatermarkCallback& callback) {
+    assert(low <= high);
+    _highWatermark = high;
+    _lowWatermark = low;
+    _onWatermark = callback;
+    _overflow = false;
+}
+
+void TcpStream::check_watermarks() {
+    if (!_highWatermark || !_onWatermark) return;
+
+    if (_overflow) {
+        if (_state.unsent <= _lowWatermark) {
+            _overflow = false;
+            _onWatermark(false);
+        }
+    } else {
+        if (_state.unsent >= _highWatermark) {
+            _overflow = true;
+            _onWatermark(true);
+        }
+    }
+}
+
 Result TcpStream::do_write(bool flush) {
+    if (flush) {
+        _state.unsent += _writeBuffer.size() - _flushedBytes;
+        _flushedBytes = _writeBuffer.size();
+    }
+
+    // otherwise it will be sent on completion of the current request
+    if (_flushedBytes && !_writeInProgress) {
+        Result res = submit_write();
+        if (!res) return res;
+    }
+
+    check_watermarks();
+    return Ok();
+}
+
+Result TcpStream::submit_write() {
+    // data appended without flush goes with the rest of the buffer
+    _state.unsent += _writeBuffer.size() - _flushedBytes;
+    _flushedBytes = 0;
+
     size_t nBytes = _writeBuffer.size();
-    if (flush && nBytes > 0) {
-        ErrorCode ec = _reactor->async_write(this, _writeBuffer, _onDataWritten);
-        if (ec != EC_OK) {
-            LOG_DEBUG() << __FUNCTION__ << " " << error_str(ec);
-            return make_unexpected(ec);
-        }
-        _state.unsent += nBytes;
+    ErrorCode ec = _reactor->async_write(this, _writeBuffer, _onDataWritten);
+    if (ec != EC_OK) {
+        LOG_DEBUG() << __FUNCTION__ << " " << error_str(ec);
+        _state.unsent -= nBytes;
+        return make_unexpected(ec);
     }
-    if (flush) assert(_writeBuffer.empty());
+    _writeInProgress = true;
     return Ok();
 }
 
 void TcpStream::on_data_written(ErrorCode errorCode, size_t n) {
+    _writeInProgress = false;
     if (errorCode != EC_OK) {
         if (_callback) _callback(errorCode, 0, 0);
-    } else {
-        _state.sent += n;
-        assert(_state.unsent >= n);
-        _state.unsent -= n;
+        return;
     }
+
+    _state.sent += n;
+    assert(_state.unsent >= n);
+    _state.unsent -= n;
     LOG_DEBUG() << __FUNCTION__ << TRACE(n) << TRACE(_state.unsent) << TRACE(_state.sent) << TRACE(_state.received);
+
+    if (_flushedBytes) {
+        // send everything accumulated while the previous request was in progress
+        Result res = submit_write();
+        if (!res) {
+            if (_callback) _callback(res.error(), 0, 0);
+            return;
+        }
+    }
+
+    check_watermarks();
 }
 
 bool TcpStream::is_connected() const {
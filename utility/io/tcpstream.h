@@ -37,6 +37,10 @@ public:
         size_t unsent=0;
     };
 
+    // Called with true when unsent data reaches the high watermark (from within write),
+    // and with false once it drains down to the low watermark
+    using WatermarkCallback = std::function<void(bool overflow)>;
+
     ~TcpStream();
 
     // Sets callback and enables reading from the stream if callback is not empty
@@ -78,6 +82,9 @@ public:
     /// Enables tcp keep-alive
     void enable_keepalive(unsigned initialDelaySecs);
 
+    /// Sets output backpressure thresholds (in unsent bytes), high==0 disables notifications
+    void set_watermarks(size_t high, size_t low, const WatermarkCallback& callback);
+
 protected:
     TcpStream();
 
@@ -95,17 +102,33 @@ private:
     void alloc_read_buffer();
     void free_read_buffer();
 
-    // sends async write request if flush == true
+    // marks buffered data for sending if flush == true, sends it unless a write request is already in progress
     Result do_write(bool flush);
 
+    // sends all buffered data in one write request
+    Result submit_write();
+
+    void check_watermarks();
+
     // callback from write request
     void on_data_written(ErrorCode errorCode, size_t n);
 
     uv_buf_t _readBuffer={0, 0};
+
+    // Data not yet passed to the reactor. While a write request is in progress, new data
+    // is accumulated here and then sent in one request with many fragments
     BufferChain _writeBuffer;
+    size_t _flushedBytes=0;
+    bool _writeInProgress=false;
+
     Callback _callback;
     State _state;
     Reactor::OnDataWritten _onDataWritten;
+
+    size_t _highWatermark=0;
+    size_t _lowWatermark=0;
+    bool _overflow=false;
+    WatermarkCallback _onWatermark;
 };
 
 }} //namespaces
@@ -34,6 +34,10 @@
 #include <iostream>
 #include <fstream>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <vector>
 #include <algorithm>
 
 namespace beam {
@@ -42,18 +46,86 @@ using namespace std;
 
 Logger* Logger::g_logger = 0;
 
-class LoggerImpl : public Logger {
+class LoggerImpl;
+
+// Background writer. Each logging thread owns a single-producer ring of formatted records,
+// the writer thread drains them in batches and does all the sink I/O, including the rotation.
+class AsyncLogWriter {
+public:
+    static constexpr uint32_t RING_SIZE = 1 << 18; // per thread, must be a power of 2
+    static constexpr unsigned FLUSH_INTERVAL_MSEC = 20;
+
+    AsyncLogWriter(LoggerImpl& owner, int flushLevel);
+    ~AsyncLogWriter();
+
+    /// Returns false if the record can't be queued, then it should be written synchronously
+    bool push(int level, const char* header, size_t headerSize, const char* msg, size_t size);
+
+    /// Waits until all the records of the calling thread are written
+    void drain_own();
+
+    void request_reopen() {
+        _reopen = true;
+        wake();
+    }
+
+private:
+    struct RecordHeader {
+        uint32_t size; // header + msg
+        uint32_t headerSize;
+        int level;
+    };
+
+    struct Ring {
+        std::atomic<uint32_t> head{0}; // free-running, advanced by the producer
+        std::atomic<uint32_t> tail{0}; // free-running, advanced by the writer
+        std::atomic<bool> orphaned{false}; // producer thread exited
+        char buf[RING_SIZE];
+
+        void write(uint32_t pos, const void* p, size_t size);
+        void read(uint32_t pos, void* p, size_t size) const;
+    };
+
+    struct ThreadRing {
+        uint64_t ownerId = 0;
+        std::shared_ptr<Ring> ring;
+
+        ~ThreadRing() {
+            if (ring) ring->orphaned = true;
+        }
+    };
+
+    Ring& get_ring();
+    void wake();
+    void run();
+    bool drain(Ring& r);
+
+    LoggerImpl& _owner;
+    int _flushLevel;
+    uint64_t _id;
+    std::vector<std::shared_ptr<Ring>> _rings; // protected by _mutex
+    std::vector<char> _scratch; // writer thread only
     mutex _mutex;
+    condition_variable _cv;
+    std::atomic<bool> _signal{false};
+    std::atomic<bool> _reopen{false};
+    std::atomic<bool> _stop{false};
+    std::thread _thread;
+};
+
+class LoggerImpl : public Logger {
 protected:
     static const size_t MAX_HEADER_SIZE = 256;
     static const size_t MAX_TIMESTAMP_SIZE = 80;
 
+    mutex _mutex;
     FILE* _sink;
     int _minLevel;
     int _flushLevel;
     LogMessageHeaderFormatter _headerFormatter = def_header_formatter;
     std::string _timeFormat;
     bool _printMilliseconds;
+    std::unique_ptr<AsyncLogWriter> _async;
 
     LoggerImpl(FILE* sink, int minLevel, int flushLevel) :
         _sink(sink),
@@ -67,6 +139,7 @@ protected:
     }
 
     virtual ~LoggerImpl() {
+        assert(!_async); // must be stopped by the derived class, before the sinks are closed
         if (this == g_logger) {
             g_logger = 0;
         }
@@ -86,6 +159,19 @@ protected:
         }
     }
 
+    // _async is read by write_message() without a lock, see Logger::set_async()
+    void set_async(bool enable) override {
+        if (!enable) {
+            stop_async();
+        } else if (!_async) {
+            _async = std::make_unique<AsyncLogWriter>(*this, _flushLevel);
+        }
+    }
+
+    void stop_async() {
+        _async.reset(); // drains all the rings
+    }
+
     void write_message(const LogMessageHeader& header, const char* buf, size_t size) override {
         char timestampFormatted[MAX_TIMESTAMP_SIZE];
         char headerFormatted[MAX_HEADER_SIZE];
@@ -95,7 +181,12 @@ protected:
             timestampFormatted[0] = 0;
         }
         size_t headerSize = _headerFormatter(headerFormatted, MAX_HEADER_SIZE, timestampFormatted, header);
-        write_impl(header.level, headerFormatted, headerSize, buf, size);
+
+        if (_async) {
+            if (_async->push(header.level, headerFormatted, headerSize, buf, size)) return;
+            _async->drain_own(); // keep the order of this thread's messages
+        }
+        dispatch(header.level, headerFormatted, headerSize, buf, size, true);
     }
 
     const FileNameType& get_current_file_name() override {
@@ -108,21 +199,195 @@ public:
         return level >= _minLevel;
     }
 
-    void write_impl(int level, const char* header, size_t headerSize, const char* msg, size_t size) {
-        if (!_sink) return;
+    /// Writes to the sink(s), flushes if allowed and the level requires
+    virtual void dispatch(int level, const char* header, size_t headerSize, const char* msg, size_t size, bool canFlush) {
+        write_impl(level, header, headerSize, msg, size, canFlush);
+    }
+
+    virtual void flush_sinks() {
+        lock_guard<mutex> lock(_mutex);
+        if (_sink) fflush(_sink);
+    }
+
+    /// Called by the writer thread after rotate() in async mode
+    virtual void reopen_files() {}
+
+    void write_impl(int level, const char* header, size_t headerSize, const char* msg, size_t size, bool canFlush = true) {
         lock_guard<mutex> lock(_mutex);
+        if (!_sink) return;
         fwrite(header, 1, headerSize, _sink);
         fwrite(msg, 1, size, _sink);
-        if (level >= _flushLevel) fflush(_sink);
+        if (canFlush && level >= _flushLevel) fflush(_sink);
     }
 };
 
+AsyncLogWriter::AsyncLogWriter(LoggerImpl& owner, int flushLevel) :
+    _owner(owner),
+    _flushLevel(flushLevel)
+{
+    static std::atomic<uint64_t> s_lastId{0};
+    _id = ++s_lastId;
+    _thread = std::thread(&AsyncLogWriter::run, this);
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_one();
+    _thread.join();
+}
+
+void AsyncLogWriter::Ring::write(uint32_t pos, const void* p, size_t size) {
+    uint32_t offset = pos & (RING_SIZE - 1);
+    size_t n = std::min<size_t>(size, RING_SIZE - offset);
+    memcpy(buf + offset, p, n);
+    memcpy(buf, (const char*) p + n, size - n);
+}
+
+void AsyncLogWriter::Ring::read(uint32_t pos, void* p, size_t size) const {
+    uint32_t offset = pos & (RING_SIZE - 1);
+    size_t n = std::min<size_t>(size, RING_SIZE - offset);
+    memcpy(p, buf + offset, n);
+    memcpy((char*) p + n, buf, size - n);
+}
+
+AsyncLogWriter::Ring& AsyncLogWriter::get_ring() {
+    static thread_local ThreadRing tr;
+    if (tr.ownerId != _id) {
+        if (tr.ring) tr.ring->orphaned = true; // left from the previous logger
+
+        tr.ring = std::make_shared<Ring>();
+        tr.ownerId = _id;
+
+        lock_guard<mutex> lock(_mutex);
+        _rings.push_back(tr.ring);
+    }
+    return *tr.ring;
+}
+
+void AsyncLogWriter::wake() {
+    if (!_signal.exchange(true)) {
+        _cv.notify_one();
+    }
+}
+
+bool AsyncLogWriter::push(int level, const char* header, size_t headerSize, const char* msg, size_t size) {
+    size_t total = sizeof(RecordHeader) + headerSize + size;
+    if (total > RING_SIZE / 2) return false;
+
+    Ring& r = get_ring();
+    uint32_t head = r.head.load(memory_order_relaxed);
+
+    while (RING_SIZE - (head - r.tail.load(memory_order_acquire)) < total) {
+        if (_stop) return false;
+        wake();
+        this_thread::yield();
+    }
+
+    RecordHeader rh;
+    rh.size = uint32_t(headerSize + size);
+    rh.headerSize = uint32_t(headerSize);
+    rh.level = level;
+
+    r.write(head, &rh, sizeof(rh));
+    r.write(head + sizeof(rh), header, headerSize);
+    r.write(uint32_t(head + sizeof(rh) + headerSize), msg, size);
+
+    head += uint32_t(total);
+    r.head.store(head, memory_order_release);
+
+    if (level >= _flushLevel || head - r.tail.load(memory_order_relaxed) > RING_SIZE / 2) {
+        wake();
+    }
+    return true;
+}
+
+void AsyncLogWriter::drain_own() {
+    Ring& r = get_ring();
+    while (r.tail.load(memory_order_acquire) != r.head.load(memory_order_relaxed) && !_stop) {
+        wake();
+        this_thread::yield();
+    }
+}
+
+bool AsyncLogWriter::drain(Ring& r) {
+    uint32_t tail = r.tail.load(memory_order_relaxed);
+    uint32_t head = r.head.load(memory_order_acquire);
+    if (tail == head) return false;
+
+    while (tail != head) {
+        RecordHeader rh;
+        r.read(tail, &rh, sizeof(rh));
+        tail += sizeof(rh);
+
+        const char* data;
+        uint32_t offset = tail & (RING_SIZE - 1);
+        if (offset + rh.size <= RING_SIZE) {
+            data = r.buf + offset;
+        } else {
+            _scratch.resize(rh.size);
+            r.read(tail, _scratch.data(), rh.size);
+            data = _scratch.data();
+        }
+
+        _owner.dispatch(rh.level, data, rh.headerSize, data + rh.headerSize, rh.size - rh.headerSize, false);
+
+        tail += rh.size;
+        r.tail.store(tail, memory_order_release);
+    }
+    return true;
+}
+
+void AsyncLogWriter::run() {
+    std::vector<std::shared_ptr<Ring>> rings;
+
+    for (;;) {
+        bool stop;
+        {
+            unique_lock<mutex> lock(_mutex);
+            if (!_stop && !_signal) {
+                _cv.wait_for(lock, chrono::milliseconds(FLUSH_INTERVAL_MSEC));
+            }
+            _signal = false;
+            stop = _stop;
+
+            // rings of the exited threads are dropped once drained
+            _rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](const std::shared_ptr<Ring>& r) {
+                return r->orphaned && (r->tail == r->head);
+            }), _rings.end());
+
+            rings = _rings;
+        }
+
+        bool written = false;
+        for (const auto& r : rings) {
+            if (drain(*r)) written = true;
+        }
+
+        if (_reopen.exchange(false)) {
+            _owner.reopen_files();
+        }
+
+        if (written) {
+            _owner.flush_sinks();
+        }
+
+        if (stop) break;
+    }
+}
+
 class ConsoleLogger : public LoggerImpl {
 public:
     ConsoleLogger(int flushLevel, int consoleLevel) :
         LoggerImpl(stdout, consoleLevel, flushLevel)
     {}
 
+    ~ConsoleLogger() {
+        stop_async();
+    }
+
     // does nothing for console
     void rotate() override {}
 };
@@ -134,36 +399,49 @@ public:
         _fileNamePrefix(fileNamePrefix),
         _dstPath(dstPath)
     {
-        open_new_file();
+        new_file_name();
+        open_file();
     }
 
     void rotate() override {
         try {
-            open_new_file();
+            new_file_name();
+            if (_async) {
+                _async->request_reopen();
+            } else {
+                open_file();
+            }
+        } catch (const std::exception& e) {
+            fprintf(stderr, "log error, %s\n", e.what());
+        }
+    }
+
+    void reopen_files() override {
+        try {
+            open_file();
         } catch (const std::exception& e) {
             fprintf(stderr, "log error, %s\n", e.what());
         }
     }
 
     ~FileLogger() {
-        fclose(_sink);
+        stop_async();
+        if (_sink) fclose(_sink);
     }
 
     const FileNameType& get_current_file_name() override {
         return _fullPath;
     }
 
-private:
-    void open_new_file() {
-        if (_sink != nullptr) {
-            fclose(_sink);
-            _sink = nullptr;
-        }
-
+    // The name is generated on the calling thread, so that it's immediately visible via get_current_file_name()
+    void new_file_name() {
         string fileName(_fileNamePrefix);
         fileName += format_timestamp("%y_%m_%d_%H_%M_%S", local_timestamp_msec(), false);
         fileName += ".log";
 
+        lock_guard<mutex> lock(_nameMutex);
+        _fileName = fileName;
+
         if (!_dstPath.empty())
         {
 #ifdef WIN32
@@ -192,18 +470,38 @@ private:
             _fullPath = fileName;
 #endif
         }
+    }
+
+    void open_file() {
+        FileNameType fullPath;
+        string fileName;
+        {
+            lock_guard<mutex> lock(_nameMutex);
+            fullPath = _fullPath;
+            fileName = _fileName;
+        }
+
+        lock_guard<mutex> lock(_mutex);
+
+        if (_sink != nullptr) {
+            fclose(_sink);
+            _sink = nullptr;
+        }
 
 #ifdef WIN32
-        _sink = _wfsopen(_fullPath.c_str(), L"ab", _SH_DENYNO);
+        _sink = _wfsopen(fullPath.c_str(), L"ab", _SH_DENYNO);
 #else
-        _sink = fopen(_fullPath.c_str(), "ab");
+        _sink = fopen(fullPath.c_str(), "ab");
 #endif
 
         if (!_sink) throw runtime_error(string("cannot open file ") + fileName);
     }
 
+private:
     std::string _fileNamePrefix;
     std::string _dstPath;
+    std::string _fileName; // without the path, for the error message
+    mutex _nameMutex;
 
 #ifdef WIN32
     std::wstring _fullPath;
@@ -223,29 +521,44 @@ public:
         _consoleSink(flushLevel, consoleLevel)
     {}
 
-    void write_message(const LogMessageHeader& header, const char* buf, size_t size) override {
-        char timestampFormatted[MAX_TIMESTAMP_SIZE];
-        char headerFormatted[MAX_HEADER_SIZE];
-        if (!_timeFormat.empty()) {
-            format_timestamp(timestampFormatted, MAX_TIMESTAMP_SIZE, _timeFormat.c_str(), header.timestamp, _printMilliseconds);
-        } else {
-            timestampFormatted[0] = 0;
-        }
-        size_t headerSize = _headerFormatter(headerFormatted, MAX_HEADER_SIZE, timestampFormatted, header);
-        if (_consoleSink.level_accepted(header.level)) {
-            _consoleSink.write_impl(header.level, headerFormatted, headerSize, buf, size);
+    ~CombinedLogger() {
+        stop_async();
+    }
+
+    void dispatch(int level, const char* header, size_t headerSize, const char* msg, size_t size, bool canFlush) override {
+        if (_consoleSink.level_accepted(level)) {
+            _consoleSink.write_impl(level, header, headerSize, msg, size, canFlush);
         }
-        if (_fileSink.level_accepted(header.level)) {
-            _fileSink.write_impl(header.level, headerFormatted, headerSize, buf, size);
+        if (_fileSink.level_accepted(level)) {
+            _fileSink.write_impl(level, header, headerSize, msg, size, canFlush);
         }
     }
 
+    void flush_sinks() override {
+        _consoleSink.flush_sinks();
+        _fileSink.flush_sinks();
+    }
+
     const FileNameType& get_current_file_name() override {
         return _fileSink.get_current_file_name();
     }
 
     void rotate() override {
-        _fileSink.rotate();
+        if (!_async) {
+            _fileSink.rotate();
+            return;
+        }
+
+        try {
+            _fileSink.new_file_name();
+            _async->request_reopen();
+        } catch (const std::exception& e) {
+            fprintf(stderr, "log error, %s\n", e.what());
+        }
+    }
+
+    void reopen_files() override {
+        _fileSink.reopen_files();
     }
 };
 
@@ -167,6 +167,11 @@ public:
     /// Rotates file name, called externally
     virtual void rotate() = 0;
 
+    /// Moves the sink I/O to a background thread. Messages are queued to per-thread lock-free rings
+    /// and written (and flushed) in batches, rotation is applied by the same thread.
+    /// Not synchronized with the logging threads: switch it only while no other thread logs (at startup or shutdown).
+    virtual void set_async(bool) = 0;
+
     static bool will_log(int level) {
         return g_logger && g_logger->level_accepted(level);
     }
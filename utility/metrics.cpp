@@ -0,0 +1,448 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "metrics.h"
+#include "common.h"
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+namespace beam {
+namespace Metrics {
+
+/////////////////////////
+// Writer
+void Writer::Type(const char* szName, const char* szHelp, const char* szType)
+{
+	for (m_iCurrent = 0; m_iCurrent < m_vFamilies.size(); m_iCurrent++)
+		if (m_vFamilies[m_iCurrent].m_sName == szName)
+			return; // already described, the samples are appended to it
+
+	Family& f = m_vFamilies.emplace_back();
+	f.m_sName = szName;
+
+	f.m_s += "# HELP ";
+	f.m_s += szName;
+	f.m_s += ' ';
+	f.m_s += szHelp;
+	f.m_s += "\n# TYPE ";
+	f.m_s += szName;
+	f.m_s += ' ';
+	f.m_s += szType;
+	f.m_s += '\n';
+}
+
+std::string& Writer::SampleName(const char* szName, const char* szSuffix, const char* szLabels)
+{
+	assert(m_iCurrent < m_vFamilies.size() && (m_vFamilies[m_iCurrent].m_sName == szName)); // Type() must precede
+	std::string& s = m_vFamilies[m_iCurrent].m_s;
+
+	s += szName;
+	if (szSuffix)
+		s += szSuffix;
+
+	if (szLabels || m_szInstance)
+	{
+		s += '{';
+		if (m_szInstance)
+		{
+			s += m_szInstance;
+			if (szLabels)
+				s += ',';
+		}
+		if (szLabels)
+			s += szLabels;
+		s += '}';
+	}
+
+	s += ' ';
+	return s;
+}
+
+void Writer::Sample(const char* szName, const char* szSuffix, const char* szLabels, double x)
+{
+	std::string& s = SampleName(szName, szSuffix, szLabels);
+
+	char sz[32];
+	snprintf(sz, sizeof(sz), "%.9g\n", x);
+	s += sz;
+}
+
+void Writer::Sample(const char* szName, const char* szSuffix, const char* szLabels, uint64_t x)
+{
+	std::string& s = SampleName(szName, szSuffix, szLabels);
+	s += std::to_string(x);
+	s += '\n';
+}
+
+void Writer::Sample(const char* szName, const char* szSuffix, const char* szLabels, int64_t x)
+{
+	std::string& s = SampleName(szName, szSuffix, szLabels);
+	s += std::to_string(x);
+	s += '\n';
+}
+
+void Writer::Close()
+{
+	for (const Family& f : m_vFamilies)
+		m_s += f.m_s;
+
+	m_vFamilies.clear();
+	m_iCurrent = 0;
+}
+
+/////////////////////////
+// Metric
+Metric::Metric(const char* szName, const char* szHelp)
+	:m_szName(szName)
+	,m_szHelp(szHelp)
+{
+	Registry::get().Add(*this);
+}
+
+Metric::~Metric()
+{
+	Registry::get().Remove(*this);
+}
+
+void Counter::Write(Writer& w) const
+{
+	w.Type(m_szName, m_szHelp, "counter");
+	w.Sample(m_szName, nullptr, nullptr, m_Value.load(std::memory_order_relaxed));
+}
+
+void Gauge::Write(Writer& w) const
+{
+	w.Type(m_szName, m_szHelp, "gauge");
+	w.Sample(m_szName, nullptr, nullptr, m_Value.load(std::memory_order_relaxed));
+}
+
+/////////////////////////
+// Distribution
+Distribution::Distribution()
+{
+	Reset();
+}
+
+void Distribution::Reset()
+{
+	for (uint32_t i = 0; i < s_Buckets; i++)
+		m_pBucket[i].store(0, std::memory_order_relaxed);
+
+	m_Count.store(0, std::memory_order_relaxed);
+	m_Sum.store(0, std::memory_order_relaxed);
+}
+
+uint32_t Distribution::get_Bucket(uint64_t x)
+{
+	if (x < s_Sub)
+		return static_cast<uint32_t>(x);
+
+	uint32_t nMsb = 63;
+	while (!(x >> nMsb))
+		nMsb--;
+
+	uint32_t nShift = nMsb - s_SubBits;
+	uint32_t nMantissa = static_cast<uint32_t>(x >> nShift); // [s_Sub, 2*s_Sub)
+
+	return (nShift + 1) * s_Sub + nMantissa - s_Sub;
+}
+
+uint64_t Distribution::get_BucketMid(uint32_t i)
+{
+	if (i < s_Sub)
+		return i;
+
+	uint32_t nShift = i / s_Sub - 1;
+	uint64_t nMantissa = i % s_Sub + s_Sub;
+
+	uint64_t nLo = nMantissa << nShift;
+	return nLo + ((uint64_t(1) << nShift) >> 1);
+}
+
+void Distribution::Add(uint64_t x)
+{
+	m_pBucket[get_Bucket(x)].fetch_add(1, std::memory_order_relaxed);
+	m_Count.fetch_add(1, std::memory_order_relaxed);
+	m_Sum.fetch_add(x, std::memory_order_relaxed);
+}
+
+uint64_t Distribution::get_Quantile(double q) const
+{
+	// buckets are read one by one, so the total is taken from them rather than m_Count
+	uint64_t pCount[s_Buckets];
+	uint64_t nTotal = 0;
+	for (uint32_t i = 0; i < s_Buckets; i++)
+		nTotal += (pCount[i] = m_pBucket[i].load(std::memory_order_relaxed));
+
+	if (!nTotal)
+		return 0;
+
+	uint64_t nRank = static_cast<uint64_t>(q * (nTotal - 1));
+	for (uint32_t i = 0; ; i++)
+	{
+		if (nRank < pCount[i])
+			return get_BucketMid(i);
+		nRank -= pCount[i];
+	}
+}
+
+void Distribution::WriteSummary(Writer& w, const char* szName, const char* szLabels, double scale) const
+{
+	static const char* s_pLabel[] = { "quantile=\"0.5\"", "quantile=\"0.9\"", "quantile=\"0.99\"", "quantile=\"0.999\"" };
+	static const double s_pQ[] = { 0.5, 0.9, 0.99, 0.999 };
+
+	std::string sLabels;
+	for (size_t i = 0; i < _countof(s_pQ); i++)
+	{
+		if (szLabels)
+		{
+			sLabels = szLabels;
+			sLabels += ',';
+			sLabels += s_pLabel[i];
+		}
+
+		w.Sample(szName, nullptr, szLabels ? sLabels.c_str() : s_pLabel[i], get_Quantile(s_pQ[i]) / scale);
+	}
+
+	w.Sample(szName, "_sum", szLabels, m_Sum.load(std::memory_order_relaxed) / scale);
+	w.Sample(szName, "_count", szLabels, m_Count.load(std::memory_order_relaxed));
+}
+
+/////////////////////////
+// Histogram
+Histogram::Histogram(const char* szName, const char* szHelp, double scale)
+	:Metric(szName, szHelp)
+	,m_Scale(scale)
+{
+}
+
+void Histogram::Write(Writer& w) const
+{
+	w.Type(m_szName, m_szHelp, "summary");
+	WriteSummary(w, m_szName, nullptr, m_Scale);
+}
+
+/////////////////////////
+// QueryProfile
+void QueryProfile::OnStep(const void* pStmt, uint64_t ns, bool bRow)
+{
+	std::unique_lock<std::mutex> scope(m_Mutex);
+
+	Pending& x = m_Pending[pStmt];
+	x.m_ns += ns;
+	if (bRow)
+		x.m_Rows++;
+}
+
+void QueryProfile::OnRun(const void* pStmt, const char* szSql, int iQuery, uint64_t nsFallback)
+{
+	std::unique_lock<std::mutex> scope(m_Mutex);
+
+	Entry& e = m_Entries[szSql ? szSql : ""];
+	e.m_iQuery = iQuery;
+
+	auto it = m_Pending.find(pStmt);
+	if (m_Pending.end() != it)
+	{
+		e.m_Latency.Add(it->second.m_ns);
+		e.m_Rows += it->second.m_Rows;
+		m_Pending.erase(it);
+	}
+	else
+		e.m_Latency.Add(nsFallback);
+}
+
+void QueryProfile::Reset()
+{
+	std::unique_lock<std::mutex> scope(m_Mutex);
+	m_Entries.clear();
+	m_Pending.clear();
+}
+
+void QueryProfile::Dump(std::string& s)
+{
+	std::unique_lock<std::mutex> scope(m_Mutex);
+
+	std::vector<std::pair<uint64_t, const std::map<std::string, Entry>::value_type*> > v;
+	uint64_t nTotal = 0;
+	for (const auto& x : m_Entries)
+	{
+		uint64_t n = x.second.m_Latency.m_Sum.load(std::memory_order_relaxed);
+		v.emplace_back(n, &x);
+		nTotal += n;
+	}
+
+	std::sort(v.begin(), v.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+	char sz[0x100];
+	snprintf(sz, sizeof(sz), "%s DB profile: %u statements, %.3f sec total\n%10s %6s %10s %10s %10s %10s %10s  %s\n",
+		m_szDb, static_cast<unsigned int>(v.size()), nTotal * 1e-9,
+		"total_ms", "share", "runs", "avg_us", "p50_us", "p99_us", "rows", "query");
+	s = sz;
+
+	for (const auto& x : v)
+	{
+		const Entry& e = x.second->second;
+		uint64_t nRuns = e.m_Latency.m_Count.load(std::memory_order_relaxed);
+
+		snprintf(sz, sizeof(sz), "%10.3f %5.1f%% %10llu %10.1f %10.1f %10.1f %10llu  ",
+			x.first * 1e-6,
+			nTotal ? (x.first * 100. / nTotal) : 0.,
+			static_cast<unsigned long long>(nRuns),
+			nRuns ? (x.first * 1e-3 / nRuns) : 0.,
+			e.m_Latency.get_Quantile(0.5) * 1e-3,
+			e.m_Latency.get_Quantile(0.99) * 1e-3,
+			static_cast<unsigned long long>(e.m_Rows));
+		s += sz;
+
+		if (e.m_iQuery >= 0)
+		{
+			s += '#';
+			s += std::to_string(e.m_iQuery);
+			s += ' ';
+		}
+		s += x.second->first;
+		s += '\n';
+	}
+}
+
+void AppendLabelValue(std::string& s, const std::string& sVal)
+{
+	for (char c : sVal)
+	{
+		switch (c)
+		{
+		case '\\': s += "\\\\"; break;
+		case '"': s += "\\\""; break;
+		case '\n': s += "\\n"; break;
+		default: s += c;
+		}
+	}
+}
+
+void QueryProfile::Collect(Writer& w)
+{
+	std::unique_lock<std::mutex> scope(m_Mutex);
+
+	if (m_Entries.empty())
+		return;
+
+	const char* szLatency = "db_query_seconds";
+	const char* szRows = "db_query_rows_total";
+
+	std::string sLabels;
+	for (int iPass = 0; iPass < 2; iPass++)
+	{
+		if (iPass)
+			w.Type(szRows, "Rows stepped per DB statement", "counter");
+		else
+			w.Type(szLatency, "DB statement latency (reset to reset)", "summary");
+
+		for (const auto& x : m_Entries)
+		{
+			sLabels = "db=\"";
+			sLabels += m_szDb;
+			sLabels += "\",query=\"";
+			AppendLabelValue(sLabels, (x.second.m_iQuery >= 0) ? std::to_string(x.second.m_iQuery) : x.first);
+			sLabels += '"';
+
+			if (iPass)
+				w.Sample(szRows, nullptr, sLabels.c_str(), x.second.m_Rows);
+			else
+				x.second.m_Latency.WriteSummary(w, szLatency, sLabels.c_str(), 1e9);
+		}
+	}
+}
+
+/////////////////////////
+// Registry
+Registry& Registry::get()
+{
+	static Registry s_Registry;
+	return s_Registry;
+}
+
+template <typename T>
+void ListAppend(T*& pHead, T& x)
+{
+	T** pp = &pHead;
+	while (*pp)
+		pp = &(*pp)->m_pNext;
+	*pp = &x;
+	x.m_pNext = nullptr;
+}
+
+template <typename T>
+void ListRemove(T*& pHead, T& x)
+{
+	for (T** pp = &pHead; *pp; pp = &(*pp)->m_pNext)
+		if (*pp == &x)
+		{
+			*pp = x.m_pNext;
+			break;
+		}
+}
+
+void Registry::Add(Metric& x)
+{
+	std::unique_lock<std::mutex> scope(m_Mutex);
+	ListAppend(m_pMetrics, x);
+}
+
+void Registry::Remove(Metric& x)
+{
+	std::unique_lock<std::mutex> scope(m_Mutex);
+	ListRemove(m_pMetrics, x);
+}
+
+void Registry::Add(Collector& x)
+{
+	std::unique_lock<std::mutex> scope(m_Mutex);
+	ListAppend(m_pCollectors, x);
+}
+
+void Registry::Remove(Collector& x)
+{
+	std::unique_lock<std::mutex> scope(m_Mutex);
+	ListRemove(m_pCollectors, x);
+}
+
+void Registry::Write(std::string& s)
+{
+	Writer w;
+	w.m_s.swap(s);
+	w.m_s.clear();
+
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+
+		for (Metric* p = m_pMetrics; p; p = p->m_pNext)
+			p->Write(w);
+
+		for (Collector* p = m_pCollectors; p; p = p->m_pNext)
+		{
+			w.m_szInstance = p->m_sLabels.empty() ? nullptr : p->m_sLabels.c_str();
+			p->Collect(w);
+		}
+		w.m_szInstance = nullptr;
+	}
+
+	w.Close();
+
+	w.m_s.swap(s);
+}
+
+} // namespace Metrics
+} // namespace beam
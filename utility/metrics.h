@@ -0,0 +1,214 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace beam {
+namespace Metrics {
+
+	// Process-wide metrics, exposed in the Prometheus text format.
+	// Metrics are static objects, they register themselves on construction. Updates are relaxed atomics, no locks.
+
+	// Samples are grouped by the metric family (the last Type() call), so that several collectors may report the same
+	// family, each with its own instance labels. The text is assembled in m_s by Close().
+	struct Writer
+	{
+		std::string m_s;
+		const char* m_szInstance = nullptr; // labels of the collector being written, prepended to the sample labels
+
+		void Type(const char* szName, const char* szHelp, const char* szType);
+		void Sample(const char* szName, const char* szSuffix, const char* szLabels, double);
+		void Sample(const char* szName, const char* szSuffix, const char* szLabels, uint64_t);
+		void Sample(const char* szName, const char* szSuffix, const char* szLabels, int64_t);
+
+		void Close();
+
+	private:
+		struct Family
+		{
+			std::string m_sName;
+			std::string m_s;
+		};
+
+		std::vector<Family> m_vFamilies; // in the order of appearance
+		size_t m_iCurrent = 0;
+
+		std::string& SampleName(const char* szName, const char* szSuffix, const char* szLabels);
+	};
+
+	struct Metric
+	{
+		const char* m_szName;
+		const char* m_szHelp;
+		Metric* m_pNext = nullptr;
+
+		Metric(const char* szName, const char* szHelp);
+		Metric(const Metric&) = delete;
+		virtual ~Metric();
+
+		virtual void Write(Writer&) const = 0;
+	};
+
+	struct Counter
+		:public Metric
+	{
+		std::atomic<uint64_t> m_Value{0};
+
+		using Metric::Metric;
+
+		void Inc(uint64_t n = 1) { m_Value.fetch_add(n, std::memory_order_relaxed); }
+
+		void Write(Writer&) const override;
+	};
+
+	struct Gauge
+		:public Metric
+	{
+		std::atomic<int64_t> m_Value{0};
+
+		using Metric::Metric;
+
+		void Set(int64_t n) { m_Value.store(n, std::memory_order_relaxed); }
+		void Add(int64_t n) { m_Value.fetch_add(n, std::memory_order_relaxed); }
+
+		void Write(Writer&) const override;
+	};
+
+	// Log-linear buckets (HDR-style): 16 sub-buckets per power of 2, i.e. the relative error is below 1/16 over the whole 64-bit range.
+	struct Distribution
+	{
+		static const uint32_t s_SubBits = 4;
+		static const uint32_t s_Sub = 1U << s_SubBits;
+		static const uint32_t s_Buckets = (64 - s_SubBits + 1) * s_Sub;
+
+		std::atomic<uint64_t> m_pBucket[s_Buckets];
+		std::atomic<uint64_t> m_Count{0};
+		std::atomic<uint64_t> m_Sum{0};
+
+		Distribution();
+		Distribution(const Distribution&) = delete;
+
+		void Add(uint64_t);
+		void Reset();
+
+		static uint32_t get_Bucket(uint64_t);
+		static uint64_t get_BucketMid(uint32_t);
+
+		uint64_t get_Quantile(double) const; // in recorded units
+
+		// quantiles + sum + count, values divided by the scale. Labels (if any) are prepended to the quantile label
+		void WriteSummary(Writer&, const char* szName, const char* szLabels, double scale) const;
+	};
+
+	// Exposed as a summary
+	struct Histogram
+		:public Metric
+		,public Distribution
+	{
+		double m_Scale; // exposed value = recorded value / scale
+
+		Histogram(const char* szName, const char* szHelp, double scale = 1.);
+
+		void Write(Writer&) const override;
+
+		// Records the elapsed time in nanoseconds (use scale 1e9 to expose seconds)
+		class Scope
+		{
+			Histogram& m_H;
+			std::chrono::steady_clock::time_point m_t0;
+		public:
+			Scope(Histogram& h) :m_H(h), m_t0(std::chrono::steady_clock::now()) {}
+			~Scope() { m_H.Add(get_ElapsedNs(m_t0)); }
+		};
+
+		static uint64_t get_ElapsedNs(std::chrono::steady_clock::time_point t0)
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+		}
+	};
+
+	// Values that are cheaper to read on demand (container sizes, per-connection stats).
+	// Called on the thread that performs the exposition, hence the collector's owner must live on that thread.
+	struct Collector
+	{
+		Collector* m_pNext = nullptr;
+		std::string m_sLabels; // distinguishes the instances of the same collector type, e.g. node="10000"
+
+		virtual ~Collector() {}
+		virtual void Collect(Writer&) = 0;
+	};
+
+	// Per-statement DB statistics: runs, rows stepped, latency. The DB it's attached to reports the timed steps,
+	// and the end of each run (via the sqlite trace hook), there's no overhead unless attached.
+	// Statements are identified by the SQL text.
+	class QueryProfile
+		:public Collector
+	{
+		struct Entry
+		{
+			int m_iQuery = -1; // NodeDB Query::Enum, if applicable
+			uint64_t m_Rows = 0;
+			Distribution m_Latency; // ns
+		};
+
+		const char* m_szDb;
+		std::mutex m_Mutex;
+		std::map<std::string, Entry> m_Entries;
+		struct Pending {
+			uint64_t m_Rows = 0;
+			uint64_t m_ns = 0;
+		};
+
+		std::map<const void*, Pending> m_Pending; // for statements being stepped
+
+	public:
+		QueryProfile(const char* szDb) :m_szDb(szDb) {}
+
+		void OnStep(const void* pStmt, uint64_t ns, bool bRow);
+
+		// Statement reset or finished. The sqlite's own time measurement has ms resolution, it's used only if the steps weren't reported
+		void OnRun(const void* pStmt, const char* szSql, int iQuery, uint64_t nsFallback);
+
+		// sorted by the total time, the heaviest first
+		void Dump(std::string&);
+		void Reset();
+
+		void Collect(Writer&) override;
+	};
+
+	class Registry
+	{
+		std::mutex m_Mutex;
+		Metric* m_pMetrics = nullptr;
+		Collector* m_pCollectors = nullptr;
+
+	public:
+		static Registry& get();
+
+		void Add(Metric&);
+		void Remove(Metric&);
+		void Add(Collector&);
+		void Remove(Collector&);
+
+		void Write(std::string&);
+	};
+
+} // namespace Metrics
+} // namespace beam
@@ -0,0 +1,180 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "parallel.h"
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace beam {
+
+ParallelLoop::ParallelLoop(size_t nCount, const Handler& h)
+    : m_Count(nCount)
+    , m_Handler(h)
+    , m_iNext(0)
+{
+}
+
+void ParallelLoop::Run()
+{
+    while (true)
+    {
+        size_t i = m_iNext++;
+        if (i >= m_Count)
+            break;
+
+        try
+        {
+            m_Handler(i);
+        }
+        catch (...)
+        {
+            std::unique_lock<std::mutex> scope(m_Mutex);
+            if (!m_pErr)
+                m_pErr = std::current_exception();
+
+            m_iNext = m_Count; // skip the rest
+        }
+    }
+}
+
+void ParallelLoop::Rethrow()
+{
+    if (m_pErr)
+        std::rethrow_exception(m_pErr);
+}
+
+namespace {
+
+class WorkerPool
+{
+    struct Job
+    {
+        ParallelLoop& m_Loop;
+        uint32_t m_MaxHelpers;
+        uint32_t m_Helpers; // currently running it
+    };
+
+    std::mutex m_Mutex;
+    std::condition_variable m_NewJob;
+    std::condition_variable m_HelperDone;
+    std::vector<Job*> m_vJobs;
+    std::vector<std::thread> m_vThreads;
+    bool m_Stop = false;
+
+    WorkerPool()
+    {
+        // the caller is the extra thread
+        for (uint32_t i = 1; i < std::thread::hardware_concurrency(); i++)
+            m_vThreads.emplace_back(&WorkerPool::Thread, this);
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::unique_lock<std::mutex> scope(m_Mutex);
+            m_Stop = true;
+        }
+        m_NewJob.notify_all();
+
+        for (size_t i = 0; i < m_vThreads.size(); i++)
+            m_vThreads[i].join();
+    }
+
+    Job* FindJobLocked()
+    {
+        for (Job* pJob : m_vJobs)
+            if (!pJob->m_Loop.IsDone() && (pJob->m_Helpers < pJob->m_MaxHelpers))
+                return pJob;
+        return nullptr;
+    }
+
+    void Thread()
+    {
+        std::unique_lock<std::mutex> scope(m_Mutex);
+
+        while (true)
+        {
+            Job* pJob = FindJobLocked();
+            if (!pJob)
+            {
+                if (m_Stop)
+                    break;
+
+                m_NewJob.wait(scope);
+                continue;
+            }
+
+            pJob->m_Helpers++;
+
+            scope.unlock();
+            pJob->m_Loop.Run();
+            scope.lock();
+
+            if (!--pJob->m_Helpers)
+                m_HelperDone.notify_all();
+        }
+    }
+
+public:
+    static WorkerPool& get()
+    {
+        static WorkerPool s_Pool;
+        return s_Pool;
+    }
+
+    void Run(ParallelLoop& loop, uint32_t nMaxHelpers)
+    {
+        Job job{ loop, nMaxHelpers, 0 };
+
+        {
+            std::unique_lock<std::mutex> scope(m_Mutex);
+            m_vJobs.push_back(&job);
+        }
+        m_NewJob.notify_all();
+
+        loop.Run(); // the caller never waits for a free worker
+
+        std::unique_lock<std::mutex> scope(m_Mutex);
+        m_vJobs.erase(std::find(m_vJobs.begin(), m_vJobs.end(), &job));
+
+        while (job.m_Helpers)
+            m_HelperDone.wait(scope);
+    }
+};
+
+} // namespace
+
+void ParallelFor(size_t nCount, const ParallelLoop::Handler& h, uint32_t nThreads)
+{
+    if (!nCount)
+        return;
+
+    if (!nThreads)
+        nThreads = std::thread::hardware_concurrency();
+    if (nThreads > nCount)
+        nThreads = static_cast<uint32_t>(nCount);
+
+    ParallelLoop loop(nCount, h);
+
+    if (nThreads <= 1)
+        loop.Run();
+    else
+        WorkerPool::get().Run(loop, nThreads - 1);
+
+    loop.Rethrow();
+}
+
+} // namespace beam
@@ -0,0 +1,53 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+
+namespace beam {
+
+// Invokes the handler for each index in [0, nCount), every participating thread picks the next unprocessed one.
+// The 1st exception stops the rest of the items, and is rethrown on the caller.
+class ParallelLoop
+{
+public:
+    typedef std::function<void(size_t)> Handler;
+
+    ParallelLoop(size_t nCount, const Handler&);
+
+    // may be called by any number of threads
+    void Run();
+    bool IsDone() const { return m_iNext >= m_Count; }
+
+    // on the caller, once all the threads are done
+    void Rethrow();
+
+private:
+    const size_t m_Count;
+    const Handler m_Handler;
+    std::atomic<size_t> m_iNext;
+
+    std::mutex m_Mutex;
+    std::exception_ptr m_pErr;
+};
+
+// Runs the loop on the process-wide worker pool (created on demand, a thread per core), the caller participates too.
+// nThreads limits the number of threads for this call, 0 = all the cores.
+void ParallelFor(size_t nCount, const ParallelLoop::Handler&, uint32_t nThreads = 0);
+
+} // namespace beam
@@ -0,0 +1,149 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utility/io/json_writer.h"
+#include "utility/io/json_serializer.h"
+#include "utility/helpers.h"
+#include "nlohmann/json.hpp"
+#include <iostream>
+#include <assert.h>
+
+using namespace beam;
+using namespace std;
+using json = nlohmann::json;
+
+static int error_count = 0;
+
+#define CHECK(s) \
+do {\
+    if (!(s)) {\
+        cerr << "CHECK failed at line " << __LINE__ << ": " #s << endl;\
+        ++error_count;\
+    }\
+} while(false)\
+
+
+// small fragments, so that the values are split between them
+struct Output {
+    io::SerializedMsg fragments;
+    io::FragmentWriter fw;
+
+    Output() : fw(16, 1, [this](io::SharedBuffer&& f) { fragments.push_back(std::move(f)); })
+    {}
+
+    string str() {
+        fw.finalize();
+        string s;
+        for (const auto& f : fragments) s.append((const char*)f.data, f.size);
+        return s;
+    }
+};
+
+string dom(const json& j) {
+    Output out;
+    serialize_json(out.fw, j);
+    return out.str();
+}
+
+void test_values() {
+    Output out;
+    io::JsonWriter w(out.fw);
+
+    string s = "quote\" backslash\\ newline\n tab\t ctl\x01 utf8 \xc3\xa9 long enough to cross fragments";
+
+    w.begin_object();
+    w.key("a").begin_array().end_array();
+    w.key("b").begin_object().end_object();
+    w.key("c").value(true);
+    w.key("d").value(false);
+    w.key("e").null();
+    w.key("f").value(-1234567890123LL);
+    w.key("g").value(18446744073709551615ULL);
+    w.key("h").value(uint8_t(7));
+    w.key("i").value(1.5);
+    w.key("j").value(2.0);
+    w.key("k").value(0.1);
+    w.key("l").value(s);
+    w.key("m").begin_array().value(1).begin_array().value("x").end_array().begin_object().key("y").value(2).end_object().end_array();
+    w.end_object();
+
+    json j = {
+        {"a", json::array()},
+        {"b", json::object()},
+        {"c", true},
+        {"d", false},
+        {"e", nullptr},
+        {"f", -1234567890123LL},
+        {"g", 18446744073709551615ULL},
+        {"h", 7},
+        {"i", 1.5},
+        {"j", 2.0},
+        {"k", 0.1},
+        {"l", s},
+        {"m", json::array({1, json::array({"x"}), json{{"y", 2}}})}
+    };
+
+    string res = out.str();
+    CHECK(res == dom(j));
+    CHECK(json::parse(res) == j);
+}
+
+void test_hex() {
+    uint8_t buf[300];
+    for (size_t i = 0; i < sizeof(buf); i++) buf[i] = (uint8_t)(i * 7);
+
+    {
+        Output out;
+        io::JsonWriter w(out.fw);
+        w.begin_array().hex(buf, 32).hex(buf, sizeof(buf)).hex(buf, 0).end_array();
+        CHECK(out.str() == dom(json::array({ to_hex(buf, 32), to_hex(buf, sizeof(buf)), "" })));
+    }
+
+    uint8_t n[32] = { 0 };
+    {
+        Output out;
+        io::JsonWriter w(out.fw);
+        w.begin_array().hex_number(n, sizeof(n));
+        n[31] = 0xab;
+        w.hex_number(n, sizeof(n));
+        n[5] = 0x0c;
+        w.hex_number(n, sizeof(n));
+        w.end_array();
+        CHECK(out.str() == "[\"0x0\",\"0xab\",\"0xc00000000000000000000000000000000000000000000000000ab\"]");
+    }
+}
+
+void test_utf8() {
+    // well-formed sequences of 2, 3 and 4 bytes
+    string valid = "\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80";
+
+    Output out;
+    io::JsonWriter w(out.fw);
+    w.begin_array();
+    w.value(valid);
+    w.value(string("\xff" "a" "\xc0\xaf" "b" "\xed\xa0\x80" "c" "\xf4\x90\x80\x80" "d" "\xe2\x82")); // stray, overlong, surrogate, too large, truncated
+    w.end_array();
+
+    const string r = "\xef\xbf\xbd";
+    string res = out.str();
+    CHECK(res == "[\"" + valid + "\",\"" + r + "a" + r + r + "b" + r + r + r + "c" + r + r + r + r + "d" + r + r + "\"]");
+    CHECK(json::parse(res)[0] == valid);
+}
+
+int main() {
+    test_values();
+    test_hex();
+    test_utf8();
+    return error_count;
+}
@@ -0,0 +1,81 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utility/logger.h"
+#include "utility/helpers.h"
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace beam;
+
+// Measures the cost of a log call as seen by the logging threads, with the file sink flushed on every message
+// (as the node does with the default log level).
+
+static const char* s_szPrefix = "logger_benchmark_";
+
+void Cleanup()
+{
+	for (boost::filesystem::directory_iterator it("."), itEnd; it != itEnd; ++it)
+		if (!it->path().filename().string().compare(0, strlen(s_szPrefix), s_szPrefix))
+			boost::filesystem::remove(it->path());
+}
+
+void Run(const char* szName, bool bAsync, size_t nThreads, size_t nCount)
+{
+	uint64_t dt_ns = 0;
+	{
+		auto logger = Logger::create(LOG_LEVEL_DEBUG, LOG_SINK_DISABLED, LOG_LEVEL_DEBUG, s_szPrefix);
+		logger->set_async(bAsync);
+
+		std::vector<std::thread> vThreads;
+		auto t0 = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < nThreads; i++)
+			vThreads.emplace_back([i, nCount]() {
+				for (size_t j = 0; j < nCount; j++)
+					LOG_INFO() << "Peer 127.0.0.1:" << 10000 + i << " Block " << j << " received, size=" << j * 17;
+			});
+
+		for (auto& t : vThreads)
+			t.join();
+
+		dt_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+	}
+
+	uint64_t nTotal = nThreads * nCount;
+	std::cout << szName << ": " << nThreads << " threads, " << nTotal << " messages, "
+		<< dt_ns * nThreads / nTotal << " ns/call per thread, "
+		<< nTotal * 1000000000ULL / (dt_ns ? dt_ns : 1) << " messages/sec" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t nCount = 50000;
+	if (argc > 1)
+		nCount = std::stoul(argv[1]);
+
+	size_t nThreads = std::max<size_t>(4, std::thread::hardware_concurrency());
+
+	Cleanup();
+
+	Run("sync", false, 1, nCount);
+	Run("async", true, 1, nCount);
+	Run("sync", false, nThreads, nCount);
+	Run("async", true, nThreads, nCount);
+
+	Cleanup();
+	return 0;
+}
@@ -15,6 +15,8 @@
 #include "utility/logger_checkpoints.h"
 #include "utility/helpers.h"
 #include <thread>
+#include <fstream>
+#include <boost/filesystem.hpp>
 #include "wallet/secstring.h"
 
 using namespace beam;
@@ -80,6 +82,55 @@ void test_ndc_2(bool exc)
     }
 }
 
+size_t count_lines_and_remove(const std::string& prefix) {
+    size_t n = 0;
+    for (boost::filesystem::directory_iterator it("."), itEnd; it != itEnd; ++it) {
+        std::string name = it->path().filename().string();
+        if (name.compare(0, prefix.size(), prefix)) continue;
+
+        {
+            std::ifstream fs(it->path().string());
+            for (std::string line; std::getline(fs, line); ) n++;
+        }
+        boost::filesystem::remove(it->path());
+    }
+    return n;
+}
+
+bool test_async() {
+    static const char* prefix = "ZzzzzAsync_";
+    static const size_t nThreads = 4;
+    static const size_t nMessages = 3000;
+
+    count_lines_and_remove(prefix);
+    {
+        auto logger = Logger::create(LOG_LEVEL_DEBUG, LOG_SINK_DISABLED, LOG_LEVEL_DEBUG, prefix);
+        logger->set_async(true);
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < nThreads; i++) {
+            threads.emplace_back([i]() {
+                for (size_t j = 0; j < nMessages; j++) {
+                    LOG_INFO() << "thread " << i << " message " << j;
+                }
+            });
+        }
+
+        logger->rotate();
+
+        // larger than the ring, written synchronously
+        LOG_INFO() << std::string(1 << 20, 'x');
+
+        for (auto& t : threads) t.join();
+    }
+
+    size_t n = count_lines_and_remove(prefix);
+    if (n == nThreads * nMessages + 1) return true;
+
+    std::cout << "async logger: " << n << " lines written" << std::endl;
+    return false;
+}
+
 void test_read_password() {
     SecString buf;
     read_password("Enter seed: ", buf);
@@ -97,5 +148,7 @@ int main() {
         test_ndc_2(true);
     }
     catch(...) {}
+
+    if (!test_async()) return 1;
 #endif
 }
@@ -0,0 +1,205 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utility/metrics.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace beam;
+
+int g_TestsFailed = 0;
+
+void TestFailed(const char* szExpr, uint32_t nLine)
+{
+	printf("Test failed! Line=%u, Expression: %s\n", nLine, szExpr);
+	g_TestsFailed++;
+	fflush(stdout);
+}
+
+#define verify_test(x) \
+	do { \
+		if (!(x)) \
+			TestFailed(#x, __LINE__); \
+	} while (false)
+
+Metrics::Counter g_Counter("test_counter_total", "Test counter");
+Metrics::Gauge g_Gauge("test_gauge", "Test gauge");
+
+void TestBuckets()
+{
+	// buckets are monotonic, and the bucket midpoint is within the relative error
+	uint32_t iPrev = 0;
+	for (uint64_t x = 1; x < (uint64_t(1) << 60); x = (x * 9 + 7) / 8)
+	{
+		uint32_t i = Metrics::Histogram::get_Bucket(x);
+		verify_test(i >= iPrev);
+		verify_test(i < Metrics::Histogram::s_Buckets);
+		iPrev = i;
+
+		uint64_t nMid = Metrics::Histogram::get_BucketMid(i);
+		uint64_t nDiff = (nMid > x) ? (nMid - x) : (x - nMid);
+		verify_test(nDiff <= x / Metrics::Histogram::s_Sub);
+	}
+
+	verify_test(Metrics::Histogram::get_Bucket(uint64_t(-1)) == Metrics::Histogram::s_Buckets - 1);
+}
+
+void TestHistogram()
+{
+	Metrics::Histogram h("test_latency_seconds", "Test histogram", 1e9);
+
+	const uint32_t nThreads = 4;
+	const uint64_t nPerThread = 10000;
+
+	std::vector<std::thread> vThreads;
+	for (uint32_t i = 0; i < nThreads; i++)
+		vThreads.emplace_back([&h, nPerThread]() {
+			for (uint64_t x = 1; x <= nPerThread; x++)
+				h.Add(x * 1000);
+		});
+
+	for (auto& t : vThreads)
+		t.join();
+
+	verify_test(h.m_Count == nThreads * nPerThread);
+
+	uint64_t nMedian = h.get_Quantile(0.5);
+	verify_test(nMedian >= 4700000 && nMedian <= 5300000);
+
+	uint64_t n99 = h.get_Quantile(0.99);
+	verify_test(n99 >= 9300000 && n99 <= 10500000);
+
+	g_Counter.Inc(5);
+	g_Counter.Inc();
+	g_Gauge.Set(10);
+	g_Gauge.Add(-3);
+
+	struct MyCollector :public Metrics::Collector
+	{
+		void Collect(Metrics::Writer& w) override
+		{
+			w.Type("test_peer_bytes_total", "Per-peer", "counter");
+			w.Sample("test_peer_bytes_total", nullptr, "peer=\"a\"", uint64_t(11));
+		}
+	} c;
+
+	Metrics::Registry::get().Add(c);
+
+	std::string s;
+	Metrics::Registry::get().Write(s);
+	std::cout << s;
+
+	verify_test(s.find("# TYPE test_counter_total counter\ntest_counter_total 6\n") != std::string::npos);
+	verify_test(s.find("# TYPE test_gauge gauge\ntest_gauge 7\n") != std::string::npos);
+	verify_test(s.find("# TYPE test_latency_seconds summary\n") != std::string::npos);
+	verify_test(s.find("test_latency_seconds_count 40000\n") != std::string::npos);
+	verify_test(s.find("test_latency_seconds{quantile=\"0.5\"} 0.005") != std::string::npos);
+	verify_test(s.find("test_peer_bytes_total{peer=\"a\"} 11\n") != std::string::npos);
+
+	Metrics::Registry::get().Remove(c);
+	Metrics::Registry::get().Write(s);
+	verify_test(s.find("test_peer_bytes_total") == std::string::npos);
+}
+
+void TestInstances()
+{
+	// two instances of the same collector, i.e. several nodes in one process
+	struct MyCollector :public Metrics::Collector
+	{
+		uint64_t m_Val;
+
+		void Collect(Metrics::Writer& w) override
+		{
+			w.Type("test_peers", "Peers", "gauge");
+			w.Sample("test_peers", nullptr, nullptr, m_Val);
+			w.Type("test_sent_total", "Sent", "counter");
+			w.Sample("test_sent_total", nullptr, "peer=\"a\"", m_Val * 10);
+		}
+	} c1, c2;
+
+	c1.m_Val = 1;
+	c1.m_sLabels = "node=\"1\"";
+	c2.m_Val = 2;
+	c2.m_sLabels = "node=\"2\"";
+
+	Metrics::Registry::get().Add(c1);
+	Metrics::Registry::get().Add(c2);
+
+	std::string s;
+	Metrics::Registry::get().Write(s);
+
+	Metrics::Registry::get().Remove(c1);
+	Metrics::Registry::get().Remove(c2);
+
+	// a single description per family, its samples go together
+	size_t n = s.find("# TYPE test_peers gauge\n");
+	verify_test(n != std::string::npos);
+	verify_test(s.find("# TYPE test_peers", n + 1) == std::string::npos);
+	verify_test(s.find("# TYPE test_peers gauge\ntest_peers{node=\"1\"} 1\ntest_peers{node=\"2\"} 2\n") != std::string::npos);
+	verify_test(s.find("# TYPE test_sent_total counter\ntest_sent_total{node=\"1\",peer=\"a\"} 10\ntest_sent_total{node=\"2\",peer=\"a\"} 20\n") != std::string::npos);
+}
+
+void TestQueryProfile()
+{
+	Metrics::QueryProfile prof("test");
+	int stmt1, stmt2;
+
+	for (int i = 0; i < 10; i++)
+	{
+		prof.OnStep(&stmt1, 400, true);
+		prof.OnStep(&stmt1, 400, true);
+		prof.OnStep(&stmt1, 200, false);
+		prof.OnRun(&stmt1, "SELECT \"x\" FROM T", 3, 1000000); // the reported steps take precedence
+	}
+	prof.OnRun(&stmt2, "DELETE FROM T", -1, 1000000); // no steps reported, fallback time is used
+
+	std::string s;
+	prof.Dump(s);
+	std::cout << s;
+
+	// the heaviest statement goes first
+	size_t nDel = s.find("DELETE FROM T");
+	size_t nSel = s.find("#3 SELECT");
+	verify_test(nDel != std::string::npos);
+	verify_test(nSel != std::string::npos);
+	verify_test(nDel < nSel);
+
+	Metrics::Writer w;
+	prof.Collect(w);
+	w.Close();
+	verify_test(w.m_s.find("db_query_rows_total{db=\"test\",query=\"3\"} 20\n") != std::string::npos);
+	verify_test(w.m_s.find("db_query_seconds_count{db=\"test\",query=\"DELETE FROM T\"} 1\n") != std::string::npos);
+	verify_test(w.m_s.find("db_query_seconds_sum{db=\"test\",query=\"3\"} 1e-05\n") != std::string::npos);
+	verify_test(w.m_s.find("db_query_seconds_sum{db=\"test\",query=\"DELETE FROM T\"} 0.001\n") != std::string::npos);
+
+	prof.Reset();
+	prof.Dump(s);
+	verify_test(s.find("DELETE") == std::string::npos);
+}
+
+int main()
+{
+	TestBuckets();
+	TestHistogram();
+	TestInstances();
+	TestQueryProfile();
+
+	// the local histogram is unregistered
+	std::string s;
+	Metrics::Registry::get().Write(s);
+	verify_test(s.find("test_latency_seconds") == std::string::npos);
+
+	return g_TestsFailed ? -1 : 0;
+}
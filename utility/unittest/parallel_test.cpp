@@ -0,0 +1,103 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utility/parallel.h"
+#include <future>
+#include <stdexcept>
+#include <vector>
+#include <stdio.h>
+
+using namespace beam;
+
+int g_TestsFailed = 0;
+
+void TestFailed(const char* szExpr, uint32_t nLine)
+{
+	printf("Test failed! Line=%u, Expression: %s\n", nLine, szExpr);
+	g_TestsFailed++;
+	fflush(stdout);
+}
+
+#define verify_test(x) \
+	do { \
+		if (!(x)) \
+			TestFailed(#x, __LINE__); \
+	} while (false)
+
+void TestAllItems(uint32_t nThreads)
+{
+	const size_t nCount = 1000;
+	std::vector<std::atomic<uint32_t> > v(nCount);
+
+	ParallelFor(nCount, [&v](size_t i) { v[i]++; }, nThreads);
+
+	for (size_t i = 0; i < nCount; i++)
+		verify_test(v[i] == 1);
+}
+
+void TestConcurrentCallers()
+{
+	// several callers share the pool, each one completes its own loop
+	std::vector<std::future<uint32_t> > vRes;
+	for (uint32_t iCaller = 0; iCaller < 4; iCaller++)
+	{
+		vRes.push_back(std::async(std::launch::async, []()
+		{
+			std::atomic<uint32_t> nSum(0);
+			for (int iRound = 0; iRound < 50; iRound++)
+				ParallelFor(100, [&nSum](size_t i) { nSum += static_cast<uint32_t>(i); });
+			return nSum.load();
+		}));
+	}
+
+	for (size_t i = 0; i < vRes.size(); i++)
+		verify_test(vRes[i].get() == 50 * 4950);
+}
+
+void TestException()
+{
+	std::atomic<uint32_t> nDone(0);
+	bool bThrown = false;
+
+	try
+	{
+		ParallelFor(1000, [&nDone](size_t i)
+		{
+			if (10 == i)
+				throw std::runtime_error("item failed");
+			nDone++;
+		}, 4);
+	}
+	catch (const std::runtime_error& e)
+	{
+		bThrown = (std::string(e.what()) == "item failed");
+	}
+
+	verify_test(bThrown);
+	verify_test(nDone < 1000);
+
+	// the pool is still usable
+	TestAllItems(4);
+}
+
+int main()
+{
+	TestAllItems(0);
+	TestAllItems(1);
+	TestAllItems(3);
+	TestConcurrentCallers();
+	TestException();
+
+	return g_TestsFailed ? -1 : 0;
+}
@@ -78,6 +78,86 @@ void tcpserver_test() {
     }
 }
 
+bool writesCompleted=false;
+
+void tcpstream_writes_test() {
+    // many small writes must be coalesced and delivered in order, with backpressure notifications
+    static const size_t MSG_SIZE = 100;
+    static const size_t NUM_MSGS = 5000;
+
+    try {
+        reactor = Reactor::create();
+
+        TcpStream::Ptr serverStream, clientStream;
+        size_t nReceived = 0;
+        bool orderOk = true;
+        int nOverflows = 0, nDrains = 0;
+
+        TcpServer::Ptr server = TcpServer::create(
+            *reactor,
+            Address(serverIp, serverPort + 1),
+            [&](TcpStream::Ptr&& newStream, int errorCode) {
+                if (errorCode != 0) {
+                    LOG_ERROR() << "Error code=" << errorCode;
+                    reactor->stop();
+                    return;
+                }
+                serverStream = std::move(newStream);
+                serverStream->enable_read([&](ErrorCode what, void* data, size_t size) -> bool {
+                    if (what != EC_OK) {
+                        reactor->stop();
+                        return false;
+                    }
+                    const uint8_t* p = (const uint8_t*)data;
+                    for (size_t i = 0; i < size; ++i, ++nReceived) {
+                        if (p[i] != (uint8_t)(nReceived / MSG_SIZE)) orderOk = false;
+                    }
+                    if (nReceived == MSG_SIZE * NUM_MSGS) reactor->stop();
+                    return true;
+                });
+            }
+        );
+
+        reactor->tcp_connect(
+            Address(serverIp, serverPort + 1),
+            2,
+            [&](uint64_t, TcpStream::Ptr&& newStream, ErrorCode errorCode) {
+                if (errorCode != 0) {
+                    LOG_ERROR() << "Error code=" << errorCode;
+                    reactor->stop();
+                    return;
+                }
+                clientStream = std::move(newStream);
+                clientStream->set_watermarks(MSG_SIZE * 1000, MSG_SIZE * 10, [&](bool overflow) {
+                    if (overflow) ++nOverflows; else ++nDrains;
+                });
+
+                uint8_t buf[MSG_SIZE];
+                for (size_t i = 0; i < NUM_MSGS; ++i) {
+                    memset(buf, (uint8_t) i, MSG_SIZE);
+                    clientStream->write(buf, MSG_SIZE, (i & 1) != 0);
+                }
+            },
+            1000, false, Address(clientIp, 0)
+        );
+
+        reactor->run();
+
+        LOG_DEBUG() << TRACE(nReceived) << TRACE(nOverflows) << TRACE(nDrains);
+        writesCompleted =
+            orderOk &&
+            (nReceived == MSG_SIZE * NUM_MSGS) &&
+            (nOverflows == 1) &&
+            (nDrains == 1) &&
+            clientStream &&
+            (clientStream->state().unsent == 0) &&
+            (clientStream->state().sent == MSG_SIZE * NUM_MSGS);
+    }
+    catch (const std::exception& e) {
+        LOG_ERROR() << e.what();
+    }
+}
+
 int main() {
     int logLevel = LOG_LEVEL_DEBUG;
 #if LOG_VERBOSE_ENABLED
@@ -85,7 +165,8 @@ int main() {
 #endif
     auto logger = Logger::create(logLevel, logLevel);
     tcpserver_test();
-    return wasAccepted ? 0 : 1;
+    tcpstream_writes_test();
+    return (wasAccepted && writesCompleted) ? 0 : 1;
 }
 
 
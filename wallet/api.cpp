@@ -201,6 +201,15 @@ namespace beam
         return coins;
     }
 
+    template <typename T>
+    static void readUnsignedFilterParameter(const nlohmann::json& filter, const std::string& name, boost::optional<T>& value)
+    {
+        if (existsJsonParam(filter, name) && filter[name].is_number_unsigned())
+        {
+            value = (T)filter[name];
+        }
+    }
+
     static uint64_t readSessionParameter(int id, const nlohmann::json& params)
     {
         uint64_t session = 0;
@@ -348,6 +357,37 @@ namespace beam
     {
         GetUtxo getUtxo;
 
+        if (existsJsonParam(params, "filter"))
+        {
+            const auto& filter = params["filter"];
+
+            if (existsJsonParam(filter, "status")
+                && filter["status"].is_number_unsigned())
+            {
+                if ((uint32_t)filter["status"] >= Coin::Status::count)
+                    throw jsonrpc_exception{ INVALID_PARAMS_JSON_RPC , "Invalid 'status' parameter.", id };
+
+                getUtxo.filter.status = (Coin::Status)filter["status"];
+            }
+
+            readUnsignedFilterParameter(filter, "min_height", getUtxo.filter.minHeight);
+            readUnsignedFilterParameter(filter, "max_height", getUtxo.filter.maxHeight);
+            readUnsignedFilterParameter(filter, "min_amount", getUtxo.filter.minAmount);
+            readUnsignedFilterParameter(filter, "max_amount", getUtxo.filter.maxAmount);
+        }
+
+        if (existsJsonParam(params, "cursor"))
+        {
+            boost::optional<Coin::ID> coinId;
+            if (params["cursor"].is_string())
+                coinId = Coin::FromString(params["cursor"]);
+
+            if (!coinId)
+                throw jsonrpc_exception{ INVALID_PARAMS_JSON_RPC , "Invalid 'cursor' parameter.", id };
+
+            getUtxo.cursor = coinId;
+        }
+
         if (existsJsonParam(params, "count"))
         {
             if (params["count"] > 0)
@@ -410,6 +450,23 @@ namespace beam
             {
                 txList.filter.height = (Height)params["filter"]["height"];
             }
+
+            readUnsignedFilterParameter(params["filter"], "min_height", txList.filter.minHeight);
+            readUnsignedFilterParameter(params["filter"], "max_height", txList.filter.maxHeight);
+            readUnsignedFilterParameter(params["filter"], "min_amount", txList.filter.minAmount);
+            readUnsignedFilterParameter(params["filter"], "max_amount", txList.filter.maxAmount);
+        }
+
+        if (existsJsonParam(params, "cursor"))
+        {
+            auto txId = params["cursor"].is_string() ? from_hex(params["cursor"]) : ByteBuffer();
+
+            TxID cursor;
+            if (txId.size() != cursor.size())
+                throw jsonrpc_exception{ INVALID_PARAMS_JSON_RPC , "Invalid 'cursor' parameter.", id };
+
+            std::copy_n(txId.begin(), cursor.size(), cursor.begin());
+            txList.cursor = cursor;
         }
 
         if (existsJsonParam(params, "count"))
@@ -537,6 +594,44 @@ namespace beam
         }
     }
 
+    void WalletApi::getResponse(int id, const GetUtxo::Response& res, io::JsonWriter& writer)
+    {
+        writer.begin_object();
+        writer.key("id").value(id);
+        writer.key("jsonrpc").value("2.0");
+        writer.key("result").begin_array();
+
+        for (auto& utxo : res.utxos)
+        {
+            writer.begin_object();
+            writer.key("amount").value(utxo.m_ID.m_Value);
+
+            writer.key("createTxId");
+            if (utxo.m_createTxId.is_initialized())
+                writer.hex(utxo.m_createTxId->data(), utxo.m_createTxId->size());
+            else
+                writer.value("");
+
+            writer.key("id").value(utxo.toStringID());
+            writer.key("maturity").value(utxo.get_Maturity());
+            writer.key("session").value(utxo.m_sessionId);
+
+            writer.key("spentTxId");
+            if (utxo.m_spentTxId.is_initialized())
+                writer.hex(utxo.m_spentTxId->data(), utxo.m_spentTxId->size());
+            else
+                writer.value("");
+
+            writer.key("status").value(static_cast<int>(utxo.m_status));
+            writer.key("status_string").value(utxo.getStatusString());
+            writer.key("type").value(static_cast<const char*>(FourCC::Text(utxo.m_ID.m_Type)));
+            writer.end_object();
+        }
+
+        writer.end_array();
+        writer.end_object();
+    }
+
     void WalletApi::getResponse(int id, const Send::Response& res, json& msg)
     {
         msg = json
@@ -650,6 +745,52 @@ namespace beam
         }
     }
 
+    static void writeStatusResponse(const TxDescription& tx, io::JsonWriter& writer, Height kernelProofHeight, Height systemHeight)
+    {
+        writer.begin_object();
+        writer.key("comment").value(reinterpret_cast<const char*>(tx.m_message.data()), tx.m_message.size());
+
+        if (kernelProofHeight > 0 && systemHeight >= kernelProofHeight)
+            writer.key("confirmations").value(systemHeight - kernelProofHeight);
+
+        writer.key("create_time").value(tx.m_createTime);
+
+        if (tx.m_status == TxStatus::Failed)
+            writer.key("failure_reason").value(wallet::GetFailureMessage(tx.m_failureReason));
+
+        writer.key("fee").value(tx.m_fee);
+
+        if (kernelProofHeight > 0)
+            writer.key("height").value(kernelProofHeight);
+
+        writer.key("income").value(!tx.m_sender);
+
+        if (tx.m_status != TxStatus::Failed && tx.m_status != TxStatus::Cancelled)
+            writer.key("kernel").hex(tx.m_kernelID.m_pData, tx.m_kernelID.nBytes);
+
+        writer.key("receiver").value(std::to_string(tx.m_sender ? tx.m_peerId : tx.m_myId));
+        writer.key("sender").value(std::to_string(tx.m_sender ? tx.m_myId : tx.m_peerId));
+        writer.key("status").value(static_cast<int>(tx.m_status));
+        writer.key("status_string").value(tx.getStatusString());
+        writer.key("txId").hex(tx.m_txId.data(), tx.m_txId.size());
+        writer.key("value").value(tx.m_amount);
+        writer.end_object();
+    }
+
+    void WalletApi::getResponse(int id, const TxList::Response& res, io::JsonWriter& writer)
+    {
+        writer.begin_object();
+        writer.key("id").value(id);
+        writer.key("jsonrpc").value("2.0");
+        writer.key("result").begin_array();
+
+        for (const auto& resItem : res.resultList)
+            writeStatusResponse(resItem.tx, writer, resItem.kernelProofHeight, resItem.systemHeight);
+
+        writer.end_array();
+        writer.end_object();
+    }
+
     void WalletApi::getResponse(int id, const WalletStatus::Response& res, json& msg)
     {
         msg = json
@@ -671,6 +812,21 @@ namespace beam
         };
     }
 
+    void WalletApi::getError(int id, int code, const std::string& info, json& msg)
+    {
+        msg = json
+        {
+            {"jsonrpc", "2.0"},
+            {"id", id},
+            {"error",
+                {
+                    {"code", code},
+                    {"message", info},
+                }
+            }
+        };
+    }
+
     void WalletApi::getResponse(int id, const Lock::Response& res, json& msg)
     {
         msg = json
@@ -714,6 +870,60 @@ namespace beam
         {
             json msg = json::parse(data, data + size);
 
+            if (msg.is_array())
+            {
+                if (msg.empty()) throwInvalidJsonRpc();
+
+                _handler.onBatchBegin(msg.size());
+
+                for (auto& item : msg)
+                    parseJsonRpc(item, data, size);
+
+                _handler.onBatchEnd();
+            }
+            else
+                parseJsonRpc(msg, data, size);
+        }
+        catch (const jsonrpc_exception& e)
+        {
+            json msg
+            {
+                {"jsonrpc", "2.0"},
+                {"id", nullptr},
+                {"error",
+                    {
+                        {"code", e.code},
+                        {"message", e.message},
+                    }
+                }
+            };
+
+            _handler.onInvalidJsonRpc(msg);
+        }
+        catch (const std::exception& e)
+        {
+            json msg
+            {
+                {"jsonrpc", "2.0"},
+                {"error",
+                    {
+                        {"code", INTERNAL_JSON_RPC_ERROR},
+                        {"message", e.what()},
+                    }
+                }
+            };
+
+            _handler.onInvalidJsonRpc(msg);
+        }
+
+        return true;
+    }
+
+    void WalletApi::parseJsonRpc(json& msg, const char* data, size_t size)
+    {
+        try
+        {
+            if (!msg.is_object()) throwInvalidJsonRpc();
             if (msg["jsonrpc"] != "2.0") throwInvalidJsonRpc();
             if (msg["id"] <= 0) throwInvalidJsonRpc();
 
@@ -777,7 +987,5 @@ namespace beam
 
             _handler.onInvalidJsonRpc(msg);
         }
-
-        return true;
     }
 }
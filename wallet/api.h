@@ -19,6 +19,7 @@
 
 #include "wallet/wallet.h"
 #include "nlohmann/json.hpp"
+#include "utility/io/json_writer.h"
 
 #define INVALID_JSON_RPC -32600
 #define NOTFOUND_JSON_RPC -32601
@@ -173,6 +174,16 @@ namespace beam
 
     struct GetUtxo
     {
+        struct
+        {
+            boost::optional<Coin::Status> status;
+            boost::optional<Height> minHeight;
+            boost::optional<Height> maxHeight;
+            boost::optional<Amount> minAmount;
+            boost::optional<Amount> maxAmount;
+        } filter;
+
+        boost::optional<Coin::ID> cursor; // continue after this coin
         int count = 0;
         int skip = 0;
 
@@ -209,8 +220,13 @@ namespace beam
         {
             boost::optional<TxStatus> status;
             boost::optional<Height> height;
+            boost::optional<Height> minHeight;
+            boost::optional<Height> maxHeight;
+            boost::optional<Amount> minAmount;
+            boost::optional<Amount> maxAmount;
         } filter;
 
+        boost::optional<TxID> cursor; // continue after this tx
         int count = 0;
         int skip = 0;
 
@@ -240,6 +256,11 @@ namespace beam
     public:
         virtual void onInvalidJsonRpc(const json& msg) = 0;
 
+        // JSON-RPC batch, each of the requests in between gets its response (or error) as usual,
+        // the handler should send them all as a single array
+        virtual void onBatchBegin(size_t count) {}
+        virtual void onBatchEnd() {}
+
 #define MESSAGE_FUNC(api, name, _) \
         virtual void onMessage(int id, const api& data) = 0;
 
@@ -257,16 +278,27 @@ namespace beam
 
         WalletApi(IWalletApiHandler& handler, ACL acl = boost::none);
 
+        // the connection may serve several wallets, each with its own keys
+        void setACL(const ACL& acl) { _acl = acl; }
+
 #define RESPONSE_FUNC(api, name, _) \
-        void getResponse(int id, const api::Response& data, json& msg);
+        static void getResponse(int id, const api::Response& data, json& msg);
 
         WALLET_API_METHODS(RESPONSE_FUNC)
 
 #undef RESPONSE_FUNC
 
+        // streaming versions for the responses that can be large, give the same json without building it
+        static void getResponse(int id, const GetUtxo::Response& data, io::JsonWriter& writer);
+        static void getResponse(int id, const TxList::Response& data, io::JsonWriter& writer);
+
+        static void getError(int id, int code, const std::string& info, json& msg);
+
         bool parse(const char* data, size_t size);
 
     private:
+        void parseJsonRpc(json& msg, const char* data, size_t size);
+
 
 #define MESSAGE_FUNC(api, name, _) \
         void on##api##Message(int id, const json& msg);
@@ -31,6 +31,7 @@
 #include "utility/io/json_serializer.h"
 #include "utility/string_helpers.h"
 #include "utility/log_rotation.h"
+#include "utility/metrics.h"
 
 #include "http/http_connection.h"
 #include "http/http_msg_creator.h"
@@ -39,6 +40,8 @@
 
 #include "wallet/wallet_db.h"
 #include "wallet/wallet_network.h"
+#include "wallet/wallet_hub.h"
+#include "wallet/api_readers.h"
 
 #include "nlohmann/json.hpp"
 #include "version.h"
@@ -46,7 +49,6 @@
 using json = nlohmann::json;
 
 static const unsigned LOG_ROTATION_PERIOD = 3 * 60 * 60 * 1000; // 3 hours
-static const size_t PACKER_FRAGMENTS_SIZE = 4096;
 
 namespace beam
 {
@@ -108,22 +110,25 @@ namespace beam
     {
     public:
         virtual void closeConnection(uint64_t id) = 0;
+        virtual WalletApi::ACL getWalletACL(const std::string& name) = 0;
     };
 
     class WalletApiServer : public IWalletApiServer
     {
     public:
-        WalletApiServer(IWalletDB::Ptr walletDB, Wallet& wallet, IWalletMessageEndpoint& wnet, io::Reactor& reactor, 
-            io::Address listenTo, bool useHttp, WalletApi::ACL acl, const TlsOptions& tlsOptions, const std::vector<uint32_t>& whitelist)
+        // serves either the single wallet, or the wallets of the hub (http only), the request path selects the wallet
+        WalletApiServer(IWalletDB::Ptr walletDB, Wallet* wallet, WalletHub* hub, io::Reactor& reactor,
+            io::Address listenTo, bool useHttp, WalletApi::ACL acl, const TlsOptions& tlsOptions, const std::vector<uint32_t>& whitelist, ApiReaders* readers)
             : _reactor(reactor)
             , _bindAddress(listenTo)
             , _useHttp(useHttp)
             , _tlsOptions(tlsOptions)
             , _walletDB(walletDB)
             , _wallet(wallet)
-            , _wnet(wnet)
+            , _hub(hub)
             , _acl(acl)
             , _whitelist(whitelist)
+            , _readers(readers)
         {
             start();
         }
@@ -162,6 +167,34 @@ namespace beam
             _pendingToClose.push_back(id);
         }
 
+        // The hosted wallet may have its own keys in <dir>/<name>.acl, otherwise the common ACL applies.
+        // The file is read once, on the first request to the wallet. A broken file denies all the keys.
+        WalletApi::ACL getWalletACL(const std::string& name) override
+        {
+            if (!_acl || !_hub)
+                return _acl;
+
+            auto it = _walletACLs.find(name);
+            if (_walletACLs.end() != it)
+                return it->second;
+
+            WalletApi::ACL acl = _acl;
+
+            std::string path = _hub->get_Path(name, ".acl");
+            if (boost::filesystem::exists(path))
+            {
+                acl = loadACL(path);
+                if (!acl)
+                {
+                    LOG_ERROR() << "ACL file not loaded, all keys are denied, path is: " << path;
+                    acl = WalletApi::ACL::value_type();
+                }
+            }
+
+            _walletACLs[name] = acl;
+            return acl;
+        }
+
     private:
 
         void checkConnections()
@@ -182,7 +215,7 @@ namespace beam
         template<typename T>
         std::shared_ptr<ApiConnection> createConnection(io::TcpStream::Ptr&& newStream)
         {
-            return std::static_pointer_cast<ApiConnection>(std::make_shared<T>(*this, _walletDB, _wallet, _wnet, std::move(newStream), _acl));
+            return std::static_pointer_cast<ApiConnection>(std::make_shared<T>(*this, _walletDB, _wallet, _hub, std::move(newStream), _acl, _readers));
         }
 
         void on_stream_accepted(io::TcpStream::Ptr&& newStream, io::ErrorCode errorCode)
@@ -213,55 +246,79 @@ namespace beam
         }
 
     private:
-        class ApiConnection : IWalletApiHandler, IWalletDbObserver
+        class ApiConnection : IWalletApiHandler, IWalletDbObserver, public std::enable_shared_from_this<ApiConnection>
         {
         public:
-            ApiConnection(IWalletDB::Ptr walletDB, Wallet& wallet, IWalletMessageEndpoint& wnet, WalletApi::ACL acl)
+            ApiConnection(IWalletDB::Ptr walletDB, Wallet* wallet, WalletHub* hub, WalletApi::ACL acl, ApiReaders* readers)
                 : _walletDB(walletDB)
                 , _wallet(wallet)
+                , _hub(hub)
                 , _api(*this, acl)
-                , _wnet(wnet)
+                , _readers(readers)
+                , _responses([this](io::SerializedMsg&& msg) { sendMsg(std::move(msg)); })
             {
-                _walletDB->subscribe(this);
+                if (_walletDB)
+                    _walletDB->subscribe(this);
             }
 
             virtual ~ApiConnection()
             {
-                _walletDB->unsubscribe(this);
+                if (_walletDB && !_hub)
+                    _walletDB->unsubscribe(this);
             }
 
-            virtual void serializeMsg(const json& msg) = 0;
+            virtual void sendMsg(io::SerializedMsg&& msg) = 0;
 
             template<typename T>
             void doResponse(int id, const T& response)
             {
                 json msg;
-                _api.getResponse(id, response, msg);
-                serializeMsg(msg);
+                WalletApi::getResponse(id, response, msg);
+                respond(std::move(msg));
             }
 
             void doError(int id, int code, const std::string& info)
             {
-                json msg
+                json msg;
+                WalletApi::getError(id, code, info, msg);
+                respond(std::move(msg));
+            }
+
+            // serves the read-only request by the readers if there're any, the response keeps its place in order
+            void doRead(int id, ApiReaders::ReadFunc&& func)
+            {
+                ResponseQueue::Slot slot = _responses.reserve();
+
+                if (!_readers)
                 {
-                    {"jsonrpc", "2.0"},
-                    {"id", id},
-                    {"error",
-                        {
-                            {"code", code},
-                            {"message", info},
-                        }
-                    }
-                };
+                    _responses.complete(slot, func(*_walletDB, _serializer));
+                    return;
+                }
+
+                std::weak_ptr<ApiConnection> wp = shared_from_this();
 
-                serializeMsg(msg);
+                _readers->push(id, std::move(func), [wp, slot](io::SerializedMsg&& msg)
+                {
+                    if (auto p = wp.lock())
+                        p->_responses.complete(slot, std::move(msg));
+                });
             }
 
             void onInvalidJsonRpc(const json& msg) override
             {
                 LOG_DEBUG() << "onInvalidJsonRpc: " << msg;
 
-                serializeMsg(msg);
+                respond(msg);
+            }
+
+            void onBatchBegin(size_t count) override
+            {
+                _responses.beginBatch(count);
+            }
+
+            void onBatchEnd() override
+            {
+                _responses.endBatch();
             }
 
             void onMessage(int id, const CreateAddress& data) override 
@@ -410,7 +467,7 @@ namespace beam
                         coins = data.coins ? *data.coins : CoinIDList();
                     }
 
-                    auto txId = _wallet.transfer_money(from, data.address, data.value, data.fee, coins, true, 120, 720, std::move(message), true);
+                    auto txId = _wallet->transfer_money(from, data.address, data.value, data.fee, coins, true, 120, 720, std::move(message), true);
                     doResponse(id, Send::Response{ txId });
                 }
                 catch(...)
@@ -423,12 +480,22 @@ namespace beam
             {
                 LOG_DEBUG() << "Status(txId = " << to_hex(data.txId.data(), data.txId.size()) << ")";
 
-                auto tx = _walletDB->getTx(data.txId);
+                doRead(id, [id, data](IWalletDB& walletDB, ResponseSerializer& out)
+                {
+                    json msg;
+                    getStatus(walletDB, id, data, msg);
+                    return out.write(msg);
+                });
+            }
+
+            static void getStatus(IWalletDB& walletDB, int id, const Status& data, json& msg)
+            {
+                auto tx = walletDB.getTx(data.txId);
 
                 if (tx)
                 {
                     Block::SystemState::ID stateID = {};
-                    _walletDB->getSystemStateID(stateID);
+                    walletDB.getSystemStateID(stateID);
 
                     Status::Response result;
                     result.tx = *tx;
@@ -436,13 +503,13 @@ namespace beam
                     result.systemHeight = stateID.m_Height;
                     result.confirmations = 0;
 
-                    wallet::getTxParameter(*_walletDB, tx->m_txId, wallet::TxParameterID::KernelProofHeight, result.kernelProofHeight);
+                    wallet::getTxParameter(walletDB, tx->m_txId, wallet::TxParameterID::KernelProofHeight, result.kernelProofHeight);
 
-                    doResponse(id, result);
+                    WalletApi::getResponse(id, result, msg);
                 }
                 else
                 {
-                    doError(id, INVALID_PARAMS_JSON_RPC, "Unknown transaction ID.");
+                    WalletApi::getError(id, INVALID_PARAMS_JSON_RPC, "Unknown transaction ID.", msg);
                 }
             }
 
@@ -456,7 +523,7 @@ namespace beam
                      WalletAddress senderAddress = wallet::createAddress(*_walletDB);
                     _walletDB->saveAddress(senderAddress);
 
-                    auto txId = _wallet.split_coins(senderAddress.m_walletID, data.coins, data.fee);
+                    auto txId = _wallet->split_coins(senderAddress.m_walletID, data.coins, data.fee);
                     doResponse(id, Send::Response{ txId });
                 }
                 catch(...)
@@ -475,7 +542,7 @@ namespace beam
                 {
                     if (tx->canCancel())
                     {
-                        _wallet.cancel_tx(tx->m_txId);
+                        _wallet->cancel_tx(tx->m_txId);
                         TxCancel::Response result{ true };
                         doResponse(id, result);
                     }
@@ -522,50 +589,62 @@ namespace beam
                 }
             }
 
-            template<typename T>
-            static void doPagination(size_t skip, size_t count, std::vector<T>& res)
+            void onMessage(int id, const GetUtxo& data) override 
             {
-                if (count > 0)
-                {
-                    size_t start = skip;
-                    size_t end = start + count;
-                    size_t size = res.size();
+                LOG_DEBUG() << "GetUtxo(id = " << id << ")";
 
-                    if (start < size)
-                    {
-                        if (end > size) end = size;
+                doRead(id, [id, data](IWalletDB& walletDB, ResponseSerializer& out) { return getUtxo(walletDB, id, data, out); });
+            }
 
-                        res = std::vector<T>(res.begin() + start, res.begin() + end);
+            static io::SerializedMsg getUtxo(IWalletDB& walletDB, int id, const GetUtxo& data, ResponseSerializer& out)
+            {
+                if (data.cursor)
+                {
+                    Coin coin;
+                    coin.m_ID = *data.cursor;
+                    if (!walletDB.find(coin))
+                    {
+                        json msg;
+                        WalletApi::getError(id, INVALID_PARAMS_JSON_RPC, "Unknown cursor coin.", msg);
+                        return out.write(msg);
                     }
-                    else res = {};
                 }
-            }
 
-            void onMessage(int id, const GetUtxo& data) override 
-            {
-                LOG_DEBUG() << "GetUtxo(id = " << id << ")";
+                CoinFilter filter;
+                filter.m_status = data.filter.status;
+                filter.m_minHeight = data.filter.minHeight.value_or(filter.m_minHeight);
+                filter.m_maxHeight = data.filter.maxHeight.value_or(filter.m_maxHeight);
+                filter.m_minAmount = data.filter.minAmount.value_or(filter.m_minAmount);
+                filter.m_maxAmount = data.filter.maxAmount.value_or(filter.m_maxAmount);
 
                 GetUtxo::Response response;
-                _walletDB->visit([&response](const Coin& c)->bool
-                {
-                    response.utxos.push_back(c);
-                    return true;
-                });
+                response.utxos = walletDB.getCoins(filter, data.cursor, data.skip, data.count);
 
-                doPagination(data.skip, data.count, response.utxos);
-
-                doResponse(id, response);
+                return out.write(id, response);
             }
 
             void onMessage(int id, const WalletStatus& data) override
             {
                 LOG_DEBUG() << "WalletStatus(id = " << id << ")";
 
+                // the hosted wallets don't keep the headers in their db
+                Block::SystemState::IHistory* pHistory = _hub ? &_hub->get_SharedHistory() : nullptr;
+
+                doRead(id, [id, pHistory](IWalletDB& walletDB, ResponseSerializer& out)
+                {
+                    json msg;
+                    getWalletStatus(walletDB, pHistory ? *pHistory : walletDB.get_History(), id, msg);
+                    return out.write(msg);
+                });
+            }
+
+            static void getWalletStatus(IWalletDB& walletDB, Block::SystemState::IHistory& history, int id, json& msg)
+            {
                 WalletStatus::Response response;
 
                 {
                     Block::SystemState::ID stateID = {};
-                    _walletDB->getSystemStateID(stateID);
+                    walletDB.getSystemStateID(stateID);
 
                     response.currentHeight = stateID.m_Height;
                     response.currentStateHash = stateID.m_Hash;
@@ -573,19 +652,19 @@ namespace beam
 
                 {
                     Block::SystemState::Full state;
-                    _walletDB->get_History().get_Tip(state);
+                    history.get_Tip(state);
                     response.prevStateHash = state.m_Prev;
                     response.difficulty = state.m_PoW.m_Difficulty.ToFloat();
                 }
 
-				wallet::Totals totals(*_walletDB);
+				wallet::Totals totals(walletDB);
 
                 response.available = totals.Avail;
                 response.receiving = totals.Incoming;
                 response.sending = totals.Outgoing;
                 response.maturing = totals.Maturing;
 
-                doResponse(id, response);
+                WalletApi::getResponse(id, response, msg);
             }
 
             void onMessage(int id, const Lock& data) override
@@ -614,13 +693,38 @@ namespace beam
             {
                 LOG_DEBUG() << "List(filter.status = " << (data.filter.status ? std::to_string((uint32_t)*data.filter.status) : "nul") << ")";
 
+                doRead(id, [id, data](IWalletDB& walletDB, ResponseSerializer& out) { return getTxList(walletDB, id, data, out); });
+            }
+
+            static io::SerializedMsg getTxList(IWalletDB& walletDB, int id, const TxList& data, ResponseSerializer& out)
+            {
+                if (data.cursor && !walletDB.getTx(*data.cursor))
+                {
+                    json msg;
+                    WalletApi::getError(id, INVALID_PARAMS_JSON_RPC, "Unknown cursor transaction.", msg);
+                    return out.write(msg);
+                }
+
+                TxFilter filter;
+                filter.m_status = data.filter.status;
+                filter.m_minHeight = data.filter.minHeight.value_or(filter.m_minHeight);
+                filter.m_maxHeight = data.filter.maxHeight.value_or(filter.m_maxHeight);
+                filter.m_minAmount = data.filter.minAmount.value_or(filter.m_minAmount);
+                filter.m_maxAmount = data.filter.maxAmount.value_or(filter.m_maxAmount);
+
+                if (data.filter.height)
+                {
+                    filter.m_minHeight = std::max(filter.m_minHeight, *data.filter.height);
+                    filter.m_maxHeight = std::min(filter.m_maxHeight, *data.filter.height);
+                }
+
                 TxList::Response res;
 
                 {
-                    auto txList = _walletDB->getTxHistory();
+                    auto txList = walletDB.getTxHistory(filter, data.cursor, data.skip, data.count);
 
                     Block::SystemState::ID stateID = {};
-                    _walletDB->getSystemStateID(stateID);
+                    walletDB.getSystemStateID(stateID);
 
                     for (const auto& tx : txList)
                     {
@@ -630,40 +734,12 @@ namespace beam
                         item.systemHeight = stateID.m_Height;
                         item.confirmations = 0;
 
-                        wallet::getTxParameter(*_walletDB, tx.m_txId, wallet::TxParameterID::KernelProofHeight, item.kernelProofHeight);
+                        wallet::getTxParameter(walletDB, tx.m_txId, wallet::TxParameterID::KernelProofHeight, item.kernelProofHeight);
                         res.resultList.push_back(item);
                     }
                 }
 
-                using Result = decltype(res.resultList);
-
-                // filter transactions by status if provided
-                if (data.filter.status)
-                {
-                    Result filteredList;
-
-                    for (const auto& it : res.resultList)
-                        if (it.tx.m_status == *data.filter.status)
-                            filteredList.push_back(it);
-
-                    res.resultList = filteredList;
-                }
-
-                // filter transactions by height if provided
-                if (data.filter.height)
-                {
-                    Result filteredList;
-
-                    for (const auto& it : res.resultList)
-                        if (it.kernelProofHeight == *data.filter.height)
-                            filteredList.push_back(it);
-
-                    res.resultList = filteredList;
-                }
-
-                doPagination(data.skip, data.count, res.resultList);
-
-                doResponse(id, res);
+                return out.write(id, res);
             }
 
         private:
@@ -672,20 +748,32 @@ namespace beam
                 doError(id, NOTFOUND_JSON_RPC, "Method not implemented yet.");
             }
 
+            void respond(const json& msg)
+            {
+                _responses.complete(_responses.reserve(), _serializer.write(msg));
+            }
+
+            ResponseSerializer _serializer;
+
         protected:
+            // in the hub mode they're bound for the time of the request only
             IWalletDB::Ptr _walletDB;
-            Wallet& _wallet;
+            Wallet* _wallet;
+            WalletHub* _hub;
             WalletApi _api;
-            IWalletMessageEndpoint& _wnet;
+            ApiReaders* _readers;
+
+        private:
+            ResponseQueue _responses;
         };
 
         class TcpApiConnection : public ApiConnection
         {
         public:
-            TcpApiConnection(IWalletApiServer& server, IWalletDB::Ptr walletDB, Wallet& wallet, IWalletMessageEndpoint& wnet, io::TcpStream::Ptr&& newStream, WalletApi::ACL acl)
-                : ApiConnection(walletDB, wallet, wnet, acl)
+            TcpApiConnection(IWalletApiServer& server, IWalletDB::Ptr walletDB, Wallet* wallet, WalletHub* hub, io::TcpStream::Ptr&& newStream, WalletApi::ACL acl, ApiReaders* readers)
+                : ApiConnection(walletDB, wallet, hub, acl, readers)
                 , _stream(std::move(newStream))
-                , _lineProtocol(BIND_THIS_MEMFN(on_raw_message), BIND_THIS_MEMFN(on_write))
+                , _lineReader(BIND_THIS_MEMFN(on_raw_message))
                 , _server(server)
             {
                 _stream->enable_keepalive(2);
@@ -697,14 +785,12 @@ namespace beam
 
             }
 
-            void serializeMsg(const json& msg) override
+            void sendMsg(io::SerializedMsg&& msg) override
             {
-                serialize_json_msg(_lineProtocol, msg);
-            }
+                static const char eol = 10;
 
-            void on_write(io::SharedBuffer&& msg)
-            {
-                _stream->write(msg);
+                _stream->write(msg, false);
+                _stream->write(&eol, 1);
             }
 
             bool on_raw_message(void* data, size_t size)
@@ -723,7 +809,7 @@ namespace beam
                     return false;
                 }
 
-                if (!_lineProtocol.new_data_from_stream(data, size))
+                if (!_lineReader.new_data_from_stream(data, size))
                 {
                     LOG_INFO() << "stream corrupted";
                     _server.closeConnection(_stream->peer_address().u64());
@@ -735,22 +821,23 @@ namespace beam
 
         private:
             io::TcpStream::Ptr _stream;
-            LineProtocol _lineProtocol;
+            LineReader _lineReader;
             IWalletApiServer& _server;
         };
 
         class HttpApiConnection : public ApiConnection
         {
         public:
-            HttpApiConnection(IWalletApiServer& server, IWalletDB::Ptr walletDB, Wallet& wallet, IWalletMessageEndpoint& wnet, io::TcpStream::Ptr&& newStream, WalletApi::ACL acl)
-                : ApiConnection(walletDB, wallet, wnet, acl)
+            HttpApiConnection(IWalletApiServer& server, IWalletDB::Ptr walletDB, Wallet* wallet, WalletHub* hub, io::TcpStream::Ptr&& newStream, WalletApi::ACL acl, ApiReaders* readers)
+                : ApiConnection(walletDB, wallet, hub, acl, readers)
                 , _keepalive(false)
+                , _closed(false)
                 , _msgCreator(2000)
-                , _packer(PACKER_FRAGMENTS_SIZE)
                 , _server(server)
             {
                 newStream->enable_keepalive(1);
                 auto peer = newStream->peer_address();
+                _id = peer.u64();
 
                 _connection = std::make_unique<HttpConnection>(
                     peer.u64(),
@@ -764,25 +851,50 @@ namespace beam
 
             virtual ~HttpApiConnection() {}
 
-            void serializeMsg(const json& msg) override
+            void sendMsg(io::SerializedMsg&& msg) override
             {
-                serialize_json_msg(_body, _packer, msg);                
-                _keepalive = send(_connection, 200, "OK");
+                _body = std::move(msg);
+
+                // the response may be sent after on_request returned, if it was served by the readers
+                if (!send(_connection, 200, "OK"))
+                {
+                    _keepalive = false;
+                    close();
+                }
             }
 
         private:
+            void close()
+            {
+                if (!_closed)
+                {
+                    _closed = true;
+                    _connection->shutdown();
+                    _server.closeConnection(_id);
+                }
+            }
 
             bool on_request(uint64_t id, const HttpMsgReader::Message& msg)
             {
                 if (msg.what != HttpMsgReader::http_message || !msg.msg)
                 {
                     LOG_DEBUG() << "-peer " << io::Address::from_u64(id) << " : " << msg.error_str();
-                    _connection->shutdown();
-                    _server.closeConnection(id);
+                    close();
                     return false;
                 }
 
-                if (msg.msg->get_path() != "/api/wallet")
+                WalletHub::HostedWallet::Ptr hosted;
+                if (_hub)
+                {
+                    // /api/wallet/<name>
+                    static const char prefix[] = "/api/wallet/";
+                    const std::string& path = msg.msg->get_path();
+
+                    if (!path.compare(0, sizeof(prefix) - 1, prefix))
+                        hosted = _hub->GetWallet(path.substr(sizeof(prefix) - 1));
+                }
+
+                if (_hub ? !hosted : (msg.msg->get_path() != "/api/wallet"))
                 {
                     _keepalive = send(_connection, 404, "Not Found");
                 }
@@ -795,14 +907,26 @@ namespace beam
 
                     LOG_INFO() << "got " << std::string((char*)data, size);
 
+                    if (hosted)
+                    {
+                        _walletDB = hosted->m_WalletDB;
+                        _wallet = hosted->m_Wallet.get();
+                        _api.setACL(_server.getWalletACL(hosted->m_Name));
+                    }
+
+                    _keepalive = true; // unless the response fails to be sent
                     _api.parse((char*)data, size);
+
+                    if (hosted)
+                    {
+                        // there're no readers in the hub mode, the responses are already sent
+                        _walletDB.reset();
+                        _wallet = nullptr;
+                    }
                 }
 
                 if (!_keepalive)
-                {
-                    _connection->shutdown();
-                    _server.closeConnection(id);
-                }
+                    close();
 
                 return _keepalive;
             }
@@ -842,10 +966,11 @@ namespace beam
             }
 
             HttpConnection::Ptr _connection;
+            uint64_t _id;
             bool _keepalive;
+            bool _closed;
 
             HttpMsgCreator _msgCreator;
-            HttpMsgCreator _packer;
             io::SerializedMsg _headers;
             io::SerializedMsg _body;
             IWalletApiServer& _server;
@@ -860,11 +985,13 @@ namespace beam
         std::map<uint64_t, std::shared_ptr<ApiConnection>> _connections;
 
         IWalletDB::Ptr _walletDB;
-        Wallet& _wallet;
-        IWalletMessageEndpoint& _wnet;
+        Wallet* _wallet;
+        WalletHub* _hub;
         std::vector<uint64_t> _pendingToClose;
         WalletApi::ACL _acl;
+        std::map<std::string, WalletApi::ACL> _walletACLs;
         std::vector<uint32_t> _whitelist;
+        ApiReaders* _readers;
     };
 }
 
@@ -890,16 +1017,25 @@ int main(int argc, char* argv[])
             std::string whitelist;
 
             uint32_t logCleanupPeriod;
+            uint32_t readThreads;
+            bool profileDB;
+
+            std::string walletsDir;
+            std::string ownerWallet;
+            uint32_t idleTimeout;
 
         } options;
 
         TlsOptions tlsOptions;
 
         io::Address node_addr;
+        std::unique_ptr<Metrics::QueryProfile> dbProfile; // outlives the connections it's attached to
         IWalletDB::Ptr walletDB;
         io::Reactor::Ptr reactor = io::Reactor::create();
         WalletApi::ACL acl;
         std::vector<uint32_t> whitelist;
+        std::unique_ptr<ApiReaders> readers;
+        SecString pass;
 
         {
             po::options_description desc("Wallet API general options");
@@ -912,6 +1048,15 @@ int main(int argc, char* argv[])
                 (cli::API_USE_HTTP, po::value<bool>(&options.useHttp)->default_value(false), "use JSON RPC over HTTP")
                 (cli::IP_WHITELIST, po::value<std::string>(&options.whitelist)->default_value(""), "IP whitelist")
                 (cli::LOG_CLEANUP_DAYS, po::value<uint32_t>(&options.logCleanupPeriod)->default_value(5), "old logfiles cleanup period(days)")
+                (cli::API_READ_THREADS, po::value<uint32_t>(&options.readThreads)->default_value(2), "number of threads serving the read-only methods (0 - serve them on the main thread)")
+                (cli::PROFILE_DB, po::value<bool>(&options.profileDB)->default_value(false), "collect per-statement DB statistics, logged on exit (single wallet only)")
+            ;
+
+            po::options_description hubDesc("Multiple wallets options");
+            hubDesc.add_options()
+                (cli::API_WALLETS_DIR, po::value<std::string>(&options.walletsDir), "serve all the wallets of the directory (<name>.db, same password), at /api/wallet/<name>. HTTP only. With ACL, <name>.acl overrides the common ACL for the wallet")
+                (cli::API_OWNER_WALLET, po::value<std::string>(&options.ownerWallet)->default_value(""), "name of the wallet which key the node is owned by")
+                (cli::API_IDLE_TIMEOUT, po::value<uint32_t>(&options.idleTimeout)->default_value(600), "idle wallet unload timeout (seconds)")
             ;
 
             po::options_description authDesc("User authorization options");
@@ -927,6 +1072,7 @@ int main(int argc, char* argv[])
                 (cli::API_TLS_KEY, po::value<std::string>(&tlsOptions.keyPath)->default_value("wallet_api.key"), "path to TLS private key")
             ;
 
+            desc.add(hubDesc);
             desc.add(authDesc);
             desc.add(tlsDesc);
             desc.add(createRulesOptionsDescription());
@@ -1017,19 +1163,41 @@ int main(int argc, char* argv[])
                 return -1;
             }
 
-            if (!WalletDB::isInitialized(options.walletPath))
+            if (!options.walletsDir.empty())
+            {
+                if (!options.useHttp)
+                {
+                    LOG_ERROR() << "Multiple wallets are served over HTTP only";
+                    return -1;
+                }
+
+                if (!boost::filesystem::is_directory(options.walletsDir))
+                {
+                    LOG_ERROR() << "Wallets directory not found, path is: " << options.walletsDir;
+                    return -1;
+                }
+
+                if (!options.ownerWallet.empty() && !WalletHub::IsValidName(options.ownerWallet))
+                {
+                    LOG_ERROR() << "Invalid owner wallet name: " << options.ownerWallet;
+                    return -1;
+                }
+            }
+            else if (!WalletDB::isInitialized(options.walletPath))
             {
                 LOG_ERROR() << "Wallet not found, path is: " << options.walletPath;
                 return -1;
             }
 
-            SecString pass;
             if (!beam::read_wallet_pass(pass, vm))
             {
                 LOG_ERROR() << "Please, provide password for the wallet.";
                 return -1;
             }
+        }
 
+        if (options.walletsDir.empty())
+        {
             walletDB = WalletDB::open(options.walletPath, pass, reactor);
             if (!walletDB)
             {
@@ -1038,6 +1206,22 @@ int main(int argc, char* argv[])
             }
 
             LOG_INFO() << "wallet sucessfully opened...";
+
+            if (options.profileDB)
+            {
+                dbProfile = std::make_unique<Metrics::QueryProfile>("wallet");
+                std::static_pointer_cast<WalletDB>(walletDB)->setProfile(dbProfile.get());
+            }
+
+            if (options.readThreads)
+            {
+                readers = std::make_unique<ApiReaders>(*reactor, std::static_pointer_cast<WalletDB>(walletDB));
+                if (!readers->start(options.walletPath, pass, options.readThreads, dbProfile.get()))
+                {
+                    LOG_ERROR() << "Wallet not opened for reading.";
+                    return -1;
+                }
+            }
         }
 
         io::Address listenTo = io::Address().port(options.port);
@@ -1046,6 +1230,27 @@ int main(int argc, char* argv[])
 
         LogRotation logRotation(*reactor, LOG_ROTATION_PERIOD, options.logCleanupPeriod);
 
+        if (!options.walletsDir.empty())
+        {
+            WalletHub::Config cfg;
+            cfg.m_Dir = options.walletsDir;
+            cfg.m_Owner = options.ownerWallet;
+            cfg.m_IdleTimeout_s = options.idleTimeout;
+
+            // the wallets are opened on demand, the read-only methods are served on the main thread
+            WalletHub hub(cfg, std::move(pass), reactor);
+            hub.get_Network().m_Cfg.m_vNodes.push_back(node_addr);
+            hub.get_Network().Connect();
+
+            WalletApiServer server(nullptr, nullptr, &hub, *reactor,
+                listenTo, options.useHttp, acl, tlsOptions, whitelist, nullptr);
+
+            io::Reactor::get_Current().run();
+
+            LOG_INFO() << "Done";
+            return 0;
+        }
+
         Wallet wallet{ walletDB };
 
         auto nnet = std::make_shared<proto::FlyClient::NetworkStd>(wallet);
@@ -1056,11 +1261,18 @@ int main(int argc, char* argv[])
 		wallet.AddMessageEndpoint(wnet);
         wallet.SetNodeEndpoint(nnet);
 
-        WalletApiServer server(walletDB, wallet, *wnet, *reactor, 
-            listenTo, options.useHttp, acl, tlsOptions, whitelist);
+        WalletApiServer server(walletDB, &wallet, nullptr, *reactor,
+            listenTo, options.useHttp, acl, tlsOptions, whitelist, readers.get());
 
         io::Reactor::get_Current().run();
 
+        if (dbProfile)
+        {
+            std::string s;
+            dbProfile->Dump(s);
+            LOG_INFO() << s;
+        }
+
         LOG_INFO() << "Done";
     }
     catch (const std::exception& e)
@@ -0,0 +1,224 @@
+// Copyright 2018 The Beam Team
+// Copyright 2019 - 2022 The LiteCash Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "api_readers.h"
+
+#include "utility/io/json_serializer.h"
+#include "utility/logger.h"
+
+using json = nlohmann::json;
+
+namespace beam
+{
+    namespace
+    {
+        const size_t PACKER_FRAGMENTS_SIZE = 4096;
+    }
+
+    ResponseSerializer::ResponseSerializer()
+        : _packer(PACKER_FRAGMENTS_SIZE)
+    {
+    }
+
+    io::SerializedMsg ResponseSerializer::write(const json& msg)
+    {
+        io::SerializedMsg out;
+        io::FragmentWriter& fw = _packer.acquire_writer(out);
+
+        if (!serialize_json(fw, msg))
+        {
+            fw.finalize();
+            out.clear();
+
+            json error;
+            WalletApi::getError(0, INTERNAL_JSON_RPC_ERROR, "Internal error. Please look at logs.", error);
+            error["id"] = nullptr;
+            serialize_json(fw, error);
+        }
+
+        fw.finalize();
+        _packer.release_writer();
+        return out;
+    }
+
+    ResponseQueue::ResponseQueue(SendFunc&& send)
+        : _send(std::move(send))
+    {
+    }
+
+    ResponseQueue::Slot ResponseQueue::reserve()
+    {
+        if (_batch)
+            return { _batch, _batchIndex++ };
+
+        auto response = std::make_shared<PendingResponse>();
+        _responses.push_back(response);
+        return { response, 0 };
+    }
+
+    void ResponseQueue::complete(const Slot& slot, io::SerializedMsg&& msg)
+    {
+        PendingResponse& response = *slot.response;
+        assert(response.remaining);
+
+        if (response.batch)
+            response.items[slot.index] = std::move(msg);
+        else
+            response.msg = std::move(msg);
+
+        response.remaining--;
+        flush();
+    }
+
+    void ResponseQueue::beginBatch(size_t count)
+    {
+        _batch = std::make_shared<PendingResponse>();
+        _batch->batch = true;
+        _batch->remaining = count;
+        _batch->items.resize(count);
+
+        _batchIndex = 0;
+        _responses.push_back(_batch);
+    }
+
+    void ResponseQueue::endBatch()
+    {
+        _batch.reset();
+        flush();
+    }
+
+    void ResponseQueue::flush()
+    {
+        while (!_responses.empty() && !_responses.front()->remaining)
+        {
+            auto response = std::move(_responses.front());
+            _responses.pop_front();
+
+            if (response->batch)
+                joinBatch(*response);
+
+            _send(std::move(response->msg));
+        }
+    }
+
+    void ResponseQueue::joinBatch(PendingResponse& response)
+    {
+        static const char s[] = "[,]";
+        io::SharedBuffer leftBrace(s, 1), comma(s + 1, 1), rightBrace(s + 2, 1);
+
+        response.msg.push_back(leftBrace);
+
+        for (size_t i = 0; i < response.items.size(); i++)
+        {
+            if (i)
+                response.msg.push_back(comma);
+
+            for (auto& fragment : response.items[i])
+                response.msg.push_back(std::move(fragment));
+        }
+
+        response.msg.push_back(rightBrace);
+        response.items.clear();
+    }
+
+    ApiReaders::ApiReaders(io::Reactor& reactor, std::shared_ptr<WalletDB> writer)
+        : _writer(std::move(writer))
+        , _rx(reactor, [](std::function<void()>&& done) { done(); })
+    {
+    }
+
+    ApiReaders::~ApiReaders()
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+
+        _newTask.notify_all();
+
+        for (auto& t : _threads)
+            t.join();
+    }
+
+    bool ApiReaders::start(const std::string& path, const SecString& password, uint32_t nThreads, Metrics::QueryProfile* profile)
+    {
+        for (uint32_t i = 0; i < nThreads; i++)
+        {
+            auto walletDB = WalletDB::openReadOnly(path, password);
+            if (!walletDB)
+                return false;
+
+            if (profile)
+                walletDB->setProfile(profile);
+
+            _threads.emplace_back(&ApiReaders::run, this, walletDB, _rx.get_tx());
+        }
+
+        return true;
+    }
+
+    void ApiReaders::push(int id, ReadFunc&& func, DoneFunc&& done)
+    {
+        // otherwise the read may miss what the previous request has just written
+        _writer->flushDB();
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _tasks.push_back({ id, std::move(func), std::move(done) });
+        }
+
+        _newTask.notify_one();
+    }
+
+    void ApiReaders::run(std::shared_ptr<WalletDB> walletDB, TX<std::function<void()>> tx)
+    {
+        ResponseSerializer serializer;
+
+        while (true)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _newTask.wait(lock, [this] { return _stop || !_tasks.empty(); });
+
+                if (_stop)
+                    break;
+
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+
+            io::SerializedMsg msg;
+
+            try
+            {
+                walletDB->beginSnapshot();
+                msg = task.func(*walletDB, serializer);
+            }
+            catch (const std::exception& e)
+            {
+                LOG_ERROR() << "API read failed: " << e.what();
+
+                json error;
+                WalletApi::getError(task.id, INTERNAL_JSON_RPC_ERROR, "Internal error. Please look at logs.", error);
+                msg = serializer.write(error);
+            }
+
+            walletDB->endSnapshot();
+
+            tx.send([done = std::move(task.done), msg = std::move(msg)]() mutable { done(std::move(msg)); });
+        }
+    }
+}
@@ -0,0 +1,144 @@
+// Copyright 2018 The Beam Team
+// Copyright 2019 - 2022 The LiteCash Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "api.h"
+#include "wallet_db.h"
+
+#include "utility/io/json_writer.h"
+#include "utility/message_queue.h"
+#include "http/http_msg_creator.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace beam
+{
+    // Serializes the API responses into fragments, the large ones - by the streaming writer, without json DOM
+    class ResponseSerializer
+    {
+    public:
+        ResponseSerializer();
+
+        io::SerializedMsg write(const nlohmann::json& msg);
+
+        template<typename T>
+        io::SerializedMsg write(int id, const T& response)
+        {
+            io::SerializedMsg out;
+            io::FragmentWriter& fw = _packer.acquire_writer(out);
+
+            try
+            {
+                io::JsonWriter writer(fw);
+                WalletApi::getResponse(id, response, writer);
+            }
+            catch (...)
+            {
+                // drop the partial response
+                fw.finalize();
+                _packer.release_writer();
+                throw;
+            }
+
+            fw.finalize();
+            _packer.release_writer();
+            return out;
+        }
+
+    private:
+        HttpMsgCreator _packer;
+    };
+
+    // Responses are sent in the order of the requests, also when some of them are served by the readers.
+    // A batch takes a single place, and is sent once all its responses are ready.
+    class ResponseQueue
+    {
+    public:
+        using SendFunc = std::function<void(io::SerializedMsg&& msg)>;
+
+        struct PendingResponse
+        {
+            io::SerializedMsg msg;
+            std::vector<io::SerializedMsg> items;
+            size_t remaining = 1;
+            bool batch = false;
+        };
+
+        struct Slot
+        {
+            std::shared_ptr<PendingResponse> response;
+            size_t index;
+        };
+
+        explicit ResponseQueue(SendFunc&& send);
+
+        Slot reserve();
+        void complete(const Slot& slot, io::SerializedMsg&& msg);
+
+        void beginBatch(size_t count);
+        void endBatch();
+
+    private:
+        void flush();
+
+        // the batch responses are already serialized, so the array is made of them and the helper fragments
+        static void joinBatch(PendingResponse& response);
+
+        SendFunc _send;
+        std::deque<std::shared_ptr<PendingResponse>> _responses;
+        std::shared_ptr<PendingResponse> _batch;
+        size_t _batchIndex = 0;
+    };
+
+    // Worker threads serving the read-only API methods, each with its own read-only connection to the wallet DB.
+    // Every request is served within a DB snapshot, and its response is passed back to the reactor thread.
+    // The readers see the committed data only, hence the pending changes of the writer are committed before each read.
+    class ApiReaders
+    {
+    public:
+        using ReadFunc = std::function<io::SerializedMsg(IWalletDB& walletDB, ResponseSerializer& out)>;
+        using DoneFunc = std::function<void(io::SerializedMsg&& msg)>;
+
+        ApiReaders(io::Reactor& reactor, std::shared_ptr<WalletDB> writer);
+        ~ApiReaders();
+
+        bool start(const std::string& path, const SecString& password, uint32_t nThreads, Metrics::QueryProfile* profile);
+
+        // func is called in a worker thread, done - in the reactor thread
+        void push(int id, ReadFunc&& func, DoneFunc&& done);
+
+    private:
+        struct Task
+        {
+            int id;
+            ReadFunc func;
+            DoneFunc done;
+        };
+
+        void run(std::shared_ptr<WalletDB> walletDB, TX<std::function<void()>> tx);
+
+        std::shared_ptr<WalletDB> _writer;
+        RX<std::function<void()>> _rx;
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _newTask;
+        std::deque<Task> _tasks;
+        bool _stop = false;
+    };
+}
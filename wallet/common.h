@@ -395,6 +395,7 @@ namespace beam
             virtual bool get_tip(Block::SystemState::Full& state) const = 0;
             virtual void send_tx_params(const WalletID& peerID, SetTxParameter&&) = 0;
             virtual void UpdateOnNextTip(const TxID&) = 0;
+            virtual void UpdateOnHeight(const TxID&, Height) = 0; // once the tip reaches the given height
         };
 
         enum class ErrorType : uint8_t
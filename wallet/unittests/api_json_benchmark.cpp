@@ -0,0 +1,201 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wallet/api.h"
+#include "utility/io/json_serializer.h"
+#include "utility/logger.h"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+using namespace beam;
+using json = nlohmann::json;
+
+// Wallet API response serialization benchmark. Serializes get_utxo and tx_list responses of the given sizes
+// into 4K fragments, as the API server does:
+//  - dom: builds nlohmann::json and dumps it,
+//  - stream: writes the same json straight into the fragments by io::JsonWriter.
+// Both must give the same text.
+//
+// Usage: api_json_benchmark [items...]
+// Each result is printed as a single-line JSON object.
+
+namespace
+{
+    const size_t g_FragmentSize = 4096;
+    const size_t g_MinBytes = 64 * 1024 * 1024; // per measurement
+
+    struct Output
+    {
+        io::SerializedMsg m_Fragments;
+        io::FragmentWriter m_Writer;
+
+        Output()
+            : m_Writer(g_FragmentSize, 16, [this](io::SharedBuffer&& f) { m_Fragments.push_back(std::move(f)); })
+        {
+        }
+
+        size_t Finalize(string* pText)
+        {
+            m_Writer.finalize();
+
+            size_t nSize = 0;
+            for (const auto& f : m_Fragments)
+            {
+                nSize += f.size;
+                if (pText)
+                    pText->append(reinterpret_cast<const char*>(f.data), f.size);
+            }
+
+            m_Fragments.clear();
+            return nSize;
+        }
+    };
+
+    template <typename T>
+    size_t SerializeDom(const T& response, Output& out)
+    {
+        json msg;
+        WalletApi::getResponse(123, response, msg);
+        serialize_json(out.m_Writer, msg);
+        return out.Finalize(nullptr);
+    }
+
+    template <typename T>
+    size_t SerializeStream(const T& response, Output& out)
+    {
+        io::JsonWriter writer(out.m_Writer);
+        WalletApi::getResponse(123, response, writer);
+        return out.Finalize(nullptr);
+    }
+
+    // returns MB/s
+    template <typename Func>
+    double Measure(Func&& func)
+    {
+        Output out;
+        size_t nBytes = 0;
+
+        auto t0 = chrono::steady_clock::now();
+        do
+            nBytes += func(out);
+        while (nBytes < g_MinBytes);
+
+        uint64_t us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count();
+        if (!us)
+            us = 1;
+
+        return static_cast<double>(nBytes) / us;
+    }
+
+    template <typename T>
+    bool Run(const char* szBench, size_t nItems, const T& response)
+    {
+        string sDom, sStream;
+        {
+            Output out;
+            json msg;
+            WalletApi::getResponse(123, response, msg);
+            serialize_json(out.m_Writer, msg);
+            out.Finalize(&sDom);
+
+            io::JsonWriter writer(out.m_Writer);
+            WalletApi::getResponse(123, response, writer);
+            out.Finalize(&sStream);
+        }
+
+        double dom = Measure([&response](Output& out) { return SerializeDom(response, out); });
+        double stream = Measure([&response](Output& out) { return SerializeStream(response, out); });
+
+        bool bSame = (sDom == sStream);
+
+        cout << "{\"bench\":\"" << szBench << "\""
+            << ",\"items\":" << nItems
+            << ",\"bytes\":" << sStream.size()
+            << ",\"dom_mb_per_sec\":" << dom
+            << ",\"stream_mb_per_sec\":" << stream
+            << ",\"speedup\":" << stream / dom
+            << ",\"identical\":" << (bSame ? "true" : "false")
+            << "}" << endl;
+
+        return bSame;
+    }
+
+    GetUtxo::Response MakeUtxos(size_t nItems)
+    {
+        GetUtxo::Response res;
+        for (size_t i = 0; i < nItems; i++)
+        {
+            Coin& coin = res.utxos.emplace_back(Amount(100000 + i));
+            coin.m_ID.m_Idx = i;
+            coin.m_maturity = 100 + i;
+            coin.m_confirmHeight = 100 + i;
+            coin.m_status = Coin::Status::Available;
+            if (i & 1)
+                coin.m_createTxId = TxID{ {uint8_t(i), uint8_t(i >> 8), 1} };
+        }
+        return res;
+    }
+
+    TxList::Response MakeTxs(size_t nItems)
+    {
+        TxList::Response res;
+        for (size_t i = 0; i < nItems; i++)
+        {
+            Status::Response& item = res.resultList.emplace_back();
+            TxDescription& tx = item.tx;
+            tx.m_txId = TxID{ {uint8_t(i), uint8_t(i >> 8), 2} };
+            tx.m_amount = 100000 + i;
+            tx.m_fee = 100;
+            tx.m_sender = (i & 1) != 0;
+            tx.m_createTime = 1550000000 + i;
+            tx.m_status = TxStatus::Completed;
+            tx.m_kernelID = i;
+            tx.m_myId.m_Pk = i + 1;
+            tx.m_peerId.m_Pk = i + 2;
+
+            string sComment = "payment #" + to_string(i);
+            tx.m_message.assign(sComment.begin(), sComment.end());
+
+            item.kernelProofHeight = 1000 + i;
+            item.systemHeight = 2000 + i;
+        }
+        return res;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    auto logger = Logger::create(LOG_LEVEL_WARNING, LOG_LEVEL_WARNING);
+
+    vector<size_t> vItems;
+    for (int i = 1; i < argc; i++)
+        vItems.push_back(stoul(argv[i]));
+
+    if (vItems.empty())
+        vItems = { 100, 10000 };
+
+    int nRet = 0;
+
+    for (size_t nItems : vItems)
+    {
+        if (!Run("GetUtxo", nItems, MakeUtxos(nItems)))
+            nRet = 1;
+
+        if (!Run("TxList", nItems, MakeTxs(nItems)))
+            nRet = 1;
+    }
+
+    return nRet;
+}
@@ -0,0 +1,135 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wallet/wallet_db.h"
+#include "utility/logger.h"
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <chrono>
+#include <random>
+
+using namespace std;
+using namespace beam;
+
+// Coin selection benchmark. Fills a wallet with the given numbers of available coins (amounts are pseudo-random, fixed seed),
+// then measures WalletDB::selectCoins:
+//  - the first call, which builds the resident coin index (roughly what every call cost before the index),
+//  - payout-like amounts, much smaller than the typical coin,
+//  - an amount above any single coin, which needs a combination of many coins (the worst case).
+//
+// Usage: coin_selection_benchmark [coins...]
+// Each result is printed as a single-line JSON object.
+
+namespace
+{
+    const char* g_szDB = "coin_selection_benchmark.db";
+
+    const Amount g_MaxCoin = 100000000;
+    const Amount g_MaxPayout = 100000;
+    const uint32_t g_Selections = 100;
+
+    uint64_t get_us(chrono::steady_clock::time_point t0)
+    {
+        return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count();
+    }
+
+    void Report(const char* szBench, size_t nCoins, uint32_t nCalls, uint64_t us, size_t nSelected)
+    {
+        cout << "{\"bench\":\"" << szBench << "\""
+            << ",\"coins\":" << nCoins
+            << ",\"calls\":" << nCalls
+            << ",\"us_per_select\":" << (nCalls ? us / nCalls : 0)
+            << ",\"selected_coins\":" << nSelected
+            << "}" << endl;
+    }
+
+    IWalletDB::Ptr CreateDB(size_t nCoins)
+    {
+        if (boost::filesystem::exists(g_szDB))
+            boost::filesystem::remove(g_szDB);
+
+        ECC::NoLeak<ECC::uintBig> seed;
+        seed.V = Zero;
+        auto walletDB = WalletDB::init(g_szDB, string("pass123"), seed, io::Reactor::get_Current().shared_from_this());
+
+        Block::SystemState::ID id = {};
+        id.m_Height = 1000;
+        walletDB->setSystemStateID(id);
+
+        mt19937_64 rnd(nCoins);
+        uniform_int_distribution<Amount> dist(1, g_MaxCoin);
+
+        const size_t nBatch = 10000;
+        vector<Coin> coins;
+        coins.reserve(nBatch);
+
+        for (size_t i = 0; i < nCoins; )
+        {
+            coins.clear();
+            for (; (i < nCoins) && (coins.size() < nBatch); i++)
+            {
+                Coin& c = coins.emplace_back(dist(rnd));
+                c.m_maturity = 10;
+                c.m_confirmHeight = 10;
+            }
+
+            walletDB->store(coins);
+        }
+
+        return walletDB;
+    }
+
+    void Run(size_t nCoins)
+    {
+        auto walletDB = CreateDB(nCoins);
+
+        auto t0 = chrono::steady_clock::now();
+        size_t nSelected = walletDB->selectCoins(1).size();
+        Report("SelectCoinsFirst", nCoins, 1, get_us(t0), nSelected);
+
+        mt19937_64 rnd(0);
+        uniform_int_distribution<Amount> dist(1, g_MaxPayout);
+
+        nSelected = 0;
+        t0 = chrono::steady_clock::now();
+        for (uint32_t i = 0; i < g_Selections; i++)
+            nSelected += walletDB->selectCoins(dist(rnd)).size();
+        Report("SelectCoinsPayout", nCoins, g_Selections, get_us(t0), nSelected / g_Selections);
+
+        t0 = chrono::steady_clock::now();
+        nSelected = walletDB->selectCoins(g_MaxCoin * 3).size();
+        Report("SelectCoinsCombined", nCoins, 1, get_us(t0), nSelected);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    auto logger = Logger::create(LOG_LEVEL_WARNING, LOG_LEVEL_WARNING);
+
+    vector<size_t> vCoins;
+    for (int i = 1; i < argc; i++)
+        vCoins.push_back(stoul(argv[i]));
+
+    if (vCoins.empty())
+        vCoins = { 10000, 100000, 1000000 };
+
+    io::Reactor::Ptr reactor = io::Reactor::create();
+    io::Reactor::Scope scope(*reactor);
+
+    for (size_t nCoins : vCoins)
+        Run(nCoins);
+
+    boost::filesystem::remove(g_szDB);
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wallet/wallet_transaction.h"
+#include "utility/serialize.h"
+#include "core/serialization_adapters.h"
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+using namespace beam;
+
+// Output creation benchmark. Creates the outputs (commitments and range proofs) of a many-output transaction
+// with 1, 2, 4, ... threads up to the number of cores, as TxBuilder does for split_coins and bulk payouts.
+// All the thread counts must give the same commitments in the same order, and the same offset. The range proofs are
+// randomized by design, so instead each one must be recoverable to its coin.
+//
+// Usage: tx_outputs_benchmark [outputs] [max threads]
+// Each result is printed as a single-line JSON object.
+
+namespace
+{
+    const char* g_szDB = "tx_outputs_benchmark.db";
+
+    ByteBuffer Serialize(const vector<Output::Ptr>& vOutputs, const ECC::Scalar::Native& offset)
+    {
+        Serializer ser;
+        for (const auto& pOutput : vOutputs)
+            ser & pOutput->m_Commitment;
+        ser & ECC::Scalar(offset);
+
+        ByteBuffer res;
+        ser.swap_buf(res);
+        return res;
+    }
+
+    bool IsRecoverable(const vector<Output::Ptr>& vOutputs, const vector<Coin>& coins, Key::IPKdf& tagKdf)
+    {
+        for (size_t i = 0; i < vOutputs.size(); i++)
+        {
+            Key::IDV kidv;
+            if (!vOutputs[i]->Recover(tagKdf, kidv) || (kidv != coins[i].m_ID))
+                return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    auto logger = Logger::create(LOG_LEVEL_WARNING, LOG_LEVEL_WARNING);
+
+    size_t nOutputs = 64;
+    if (argc > 1)
+        nOutputs = stoul(argv[1]);
+
+    io::Reactor::Ptr reactor = io::Reactor::create();
+    io::Reactor::Scope scope(*reactor);
+
+    if (boost::filesystem::exists(g_szDB))
+        boost::filesystem::remove(g_szDB);
+
+    ECC::NoLeak<ECC::uintBig> seed;
+    seed.V = 1U;
+    auto walletDB = WalletDB::init(g_szDB, string("pass123"), seed, reactor);
+
+    vector<Coin> coins;
+    for (size_t i = 0; i < nOutputs; i++)
+    {
+        Coin& c = coins.emplace_back(100 + i);
+        c.m_ID.m_Idx = i;
+    }
+
+    uint32_t nCores = (argc > 2) ? static_cast<uint32_t>(stoul(argv[2])) : std::thread::hardware_concurrency();
+    if (!nCores)
+        nCores = 1;
+
+    vector<uint32_t> vThreads;
+    for (uint32_t n = 1; n < nCores; n <<= 1)
+        vThreads.push_back(n);
+    vThreads.push_back(nCores);
+
+    ByteBuffer bufRef;
+    uint64_t us1 = 0;
+    int nRet = 0;
+
+    for (uint32_t nThreads : vThreads)
+    {
+        vector<Output::Ptr> vOutputs;
+        ECC::Scalar::Native offset = Zero;
+
+        auto t0 = chrono::steady_clock::now();
+        wallet::CreateOutputs(vOutputs, offset, coins, *walletDB, nThreads);
+        uint64_t us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count();
+        if (!us)
+            us = 1;
+
+        ByteBuffer buf = Serialize(vOutputs, offset);
+        bool bSame = true;
+        if (bufRef.empty())
+        {
+            bufRef.swap(buf);
+            us1 = us;
+        }
+        else
+            bSame = (buf == bufRef);
+
+        bSame = bSame && IsRecoverable(vOutputs, coins, *walletDB->get_MasterKdf());
+
+        if (!bSame)
+            nRet = 1;
+
+        cout << "{\"bench\":\"CreateOutputs\""
+            << ",\"outputs\":" << nOutputs
+            << ",\"threads\":" << nThreads
+            << ",\"outputs_per_sec\":" << nOutputs * 1000000ULL / us
+            << ",\"speedup\":" << static_cast<double>(us1) / us
+            << ",\"deterministic\":" << (bSame ? "true" : "false")
+            << "}" << endl;
+    }
+
+    walletDB.reset();
+    boost::filesystem::remove(g_szDB);
+    return nRet;
+}
@@ -17,8 +17,12 @@
 #include "test_helpers.h"
 
 #include "wallet/api.h"
+#include "wallet/api_readers.h"
 #include "nlohmann/json.hpp"
 
+#include <boost/filesystem.hpp>
+#include <future>
+
 using namespace std;
 using namespace beam;
 using json = nlohmann::json;
@@ -54,6 +58,26 @@ namespace
         WALLET_CHECK(msg["method"].is_string());
     }
 
+    // the streaming serialization must give exactly the same text as json DOM,
+    // i.e. the writers put the members in the alphabetical order, as nlohmann's json object keeps them
+    template<typename T>
+    void testStreamedResponse(const T& response)
+    {
+        io::SerializedMsg fragments;
+        io::FragmentWriter fw(64, 1, [&fragments](io::SharedBuffer&& f) { fragments.push_back(std::move(f)); });
+        io::JsonWriter writer(fw);
+        WalletApi::getResponse(123, response, writer);
+        fw.finalize();
+
+        std::string streamed;
+        for (const auto& f : fragments)
+            streamed.append(reinterpret_cast<const char*>(f.data), f.size);
+
+        json res;
+        WalletApi::getResponse(123, response, res);
+        WALLET_CHECK(streamed == res.dump());
+    }
+
     void testResultHeader(const json& msg)
     {
         CHECK_JSON_FIELD(msg, "jsonrpc");
@@ -196,6 +220,10 @@ namespace
                 WALLET_CHECK(result[i]["type"] == "norm");
                 WALLET_CHECK(result[i]["maturity"] == 60);
             }
+
+            getUtxo.utxos[1].m_createTxId = TxID{ {1, 2, 3} };
+            getUtxo.utxos[2].m_spentTxId = TxID{ {4, 5, 6} };
+            testStreamedResponse(getUtxo);
         }
     }
 
@@ -380,6 +408,26 @@ namespace
             testResultHeader(res);
 
             WALLET_CHECK(res["id"] == 123);
+
+            for (auto status : { TxStatus::Completed, TxStatus::Failed, TxStatus::Cancelled, TxStatus::Registering })
+            {
+                Status::Response& item = txList.resultList.emplace_back();
+                item.tx.m_txId = TxID{ {uint8_t(status), 7} };
+                item.tx.m_status = status;
+                item.tx.m_amount = 1000 + uint8_t(status);
+                item.tx.m_fee = 10;
+                item.tx.m_sender = (status == TxStatus::Completed);
+                item.tx.m_createTime = 1500000000;
+                item.tx.m_kernelID = 5U;
+
+                std::string comment = "comment \"" + std::to_string(int(status)) + "\"\n";
+                item.tx.m_message.assign(comment.begin(), comment.end());
+
+                item.kernelProofHeight = (status == TxStatus::Completed) ? 10 : 0;
+                item.systemHeight = 15;
+            }
+
+            testStreamedResponse(txList);
         }
     }
 
@@ -411,6 +459,52 @@ namespace
         WALLET_CHECK(api.parse(msg.data(), msg.size()));
     }
 
+    void testBatchJsonRpc(const std::string& msg)
+    {
+        class WalletApiHandler : public WalletApiHandlerBase
+        {
+        public:
+            std::vector<std::string> calls;
+
+            void onBatchBegin(size_t count) override
+            {
+                WALLET_CHECK(count == 3);
+                calls.push_back("begin");
+            }
+
+            void onBatchEnd() override
+            {
+                calls.push_back("end");
+            }
+
+            void onInvalidJsonRpc(const json& msg) override
+            {
+                testErrorHeader(msg);
+                WALLET_CHECK(msg["id"] == 2);
+                WALLET_CHECK(msg["error"]["code"] == NOTFOUND_JSON_RPC);
+                calls.push_back("error");
+            }
+
+            void onMessage(int id, const Status& data) override
+            {
+                WALLET_CHECK(id == 1);
+                calls.push_back("tx_status");
+            }
+
+            void onMessage(int id, const WalletStatus& data) override
+            {
+                WALLET_CHECK(id == 3);
+                calls.push_back("wallet_status");
+            }
+        };
+
+        WalletApiHandler handler;
+        WalletApi api(handler);
+
+        WALLET_CHECK(api.parse(msg.data(), msg.size()));
+        WALLET_CHECK(handler.calls == std::vector<std::string>({ "begin", "tx_status", "error", "wallet_status", "end" }));
+    }
+
     void testValidateAddressJsonRpc(const std::string& msg, bool valid)
     {
         class WalletApiHandler : public WalletApiHandlerBase
@@ -455,6 +549,166 @@ namespace
             WALLET_CHECK(res["result"]["is_valid"] == valid);
         }
     }
+
+    const char* ReadersDBName = "api_readers.db";
+
+    std::shared_ptr<WalletDB> createReadersWalletDB()
+    {
+        if (boost::filesystem::exists(ReadersDBName))
+            boost::filesystem::remove(ReadersDBName);
+
+        ECC::NoLeak<ECC::uintBig> seed;
+        seed.V = Zero;
+        auto walletDB = WalletDB::init(ReadersDBName, string("pass123"), seed, io::Reactor::get_Current().shared_from_this());
+        return std::static_pointer_cast<WalletDB>(walletDB);
+    }
+
+    string toString(const io::SerializedMsg& msg)
+    {
+        string s;
+        for (const auto& f : msg)
+            s.append(reinterpret_cast<const char*>(f.data), f.size);
+        return s;
+    }
+
+    size_t countCoins(IWalletDB& walletDB)
+    {
+        size_t n = 0;
+        walletDB.visit([&n](const Coin&) { n++; return true; });
+        return n;
+    }
+
+    void testReadersReadAfterWrite()
+    {
+        cout << "\nApi readers, read after write\n";
+
+        io::Reactor::Ptr reactor = io::Reactor::create();
+        io::Reactor::Scope scope(*reactor);
+
+        auto walletDB = createReadersWalletDB();
+
+        {
+            ApiReaders readers(*reactor, walletDB);
+            WALLET_CHECK(!readers.start("no_such_wallet.db", string("pass123"), 1, nullptr));
+        }
+
+        ApiReaders readers(*reactor, walletDB);
+        WALLET_CHECK(readers.start(ReadersDBName, string("pass123"), 2, nullptr));
+
+        const int nCount = 10;
+        vector<json> sent;
+        ResponseQueue responses([&](io::SerializedMsg&& msg)
+        {
+            sent.push_back(json::parse(toString(msg)));
+            if (sent.size() == nCount)
+                reactor->stop();
+        });
+
+        // each read follows a write it must see, the slower reads must not reorder the responses
+        for (int i = 0; i < nCount; i++)
+        {
+            Coin coin(5);
+            walletDB->store(coin);
+
+            auto slot = responses.reserve();
+            readers.push(i, [i](IWalletDB& walletDB, ResponseSerializer& out)
+            {
+                if (!(i & 1))
+                    this_thread::sleep_for(chrono::milliseconds(20));
+
+                return out.write(json{ i, countCoins(walletDB) });
+            },
+            [&responses, slot](io::SerializedMsg&& msg) { responses.complete(slot, std::move(msg)); });
+        }
+
+        reactor->run();
+
+        WALLET_CHECK(sent.size() == nCount);
+        for (int i = 0; i < (int) sent.size(); i++)
+        {
+            WALLET_CHECK(sent[i][0] == i);
+            WALLET_CHECK(sent[i][1] >= i + 1);
+        }
+    }
+
+    void testReadersSnapshot()
+    {
+        cout << "\nApi readers, snapshot\n";
+
+        io::Reactor::Ptr reactor = io::Reactor::create();
+        io::Reactor::Scope scope(*reactor);
+
+        auto walletDB = createReadersWalletDB();
+        Coin coin(5);
+        walletDB->store(coin);
+
+        ApiReaders readers(*reactor, walletDB);
+        WALLET_CHECK(readers.start(ReadersDBName, string("pass123"), 1, nullptr));
+
+        std::promise<void> firstRead, written;
+        auto firstReadDone = firstRead.get_future();
+        auto writtenDone = written.get_future().share();
+
+        json res;
+        readers.push(1, [&firstRead, writtenDone](IWalletDB& walletDB, ResponseSerializer& out)
+        {
+            size_t n = countCoins(walletDB);
+            firstRead.set_value();
+            writtenDone.wait();
+            return out.write(json{ n, countCoins(walletDB) });
+        },
+        [&](io::SerializedMsg&& msg)
+        {
+            res = json::parse(toString(msg));
+            reactor->stop();
+        });
+
+        // the commit waits for the snapshot to end
+        firstReadDone.wait();
+        Coin coin2(7);
+        walletDB->store(coin2);
+        written.set_value();
+        walletDB->flushDB();
+
+        reactor->run();
+        WALLET_CHECK(res == json({ 1, 1 }));
+
+        readers.push(2, [](IWalletDB& walletDB, ResponseSerializer& out) { return out.write(json(countCoins(walletDB))); },
+            [&](io::SerializedMsg&& msg)
+            {
+                res = json::parse(toString(msg));
+                reactor->stop();
+            });
+
+        reactor->run();
+        WALLET_CHECK(res == 2);
+    }
+
+    void testResponseQueueBatch()
+    {
+        cout << "\nApi responses order with a batch\n";
+
+        vector<string> sent;
+        ResponseQueue responses([&sent](io::SerializedMsg&& msg) { sent.push_back(toString(msg)); });
+        ResponseSerializer serializer;
+
+        auto slot0 = responses.reserve();
+        responses.beginBatch(2);
+        auto slot1 = responses.reserve();
+        auto slot2 = responses.reserve();
+        responses.endBatch();
+        auto slot3 = responses.reserve();
+
+        responses.complete(slot3, serializer.write(json(3)));
+        responses.complete(slot2, serializer.write(json(2)));
+        WALLET_CHECK(sent.empty());
+
+        responses.complete(slot0, serializer.write(json(0)));
+        WALLET_CHECK(sent.size() == 1);
+
+        responses.complete(slot1, serializer.write(json(1)));
+        WALLET_CHECK(sent == vector<string>({ "0", "[1,2]", "3" }));
+    }
 }
 
 int main()
@@ -646,6 +900,37 @@ int main()
         }
     }), false);
 
+    testBatchJsonRpc(JSON_CODE(
+    [
+        {
+            "jsonrpc": "2.0",
+            "id" : 1,
+            "method" : "tx_status",
+            "params" :
+            {
+                "txId" : "10c4b760c842433cb58339a0fafef3db"
+            }
+        },
+        {
+            "jsonrpc": "2.0",
+            "id" : 2,
+            "method" : "balance123"
+        },
+        {
+            "jsonrpc": "2.0",
+            "id" : 3,
+            "method" : "wallet_status"
+        }
+    ]));
+
+    testInvalidJsonRpc([](const json& msg)
+    {
+        testErrorHeader(msg);
+
+        WALLET_CHECK(msg["id"] == nullptr);
+        WALLET_CHECK(msg["error"]["code"] == INVALID_JSON_RPC);
+    }, JSON_CODE([]));
+
     testValidateAddressJsonRpc(JSON_CODE(
     {
         "jsonrpc": "2.0",
@@ -657,5 +942,9 @@ int main()
         }
     }), true);
 
+    testReadersReadAfterWrite();
+    testReadersSnapshot();
+    testResponseQueueBatch();
+
     return WALLET_CHECK_RESULT;
 }
@@ -18,8 +18,12 @@
 #include "utility/test_helpers.h"
 
 #include "utility/logger.h"
+#include "utility/metrics.h"
+#include "sqlite/sqlite3.h"
 #include <boost/filesystem.hpp>
 #include <numeric>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 using namespace ECC;
@@ -1075,6 +1079,47 @@ void TestSelect5()
     SelectCoins(db, 45'678'910);
 }
 
+void TestSelect7()
+{
+    cout << "\nWallet database coin selection 7 test\n";
+    auto db = createSqliteWalletDB();
+
+    Coin c1 = CreateAvailCoin(10);
+    Coin c2 = CreateAvailCoin(20);
+    db->store(c1);
+    db->store(c2);
+
+    // the first selection loads the coin index, the following ones must see the changes
+    auto coins = db->selectCoins(15);
+    WALLET_CHECK(coins.size() == 1 && coins[0].m_ID.m_Value == 20);
+
+    c2.m_spentHeight = 20;
+    db->save(c2);
+    WALLET_CHECK(db->selectCoins(15).empty());
+
+    Coin c3 = CreateAvailCoin(30);
+    db->store(c3);
+    coins = db->selectCoins(15);
+    WALLET_CHECK(coins.size() == 1 && coins[0].m_ID.m_Value == 30);
+
+    TxID txID = { {7} };
+    wallet::setTxParameter(*db, txID, wallet::TxParameterID::Status, TxStatus::InProgress, false);
+    c3.m_spentTxId = txID;
+    db->save(c3);
+    WALLET_CHECK(db->selectCoins(15).empty());
+
+    db->rollbackTx(txID);
+    coins = db->selectCoins(15);
+    WALLET_CHECK(coins.size() == 1 && coins[0].m_ID.m_Value == 30 && !coins[0].m_spentTxId);
+
+    db->remove(c3.m_ID);
+    WALLET_CHECK(db->selectCoins(15).empty());
+    WALLET_CHECK(db->selectCoins(5).size() == 1);
+
+    db->rollbackConfirmedUtxo(5);
+    WALLET_CHECK(db->selectCoins(5).empty());
+}
+
 void TestSelect6()
 {
     cout << "\nWallet database coin selection 6 test\n";
@@ -1304,6 +1349,331 @@ void TestWalletMessages()
     }
 }
 
+
+void TestPagedListing()
+{
+    cout << "\nWallet database paged listing test\n";
+    auto db = createSqliteWalletDB();
+
+    // 1, 4, 7... spent at 20, 2, 5, 8... unconfirmed, 3, 6, 9... available
+    for (Amount i = 1; i <= 30; ++i)
+    {
+        Coin c;
+        switch (i % 3)
+        {
+        case 1: c = CreateCoin(i, 5, 5, 20); break;
+        case 2: c = CreateCoin(i); break;
+        default: c = CreateAvailCoin(i);
+        }
+        db->store(c);
+    }
+
+    auto amounts = [](const vector<Coin>& coins)
+    {
+        vector<Amount> res;
+        for (const auto& c : coins)
+            res.push_back(c.m_ID.m_Value);
+        return res;
+    };
+
+    CoinFilter all;
+    WALLET_CHECK(db->getCoins(all, {}, 0, 0).size() == 30);
+    WALLET_CHECK(amounts(db->getCoins(all, {}, 28, 5)) == vector<Amount>({ 29, 30 }));
+
+    CoinFilter avail;
+    avail.m_status = Coin::Available;
+    auto page = db->getCoins(avail, {}, 0, 4);
+    WALLET_CHECK(amounts(page) == vector<Amount>({ 3, 6, 9, 12 }));
+    WALLET_CHECK(amounts(db->getCoins(avail, page.back().m_ID, 0, 4)) == vector<Amount>({ 15, 18, 21, 24 }));
+    WALLET_CHECK(amounts(db->getCoins(avail, {}, 2, 2)) == vector<Amount>({ 9, 12 }));
+
+    CoinFilter spent;
+    spent.m_status = Coin::Spent;
+    WALLET_CHECK(db->getCoins(spent, {}, 0, 0).size() == 10);
+    WALLET_CHECK(amounts(db->getCoins(spent, {}, 8, 0)) == vector<Amount>({ 25, 28 }));
+
+    CoinFilter unconfirmed;
+    unconfirmed.m_status = Coin::Unavailable;
+    WALLET_CHECK(amounts(db->getCoins(unconfirmed, {}, 1, 3)) == vector<Amount>({ 5, 8, 11 }));
+
+    CoinFilter byAmount;
+    byAmount.m_minAmount = 10;
+    byAmount.m_maxAmount = 20;
+    WALLET_CHECK(db->getCoins(byAmount, {}, 0, 0).size() == 11);
+
+    CoinFilter byHeight;
+    byHeight.m_minHeight = byHeight.m_maxHeight = 5;
+    WALLET_CHECK(db->getCoins(byHeight, {}, 0, 0).size() == 10);
+
+    // the cursor coin doesn't have to match the filter
+    WALLET_CHECK(amounts(db->getCoins(avail, page.front().m_ID, 0, 1)) == vector<Amount>({ 6 }));
+    WALLET_CHECK(amounts(db->getCoins(spent, page.front().m_ID, 0, 1)) == vector<Amount>({ 4 }));
+
+    // txs
+    for (uint8_t i = 0; i < 10; ++i)
+    {
+        TxDescription tx;
+        tx.m_txId = {{ i, 1 }};
+        tx.m_amount = 100 * i;
+        tx.m_createTime = 1000 + i;
+        tx.m_status = (i & 1) ? TxStatus::Completed : TxStatus::Failed;
+        db->saveTx(tx);
+
+        if (i & 1)
+            wallet::setTxParameter(*db, tx.m_txId, TxParameterID::KernelProofHeight, Height(100 + i), false);
+    }
+
+    auto createTimes = [](const vector<TxDescription>& txs)
+    {
+        vector<Timestamp> res;
+        for (const auto& tx : txs)
+            res.push_back(tx.m_createTime);
+        return res;
+    };
+
+    TxFilter allTxs;
+    WALLET_CHECK(createTimes(db->getTxHistory(allTxs, {}, 0, 3)) == vector<Timestamp>({ 1009, 1008, 1007 }));
+    WALLET_CHECK(db->getTxHistory(allTxs, {}, 0, 0).size() == 10);
+
+    TxFilter completed;
+    completed.m_status = TxStatus::Completed;
+    auto txPage = db->getTxHistory(completed, {}, 0, 2);
+    WALLET_CHECK(createTimes(txPage) == vector<Timestamp>({ 1009, 1007 }));
+    WALLET_CHECK(createTimes(db->getTxHistory(completed, txPage.back().m_txId, 0, 5)) == vector<Timestamp>({ 1005, 1003, 1001 }));
+    WALLET_CHECK(createTimes(db->getTxHistory(completed, {}, 1, 1)) == vector<Timestamp>({ 1007 }));
+
+    TxFilter byTxHeight;
+    byTxHeight.m_minHeight = 103;
+    byTxHeight.m_maxHeight = 105;
+    WALLET_CHECK(createTimes(db->getTxHistory(byTxHeight, {}, 0, 0)) == vector<Timestamp>({ 1005, 1003 }));
+
+    TxFilter byTxAmount;
+    byTxAmount.m_minAmount = 200;
+    byTxAmount.m_maxAmount = 400;
+    WALLET_CHECK(createTimes(db->getTxHistory(byTxAmount, {}, 0, 0)) == vector<Timestamp>({ 1004, 1003, 1002 }));
+}
+
+void TestKeyCache()
+{
+    cout << "\nWallet database key cache test\n";
+    auto db = createSqliteWalletDB();
+    Key::IKdf::Ptr pMaster = db->get_MasterKdf();
+
+    // plain, child, BB2.1 (derived by the master)
+    vector<Coin::ID> ids;
+    for (Key::Index iSubIdx : { 0U, 7U, (2U << 24) | 7U })
+    {
+        for (uint64_t i = 1; i <= 20; ++i)
+        {
+            Coin c(i * 100);
+            c.m_ID.m_Idx = i;
+            c.m_ID.m_SubIdx = iSubIdx;
+            ids.push_back(c.m_ID);
+        }
+    }
+
+    // reference values, derived without the cache
+    vector<Point> expected;
+    for (const auto& cid : ids)
+    {
+        Key::IKdf::Ptr pKdf = pMaster;
+        if (cid.m_SubIdx && (2 != (cid.m_SubIdx >> 24)))
+            HKdf::CreateChild(pKdf, *pMaster, cid.m_SubIdx);
+
+        Scalar::Native sk;
+        Point comm;
+        SwitchCommitment().Create(sk, comm, *pKdf, cid);
+        expected.push_back(comm);
+    }
+
+    WALLET_CHECK(db->get_ChildKdf(7) == db->get_ChildKdf(7));
+    WALLET_CHECK(db->get_ChildKdf(0) == pMaster);
+    WALLET_CHECK(db->get_ChildKdf((2U << 24) | 7U) == pMaster);
+
+    // concurrent lookups, half of them hit the entries made by the others
+    std::atomic<uint32_t> nMismatch(0);
+    auto fnThread = [&]()
+    {
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (size_t i = 0; i < ids.size(); ++i)
+            {
+                Point comm;
+                db->get_Commitment(comm, ids[i]);
+                if (comm != expected[i])
+                    nMismatch++;
+
+                Scalar::Native sk;
+                db->calcCommitment(sk, comm, ids[i]);
+                if (comm != expected[i])
+                    nMismatch++;
+            }
+        }
+    };
+
+    vector<std::thread> vThreads;
+    for (int i = 0; i < 4; ++i)
+        vThreads.emplace_back(fnThread);
+    for (auto& t : vThreads)
+        t.join();
+
+    WALLET_CHECK(nMismatch == 0);
+
+    // the coins are found by the commitments calculated above
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        Coin::ID cid;
+        WALLET_CHECK(db->get_CoinID(expected[i], cid) && (cid == ids[i]));
+    }
+
+    Point comm;
+    Coin::ID cid(200, 100500, Key::Type::Regular);
+    Scalar::Native sk;
+    db->calcCommitment(sk, comm, cid);
+    WALLET_CHECK(!db->get_CoinID(comm, cid)); // not calculated by get_Commitment
+}
+
+void TestProfile()
+{
+    cout << "\nWallet database profile test\n";
+    auto db = createSqliteWalletDB();
+    auto& walletDB = static_cast<WalletDB&>(*db);
+
+    Metrics::QueryProfile prof("wallet");
+    walletDB.setProfile(&prof);
+
+    Coin coin = CreateAvailCoin(5);
+    db->store(coin);
+    db->getTxHistory();
+
+    std::string s;
+    prof.Dump(s);
+    WALLET_CHECK(s.find("INSERT INTO storage") != string::npos);
+    WALLET_CHECK(s.find("FROM tx_summary") != string::npos);
+
+    walletDB.setProfile(nullptr);
+    prof.Reset();
+    db->getTxHistory();
+    prof.Dump(s);
+    WALLET_CHECK(s.find("FROM tx_summary") == string::npos);
+
+    // the read-only connection reports to the same profile
+    auto ro = WalletDB::openReadOnly("wallet.db", string("pass123"));
+    WALLET_CHECK(ro);
+    ro->setProfile(&prof);
+
+    ro->beginSnapshot();
+    auto coins = ro->getCoinsCreatedByTx(TxID());
+    ro->endSnapshot();
+    WALLET_CHECK(coins.empty());
+
+    prof.Dump(s);
+    WALLET_CHECK(s.find("FROM storage") != string::npos);
+    ro->setProfile(nullptr);
+}
+
+void TestMigrateTxSummary()
+{
+    cout << "\nWallet database tx summary migration test\n";
+
+    vector<TxDescription> txs;
+    for (uint8_t i = 1; i <= 3; ++i)
+    {
+        TxDescription tx;
+        tx.m_txId = {{ i, 14 }};
+        tx.m_amount = i * 100;
+        tx.m_fee = i;
+        tx.m_change = 7;
+        tx.m_minHeight = 134;
+        tx.m_peerId.m_Pk = unsigned(20 + i);
+        tx.m_peerId.m_Channel = 0U;
+        tx.m_myId.m_Pk = unsigned(40 + i);
+        tx.m_myId.m_Channel = 0U;
+        tx.m_message = toByteBuffer(string("msg"));
+        tx.m_createTime = 1000 + i;
+        tx.m_modifyTime = 2000 + i;
+        tx.m_sender = (i != 2);
+        tx.m_status = (i == 1) ? TxStatus::Completed : TxStatus::InProgress;
+        txs.push_back(tx);
+    }
+
+    TxID txIncomplete = {{ 9, 14 }}; // some parameters, but not the mandatory ones
+
+    {
+        auto db = createSqliteWalletDB();
+        for (const auto& tx : txs)
+            db->saveTx(tx);
+
+        wallet::setTxParameter(*db, txs[0].m_txId, TxParameterID::KernelProofHeight, Height(150), false);
+        wallet::setTxParameter(*db, txs[0].m_txId, TxParameterID::TransactionType, TxType::Simple, false);
+        wallet::setTxParameter(*db, txIncomplete, TxParameterID::Amount, Amount(5), false);
+        wallet::setTxParameter(*db, txIncomplete, TxParameterID::CreateTime, Timestamp(3000), false);
+
+        wallet::setVar(*db, "Version", 14);
+    }
+
+    {
+        // v14 had no summary table
+        sqlite3* pDb = nullptr;
+        WALLET_CHECK(SQLITE_OK == sqlite3_open_v2("wallet.db", &pDb, SQLITE_OPEN_READWRITE, nullptr));
+        string pass("pass123");
+        WALLET_CHECK(SQLITE_OK == sqlite3_key(pDb, pass.data(), static_cast<int>(pass.size())));
+        WALLET_CHECK(SQLITE_OK == sqlite3_exec(pDb, "DROP TABLE tx_summary;", nullptr, nullptr, nullptr));
+        sqlite3_close(pDb);
+    }
+
+    auto db = WalletDB::open("wallet.db", string("pass123"), io::Reactor::get_Current().shared_from_this());
+    WALLET_CHECK(db);
+    if (!db)
+        return;
+
+    int version = 0;
+    WALLET_CHECK(wallet::getVar(*db, "Version", version) && (version == 15));
+
+    auto checkTx = [](const TxDescription& a, const TxDescription& b)
+    {
+        WALLET_CHECK(a.m_txId == b.m_txId);
+        WALLET_CHECK(a.m_amount == b.m_amount);
+        WALLET_CHECK(a.m_fee == b.m_fee);
+        WALLET_CHECK(a.m_change == b.m_change);
+        WALLET_CHECK(a.m_minHeight == b.m_minHeight);
+        WALLET_CHECK(a.m_peerId == b.m_peerId);
+        WALLET_CHECK(a.m_myId == b.m_myId);
+        WALLET_CHECK(a.m_message == b.m_message);
+        WALLET_CHECK(a.m_createTime == b.m_createTime);
+        WALLET_CHECK(a.m_modifyTime == b.m_modifyTime);
+        WALLET_CHECK(a.m_sender == b.m_sender);
+        WALLET_CHECK(a.m_status == b.m_status);
+    };
+
+    for (const auto& tx : txs)
+    {
+        auto res = db->getTx(tx.m_txId);
+        WALLET_CHECK(res.is_initialized());
+        if (res)
+            checkTx(*res, tx);
+    }
+
+    WALLET_CHECK(!db->getTx(txIncomplete).is_initialized());
+
+    // the newest first, the incomplete one is skipped
+    auto history = db->getTxHistory();
+    WALLET_CHECK(history.size() == txs.size());
+    for (size_t i = 0; i < history.size() && i < txs.size(); ++i)
+        checkTx(history[i], txs[txs.size() - 1 - i]);
+
+    // the kernel proof height is taken from the txparams too
+    TxFilter byHeight;
+    byHeight.m_minHeight = 150;
+    history = db->getTxHistory(byHeight, {}, 0, 10);
+    WALLET_CHECK(history.size() == 1);
+    WALLET_CHECK(!history.empty() && history[0].m_txId == txs[0].m_txId);
+
+    // and the params that aren't a part of the summary are intact
+    TxType txType = TxType::AtomicSwap;
+    WALLET_CHECK(wallet::getTxParameter(*db, txs[0].m_txId, TxParameterID::TransactionType, txType) && (txType == TxType::Simple));
+}
+
 }
 
 int main() 
@@ -1330,10 +1700,15 @@ int main()
     TestSelect4();
     TestSelect5();
     TestSelect6();
+    TestSelect7();
     TestAddresses();
     TestTxParameters();
     TestTransferredByTx();
     TestWalletMessages();
+    TestPagedListing();
+    TestKeyCache();
+    TestProfile();
+    TestMigrateTxSummary();
 
 
     return WALLET_CHECK_RESULT;
@@ -19,6 +19,7 @@
 #include "wallet/common.h"
 #include "wallet/wallet_network.h"
 #include "wallet/wallet.h"
+#include "wallet/wallet_hub.h"
 #include "wallet/secstring.h"
 #include "utility/test_helpers.h"
 #include "../../core/radixtree.h"
@@ -108,6 +109,7 @@ namespace
         void remove(const std::vector<beam::Coin::ID>&) override {}
         void remove(const beam::Coin::ID&) override {}
         void visit(std::function<bool(const beam::Coin& coin)> ) override {}
+        std::vector<beam::Coin> getCoins(const CoinFilter&, const boost::optional<beam::Coin::ID>&, size_t, size_t) override { return {}; }
         void setVarRaw(const char* , const void* , size_t ) override {}
         bool getVarRaw(const char* , void* , int) const override { return false; }
         bool getBlob(const char* name, ByteBuffer& var) const override { return false; }
@@ -119,6 +121,7 @@ namespace
         void unsubscribe(IWalletDbObserver* observer) override {}
 
         std::vector<TxDescription> getTxHistory(uint64_t , int ) override { return {}; };
+        std::vector<TxDescription> getTxHistory(const TxFilter&, const boost::optional<TxID>&, size_t, size_t) override { return {}; };
         boost::optional<TxDescription> getTx(const TxID& ) override { return boost::optional<TxDescription>{}; };
         void saveTx(const TxDescription& p) override
         {
@@ -823,6 +826,219 @@ namespace
         WALLET_CHECK(count == 2);
     }
 
+    // Holds the transactions until they're mined explicitly, reports the utxo events of the owner wallet
+    struct TestOwnedNodeNetwork
+        :public TestNodeNetwork
+    {
+        struct Shared
+            :public TestNodeNetwork::Shared
+        {
+            IWalletDB::Ptr m_pOwnerDB;
+            std::vector<Transaction::Ptr> m_vPending;
+            std::vector<proto::UtxoEvent> m_vEvents;
+
+            void MineBlock()
+            {
+                std::vector<Coin::ID> vOwned;
+                for (const auto& pTx : m_vPending)
+                {
+                    proto::NewTransaction msg;
+                    msg.m_Transaction = pTx;
+                    m_Blockchain.HandleTx(msg);
+
+                    for (const auto& pOutp : pTx->m_vOutputs)
+                    {
+                        m_pOwnerDB->visit([&](const Coin& coin)
+                        {
+                            ECC::Point comm;
+                            m_pOwnerDB->get_Commitment(comm, coin.m_ID);
+                            if (comm == pOutp->m_Commitment)
+                                vOwned.push_back(coin.m_ID);
+                            return true;
+                        });
+                    }
+                }
+                m_vPending.clear();
+
+                AddBlock();
+
+                for (const auto& cid : vOwned)
+                {
+                    m_vEvents.emplace_back();
+                    proto::UtxoEvent& evt = m_vEvents.back();
+                    evt.m_Kidv = cid;
+                    m_pOwnerDB->get_Commitment(evt.m_Commitment, cid);
+                    evt.m_AssetID = Zero;
+                    evt.m_Height = evt.m_Maturity = m_Blockchain.m_mcm.m_vStates.back().m_Hdr.m_Height;
+                    evt.m_Added = 1;
+                }
+            }
+        };
+
+        Shared& m_OwnedShared;
+        uint32_t m_KernelRequests = 0;
+
+        TestOwnedNodeNetwork(Shared& shared, proto::FlyClient& x)
+            :TestNodeNetwork(shared, x)
+            ,m_OwnedShared(shared)
+        {
+        }
+
+        void PostProcess(Request& r) override
+        {
+            switch (r.get_Type())
+            {
+            case Request::Type::Transaction:
+                {
+                    proto::FlyClient::RequestTransaction& v = static_cast<proto::FlyClient::RequestTransaction&>(r);
+                    v.m_Res.m_Value = true;
+                    m_OwnedShared.m_vPending.push_back(v.m_Msg.m_Transaction);
+                }
+                break;
+
+            case Request::Type::UtxoEvents:
+                {
+                    proto::FlyClient::RequestUtxoEvents& v = static_cast<proto::FlyClient::RequestUtxoEvents&>(r);
+                    for (const auto& evt : m_OwnedShared.m_vEvents)
+                        if (evt.m_Height >= v.m_Msg.m_HeightMin)
+                            v.m_Res.m_Events.push_back(evt);
+                }
+                break;
+
+            case Request::Type::Kernel:
+                m_KernelRequests++;
+                TestNodeNetwork::PostProcess(r);
+                break;
+
+            default:
+                TestNodeNetwork::PostProcess(r);
+            }
+        }
+    };
+
+    void TestTxUpdateOnUtxoEvents()
+    {
+        cout << "\nTesting tx updates on the owned node utxo events...\n";
+
+        enum struct Mode { OutputEvent, Expiration, NodeOffline };
+
+        for (Mode mode : { Mode::OutputEvent, Mode::Expiration, Mode::NodeOffline })
+        {
+            io::Reactor::Ptr mainReactor{ io::Reactor::create() };
+            io::Reactor::Scope scope(*mainReactor);
+
+            IWalletDB::Ptr senderWalletDB = createSenderWalletDB(1, 10); // the change output is reported by the owned node
+            IWalletDB::Ptr receiverWalletDB = createReceiverWalletDB();
+
+            WalletAddress wa = wallet::createAddress(*receiverWalletDB);
+            receiverWalletDB->saveAddress(wa);
+            WalletID receiver_id = wa.m_walletID;
+
+            wa = wallet::createAddress(*senderWalletDB);
+            senderWalletDB->saveAddress(wa);
+            WalletID sender_id = wa.m_walletID;
+
+            int count = 0;
+            auto f = [&count](const auto& /*id*/) { count++; };
+
+            TestOwnedNodeNetwork::Shared tnns;
+            tnns.m_pOwnerDB = senderWalletDB;
+
+            Wallet sender(senderWalletDB, f);
+            Wallet receiver(receiverWalletDB, f);
+
+            auto twn = make_shared<TestWalletNetwork>();
+            auto netNodeS = make_shared<TestOwnedNodeNetwork>(tnns, sender);
+            auto netNodeR = make_shared<TestOwnedNodeNetwork>(tnns, receiver);
+
+            sender.AddMessageEndpoint(twn);
+            sender.SetNodeEndpoint(netNodeS);
+
+            receiver.AddMessageEndpoint(twn);
+            receiver.SetNodeEndpoint(netNodeR);
+
+            twn->m_Map[sender_id].m_pSink = &sender;
+            twn->m_Map[receiver_id].m_pSink = &receiver;
+
+            tnns.AddBlock();
+            static_cast<proto::FlyClient&>(sender).OnOwnedNode(PeerID(), true);
+
+            Height hLifetime = (Mode::Expiration == mode) ? 3 : 50;
+            TxID txID = sender.transfer_money(sender_id, receiver_id, 4, 1, true, hLifetime, 200);
+
+            // all the requests are served asynchronously, the timer lets them settle between the blocks
+            uint32_t nStep = 0, nBlocks = 0, nKrnRegistered = 0;
+            io::Timer::Ptr timer = io::Timer::create(*mainReactor);
+            timer->start(100, true, [&]()
+            {
+                if ((count == 2) || (++nStep > 100))
+                {
+                    mainReactor->stop();
+                    return;
+                }
+
+                if (!nKrnRegistered)
+                {
+                    // wait for the registration and the 1st kernel request
+                    if (!tnns.m_vPending.empty() && netNodeS->m_KernelRequests)
+                        nKrnRegistered = netNodeS->m_KernelRequests;
+                    return;
+                }
+
+                switch (mode)
+                {
+                case Mode::OutputEvent:
+                    if (nBlocks < 3)
+                        WALLET_CHECK(netNodeS->m_KernelRequests == nKrnRegistered); // no polling on empty blocks
+                    if (nBlocks++ == 3)
+                        tnns.MineBlock();
+                    else
+                        tnns.AddBlock();
+                    break;
+
+                case Mode::Expiration:
+                    tnns.AddBlock();
+                    break;
+
+                case Mode::NodeOffline:
+                    if (nBlocks == 1)
+                    {
+                        WALLET_CHECK(netNodeS->m_KernelRequests == nKrnRegistered);
+                        static_cast<proto::FlyClient&>(sender).OnOwnedNode(PeerID(), false);
+                    }
+                    if (nBlocks > 1)
+                        WALLET_CHECK(netNodeS->m_KernelRequests == nKrnRegistered + nBlocks - 1); // polled on each tip
+                    if (nBlocks++ == 3)
+                        tnns.MineBlock();
+                    else
+                        tnns.AddBlock();
+                    break;
+                }
+            });
+
+            mainReactor->run();
+
+            WALLET_CHECK(count == 2);
+
+            auto tx = senderWalletDB->getTx(txID);
+            WALLET_CHECK(tx);
+            if (Mode::Expiration == mode)
+            {
+                WALLET_CHECK(tx->m_status == TxStatus::Failed);
+                WALLET_CHECK(tx->m_failureReason == TxFailureReason::TransactionExpired);
+                // woken at the expiration height instead of polling on each block
+                WALLET_CHECK(netNodeS->m_KernelRequests <= nKrnRegistered + 2);
+                WALLET_CHECK(nStep > hLifetime);
+            }
+            else
+            {
+                WALLET_CHECK(tx->m_status == TxStatus::Completed);
+                if (Mode::OutputEvent == mode)
+                    WALLET_CHECK(netNodeS->m_KernelRequests == nKrnRegistered + 1);
+            }
+        }
+    }
+
     class TestNode
     {
     public:
@@ -856,6 +1072,23 @@ namespace
                     c.SendTip();
             }
         }
+
+        void SendBbs(const proto::BbsMsg& msg)
+        {
+            for (ClientList::iterator it = m_lstClients.begin(); m_lstClients.end() != it; it++)
+            {
+                Client& c = *it;
+                if (c.m_Subscribed)
+                    c.Send(msg);
+            }
+        }
+
+        // the owned node reports the utxo events to the clients of this key
+        Key::IPKdf::Ptr m_pOwnerKdf;
+        std::vector<proto::UtxoEvent> m_vEvents;
+
+        std::vector<Height> m_vUtxoEventsRequests;
+        std::vector<proto::BbsSubscribe> m_vBbsSubscribes;
     private:
 
         struct Client
@@ -864,6 +1097,7 @@ namespace
         {
             TestNode& m_This;
             bool m_Subscribed;
+            bool m_Owner = false;
 
             Client(TestNode& n)
                 : m_This(n)
@@ -924,6 +1158,31 @@ namespace
             {
             }
 
+            void OnMsg(proto::Authentication&& msg) override
+            {
+                proto::NodeConnection::OnMsg(std::move(msg));
+
+                Key::IPKdf* pOwner = m_This.m_pOwnerKdf.get();
+                if ((proto::IDType::Owner == msg.m_IDType) && pOwner && IsKdfObscured(*pOwner, msg.m_ID))
+                {
+                    m_Owner = true;
+                    ProvePKdfObscured(*pOwner, proto::IDType::Viewer);
+                }
+            }
+
+            void OnMsg(proto::GetUtxoEvents&& msg) override
+            {
+                m_This.m_vUtxoEventsRequests.push_back(msg.m_HeightMin);
+
+                proto::UtxoEvents msgOut;
+                if (m_Owner)
+                    for (const auto& evt : m_This.m_vEvents)
+                        if (evt.m_Height >= msg.m_HeightMin)
+                            msgOut.m_Events.push_back(evt);
+
+                Send(msgOut);
+            }
+
             void OnMsg(proto::GetProofState&&) override
             {
                 Send(proto::ProofState{});
@@ -941,6 +1200,8 @@ namespace
 
             void OnMsg(proto::BbsSubscribe&& msg) override
             {
+                m_This.m_vBbsSubscribes.push_back(msg);
+
                 if (m_Subscribed)
                     return;
                 m_Subscribed = true;
@@ -1014,6 +1275,218 @@ namespace
         } m_Server;
     };
 
+    struct TestBbsReceiver
+        : public proto::FlyClient::IBbsReceiver
+    {
+        std::vector<proto::BbsMsg> m_vMsgs;
+
+        void OnMsg(proto::BbsMsg&& msg) override
+        {
+            m_vMsgs.push_back(std::move(msg));
+        }
+    };
+
+    void TestWalletHub()
+    {
+        cout << "\nTesting wallet hub...\n";
+
+        // the small rollback window keeps the older states out of the shared history
+        uint32_t nMaxRollbackPrev = Rules::get().Macroblock.MaxRollback;
+        Rules::get().Macroblock.MaxRollback = 10;
+        Rules::get().UpdateChecksum();
+
+        {
+            io::Reactor::Ptr mainReactor{ io::Reactor::create() };
+            io::Reactor::Scope scope(*mainReactor);
+
+            TestNode node;
+            const Block::SystemState::Full& sTip = node.m_Blockchain.m_mcm.m_vStates.back().m_Hdr;
+
+            const string dir = "hub_wallets";
+            boost::filesystem::remove_all(dir);
+            boost::filesystem::create_directory(dir);
+
+            auto createWallet = [&](const string& name, uint32_t nSeed)
+            {
+                ECC::NoLeak<ECC::uintBig> seed;
+                seed.V = nSeed;
+                return WalletDB::init(dir + "/" + name + ".db", DBPassword, seed, mainReactor);
+            };
+
+            // the wallet was last synced at the given state, with a single coin
+            auto createSyncedWallet = [&](const string& name, Height hCoin, const Block::SystemState::ID& id)
+            {
+                auto walletDB = createWallet(name, 7);
+                Coin coin = CreateAvailCoin(5, hCoin);
+                walletDB->store(coin);
+                walletDB->setSystemStateID(id);
+            };
+
+            auto getConfirmHeight = [](const IWalletDB::Ptr& walletDB)
+            {
+                Height h = 0;
+                walletDB->visit([&h](const Coin& c)
+                {
+                    h = c.m_confirmHeight;
+                    return true;
+                });
+                return h;
+            };
+
+            Block::SystemState::ID idOld, idTip, idForked;
+            node.m_Blockchain.m_mcm.m_vStates[49].m_Hdr.get_ID(idOld);
+            WALLET_CHECK(idOld.m_Height == 50);
+            sTip.get_ID(idTip);
+            idForked = idTip;
+            idForked.m_Hash = Zero;
+
+            // the owned node reports a coin of the owner key
+            Key::IDV kidv(100, 777, Key::Type::Regular);
+            proto::UtxoEvent evt;
+            evt.m_Kidv = kidv;
+            evt.m_AssetID = Zero;
+            evt.m_Height = evt.m_Maturity = sTip.m_Height - 5;
+            evt.m_Added = 1;
+            {
+                auto ownerDB = createWallet("owner", 0);
+                ownerDB->get_Commitment(evt.m_Commitment, kidv);
+                node.m_pOwnerKdf = ownerDB->get_MasterKdf();
+                node.m_vEvents.push_back(evt);
+            }
+
+            createWallet("second", 0);
+            createSyncedWallet("other", 60, idOld);
+            createSyncedWallet("stale", 60, idOld);
+            createSyncedWallet("forked", 140, idForked);
+            createSyncedWallet("synced", 140, idTip);
+
+            WalletHub::Config cfg;
+            cfg.m_Dir = dir;
+            cfg.m_Owner = "owner";
+            cfg.m_IdleTimeout_s = 1;
+
+            WalletHub hub(cfg, SecString(DBPassword), mainReactor);
+
+            io::Timer::Ptr timer = io::Timer::create(*mainReactor);
+            auto runUntil = [&](const std::function<bool()>& pred)
+            {
+                uint32_t nStep = 0;
+                timer->start(100, true, [&]()
+                {
+                    if (pred() || (++nStep > 100))
+                        mainReactor->stop();
+                });
+                mainReactor->run();
+                timer->cancel();
+                return pred();
+            };
+
+            // the wallets are loaded on demand
+            WALLET_CHECK(hub.get_LoadedCount() == 1);
+            auto pOwner = hub.GetWallet("owner");
+            auto pSecond = hub.GetWallet("second");
+            auto pOther = hub.GetWallet("other");
+            WALLET_CHECK(pOwner && pOwner->m_Owned);
+            WALLET_CHECK(pSecond && pSecond->m_Owned);
+            WALLET_CHECK(pOther && !pOther->m_Owned);
+            WALLET_CHECK(hub.GetWallet("second") == pSecond);
+            WALLET_CHECK(!hub.GetWallet("missing"));
+            WALLET_CHECK(!hub.GetWallet("../other"));
+            WALLET_CHECK(hub.get_LoadedCount() == 3);
+
+            hub.get_Network().m_Cfg.m_vNodes.push_back(io::Address::localhost().port(32125));
+            hub.get_Network().Connect();
+
+            auto hasEventCoin = [&](const WalletHub::HostedWallet::Ptr& p)
+            {
+                Coin c;
+                c.m_ID = kidv;
+                return p->m_WalletDB->find(c) && (c.m_confirmHeight == evt.m_Height);
+            };
+
+            // the owned wallets share the events requests
+            WALLET_CHECK(runUntil([&]() { return hasEventCoin(pOwner) && hasEventCoin(pSecond); }));
+            WALLET_CHECK(!hasEventCoin(pOther));
+            WALLET_CHECK(!node.m_vUtxoEventsRequests.empty());
+            std::set<Height> setHeights(node.m_vUtxoEventsRequests.begin(), node.m_vUtxoEventsRequests.end());
+            WALLET_CHECK(setHeights.size() == node.m_vUtxoEventsRequests.size());
+
+            // loaded before the first tip, verified once it's known. Its state is out of the shared history, hence reverted
+            WALLET_CHECK(getConfirmHeight(pOther->m_WalletDB) == MaxHeight);
+
+            auto pStale = hub.GetWallet("stale");
+            auto pForked = hub.GetWallet("forked");
+            auto pSynced = hub.GetWallet("synced");
+            WALLET_CHECK(pStale && pForked && pSynced);
+            WALLET_CHECK(getConfirmHeight(pStale->m_WalletDB) == MaxHeight);
+            WALLET_CHECK(getConfirmHeight(pForked->m_WalletDB) == MaxHeight);
+            WALLET_CHECK(getConfirmHeight(pSynced->m_WalletDB) == 140);
+
+            // single node subscription per channel, the messages are dispatched to all the subscribers
+            const BbsChannel ch = 5000;
+            auto getSubscribes = [&]()
+            {
+                std::vector<proto::BbsSubscribe> v;
+                for (const auto& msg : node.m_vBbsSubscribes)
+                    if (msg.m_Channel == ch)
+                        v.push_back(msg);
+                return v;
+            };
+
+            TestBbsReceiver r1, r2;
+            auto pEndpoint1 = hub.CreateEndpoint();
+            auto pEndpoint2 = hub.CreateEndpoint();
+
+            pEndpoint1->BbsSubscribe(ch, 200, &r1);
+            WALLET_CHECK(runUntil([&]() { return getSubscribes().size() == 1; }));
+            WALLET_CHECK(getSubscribes()[0].m_On && (getSubscribes()[0].m_TimeFrom == 200));
+
+            // the newcomer needs older messages, the hub resubscribes from its time
+            pEndpoint2->BbsSubscribe(ch, 100, &r2);
+            WALLET_CHECK(runUntil([&]() { return getSubscribes().size() == 3; }));
+            if (getSubscribes().size() == 3)
+            {
+                WALLET_CHECK(!getSubscribes()[1].m_On);
+                WALLET_CHECK(getSubscribes()[2].m_On && (getSubscribes()[2].m_TimeFrom == 100));
+            }
+
+            proto::BbsMsg msg;
+            msg.m_Channel = ch;
+            msg.m_TimePosted = 300;
+            msg.m_Message.assign(3, 'x');
+            msg.m_Nonce = Zero;
+
+            node.SendBbs(msg);
+            WALLET_CHECK(runUntil([&]() { return (r1.m_vMsgs.size() == 1) && (r2.m_vMsgs.size() == 1); }));
+
+            pEndpoint2.reset(); // the rest are still subscribed
+            node.SendBbs(msg);
+            WALLET_CHECK(runUntil([&]() { return r1.m_vMsgs.size() == 2; }));
+            WALLET_CHECK(r2.m_vMsgs.size() == 1);
+            WALLET_CHECK(getSubscribes().size() == 3);
+
+            pEndpoint1.reset();
+            WALLET_CHECK(runUntil([&]() { return getSubscribes().size() == 4; }));
+            WALLET_CHECK(!getSubscribes().back().m_On);
+
+            // not referenced and idle - unloaded, except the owner
+            pOwner.reset();
+            pSecond.reset();
+            pOther.reset();
+            pStale.reset();
+            pForked.reset();
+            pSynced.reset();
+            WALLET_CHECK(runUntil([&]() { return hub.get_LoadedCount() == 1; }));
+
+            auto p = hub.GetWallet("second");
+            WALLET_CHECK(p && hasEventCoin(p));
+            WALLET_CHECK(hub.get_LoadedCount() == 2);
+        }
+
+        Rules::get().Macroblock.MaxRollback = nMaxRollbackPrev;
+        Rules::get().UpdateChecksum();
+    }
+
     void TestTxToHimself()
     {
         cout << "\nTesting Tx to himself...\n";
@@ -1691,6 +2164,7 @@ namespace
             bool get_tip(Block::SystemState::Full& state) const override { return false; }
             void send_tx_params(const WalletID& peerID, wallet::SetTxParameter&&) override {}
             void UpdateOnNextTip(const TxID&) override {};
+            void UpdateOnHeight(const TxID&, Height) override {};
         } gateway;
         TestWalletRig sender("sender", createSenderWalletDB());
         TestWalletRig receiver("receiver", createReceiverWalletDB());
@@ -2074,11 +2548,13 @@ int main()
         TestWalletNegotiation(createSenderWalletDB(), createReceiverWalletDB());
     }
 
+    TestTxUpdateOnUtxoEvents();
     TestSplitTransaction();
 
     //TestSwapTransaction();
 
     TestTxToHimself();
+    TestWalletHub();
 
     //TestExpiredTransaction();
 
@@ -47,6 +47,14 @@ namespace beam
             }
             return true;
         }
+
+        // The stored coin and its utxo event may disagree on the key scheme (see the BB2.1 detection), hence it's not a part of the key
+        Coin::ID get_UtxoKey(const Coin::ID& cid)
+        {
+            Coin::ID ret = cid;
+            ret.m_SubIdx &= (1U << 24) - 1;
+            return ret;
+        }
     }
 
     int WalletID::cmp(const WalletID& x) const
@@ -120,11 +128,26 @@ namespace beam
         {
             assert(m_OwnedNodesOnline);
             if (!--m_OwnedNodesOnline)
+            {
                 AbortUtxoEvents();
+
+                // no more utxo events, back to polling
+                while (!m_UtxoTransactionsToUpdate.empty())
+                {
+                    auto it = m_UtxoTransactionsToUpdate.begin();
+                    UpdateOnNextTip(it->second);
+                    EraseUtxoUpdate(it);
+                }
+            }
         }
     }
 
     Block::SystemState::IHistory& Wallet::get_History()
+    {
+        return get_HeaderHistory();
+    }
+
+    Block::SystemState::IHistory& Wallet::get_HeaderHistory() const
     {
         return m_WalletDB->get_History();
     }
@@ -302,10 +325,17 @@ namespace beam
 
     void Wallet::ResumeAllTransactions()
     {
-        auto txs = m_WalletDB->getTxHistory();
-        for (auto& tx : txs)
+        // only the active ones, by the status index
+        for (TxStatus s : { TxStatus::Pending, TxStatus::InProgress, TxStatus::Registering })
         {
-            ResumeTransaction(tx);
+            TxFilter filter;
+            filter.m_status = s;
+
+            auto txs = m_WalletDB->getTxHistory(filter, {}, 0, 0);
+            for (auto& tx : txs)
+            {
+                ResumeTransaction(tx);
+            }
         }
     }
 
@@ -343,6 +373,8 @@ namespace beam
 			pGuard.swap(it->second);
             m_Transactions.erase(it);
         }
+
+        ForgetTransactionUpdates(txID);
  
         if (m_TxCompletedAction)
         {
@@ -417,7 +449,7 @@ namespace beam
 
     bool Wallet::get_tip(Block::SystemState::Full& state) const
     {
-        return m_WalletDB->get_History().get_Tip(state);
+        return get_HeaderHistory().get_Tip(state);
     }
 
     void Wallet::send_tx_params(const WalletID& peerID, SetTxParameter&& msg)
@@ -437,6 +469,76 @@ namespace beam
         }
     }
 
+    void Wallet::UpdateOnHeight(const TxID& txID, Height h)
+    {
+        if (m_Transactions.find(txID) != m_Transactions.end())
+        {
+            ScheduleOnHeight(txID, h);
+        }
+    }
+
+    void Wallet::ScheduleOnHeight(const TxID& txID, Height h)
+    {
+        // a single entry per tx, the earliest one
+        TxUpdates& x = m_TxUpdates[txID];
+        if (x.m_bHeight)
+        {
+            if (x.m_itHeight->first <= h)
+                return;
+
+            m_HeightTransactionsToUpdate.erase(x.m_itHeight);
+        }
+
+        x.m_itHeight = m_HeightTransactionsToUpdate.emplace(h, txID);
+        x.m_bHeight = true;
+    }
+
+    void Wallet::ScheduleOnUtxo(const TxID& txID, const Coin::ID& key)
+    {
+        auto it = m_UtxoTransactionsToUpdate.find(key);
+        if (m_UtxoTransactionsToUpdate.end() != it)
+        {
+            if (it->second == txID)
+                return;
+
+            EraseUtxoUpdate(it); // the latest tx takes over the output
+        }
+
+        it = m_UtxoTransactionsToUpdate.emplace(key, txID).first;
+        m_TxUpdates[txID].m_vUtxos.push_back(it);
+    }
+
+    void Wallet::EraseHeightUpdate(HeightUpdates::iterator it)
+    {
+        auto itIdx = m_TxUpdates.find(it->second);
+        assert(m_TxUpdates.end() != itIdx);
+
+        TxUpdates& x = itIdx->second;
+        assert(x.m_bHeight && (x.m_itHeight == it));
+        x.m_bHeight = false;
+
+        if (x.m_vUtxos.empty())
+            m_TxUpdates.erase(itIdx);
+
+        m_HeightTransactionsToUpdate.erase(it);
+    }
+
+    void Wallet::EraseUtxoUpdate(UtxoUpdates::iterator it)
+    {
+        auto itIdx = m_TxUpdates.find(it->second);
+        assert(m_TxUpdates.end() != itIdx);
+
+        TxUpdates& x = itIdx->second;
+        auto itPos = std::find(x.m_vUtxos.begin(), x.m_vUtxos.end(), it); // few outputs per tx
+        assert(x.m_vUtxos.end() != itPos);
+        x.m_vUtxos.erase(itPos);
+
+        if (x.m_vUtxos.empty() && !x.m_bHeight)
+            m_TxUpdates.erase(itIdx);
+
+        m_UtxoTransactionsToUpdate.erase(it);
+    }
+
     void Wallet::OnWalletMessage(const WalletID& myID, wallet::SetTxParameter&& msg)
     {
         auto t = getTransaction(myID, msg);
@@ -535,6 +637,48 @@ namespace beam
         m_NextTipTransactionToUpdate.insert(tx);
     }
 
+    bool Wallet::UpdateOnOutputs(wallet::BaseTransaction::Ptr tx, Height hTip)
+    {
+        // The kernel gets into the same block as the tx outputs. If the owned node reports our utxo events - there's no need to ask for the kernel
+        // on each new tip: wake up on the first confirmed output, or when it's time to check the expiration.
+        if (!m_OwnedNodesOnline)
+            return false;
+
+        const TxID& txID = tx->GetTxID();
+        auto coins = m_WalletDB->getCoinsCreatedByTx(txID);
+        if (coins.empty())
+            return false;
+
+        for (const auto& coin : coins)
+            if (coin.m_confirmHeight != MaxHeight)
+                return false; // already confirmed, the event won't come
+
+        for (const auto& coin : coins)
+            ScheduleOnUtxo(txID, get_UtxoKey(coin.m_ID));
+
+        Height hMax;
+        if (tx->GetParameter(TxParameterID::MaxHeight, hMax))
+            ScheduleOnHeight(txID, std::max(hMax, hTip + 1));
+
+        return true;
+    }
+
+    void Wallet::ForgetTransactionUpdates(const TxID& txID)
+    {
+        auto itIdx = m_TxUpdates.find(txID);
+        if (m_TxUpdates.end() == itIdx)
+            return;
+
+        TxUpdates& x = itIdx->second;
+        if (x.m_bHeight)
+            m_HeightTransactionsToUpdate.erase(x.m_itHeight);
+
+        for (const auto& it : x.m_vUtxos)
+            m_UtxoTransactionsToUpdate.erase(it);
+
+        m_TxUpdates.erase(itIdx);
+    }
+
     void Wallet::OnRequestComplete(MyRequestUtxo& r)
     {
         if (r.m_Res.m_Proofs.empty())
@@ -561,7 +705,7 @@ namespace beam
         auto tx = it->second;
         if (!r.m_Res.m_Proof.empty())
         {
-            m_WalletDB->get_History().AddStates(&r.m_Res.m_Proof.m_State, 1); // why not?
+            get_History().AddStates(&r.m_Res.m_Proof.m_State, 1); // why not?
 
             if (tx->SetParameter(TxParameterID::KernelProofHeight, r.m_Res.m_Proof.m_State.m_Height))
             {
@@ -574,7 +718,8 @@ namespace beam
             Block::SystemState::Full sTip;
             get_tip(sTip);
             tx->SetParameter(TxParameterID::KernelUnconfirmedHeight, sTip.m_Height);
-            UpdateOnNextTip(tx);
+            if (!UpdateOnOutputs(tx, sTip.m_Height))
+                UpdateOnNextTip(tx);
         }
     }
 
@@ -589,7 +734,7 @@ namespace beam
             return;
 
         Block::SystemState::Full sTip;
-        m_WalletDB->get_History().get_Tip(sTip);
+        get_History().get_Tip(sTip);
 
         Height h = GetUtxoEventsHeightNext();
         assert(h <= sTip.m_Height + 1);
@@ -621,10 +766,18 @@ namespace beam
 		{
 			proto::UtxoEvent& evt = v[i];
 
+			// the coins the wallet has just polled, or reported before, are known by the commitment
+			Coin::ID cid;
+			if (m_WalletDB->get_CoinID(evt.m_Commitment, cid))
+			{
+				evt.m_Kidv = cid;
+				ProcessUtxoEvent(evt);
+				continue;
+			}
+
 			// filter-out false positives
-			Scalar::Native sk;
 			Point comm;
-			m_WalletDB->calcCommitment(sk, comm, evt.m_Kidv);
+			m_WalletDB->get_Commitment(comm, evt.m_Kidv);
 
 			if (comm == evt.m_Commitment)
 				ProcessUtxoEvent(evt);
@@ -636,7 +789,7 @@ namespace beam
 					// Is it BB2.1?
 					evt.m_Kidv.m_SubIdx |= (2U << 24);
 
-					m_WalletDB->calcCommitment(sk, comm, evt.m_Kidv);
+					m_WalletDB->get_Commitment(comm, evt.m_Kidv);
 
 					if (comm == evt.m_Commitment)
 						ProcessUtxoEvent(evt);
@@ -647,7 +800,7 @@ namespace beam
 		if (r.m_Res.m_Events.size() < proto::UtxoEvent::s_Max)
 		{
 			Block::SystemState::Full sTip;
-			m_WalletDB->get_History().get_Tip(sTip);
+			get_History().get_Tip(sTip);
 
 			SetUtxoEventsHeight(sTip.m_Height);
 		}
@@ -678,6 +831,19 @@ namespace beam
 
     void Wallet::ProcessUtxoEvent(const proto::UtxoEvent& evt)
     {
+        if (evt.m_Added)
+        {
+            auto it = m_UtxoTransactionsToUpdate.find(get_UtxoKey(evt.m_Kidv));
+            if (m_UtxoTransactionsToUpdate.end() != it)
+            {
+                auto itTx = m_Transactions.find(it->second);
+                if (m_Transactions.end() != itTx)
+                    UpdateOnSynced(itTx->second);
+
+                EraseUtxoUpdate(it);
+            }
+        }
+
         Coin c;
         c.m_ID = evt.m_Kidv;
 
@@ -702,15 +868,20 @@ namespace beam
     void Wallet::OnRolledBack()
     {
         Block::SystemState::Full sTip;
-        m_WalletDB->get_History().get_Tip(sTip);
+        get_History().get_Tip(sTip);
 
         Block::SystemState::ID id;
         sTip.get_ID(id);
         LOG_INFO() << "Rolled back to " << id;
 
-        m_WalletDB->get_History().DeleteFrom(sTip.m_Height + 1);
+        get_History().DeleteFrom(sTip.m_Height + 1);
+
+        RollbackTo(sTip.m_Height);
+    }
 
-        m_WalletDB->rollbackConfirmedUtxo(sTip.m_Height);
+    void Wallet::RollbackTo(Height h)
+    {
+        m_WalletDB->rollbackConfirmedUtxo(h);
 
         ResumeAllTransactions();
 
@@ -718,18 +889,22 @@ namespace beam
         {
             const auto& pTx = it->second;
 
-            Height h;
-            if (pTx->GetParameter(TxParameterID::KernelProofHeight, h) && (h > sTip.m_Height))
+            Height hProof;
+            if (pTx->GetParameter(TxParameterID::KernelProofHeight, hProof) && (hProof > h))
             {
-                h = 0;
-                pTx->SetParameter(TxParameterID::KernelProofHeight, h);
+                hProof = 0;
+                pTx->SetParameter(TxParameterID::KernelProofHeight, hProof);
                 UpdateOnSynced(pTx);
             }
         }
 
-        Height h = GetUtxoEventsHeightNext();
-        if (h > sTip.m_Height + 1)
-            SetUtxoEventsHeight(sTip.m_Height);
+        if (GetUtxoEventsHeightNext() > h + 1)
+            SetUtxoEventsHeight(h);
+    }
+
+    bool Wallet::IsIdle() const
+    {
+        return m_Transactions.empty() && !SyncRemains() && !m_AsyncUpdateCounter;
     }
 
     void Wallet::OnNewTip()
@@ -753,6 +928,19 @@ namespace beam
         }
         m_NextTipTransactionToUpdate.clear();
 
+        while (!m_HeightTransactionsToUpdate.empty())
+        {
+            auto it = m_HeightTransactionsToUpdate.begin();
+            if (it->first > sTip.m_Height)
+                break;
+
+            auto itTx = m_Transactions.find(it->second);
+            if (m_Transactions.end() != itTx)
+                UpdateOnSynced(itTx->second);
+
+            EraseHeightUpdate(it);
+        }
+
         CheckSyncDone();
 
         ProcessStoredMessages();
@@ -772,8 +960,7 @@ namespace beam
         MyRequestUtxo::Ptr pReq(new MyRequestUtxo);
         pReq->m_CoinID = cid;
 
-		Scalar::Native sk;
-		m_WalletDB->calcCommitment(sk, pReq->m_Msg.m_Utxo, cid);
+		m_WalletDB->get_Commitment(pReq->m_Msg.m_Utxo, cid);
 
         LOG_DEBUG() << "Get utxo proof: " << pReq->m_Msg.m_Utxo;
 
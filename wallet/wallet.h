@@ -84,6 +84,12 @@ namespace beam
         TxID swap_coins(const WalletID& from, const WalletID& to, Amount amount, Amount fee, wallet::AtomicSwapCoin swapCoin, Amount swapAmount);
         void Refresh();
 
+        // Forgets everything confirmed above the given height, for the case the wallet missed the rollback
+        void RollbackTo(Height);
+
+        // No transactions in progress and nothing to sync, the wallet may be unloaded
+        bool IsIdle() const;
+
         // IWallet
         void subscribe(IWalletObserver* observer) override;
         void unsubscribe(IWalletObserver* observer) override;
@@ -105,6 +111,7 @@ namespace beam
         void send_tx_params(const WalletID& peerID, wallet::SetTxParameter&&) override;
         void register_tx(const TxID& txId, Transaction::Ptr) override;
         void UpdateOnNextTip(const TxID&) override;
+        void UpdateOnHeight(const TxID&, Height) override;
 
         void OnWalletMessage(const WalletID& peerID, wallet::SetTxParameter&&) override;
 
@@ -116,6 +123,11 @@ namespace beam
         Block::SystemState::IHistory& get_History() override;
         void OnOwnedNode(const PeerID&, bool bUp) override;
 
+    protected:
+        // the header history the wallet works with, the one in its db unless overridden
+        virtual Block::SystemState::IHistory& get_HeaderHistory() const;
+
+    private:
         struct RequestHandler
             : public proto::FlyClient::Request::IHandler
         {
@@ -131,6 +143,10 @@ namespace beam
         void updateTransaction(const TxID& txID);
         void UpdateOnSynced(wallet::BaseTransaction::Ptr tx);
         void UpdateOnNextTip(wallet::BaseTransaction::Ptr tx);
+        bool UpdateOnOutputs(wallet::BaseTransaction::Ptr tx, Height hTip);
+        void ScheduleOnHeight(const TxID& txID, Height h);
+        void ScheduleOnUtxo(const TxID& txID, const Coin::ID& key);
+        void ForgetTransactionUpdates(const TxID& txID);
         void saveKnownState();
         void RequestUtxoEvents();
         void AbortUtxoEvents();
@@ -217,6 +233,24 @@ namespace beam
         std::map<TxID, wallet::BaseTransaction::Ptr> m_Transactions;
         std::unordered_set<wallet::BaseTransaction::Ptr> m_TransactionsToUpdate;
         std::unordered_set<wallet::BaseTransaction::Ptr> m_NextTipTransactionToUpdate;
+        typedef std::multimap<Height, TxID> HeightUpdates;
+        typedef std::map<Coin::ID, TxID> UtxoUpdates;
+
+        HeightUpdates m_HeightTransactionsToUpdate;
+        UtxoUpdates m_UtxoTransactionsToUpdate; // by the ID without the key scheme, see get_UtxoKey()
+
+        // reverse index of the above, so that the tx updates are rescheduled and forgotten without a scan
+        struct TxUpdates
+        {
+            HeightUpdates::iterator m_itHeight; // valid if m_bHeight
+            bool m_bHeight = false;
+            std::vector<UtxoUpdates::iterator> m_vUtxos;
+        };
+
+        std::map<TxID, TxUpdates> m_TxUpdates;
+
+        void EraseHeightUpdate(HeightUpdates::iterator);
+        void EraseUtxoUpdate(UtxoUpdates::iterator);
         TxCompletedAction m_TxCompletedAction;
         UpdateCompletedAction m_UpdateCompleted;
         uint32_t m_LastSyncTotal;
@@ -17,6 +17,7 @@
 #include "wallet_transaction.h"
 #include "utility/logger.h"
 #include "utility/helpers.h"
+#include "utility/metrics.h"
 #include "sqlite/sqlite3.h"
 #include <sstream>
 #include <boost/functional/hash.hpp>
@@ -64,6 +65,7 @@
 #define VARIABLES_NAME "variables"
 #define ADDRESSES_NAME "addresses"
 #define TX_PARAMS_NAME "txparams"
+#define TX_SUMMARY_NAME "tx_summary"
 #define PRIVATE_VARIABLES_NAME "PrivateVariables"
 #define WALLET_MESSAGE_NAME "WalletMessages"
 #define INCOMING_WALLET_MESSAGE_NAME "IncomingWalletMessages"
@@ -91,6 +93,49 @@
 
 #define TX_PARAMS_FIELDS ENUM_TX_PARAMS_FIELDS(LIST, COMMA, )
 
+// Denormalized copy of the tx parameters that make up TxDescription, maintained by setTxParameter()
+#define ENUM_TX_SUMMARY_FIELDS(each, sep, obj) \
+    each(txID,           txId,           BLOB NOT NULL PRIMARY KEY, obj) sep \
+    each(amount,         amount,         INTEGER NOT NULL, obj) sep \
+    each(fee,            fee,            INTEGER NOT NULL, obj) sep \
+    each(change,         change,         INTEGER NOT NULL, obj) sep \
+    each(minHeight,      minHeight,      INTEGER NOT NULL, obj) sep \
+    each(peerID,         peerId,         BLOB NOT NULL, obj) sep \
+    each(myID,           myId,           BLOB NOT NULL, obj) sep \
+    each(message,        message,        BLOB, obj) sep \
+    each(createTime,     createTime,     INTEGER NOT NULL, obj) sep \
+    each(modifyTime,     modifyTime,     INTEGER NOT NULL, obj) sep \
+    each(sender,         sender,         INTEGER NOT NULL, obj) sep \
+    each(selfTx,         selfTx,         INTEGER NOT NULL, obj) sep \
+    each(status,         status,         INTEGER NOT NULL, obj) sep \
+    each(kernelID,       kernelID,       BLOB NOT NULL, obj) sep \
+    each(failureReason,  failureReason,  INTEGER NOT NULL, obj)
+
+#define TX_SUMMARY_FIELDS ENUM_TX_SUMMARY_FIELDS(LIST, COMMA, )
+
+// Not a part of TxDescription: the kernel proof height (for filtering), and the mask of the mandatory parameters set so far
+#define TX_SUMMARY_EXTRA_FIELDS "kernelProofHeight INTEGER NOT NULL DEFAULT 0, paramMask INTEGER NOT NULL DEFAULT 0"
+
+// tx parameter, summary column, value type, mandatory parameter bit
+#define ENUM_TX_SUMMARY_PARAMS(each) \
+    each(Amount,             amount,             Amount,          1) \
+    each(Fee,                fee,                Amount,          2) \
+    each(PeerID,             peerID,             WalletID,        4) \
+    each(MyID,               myID,               WalletID,        8) \
+    each(CreateTime,         createTime,         Timestamp,       16) \
+    each(IsSender,           sender,             bool,            32) \
+    each(MinHeight,          minHeight,          Height,          0) \
+    each(Message,            message,            ByteBuffer,      0) \
+    each(Change,             change,             Amount,          0) \
+    each(ModifyTime,         modifyTime,         Timestamp,       0) \
+    each(Status,             status,             TxStatus,        0) \
+    each(KernelID,           kernelID,           Merkle::Hash,    0) \
+    each(FailureReason,      failureReason,      TxFailureReason, 0) \
+    each(IsSelfTx,           selfTx,             bool,            0) \
+    each(KernelProofHeight,  kernelProofHeight,  Height,          0)
+
+#define TX_SUMMARY_MANDATORY 63 // Amount, Fee, PeerID, MyID, CreateTime, IsSender
+
 #define ENUM_WALLET_MESSAGE_FIELDS(each, sep, obj) \
     each(ID,  ID,  INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, obj) sep \
     each(PeerID, PeerID,   BLOB, obj) sep \
@@ -576,7 +621,7 @@ namespace beam
         };
 
         template<typename T>
-        void deserialize(T& value, ByteBuffer& blob)
+        void deserialize(T& value, const ByteBuffer& blob)
         {
             if (!blob.empty())
             {
@@ -590,7 +635,7 @@ namespace beam
             }
         }
 
-        void deserialize(ByteBuffer& value, ByteBuffer& blob)
+        void deserialize(ByteBuffer& value, const ByteBuffer& blob)
         {
             value = blob;
         }
@@ -604,6 +649,7 @@ namespace beam
                 : _walletDB(nullptr)
                 , _db(privateDB ? db->m_PrivateDB : db->_db)
                 , _stm(nullptr)
+                , _profile(db->m_Profile)
             {
                 int ret = sqlite3_prepare_v2(_db, sql, -1, &_stm, nullptr);
                 throwIfError(ret, _db);
@@ -613,6 +659,7 @@ namespace beam
                 : _walletDB(db)
                 , _db(privateDB ? db->m_PrivateDB : db->_db)
                 , _stm(nullptr)
+                , _profile(db->m_Profile)
             {
                 int ret = sqlite3_prepare_v2(_db, sql, -1, &_stm, nullptr);
                 throwIfError(ret, _db);
@@ -727,7 +774,17 @@ namespace beam
             bool step()
             {
                 int n = _walletDB ? sqlite3_total_changes(_db) : 0;
-                int ret = sqlite3_step(_stm);
+                int ret;
+                if (_profile)
+                {
+                    auto t0 = std::chrono::steady_clock::now();
+                    ret = sqlite3_step(_stm);
+                    _profile->OnStep(_stm, Metrics::Histogram::get_ElapsedNs(t0), ret == SQLITE_ROW);
+                }
+                else
+                {
+                    ret = sqlite3_step(_stm);
+                }
                 if (_walletDB && sqlite3_total_changes(_db) != n)
                 {
                     _walletDB->onModified();
@@ -762,6 +819,11 @@ namespace beam
                 status = static_cast<TxStatus>(sqlite3_column_int(_stm, col));
             }
 
+            void get(int col, TxFailureReason& reason)
+            {
+                reason = static_cast<TxFailureReason>(sqlite3_column_int(_stm, col));
+            }
+
             void get(int col, bool& val)
             {
                 val = sqlite3_column_int(_stm, col) == 0 ? false : true;
@@ -856,6 +918,7 @@ namespace beam
             WalletDB* _walletDB;
             sqlite3 * _db;
             sqlite3_stmt* _stm;
+            Metrics::QueryProfile* _profile;
         };
 
         struct Transaction
@@ -909,7 +972,8 @@ namespace beam
         const char* SystemStateIDName = "SystemStateID";
         const char* LastUpdateTimeName = "LastUpdateTime";
         const int BusyTimeoutMs = 5000;
-        const int DbVersion = 14;
+        const int DbVersion = 15;
+        const int DbVersion14 = 14;
         const int DbVersion13 = 13;
         const int DbVersion12 = 12;
         const int DbVersion11 = 11;
@@ -1028,7 +1092,8 @@ namespace beam
         {
             const char* req = "CREATE TABLE " STORAGE_NAME " (" ENUM_ALL_STORAGE_FIELDS(LIST_WITH_TYPES, COMMA, ) ");"
                 "CREATE UNIQUE INDEX CoinIndex ON " STORAGE_NAME "(" ENUM_STORAGE_ID(LIST, COMMA, )  ");"
-                "CREATE INDEX ConfirmIndex ON " STORAGE_NAME"(confirmHeight);";
+                "CREATE INDEX ConfirmIndex ON " STORAGE_NAME"(confirmHeight);"
+                "CREATE INDEX SpentIndex ON " STORAGE_NAME"(spentHeight);";
             int ret = sqlite3_exec(db, req, nullptr, nullptr, nullptr);
             throwIfError(ret, db);
         }
@@ -1047,6 +1112,15 @@ namespace beam
             }
         }
 
+        void CreateTxSummaryTable(sqlite3* db)
+        {
+            const char* req = "CREATE TABLE " TX_SUMMARY_NAME " (" ENUM_TX_SUMMARY_FIELDS(LIST_WITH_TYPES, COMMA, ) ", " TX_SUMMARY_EXTRA_FIELDS ") WITHOUT ROWID;"
+                "CREATE INDEX TxSummaryTimeIndex ON " TX_SUMMARY_NAME "(createTime DESC, txID);"
+                "CREATE INDEX TxSummaryStatusIndex ON " TX_SUMMARY_NAME "(status, createTime DESC, txID);";
+            int ret = sqlite3_exec(db, req, nullptr, nullptr, nullptr);
+            throwIfError(ret, db);
+        }
+
         void CreatePrivateVariablesTable(sqlite3* db)
         {
             const char* req = "CREATE TABLE " PRIVATE_VARIABLES_NAME " (" ENUM_VARIABLES_FIELDS(LIST_WITH_TYPES, COMMA, ) ");";
@@ -1099,6 +1173,8 @@ namespace beam
                 throwIfError(ret, walletDB->_db);
             }
 
+            CreateTxSummaryTable(walletDB->_db);
+
             {
                 const char* req = "CREATE TABLE [" TblStates "] ("
                     "[" TblStates_Height    "] INTEGER NOT NULL PRIMARY KEY,"
@@ -1243,7 +1319,25 @@ namespace beam
 
                             walletDB->setPrivateVarRaw(WalletSeed, &seed.V, sizeof(seed.V));
                         }
-                        
+                        // no break;
+
+                    case DbVersion14:
+                        {
+                            LOG_INFO() << "Building the transaction summary";
+
+                            CreateTxSummaryTable(walletDB->_db);
+
+                            sqlite::Statement stm(walletDB.get(), "SELECT " TX_PARAMS_FIELDS " FROM " TX_PARAMS_NAME ";");
+                            while (stm.step())
+                            {
+                                TxParameter parameter = {};
+                                int colIdx = 0;
+                                ENUM_TX_PARAMS_FIELDS(STM_GET_LIST, NOSEP, parameter);
+
+                                walletDB->updateTxSummary(parameter.m_txID, static_cast<wallet::TxParameterID>(parameter.m_paramID), parameter.m_value);
+                            }
+                        }
+
                         wallet::setVar(*walletDB, Version, DbVersion);
                         // no break;
 
@@ -1295,6 +1389,13 @@ namespace beam
                     throwIfError(ret, walletDB->_db);
                 }
 
+                {
+                    // for the unspent coins listing, missing in the older wallets
+                    const char* req = "CREATE INDEX IF NOT EXISTS SpentIndex ON " STORAGE_NAME "(spentHeight);";
+                    int ret = sqlite3_exec(walletDB->_db, req, NULL, NULL, NULL);
+                    throwIfError(ret, walletDB->_db);
+                }
+
                 ECC::NoLeak<ECC::Hash::Value> seed;
                 if (walletDB->getPrivateVarRaw(WalletSeed, &seed.V, sizeof(seed.V)))
                 {
@@ -1314,6 +1415,58 @@ namespace beam
         return Ptr();
     }
 
+    shared_ptr<WalletDB> WalletDB::openReadOnly(const string& path, const SecString& password)
+    {
+        try
+        {
+            sqlite3 *db = nullptr;
+            {
+                int ret = sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+                throwIfError(ret, db);
+            }
+
+            enterKey(db, password);
+            auto walletDB = make_shared<WalletDB>(db, io::Reactor::Ptr(), db);
+            walletDB->m_DbTransaction.reset();
+            {
+                int ret = sqlite3_busy_timeout(walletDB->_db, BusyTimeoutMs);
+                throwIfError(ret, walletDB->_db);
+            }
+
+            int version = 0;
+            wallet::getVar(*walletDB, Version, version);
+            if (version != DbVersion)
+            {
+                LOG_ERROR() << "Invalid DB version: " << version << ". Expected: " << DbVersion;
+                return nullptr;
+            }
+
+            return walletDB;
+        }
+        catch (const runtime_error&)
+        {
+
+        }
+
+        return nullptr;
+    }
+
+    void WalletDB::beginSnapshot()
+    {
+        assert(!m_Reactor && !m_DbTransaction);
+
+        // the writing connection may have changed anything since the last snapshot
+        m_TxParametersCache.clear();
+        m_AddressesCache.clear();
+
+        m_DbTransaction.reset(new sqlite::Transaction(_db));
+    }
+
+    void WalletDB::endSnapshot()
+    {
+        m_DbTransaction.reset(); // rolled back, nothing to commit
+    }
+
     WalletDB::WalletDB(sqlite3* db, io::Reactor::Ptr reactor, sqlite3* sdb)
         : _db(db)
         , m_PrivateDB(sdb)
@@ -1350,6 +1503,36 @@ namespace beam
         }
     }
 
+    namespace
+    {
+        int onSqliteTrace(unsigned int type, void* ctx, void* p, void* x)
+        {
+            auto profile = reinterpret_cast<Metrics::QueryProfile*>(ctx);
+            assert(type == SQLITE_TRACE_PROFILE);
+            profile->OnRun(p, sqlite3_sql(reinterpret_cast<sqlite3_stmt*>(p)), -1, *reinterpret_cast<const int64_t*>(x));
+            return 0;
+        }
+    }
+
+    void WalletDB::setProfile(Metrics::QueryProfile* profile)
+    {
+        m_Profile = profile;
+
+        auto apply = [profile](sqlite3* db)
+        {
+            if (profile)
+                sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE, onSqliteTrace, profile);
+            else
+                sqlite3_trace_v2(db, 0, nullptr, nullptr);
+        };
+
+        apply(_db);
+        if (m_PrivateDB != _db)
+        {
+            apply(m_PrivateDB);
+        }
+    }
+
     Key::IKdf::Ptr WalletDB::get_MasterKdf() const
     {
         return m_pKdf;
@@ -1375,30 +1558,115 @@ namespace beam
         SwitchCommitment().Create(sk, comm, *get_ChildKdf(cid.m_SubIdx), cid);
     }
 
+    void IWalletDB::get_Commitment(ECC::Point& comm, const Coin::ID& cid)
+    {
+        ECC::Scalar::Native sk;
+        calcCommitment(sk, comm, cid);
+    }
+
+    void WalletDB::KeyCache::SetMaster(const Key::IKdf::Ptr& pMaster)
+    {
+        if (m_pMaster != pMaster)
+        {
+            m_pMaster = pMaster;
+            m_Kdfs.clear();
+            m_Commitments.clear();
+            m_CoinIDs.clear();
+        }
+    }
+
+    Key::IKdf::Ptr WalletDB::get_ChildKdf(Key::Index iKdf) const
+    {
+        if (!iKdf || (2 == (iKdf >> 24)))
+            return IWalletDB::get_ChildKdf(iKdf); // the master itself
+
+        {
+            std::unique_lock<std::mutex> lock(m_KeyCache.m_Mutex);
+            m_KeyCache.SetMaster(m_pKdf);
+
+            auto it = m_KeyCache.m_Kdfs.find(iKdf);
+            if (m_KeyCache.m_Kdfs.end() != it)
+                return it->second;
+        }
+
+        Key::IKdf::Ptr pRet = IWalletDB::get_ChildKdf(iKdf);
+
+        std::unique_lock<std::mutex> lock(m_KeyCache.m_Mutex);
+        if (m_KeyCache.m_pMaster == m_pKdf)
+        {
+            if (m_KeyCache.m_Kdfs.size() >= KeyCache::s_MaxKdfs)
+                m_KeyCache.m_Kdfs.clear();
+            m_KeyCache.m_Kdfs[iKdf] = pRet;
+        }
+
+        return pRet;
+    }
+
+    void WalletDB::get_Commitment(ECC::Point& comm, const Coin::ID& cid)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_KeyCache.m_Mutex);
+            m_KeyCache.SetMaster(m_pKdf);
+
+            auto it = m_KeyCache.m_Commitments.find(cid);
+            if (m_KeyCache.m_Commitments.end() != it)
+            {
+                comm = it->second;
+                return;
+            }
+        }
+
+        IWalletDB::get_Commitment(comm, cid);
+
+        std::unique_lock<std::mutex> lock(m_KeyCache.m_Mutex);
+        if (m_KeyCache.m_pMaster == m_pKdf)
+        {
+            if (m_KeyCache.m_Commitments.size() >= KeyCache::s_MaxCommitments)
+            {
+                m_KeyCache.m_Commitments.clear();
+                m_KeyCache.m_CoinIDs.clear();
+            }
+            m_KeyCache.m_Commitments[cid] = comm;
+            m_KeyCache.m_CoinIDs[comm] = cid;
+        }
+    }
+
+    bool WalletDB::get_CoinID(const ECC::Point& comm, Coin::ID& cid)
+    {
+        std::unique_lock<std::mutex> lock(m_KeyCache.m_Mutex);
+        m_KeyCache.SetMaster(m_pKdf);
+
+        auto it = m_KeyCache.m_CoinIDs.find(comm);
+        if (m_KeyCache.m_CoinIDs.end() == it)
+            return false;
+
+        cid = it->second;
+        return true;
+    }
+
     vector<Coin> WalletDB::selectCoins(Amount amount)
     {
         vector<Coin> coins, coinsSel;
         Block::SystemState::ID stateID = {};
         getSystemStateID(stateID);
 
+        if (!m_CoinIndex.m_Valid)
+            buildCoinIndex();
+
+        for (const auto& p : m_CoinIndex.m_Coins)
         {
-            sqlite::Statement stm(this, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE maturity>=0 AND maturity<=?1 AND spentHeight<0 ORDER BY amount ASC");
-            stm.bind(1, stateID.m_Height);
+            if (p.second.m_maturity > stateID.m_Height)
+                continue;
 
-            while (stm.step())
-            {
-                auto& coin = coins.emplace_back();
-                int colIdx = 0;
-                ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+            auto& coin = coins.emplace_back(p.second);
 
-                wallet::DeduceStatus(*this, coin, stateID.m_Height);
-                if (Coin::Status::Available != coin.m_status)
-                    coins.pop_back();
-                else
-                {
-                    if (coin.m_ID.m_Value >= amount)
-                        break;
-                }
+            wallet::DeduceStatus(*this, coin, stateID.m_Height);
+            if (Coin::Status::Available != coin.m_status)
+                coins.pop_back();
+            else
+            {
+                if (coin.m_ID.m_Value >= amount)
+                    break;
             }
         }
 
@@ -1497,6 +1765,8 @@ namespace beam
         int colIdx = 0;
         ENUM_ALL_STORAGE_FIELDS(STM_BIND_LIST, NOSEP, coin);
         stm.step();
+
+        updateCoinIndex(coin);
     }
 
     void WalletDB::insertNew(Coin& coin)
@@ -1520,7 +1790,39 @@ namespace beam
         ENUM_STORAGE_ID(STM_BIND_LIST, NOSEP, coin);
         stm.step();
 
-        return sqlite3_changes(_db) > 0;
+        if (!sqlite3_changes(_db))
+            return false;
+
+        updateCoinIndex(coin);
+        return true;
+    }
+
+    void WalletDB::buildCoinIndex()
+    {
+        m_CoinIndex.m_Coins.clear();
+
+        sqlite::Statement stm(this, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE maturity>=0 AND spentHeight<0;");
+        while (stm.step())
+        {
+            Coin coin;
+            int colIdx = 0;
+            ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+
+            m_CoinIndex.m_Coins.emplace(coin.m_ID, coin);
+        }
+
+        m_CoinIndex.m_Valid = true;
+    }
+
+    void WalletDB::updateCoinIndex(const Coin& coin)
+    {
+        if (!m_CoinIndex.m_Valid)
+            return;
+
+        if (CoinIndex::IsCandidate(coin))
+            m_CoinIndex.m_Coins[coin.m_ID] = coin;
+        else
+            m_CoinIndex.m_Coins.erase(coin.m_ID);
     }
 
     void WalletDB::saveRaw(const Coin& coin)
@@ -1631,6 +1933,8 @@ namespace beam
         STORAGE_BIND_ID(wrp)
 
         stm.step();
+
+        m_CoinIndex.m_Coins.erase(cid);
     }
 
     void WalletDB::remove(const Coin::ID& cid)
@@ -1644,6 +1948,7 @@ namespace beam
         {
             sqlite::Statement stm(this, "DELETE FROM " STORAGE_NAME ";");
             stm.step();
+            m_CoinIndex.m_Coins.clear();
             notifyCoinsChanged();
         }
     }
@@ -1688,6 +1993,124 @@ namespace beam
         }
     }
 
+    std::vector<Coin> WalletDB::getCoins(const CoinFilter& filter, const boost::optional<Coin::ID>& after, size_t skip, size_t count)
+    {
+        // heights and amounts are stored as signed, MaxHeight (not confirmed/spent) is -1
+        const uint64_t maxSigned = numeric_limits<int64_t>::max();
+
+        // The coin status is deduced, only its height-related part can be selected in SQL. The rest is checked per coin,
+        // and the paging is done here in this case.
+        bool exactStatus = true;
+        bool unspent = false;
+        bool byMaturity = false;
+
+        string req = "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE 1";
+        if (filter.m_status)
+        {
+            switch (*filter.m_status)
+            {
+            case Coin::Status::Spent:
+                req += " AND spentHeight>=0";
+                break;
+
+            case Coin::Status::Maturing:
+                req += " AND spentHeight=?1 AND confirmHeight>=0 AND maturity>?2";
+                unspent = byMaturity = true;
+                break;
+
+            case Coin::Status::Available:
+            case Coin::Status::Outgoing:
+                req += " AND spentHeight=?1 AND confirmHeight>=0 AND maturity<=?2";
+                unspent = byMaturity = true;
+                exactStatus = false;
+                break;
+
+            default:
+                req += " AND spentHeight=?1 AND confirmHeight<0";
+                unspent = true;
+                exactStatus = false;
+            }
+        }
+
+        bool byHeight = (filter.m_minHeight > 0) || (filter.m_maxHeight != MaxHeight);
+        if (byHeight)
+            req += " AND confirmHeight>=?3 AND confirmHeight<=?4";
+
+        bool byAmount = (filter.m_minAmount > 0) || (filter.m_maxAmount != numeric_limits<Amount>::max());
+        if (byAmount)
+            req += " AND amount>=?5 AND amount<=?6";
+
+        if (after)
+            req += " AND ROWID>(SELECT ROWID FROM " STORAGE_NAME " WHERE Type=?7 AND SubKey=?8 AND Number=?9 AND amount=?10)";
+
+        req += " ORDER BY ROWID";
+
+        if (exactStatus && count)
+            req += " LIMIT ?11 OFFSET ?12";
+
+        sqlite::Statement stm(this, req.c_str());
+
+        Height h = getCurrentHeight();
+
+        if (unspent)
+            stm.bind(1, MaxHeight);
+        if (byMaturity)
+            stm.bind(2, h);
+
+        if (byHeight)
+        {
+            stm.bind(3, filter.m_minHeight);
+            stm.bind(4, std::min<uint64_t>(filter.m_maxHeight, maxSigned));
+        }
+
+        if (byAmount)
+        {
+            stm.bind(5, filter.m_minAmount);
+            stm.bind(6, std::min<uint64_t>(filter.m_maxAmount, maxSigned));
+        }
+
+        if (after)
+        {
+            Coin cAfter;
+            cAfter.m_ID = *after;
+            int colIdx = 6;
+            STORAGE_BIND_ID(cAfter)
+        }
+
+        if (exactStatus && count)
+        {
+            stm.bind(11, static_cast<uint64_t>(count));
+            stm.bind(12, static_cast<uint64_t>(skip));
+            skip = 0;
+        }
+
+        vector<Coin> coins;
+        while (stm.step())
+        {
+            Coin coin;
+
+            int colIdx = 0;
+            ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+
+            wallet::DeduceStatus(*this, coin, h);
+
+            if (filter.m_status && (coin.m_status != *filter.m_status))
+                continue;
+
+            if (skip)
+            {
+                skip--;
+                continue;
+            }
+
+            coins.push_back(std::move(coin));
+            if (coins.size() == count)
+                break;
+        }
+
+        return coins;
+    }
+
     void WalletDB::setVarRaw(const char* name, const void* data, size_t size)
     {
         const char* req = "INSERT or REPLACE INTO " VARIABLES_NAME " (" VARIABLES_FIELDS ") VALUES(?1, ?2);";
@@ -1836,40 +2259,83 @@ namespace beam
             stm.step();
         }
 
+        m_CoinIndex.m_Valid = false;
         notifyCoinsChanged();
     }
 
     vector<TxDescription> WalletDB::getTxHistory(uint64_t start, int count)
     {
-        // TODO this is temporary solution
-        int txCount = 0;
+        const char* req = "SELECT " TX_SUMMARY_FIELDS " FROM " TX_SUMMARY_NAME " WHERE paramMask=?1 ORDER BY createTime DESC, txID LIMIT ?2 OFFSET ?3;";
+
+        sqlite::Statement stm(this, req);
+        stm.bind(1, TX_SUMMARY_MANDATORY);
+        stm.bind(2, count);
+        stm.bind(3, start);
+
+        vector<TxDescription> res;
+        while (stm.step())
         {
-            sqlite::Statement stm(this, "SELECT COUNT(DISTINCT txID) FROM " TX_PARAMS_NAME " ;");
-            stm.step();
-            stm.get(0, txCount);
+            res.emplace_back();
+            int colIdx = 0;
+            ENUM_TX_SUMMARY_FIELDS(STM_GET_LIST, NOSEP, res.back());
         }
-        
-        vector<TxDescription> res;
-        if (txCount > 0)
+
+        return res;
+    }
+
+    vector<TxDescription> WalletDB::getTxHistory(const TxFilter& filter, const boost::optional<TxID>& after, size_t skip, size_t count)
+    {
+        // heights and amounts are stored as signed
+        const uint64_t maxSigned = numeric_limits<int64_t>::max();
+
+        string req = "SELECT " TX_SUMMARY_FIELDS " FROM " TX_SUMMARY_NAME " WHERE paramMask=?1";
+        if (filter.m_status)
+            req += " AND status=?2";
+
+        bool byHeight = (filter.m_minHeight > 0) || (filter.m_maxHeight != MaxHeight);
+        if (byHeight)
+            req += " AND kernelProofHeight>=?3 AND kernelProofHeight<=?4";
+
+        bool byAmount = (filter.m_minAmount > 0) || (filter.m_maxAmount != numeric_limits<Amount>::max());
+        if (byAmount)
+            req += " AND amount>=?5 AND amount<=?6";
+
+        // most recent first, tie-break by ID to keep the order stable for the cursor
+        if (after)
+            req += " AND (createTime<(SELECT createTime FROM " TX_SUMMARY_NAME " WHERE txID=?7) OR (createTime=(SELECT createTime FROM " TX_SUMMARY_NAME " WHERE txID=?7) AND txID>?7))";
+
+        req += " ORDER BY createTime DESC, txID LIMIT ?8 OFFSET ?9;";
+
+        sqlite::Statement stm(this, req.c_str());
+        stm.bind(1, TX_SUMMARY_MANDATORY);
+
+        if (filter.m_status)
+            stm.bind(2, *filter.m_status);
+
+        if (byHeight)
         {
-            res.reserve(static_cast<size_t>(min(txCount, count)));
-            const char* req = "SELECT DISTINCT txID FROM " TX_PARAMS_NAME " LIMIT ?1 OFFSET ?2 ;";
+            stm.bind(3, filter.m_minHeight);
+            stm.bind(4, std::min<uint64_t>(filter.m_maxHeight, maxSigned));
+        }
 
-            sqlite::Statement stm(this, req);
-            stm.bind(1, count);
-            stm.bind(2, start);
+        if (byAmount)
+        {
+            stm.bind(5, filter.m_minAmount);
+            stm.bind(6, std::min<uint64_t>(filter.m_maxAmount, maxSigned));
+        }
 
-            while (stm.step())
-            {
-                TxID txID;
-                stm.get(0, txID);
-                auto t = getTx(txID);
-                if (t.is_initialized())
-                {
-                    res.emplace_back(*t);
-                }
-            }
-            sort(res.begin(), res.end(), [](const auto& left, const auto& right) {return left.m_createTime > right.m_createTime; });
+        if (after)
+            stm.bind(7, *after);
+
+        stm.bind(8, count ? static_cast<uint64_t>(count) : maxSigned);
+        stm.bind(9, static_cast<uint64_t>(skip));
+
+        vector<TxDescription> res;
+        while (stm.step())
+        {
+            res.emplace_back();
+            int colIdx = 0;
+            ENUM_TX_SUMMARY_FIELDS(STM_GET_LIST, NOSEP, res.back());
         }
 
         return res;
@@ -1877,82 +2343,58 @@ namespace beam
 
     boost::optional<TxDescription> WalletDB::getTx(const TxID& txId)
     {
-        const char* req = "SELECT * FROM " TX_PARAMS_NAME " WHERE txID=?1;";
+        const char* req = "SELECT " TX_SUMMARY_FIELDS " FROM " TX_SUMMARY_NAME " WHERE txID=?1 AND paramMask=?2;";
         sqlite::Statement stm(this, req);
         stm.bind(1, txId);
+        stm.bind(2, TX_SUMMARY_MANDATORY);
 
-        TxDescription txDescription;
-        txDescription.m_txId = txId;
+        if (stm.step())
+        {
+            TxDescription txDescription;
+            int colIdx = 0;
+            ENUM_TX_SUMMARY_FIELDS(STM_GET_LIST, NOSEP, txDescription);
+            return txDescription;
+        }
 
-        const std::set<wallet::TxParameterID> mandatoryParams{ wallet::TxParameterID::Amount, wallet::TxParameterID::Fee,
-            wallet::TxParameterID::PeerID,
-            wallet::TxParameterID::MyID, wallet::TxParameterID::CreateTime,
-            wallet::TxParameterID::IsSender };
-        std::set<wallet::TxParameterID> gottenParams;
+        return boost::optional<TxDescription>{};
+    }
 
-        while (stm.step())
+    void WalletDB::updateTxSummary(const TxID& txID, wallet::TxParameterID paramID, const ByteBuffer& blob)
+    {
+        switch (paramID)
         {
-            TxParameter parameter = {};
-            int colIdx = 0;
-            ENUM_TX_PARAMS_FIELDS(STM_GET_LIST, NOSEP, parameter);
+#define MACRO(id, column, type, mask) \
+        case wallet::TxParameterID::id: \
+            { \
+                type value; \
+                deserialize(value, blob); \
+                insertTxSummary(txID); \
+                sqlite::Statement stm(this, "UPDATE " TX_SUMMARY_NAME " SET " #column "=?2, paramMask=paramMask|?3 WHERE txID=?1;"); \
+                stm.bind(1, txID); \
+                stm.bind(2, value); \
+                stm.bind(3, mask); \
+                stm.step(); \
+            } \
+            break;
 
-            gottenParams.emplace(static_cast<wallet::TxParameterID>(parameter.m_paramID));
+        ENUM_TX_SUMMARY_PARAMS(MACRO)
+#undef MACRO
 
-            switch (static_cast<wallet::TxParameterID>(parameter.m_paramID))
-            {
-            case wallet::TxParameterID::Amount:
-                deserialize(txDescription.m_amount, parameter.m_value);
-                break;
-            case wallet::TxParameterID::Fee:
-                deserialize(txDescription.m_fee, parameter.m_value);
-                break;
-            case wallet::TxParameterID::MinHeight:
-                deserialize(txDescription.m_minHeight, parameter.m_value);
-                break;
-            case wallet::TxParameterID::PeerID:
-                deserialize(txDescription.m_peerId, parameter.m_value);
-                break;
-            case wallet::TxParameterID::MyID:
-                deserialize(txDescription.m_myId, parameter.m_value);
-                break;
-            case wallet::TxParameterID::CreateTime:
-                deserialize(txDescription.m_createTime, parameter.m_value);
-                break;
-            case wallet::TxParameterID::IsSender:
-                deserialize(txDescription.m_sender, parameter.m_value);
-                break;
-            case wallet::TxParameterID::Message:
-                deserialize(txDescription.m_message, parameter.m_value);
-                break;
-            case wallet::TxParameterID::Change:
-                deserialize(txDescription.m_change, parameter.m_value);
-                break;
-            case wallet::TxParameterID::ModifyTime:
-                deserialize(txDescription.m_modifyTime, parameter.m_value);
-                break;
-            case wallet::TxParameterID::Status:
-                deserialize(txDescription.m_status, parameter.m_value);
-                break;
-            case wallet::TxParameterID::KernelID:
-                deserialize(txDescription.m_kernelID, parameter.m_value);
-                break;
-            case wallet::TxParameterID::FailureReason:
-                deserialize(txDescription.m_failureReason, parameter.m_value);
-                break;
-            case wallet::TxParameterID::IsSelfTx:
-                deserialize(txDescription.m_selfTx, parameter.m_value);
-                break;
-            default:
-                break; // suppress warning
-            }
+        default:
+            break; // not a part of the summary
         }
+    }
 
-        if (std::includes(gottenParams.begin(), gottenParams.end(), mandatoryParams.begin(), mandatoryParams.end()))
-        {
-            return txDescription;
-        }
+    void WalletDB::insertTxSummary(const TxID& txID)
+    {
+        // all the columns get the TxDescription defaults, the parameters overwrite them as they're set
+        TxDescription tx;
+        tx.m_txId = txID;
 
-        return boost::optional<TxDescription>{};
+        sqlite::Statement stm(this, "INSERT OR IGNORE INTO " TX_SUMMARY_NAME " (" TX_SUMMARY_FIELDS ") VALUES(" ENUM_TX_SUMMARY_FIELDS(BIND_LIST, COMMA, ) ");");
+        int colIdx = 0;
+        ENUM_TX_SUMMARY_FIELDS(STM_BIND_LIST, NOSEP, tx);
+        stm.step();
     }
 
     void WalletDB::saveTx(const TxDescription& p)
@@ -1991,6 +2433,11 @@ namespace beam
             stm.bind(2, wallet::TxParameterID::TransactionType);
 
             stm.step();
+
+            sqlite::Statement stm2(this, "DELETE FROM " TX_SUMMARY_NAME " WHERE txID=?1;");
+            stm2.bind(1, txId);
+            stm2.step();
+
             deleteParametersFromCache(txId);
             notifyTransactionChanged(ChangeAction::Removed, { *tx });
         }
@@ -2003,6 +2450,10 @@ namespace beam
             sqlite::Statement stm(this, req);
             stm.bind(1, txId);
             stm.step();
+
+            for (auto& p : m_CoinIndex.m_Coins)
+                if (p.second.m_spentTxId == txId)
+                    p.second.m_spentTxId.reset();
         }
         {
             const char* req = "DELETE FROM " STORAGE_NAME " WHERE createTxId=?1 AND confirmHeight=?2;";
@@ -2198,6 +2649,7 @@ namespace beam
                 stm2.bind(2, paramID);
                 stm2.bind(3, blob);
                 stm2.step();
+                updateTxSummary(txID, paramID, blob);
                 if (shouldNotifyAboutChanges)
                 {
                     auto tx = getTx(txID);
@@ -2219,6 +2671,7 @@ namespace beam
         int colIdx = 0;
         ENUM_TX_PARAMS_FIELDS(STM_BIND_LIST, NOSEP, parameter);
         stm.step();
+        updateTxSummary(txID, paramID, blob);
         if (shouldNotifyAboutChanges)
         {
             auto tx = getTx(txID);
@@ -2414,6 +2867,10 @@ namespace beam
 
         stm.step();
 
+        for (auto& p : m_CoinIndex.m_Coins)
+            if (p.second.m_sessionId == session)
+                p.second.m_sessionId = 0;
+
         return sqlite3_changes(_db) > 0;
     }
 
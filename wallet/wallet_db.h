@@ -31,6 +31,7 @@
 #include "wallet/common.h"
 #include "utility/io/address.h"
 #include "secstring.h"
+#include <mutex>
 
 struct sqlite3;
 
@@ -79,6 +80,25 @@ namespace beam
 
     using CoinIDList = std::vector<Coin::ID>;
 
+    // Filters for the paged coin and tx listings. All the bounds are inclusive
+    struct CoinFilter
+    {
+        boost::optional<Coin::Status> m_status;
+        Height m_minHeight = 0; // confirm height. Unconfirmed coins are excluded if any of the bounds is set
+        Height m_maxHeight = MaxHeight;
+        Amount m_minAmount = 0;
+        Amount m_maxAmount = std::numeric_limits<Amount>::max();
+    };
+
+    struct TxFilter
+    {
+        boost::optional<TxStatus> m_status;
+        Height m_minHeight = 0; // kernel proof height, 0 for txs without it
+        Height m_maxHeight = MaxHeight;
+        Amount m_minAmount = 0;
+        Amount m_maxAmount = std::numeric_limits<Amount>::max();
+    };
+
     struct WalletAddress
     {
         WalletID m_walletID;
@@ -152,8 +172,12 @@ namespace beam
         virtual ~IWalletDB() {}
 
         virtual beam::Key::IKdf::Ptr get_MasterKdf() const = 0;
-        beam::Key::IKdf::Ptr get_ChildKdf(Key::Index) const;
+        virtual beam::Key::IKdf::Ptr get_ChildKdf(Key::Index) const;
         void calcCommitment(ECC::Scalar::Native& sk, ECC::Point& comm, const Coin::ID&);
+        // the commitment only, when the blinding factor isn't needed
+        virtual void get_Commitment(ECC::Point& comm, const Coin::ID&);
+        // the coin which commitment was calculated recently, if any
+        virtual bool get_CoinID(const ECC::Point&, Coin::ID&) { return false; }
         virtual uint64_t AllocateKidRange(uint64_t nCount) = 0;
         virtual std::vector<Coin> selectCoins(Amount amount) = 0;
         virtual std::vector<Coin> getCoinsCreatedByTx(const TxID& txId) = 0;
@@ -170,6 +194,10 @@ namespace beam
 
         virtual void visit(std::function<bool(const Coin& coin)> func) = 0;
 
+        // Paged listing, in the order of insertion. Either skip the first coins, or continue after the given one (keyset cursor).
+        // count == 0 means no limit
+        virtual std::vector<Coin> getCoins(const CoinFilter& filter, const boost::optional<Coin::ID>& after, size_t skip, size_t count) = 0;
+
         virtual void setVarRaw(const char* name, const void* data, size_t size) = 0;
         virtual bool getVarRaw(const char* name, void* data, int size) const = 0;
 
@@ -181,6 +209,8 @@ namespace beam
         virtual void rollbackConfirmedUtxo(Height minHeight) = 0;
 
         virtual std::vector<TxDescription> getTxHistory(uint64_t start = 0, int count = std::numeric_limits<int>::max()) = 0;
+        // Paged listing, the most recent first. Same paging rules as for getCoins()
+        virtual std::vector<TxDescription> getTxHistory(const TxFilter& filter, const boost::optional<TxID>& after, size_t skip, size_t count) = 0;
         virtual boost::optional<TxDescription> getTx(const TxID& txId) = 0;
         virtual void saveTx(const TxDescription& p) = 0;
         virtual void deleteTx(const TxID& txId) = 0;
@@ -231,6 +261,8 @@ namespace beam
         struct Transaction;
     }
 
+    namespace Metrics { class QueryProfile; }
+
     class WalletDB : public IWalletDB
     {
     public:
@@ -242,7 +274,22 @@ namespace beam
         WalletDB(sqlite3* db, const ECC::NoLeak<ECC::uintBig>& secretKey, io::Reactor::Ptr reactor, sqlite3* sdb);
         ~WalletDB();
 
+        // Per-statement profiling (by SQL text) via the sqlite trace hooks, no overhead unless set. Pass nullptr to stop.
+        void setProfile(Metrics::QueryProfile* profile);
+
+        // Read-only connection to an already opened wallet, for the reads from other threads. Needs no reactor, and keeps no transaction open.
+        // Reads in between beginSnapshot/endSnapshot see the same state, the one last flushed by the writing connection.
+        static std::shared_ptr<WalletDB> openReadOnly(const std::string& path, const SecString& password);
+        void beginSnapshot();
+        void endSnapshot();
+
+        // commits the pending changes of this (writing) connection, the other connections see the committed data only
+        void flushDB();
+
         beam::Key::IKdf::Ptr get_MasterKdf() const override;
+        beam::Key::IKdf::Ptr get_ChildKdf(Key::Index) const override;
+        void get_Commitment(ECC::Point& comm, const Coin::ID&) override;
+        bool get_CoinID(const ECC::Point& comm, Coin::ID&) override;
         uint64_t AllocateKidRange(uint64_t nCount) override;
         std::vector<Coin> selectCoins(Amount amount) override;
         std::vector<Coin> getCoinsCreatedByTx(const TxID& txId) override;
@@ -258,6 +305,7 @@ namespace beam
         void clear() override;
 
         void visit(std::function<bool(const Coin& coin)> func) override;
+        std::vector<Coin> getCoins(const CoinFilter& filter, const boost::optional<Coin::ID>& after, size_t skip, size_t count) override;
 
         void setVarRaw(const char* name, const void* data, size_t size) override;
         bool getVarRaw(const char* name, void* data, int size) const override;
@@ -270,6 +318,7 @@ namespace beam
         void rollbackConfirmedUtxo(Height minHeight) override;
 
         std::vector<TxDescription> getTxHistory(uint64_t start, int count) override;
+        std::vector<TxDescription> getTxHistory(const TxFilter& filter, const boost::optional<TxID>& after, size_t skip, size_t count) override;
         boost::optional<TxDescription> getTx(const TxID& txId) override;
         void saveTx(const TxDescription& p) override;
         void deleteTx(const TxID& txId) override;
@@ -322,20 +371,24 @@ namespace beam
         void insertRaw(const Coin&);
         void insertNew(Coin&);
         void saveRaw(const Coin&);
+        void buildCoinIndex();
+        void updateCoinIndex(const Coin&);
 
         using ParameterCache = std::map<TxID, std::map<wallet::TxParameterID, boost::optional<ByteBuffer>>>;
 
         void insertParameterToCache(const TxID& txID, wallet::TxParameterID paramID, const boost::optional<ByteBuffer>& blob) const;
         void deleteParametersFromCache(const TxID& txID);
+        void updateTxSummary(const TxID& txID, wallet::TxParameterID paramID, const ByteBuffer& blob);
+        void insertTxSummary(const TxID& txID);
         void insertAddressToCache(const WalletID& id, const boost::optional<WalletAddress>& address) const;
         void deleteAddressFromCache(const WalletID& id);
-        void flushDB();
         void onModified();
         void onFlushTimer();
     private:
         friend struct sqlite::Statement;
         sqlite3* _db;
         sqlite3* m_PrivateDB;
+        Metrics::QueryProfile* m_Profile = nullptr;
         io::Reactor::Ptr m_Reactor;
         Key::IKdf::Ptr m_pKdf;
         io::Timer::Ptr m_FlushTimer;
@@ -352,8 +405,50 @@ namespace beam
             IMPLEMENT_GET_PARENT_OBJ(WalletDB, m_History)
         } m_History;
         
+        // Resident copy of the confirmed unspent coins, ordered by amount, for the coin selection.
+        // Built on demand, then kept in sync by the coin write paths. The bulk rollback just drops it.
+        struct CoinIndex
+        {
+            struct Order
+            {
+                bool operator()(const Coin::ID& a, const Coin::ID& b) const
+                {
+                    if (a.m_Value != b.m_Value)
+                        return a.m_Value < b.m_Value;
+                    return a.cmp(b) < 0;
+                }
+            };
+
+            std::map<Coin::ID, Coin, Order> m_Coins;
+            bool m_Valid = false;
+
+            static bool IsCandidate(const Coin& c)
+            {
+                return (MaxHeight != c.m_maturity) && (MaxHeight == c.m_spentHeight);
+            }
+        } m_CoinIndex;
+
         mutable ParameterCache m_TxParametersCache;
         mutable std::map<WalletID, boost::optional<WalletAddress>> m_AddressesCache;
+
+        // Derived child kdfs and coin commitments. The same coins are checked over and over (utxo events, proofs polling),
+        // and each check costs a key derivation. Used by the outputs creating threads too, hence the mutex.
+        // Bounded (dropped once full), and dropped if the master key is changed.
+        struct KeyCache
+        {
+            static const size_t s_MaxKdfs = 256;
+            static const size_t s_MaxCommitments = 1U << 16;
+
+            std::mutex m_Mutex;
+            Key::IKdf::Ptr m_pMaster; // the entries are derived from
+            std::map<Key::Index, Key::IKdf::Ptr> m_Kdfs;
+            std::map<Coin::ID, ECC::Point> m_Commitments;
+            std::map<ECC::Point, Coin::ID> m_CoinIDs; // reverse of the above
+
+            void SetMaster(const Key::IKdf::Ptr&);
+        };
+
+        mutable KeyCache m_KeyCache;
     };
 
     namespace wallet
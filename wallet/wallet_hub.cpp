@@ -0,0 +1,420 @@
+// Copyright 2018 The Beam Team
+// Copyright 2019 - 2022 The LiteCash Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wallet_hub.h"
+#include "wallet_network.h"
+#include "utility/logger.h"
+#include <cctype>
+
+using namespace std;
+
+namespace beam
+{
+    // Node endpoint of a hosted wallet. The requests go to the shared connection, the bbs subscriptions - to the hub dispatcher
+    class WalletHub::Endpoint
+        : public proto::FlyClient::INetwork
+    {
+        WalletHub& m_Hub;
+        std::map<BbsChannel, IBbsReceiver*> m_Subscriptions;
+
+    public:
+        Endpoint(WalletHub& hub) : m_Hub(hub) {}
+
+        ~Endpoint()
+        {
+            for (const auto& x : m_Subscriptions)
+                m_Hub.BbsUnsubscribe(x.first, x.second);
+        }
+
+        // the shared connection is managed by the hub
+        void Connect() override {}
+        void Disconnect() override {}
+
+        void PostRequestInternal(Request& r) override
+        {
+            m_Hub.PostRequest(r);
+        }
+
+        void BbsSubscribe(BbsChannel ch, Timestamp ts, IBbsReceiver* p) override
+        {
+            auto it = m_Subscriptions.find(ch);
+            if (m_Subscriptions.end() != it)
+            {
+                if (it->second != p)
+                    m_Hub.BbsUnsubscribe(ch, it->second);
+                m_Subscriptions.erase(it);
+            }
+
+            if (p)
+            {
+                m_Subscriptions[ch] = p;
+                m_Hub.BbsSubscribe(ch, ts, p);
+            }
+        }
+    };
+
+    // The wallet works with the shared header history rather than the one in its db
+    class WalletHub::MyWallet
+        : public Wallet
+    {
+        WalletHub& m_Hub;
+
+        Block::SystemState::IHistory& get_HeaderHistory() const override
+        {
+            return m_Hub.m_History;
+        }
+
+    public:
+        MyWallet(WalletHub& hub, IWalletDB::Ptr walletDB)
+            : Wallet(walletDB)
+            , m_Hub(hub)
+        {
+        }
+    };
+
+    WalletHub::WalletHub(const Config& cfg, SecString&& pass, io::Reactor::Ptr reactor)
+        : m_Cfg(cfg)
+        , m_Pass(std::move(pass))
+        , m_Reactor(reactor)
+        , m_Network(make_shared<proto::FlyClient::NetworkStd>(static_cast<proto::FlyClient&>(*this)))
+        , m_pTimer(io::Timer::create(*reactor))
+    {
+        if (!m_Cfg.m_Owner.empty())
+        {
+            // logs in to the owned node with this key
+            auto p = LoadWallet(m_Cfg.m_Owner);
+            if (!p)
+                throw runtime_error("Can't open the owner wallet " + m_Cfg.m_Owner);
+
+            m_pOwnerKdf = p->m_WalletDB->get_MasterKdf();
+            p->m_Owned = true;
+            m_Wallets[p->m_Name] = p;
+        }
+
+        uint32_t period_s = std::max(1U, std::min(m_Cfg.m_IdleTimeout_s, 60U));
+        m_pTimer->start(period_s * 1000, true, [this]() { OnTimer(); });
+    }
+
+    WalletHub::~WalletHub()
+    {
+        m_pTimer->cancel();
+
+        // while the hub is intact, the owned node going down is reported to the wallets
+        m_Network->Disconnect();
+
+        // the wallets abort their requests and unsubscribe while the network is still there
+        m_Wallets.clear();
+
+        for (auto& x : m_UtxoEvents)
+            x.second.m_pReq->m_pTrg = nullptr;
+        m_UtxoEvents.clear();
+    }
+
+    bool WalletHub::IsValidName(const string& name)
+    {
+        if (name.empty() || (name.size() > 64))
+            return false;
+
+        for (char c : name)
+            if (!isalnum(static_cast<unsigned char>(c)) && (c != '_') && (c != '-'))
+                return false;
+
+        return true;
+    }
+
+    shared_ptr<proto::FlyClient::INetwork> WalletHub::CreateEndpoint()
+    {
+        return make_shared<Endpoint>(*this);
+    }
+
+    string WalletHub::get_Path(const string& name, const char* szExt) const
+    {
+        return (m_Cfg.m_Dir.empty() ? string(".") : m_Cfg.m_Dir) + "/" + name + szExt;
+    }
+
+    WalletHub::HostedWallet::Ptr WalletHub::GetWallet(const string& name)
+    {
+        HostedWallet::Ptr p;
+
+        auto it = m_Wallets.find(name);
+        if (m_Wallets.end() != it)
+            p = it->second;
+        else
+        {
+            p = LoadWallet(name);
+            if (!p)
+                return p;
+
+            m_Wallets[name] = p;
+        }
+
+        p->m_LastUsed = chrono::steady_clock::now();
+        return p;
+    }
+
+    WalletHub::HostedWallet::Ptr WalletHub::LoadWallet(const string& name)
+    {
+        if (!IsValidName(name))
+            return HostedWallet::Ptr();
+
+        string path = get_Path(name, ".db");
+        if (!WalletDB::isInitialized(path))
+            return HostedWallet::Ptr();
+
+        auto walletDB = WalletDB::open(path, m_Pass, m_Reactor);
+        if (!walletDB)
+        {
+            LOG_WARNING() << "Wallet " << name << " not opened";
+            return HostedWallet::Ptr();
+        }
+
+        auto p = make_shared<HostedWallet>();
+        p->m_Name = name;
+        p->m_WalletDB = walletDB;
+        p->m_Owned = m_pOwnerKdf && walletDB->get_MasterKdf()->IsSame(*m_pOwnerKdf);
+
+        auto pWallet = make_shared<MyWallet>(*this, walletDB);
+        p->m_Wallet = pWallet;
+
+        auto pEndpoint = CreateEndpoint();
+        auto wnet = make_shared<WalletNetworkViaBbs>(*pWallet, pEndpoint, walletDB);
+        pWallet->AddMessageEndpoint(wnet);
+        pWallet->SetNodeEndpoint(pEndpoint);
+
+        proto::FlyClient& fc = *pWallet;
+        if (p->m_Owned)
+            for (const auto& nodeID : m_OwnedNodes)
+                fc.OnOwnedNode(nodeID, true);
+
+        Block::SystemState::Full s;
+        if (m_History.get_Tip(s))
+        {
+            CheckRollback(*p);
+            fc.OnNewTip(); // catch up
+        }
+
+        LOG_INFO() << "Wallet " << name << " loaded" << (p->m_Owned ? ", owned node key" : "");
+        return p;
+    }
+
+    void WalletHub::CheckRollback(HostedWallet& x)
+    {
+        // The chain might have been reorganized while the wallet wasn't loaded. Its own history isn't maintained,
+        // so the fork point is unknown, assume the deepest possible.
+        // The shared history keeps a limited window, the state below it can't be verified, and is reverted as well.
+        x.m_RollbackChecked = true;
+
+        Block::SystemState::ID id;
+        Block::SystemState::Full s;
+        if (!x.m_WalletDB->getSystemStateID(id) || !id.m_Height || !m_History.get_Tip(s) || (id.m_Height > s.m_Height))
+            return;
+
+        if (m_History.get_At(s, id.m_Height))
+        {
+            Merkle::Hash hv;
+            s.get_Hash(hv);
+            if (hv == id.m_Hash)
+                return;
+        }
+
+        Height h = id.m_Height - std::min(id.m_Height, Height(Rules::get().Macroblock.MaxRollback));
+        LOG_INFO() << "Wallet " << x.m_Name << " missed the rollback, reverting to " << h;
+        x.m_Wallet->RollbackTo(h);
+    }
+
+    void WalletHub::OnTimer()
+    {
+        auto now = chrono::steady_clock::now();
+        auto timeout = chrono::seconds(m_Cfg.m_IdleTimeout_s);
+
+        for (auto it = m_Wallets.begin(); m_Wallets.end() != it; )
+        {
+            const HostedWallet& x = *it->second;
+
+            bool bEvict =
+                (x.m_Name != m_Cfg.m_Owner) &&
+                (it->second.use_count() == 1) &&
+                (now - x.m_LastUsed >= timeout) &&
+                x.m_Wallet->IsIdle();
+
+            if (bEvict)
+            {
+                LOG_INFO() << "Wallet " << x.m_Name << " unloaded";
+                it = m_Wallets.erase(it);
+            }
+            else
+                it++;
+        }
+    }
+
+    vector<WalletHub::HostedWallet::Ptr> WalletHub::get_Wallets() const
+    {
+        // a copy, the notified wallets may affect the set
+        vector<HostedWallet::Ptr> v;
+        v.reserve(m_Wallets.size());
+        for (const auto& x : m_Wallets)
+            v.push_back(x.second);
+        return v;
+    }
+
+    void WalletHub::OnNewTip()
+    {
+        m_History.ShrinkToWindow(Rules::get().Macroblock.MaxRollback * 2);
+
+        for (const auto& p : get_Wallets())
+        {
+            if (!p->m_RollbackChecked)
+                CheckRollback(*p); // loaded before the first tip
+
+            static_cast<proto::FlyClient&>(*p->m_Wallet).OnNewTip();
+        }
+    }
+
+    void WalletHub::OnTipUnchanged()
+    {
+        for (const auto& p : get_Wallets())
+            static_cast<proto::FlyClient&>(*p->m_Wallet).OnTipUnchanged();
+    }
+
+    void WalletHub::OnRolledBack()
+    {
+        for (const auto& p : get_Wallets())
+            static_cast<proto::FlyClient&>(*p->m_Wallet).OnRolledBack();
+    }
+
+    void WalletHub::get_Kdf(Key::IKdf::Ptr& pKdf)
+    {
+        pKdf = m_pOwnerKdf;
+    }
+
+    void WalletHub::OnOwnedNode(const PeerID& id, bool bUp)
+    {
+        if (bUp)
+            m_OwnedNodes.insert(id);
+        else
+            m_OwnedNodes.erase(id);
+
+        for (const auto& p : get_Wallets())
+            if (p->m_Owned)
+                static_cast<proto::FlyClient&>(*p->m_Wallet).OnOwnedNode(id, bUp);
+    }
+
+    void WalletHub::PostRequest(Request& r)
+    {
+        if (Request::Type::UtxoEvents == r.get_Type())
+            PostUtxoEvents(static_cast<RequestUtxoEvents&>(r));
+        else
+            m_Network->PostRequestInternal(r);
+    }
+
+    void WalletHub::PostUtxoEvents(RequestUtxoEvents& r)
+    {
+        // The events are of the owner key, the same for all the owned wallets. They usually ask from the same height
+        UtxoEventsWaiters& x = m_UtxoEvents[r.m_Msg.m_HeightMin];
+        if (!x.m_pReq)
+        {
+            x.m_pReq.reset(new RequestUtxoEvents);
+            x.m_pReq->m_Msg = r.m_Msg;
+            m_Network->PostRequest(*x.m_pReq, m_UtxoEventsHandler);
+        }
+
+        x.m_vWaiting.push_back(&r);
+    }
+
+    void WalletHub::UtxoEventsHandler::OnComplete(Request& r)
+    {
+        assert(Request::Type::UtxoEvents == r.get_Type());
+        get_ParentObj().OnUtxoEvents(static_cast<RequestUtxoEvents&>(r));
+    }
+
+    void WalletHub::OnUtxoEvents(RequestUtxoEvents& r)
+    {
+        auto it = m_UtxoEvents.find(r.m_Msg.m_HeightMin);
+        if ((m_UtxoEvents.end() == it) || (it->second.m_pReq.get() != &r))
+            return;
+
+        vector<RequestUtxoEvents::Ptr> vWaiting;
+        vWaiting.swap(it->second.m_vWaiting);
+        m_UtxoEvents.erase(it);
+
+        // each wallet filters-out the events of the coins it doesn't know
+        for (const auto& pReq : vWaiting)
+        {
+            if (!pReq->m_pTrg)
+                continue; // aborted
+
+            pReq->m_Res = r.m_Res;
+            pReq->m_pTrg->OnComplete(*pReq);
+        }
+    }
+
+    void WalletHub::BbsSubscribe(BbsChannel ch, Timestamp ts, IBbsReceiver* p)
+    {
+        auto& receivers = m_BbsSubscriptions[ch];
+        if (receivers.empty())
+        {
+            receivers[p] = ts;
+            m_Network->BbsSubscribe(ch, ts, &m_BbsReceiver);
+            return;
+        }
+
+        Timestamp tsMin = receivers.begin()->second;
+        for (const auto& x : receivers)
+            tsMin = std::min(tsMin, x.second);
+
+        receivers[p] = ts;
+
+        if (ts < tsMin)
+        {
+            // the newcomer needs older messages, resubscribe from its time. The rest will receive some duplicates
+            m_Network->BbsSubscribe(ch, 0, nullptr);
+            m_Network->BbsSubscribe(ch, ts, &m_BbsReceiver);
+        }
+    }
+
+    void WalletHub::BbsUnsubscribe(BbsChannel ch, IBbsReceiver* p)
+    {
+        auto it = m_BbsSubscriptions.find(ch);
+        if (m_BbsSubscriptions.end() == it)
+            return;
+
+        it->second.erase(p);
+        if (it->second.empty())
+        {
+            m_BbsSubscriptions.erase(it);
+            m_Network->BbsSubscribe(ch, 0, nullptr);
+        }
+    }
+
+    void WalletHub::BbsReceiver::OnMsg(proto::BbsMsg&& msg)
+    {
+        WalletHub& hub = get_ParentObj();
+
+        auto it = hub.m_BbsSubscriptions.find(msg.m_Channel);
+        if (hub.m_BbsSubscriptions.end() == it)
+            return;
+
+        vector<IBbsReceiver*> v;
+        v.reserve(it->second.size());
+        for (const auto& x : it->second)
+            v.push_back(x.first);
+
+        for (IBbsReceiver* p : v)
+        {
+            proto::BbsMsg msgCopy = msg;
+            p->OnMsg(std::move(msgCopy));
+        }
+    }
+}
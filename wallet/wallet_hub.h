@@ -0,0 +1,136 @@
+// Copyright 2018 The Beam Team
+// Copyright 2019 - 2022 The LiteCash Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "wallet.h"
+#include "utility/io/timer.h"
+#include <chrono>
+
+namespace beam
+{
+    // Serves many wallets from one process. Each wallet is a separate WalletDB (<dir>/<name>.db), opened on demand
+    // and closed once it's idle for a while. All of them share a single node connection and the header history.
+    //
+    // The node reports utxo events to the owner only, i.e. to the wallets of the seed which key the node is owned by.
+    // Such wallets are given a single events request per height, each one keeps the events its key derives.
+    // The rest of the wallets work as with a non-owned node, polling the proofs of the coins they expect.
+    class WalletHub
+        : private proto::FlyClient
+    {
+    public:
+        struct Config
+        {
+            std::string m_Dir;
+            std::string m_Owner; // the wallet which key is used to log in to the owned node, optional
+            uint32_t m_IdleTimeout_s = 600;
+        };
+
+        struct HostedWallet
+        {
+            typedef std::shared_ptr<HostedWallet> Ptr;
+
+            std::string m_Name;
+            IWalletDB::Ptr m_WalletDB;
+            std::shared_ptr<Wallet> m_Wallet;
+            bool m_Owned = false; // same key as the owner wallet
+            bool m_RollbackChecked = false; // its stored state is verified against the shared history
+            std::chrono::steady_clock::time_point m_LastUsed;
+        };
+
+        WalletHub(const Config&, SecString&& pass, io::Reactor::Ptr reactor);
+        ~WalletHub();
+
+        // node addresses should be set before Connect()
+        proto::FlyClient::NetworkStd& get_Network() { return *m_Network; }
+        Block::SystemState::IHistory& get_SharedHistory() { return m_History; }
+
+        // opens the wallet if it's not loaded yet. Returns nullptr if there's no such wallet, or it can't be opened.
+        // The wallet isn't evicted while referenced.
+        HostedWallet::Ptr GetWallet(const std::string& name);
+
+        size_t get_LoadedCount() const { return m_Wallets.size(); }
+
+        // node endpoint over the shared connection, as the hosted wallets have. The bbs subscriptions are dropped with it
+        std::shared_ptr<proto::FlyClient::INetwork> CreateEndpoint();
+
+        // <dir>/<name><ext>, the wallet db and its accompanying files
+        std::string get_Path(const std::string& name, const char* szExt) const;
+
+        static bool IsValidName(const std::string&);
+
+    private:
+        class Endpoint;
+        class MyWallet;
+
+        // FlyClient
+        void OnNewTip() override;
+        void OnTipUnchanged() override;
+        void OnRolledBack() override;
+        void get_Kdf(Key::IKdf::Ptr&) override;
+        Block::SystemState::IHistory& get_History() override { return m_History; }
+        void OnOwnedNode(const PeerID&, bool bUp) override;
+
+        void PostRequest(Request&);
+        void PostUtxoEvents(RequestUtxoEvents&);
+        void OnUtxoEvents(RequestUtxoEvents&);
+
+        struct UtxoEventsHandler
+            : public Request::IHandler
+        {
+            void OnComplete(Request&) override;
+            IMPLEMENT_GET_PARENT_OBJ(WalletHub, m_UtxoEventsHandler)
+        } m_UtxoEventsHandler;
+
+        // The node connection keeps a single receiver per bbs channel, the hub dispatches the messages to all the subscribed wallets
+        struct BbsReceiver
+            : public IBbsReceiver
+        {
+            void OnMsg(proto::BbsMsg&&) override;
+            IMPLEMENT_GET_PARENT_OBJ(WalletHub, m_BbsReceiver)
+        } m_BbsReceiver;
+
+        void BbsSubscribe(BbsChannel, Timestamp, IBbsReceiver*);
+        void BbsUnsubscribe(BbsChannel, IBbsReceiver*);
+
+        std::vector<HostedWallet::Ptr> get_Wallets() const;
+        HostedWallet::Ptr LoadWallet(const std::string& name);
+        void CheckRollback(HostedWallet&);
+        void OnTimer();
+
+        Config m_Cfg;
+        SecString m_Pass;
+        io::Reactor::Ptr m_Reactor;
+
+        Block::SystemState::HistoryMap m_History;
+        std::shared_ptr<proto::FlyClient::NetworkStd> m_Network;
+
+        Key::IKdf::Ptr m_pOwnerKdf;
+        std::set<PeerID> m_OwnedNodes;
+
+        // pending events requests by their start height, with the wallet requests waiting for each
+        struct UtxoEventsWaiters
+        {
+            RequestUtxoEvents::Ptr m_pReq;
+            std::vector<RequestUtxoEvents::Ptr> m_vWaiting;
+        };
+        std::map<Height, UtxoEventsWaiters> m_UtxoEvents;
+
+        std::map<BbsChannel, std::map<IBbsReceiver*, Timestamp> > m_BbsSubscriptions;
+
+        std::map<std::string, HostedWallet::Ptr> m_Wallets;
+        io::Timer::Ptr m_pTimer;
+    };
+}
@@ -25,6 +25,7 @@
 #include <boost/uuid/uuid_generators.hpp>
 #include <numeric>
 #include "utility/logger.h"
+#include "utility/parallel.h"
 
 namespace beam { namespace wallet
 {
@@ -239,6 +240,11 @@ namespace beam { namespace wallet
         m_Gateway.UpdateOnNextTip(GetTxID());
     }
 
+    void BaseTransaction::UpdateOnHeight(Height h)
+    {
+        m_Gateway.UpdateOnHeight(GetTxID(), h);
+    }
+
     void BaseTransaction::CompleteTx()
     {
         LOG_INFO() << GetTxID() << " Transaction completed";
@@ -430,7 +436,13 @@ namespace beam { namespace wallet
                     SendInvitation(builder, isSender);
                     SetState(State::Invitation);
                 }
-                UpdateOnNextTip();
+
+                // the peer's response triggers the update by itself, otherwise there's nothing to do until the tx expires
+                Height maxHeight = MaxHeight;
+                if (GetParameter(TxParameterID::MaxHeight, maxHeight) || GetParameter(TxParameterID::PeerResponseHeight, maxHeight))
+                    UpdateOnHeight((maxHeight < MaxHeight) ? (maxHeight + 1) : MaxHeight);
+                else
+                    UpdateOnNextTip();
                 return;
             }
 
@@ -822,20 +834,38 @@ namespace beam { namespace wallet
         m_Tx.GetWalletDB()->store(newUtxo);
     }
 
-    void TxBuilder::CreateOutputs()
+    void CreateOutputs(vector<Output::Ptr>& vOutputs, Scalar::Native& offset, const vector<Coin>& coins, const IWalletDB& walletDB, uint32_t nThreads)
     {
-        for (const auto& utxo : m_Coins)
+        size_t nCount = coins.size();
+        if (!nCount)
+            return;
+
+        // each output goes to its own slot, the range proof (the dominant part) uses the MultiMac scratch on the creating thread's stack
+        vector<Output::Ptr> vRes(nCount);
+        vector<Scalar::Native> vBlinding(nCount);
+        Key::IKdf::Ptr pMaster = walletDB.get_MasterKdf();
+
+        ParallelFor(nCount, [&](size_t i)
         {
-            Scalar::Native blindingFactor;
-            Output::Ptr output = make_unique<Output>();
-            output->Create(blindingFactor, *m_Tx.GetWalletDB()->get_ChildKdf(utxo.m_ID.m_SubIdx), utxo.m_ID, *m_Tx.GetWalletDB()->get_MasterKdf());
+            const Coin& utxo = coins[i];
+            vRes[i] = make_unique<Output>();
+            vRes[i]->Create(vBlinding[i], *walletDB.get_ChildKdf(utxo.m_ID.m_SubIdx), utxo.m_ID, *pMaster);
+        }, nThreads);
 
-            blindingFactor = -blindingFactor;
-            m_Offset += blindingFactor;
-            m_Outputs.emplace_back(move(output));
+        vOutputs.reserve(vOutputs.size() + nCount);
+        for (size_t i = 0; i < nCount; i++)
+        {
+            vBlinding[i] = -vBlinding[i];
+            offset += vBlinding[i];
+            vOutputs.push_back(move(vRes[i]));
         }
     }
 
+    void TxBuilder::CreateOutputs()
+    {
+        wallet::CreateOutputs(m_Outputs, m_Offset, m_Coins, *m_Tx.GetWalletDB());
+    }
+
     void TxBuilder::AddOutput(Amount amount, bool bChange)
     {
         m_Outputs.push_back(CreateOutput(amount, bChange));
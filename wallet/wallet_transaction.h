@@ -40,6 +40,11 @@ namespace beam { namespace wallet
 
     std::string GetFailureMessage(TxFailureReason reason);
 
+    // Creates the outputs (with the range proofs) for the given coins, the work is spread over nThreads (0 - all the cores) of the shared pool.
+    // An exception on any thread is rethrown here.
+    // The result doesn't depend on the threads: the outputs are in the coins order, the blinding factors are subtracted from the offset.
+    void CreateOutputs(std::vector<Output::Ptr>& vOutputs, ECC::Scalar::Native& offset, const std::vector<Coin>& coins, const IWalletDB& walletDB, uint32_t nThreads = 0);
+
     class TransactionFailedException : public std::runtime_error
     {
     public:
@@ -115,6 +120,7 @@ namespace beam { namespace wallet
         bool CheckExternalFailures();
         void ConfirmKernel(const Merkle::Hash& kernelID);
         void UpdateOnNextTip();
+        void UpdateOnHeight(Height h);
         void CompleteTx();
         void RollbackTx();
 		void NotifyFailure(TxFailureReason);